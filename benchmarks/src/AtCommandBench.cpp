@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.AtCommandChannel.hpp>
+
+#include "FakeModem.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using namespace Win32::Devices;
+
+namespace bench
+{
+	///	One command at a time, waiting on each future.
+	void BM_AtSequential(benchmark::State& state)
+	{
+		tests::FakeModem modem;
+		modem.Script("AT+CSQ", "\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		std::vector<double> latencies;
+		latencies.reserve(1u << 16);
+		for (auto _ : state)
+		{
+			auto start = std::chrono::steady_clock::now();
+			AtResponse response = channel.Send("AT+CSQ").get();
+			auto elapsed = std::chrono::steady_clock::now() - start;
+
+			if (!response.Ok()) state.SkipWithError("command failed");
+			latencies.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+		}
+
+		std::sort(latencies.begin(), latencies.end());
+		state.counters["commands_per_s"] = benchmark::Counter((double)state.iterations(), benchmark::Counter::kIsRate);
+		state.counters["p50_us"] = latencies[latencies.size() / 2];
+		state.counters["p99_us"] = latencies[latencies.size() * 99 / 100];
+	}
+	BENCHMARK(BM_AtSequential)->UseRealTime();
+
+
+	///	Batches queued at once; each command is written as soon as the
+	///		previous one's result arrives.
+	void BM_AtPipelined(benchmark::State& state)
+	{
+		tests::FakeModem modem;
+		modem.Script("AT+CSQ", "\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		const size_t batch = (size_t)state.range(0);
+		std::vector<std::future<AtResponse>> futures;
+		futures.reserve(batch);
+		for (auto _ : state)
+		{
+			futures.clear();
+			for (size_t i = 0; i < batch; i++) futures.push_back(channel.Send("AT+CSQ"));
+			for (auto& future : futures)
+			{
+				if (!future.get().Ok()) state.SkipWithError("command failed");
+			}
+		}
+		state.counters["commands_per_s"] = benchmark::Counter((double)(state.iterations() * batch), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_AtPipelined)->Arg(8)->Arg(64)->UseRealTime();
+}
@@ -0,0 +1,96 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.ModbusMaster.hpp>
+#include <Win32.Devices.SerialCrc.hpp>
+
+#include "ModbusSlaves.hpp"
+
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace bench
+{
+	constexpr uint8_t BusSlaves = 30;
+	constexpr uint16_t BlocksPerSlave = 4;
+	constexpr uint16_t BlockSize = 6;
+
+
+	void BM_Crc16ModbusTable(benchmark::State& state)
+	{
+		std::vector<uint8_t> frame(256, 0x5A);
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(Crc16Modbus(frame.data(), frame.size()));
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)frame.size());
+	}
+	BENCHMARK(BM_Crc16ModbusTable);
+
+
+	void BM_Crc16ModbusBitwise(benchmark::State& state)
+	{
+		std::vector<uint8_t> frame(256, 0x5A);
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(tests::BitwiseCrc16Modbus(frame.data(), frame.size()));
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)frame.size());
+	}
+	BENCHMARK(BM_Crc16ModbusBitwise);
+
+
+	///	One sweep of 30 slaves at 115200 baud, each with four adjacent
+	///		blocks of registers: read block by block as hand-written code
+	///		does, or merged by the master's watches into a read per slave.
+	///		The simulated slaves hold each answer for its wire time.
+	void BM_BusSweep(benchmark::State& state)
+	{
+		const bool merged = state.range(0) != 0;
+
+		tests::PtyPair pty;
+		pty.device.BaudRate(115200);
+		tests::ModbusSlaves slaves(pty.master);
+		slaves.paceBaud = 115200;
+		for (uint8_t slave = 1; slave <= BusSlaves; slave++) slaves.Add(slave);
+		slaves.Start();
+
+		ModbusMaster master(pty.device);
+		if (merged)
+		{
+			for (uint8_t slave = 1; slave <= BusSlaves; slave++)
+			{
+				for (uint16_t block = 0; block < BlocksPerSlave; block++)
+				{
+					master.Watch(slave, ModbusTable::Holding, (uint16_t)(block * BlockSize), BlockSize);
+				}
+			}
+		}
+
+		uint64_t blocks = 0;
+		for (auto _ : state)
+		{
+			if (merged)
+			{
+				for (size_t i = 0; i < master.Requests(); i++) master.PollOnce();
+			}
+			else
+			{
+				for (uint8_t slave = 1; slave <= BusSlaves; slave++)
+				{
+					for (uint16_t block = 0; block < BlocksPerSlave; block++)
+					{
+						master.ReadRegisters(slave, ModbusTable::Holding, (uint16_t)(block * BlockSize), BlockSize);
+					}
+				}
+			}
+			blocks += BusSlaves * BlocksPerSlave;
+		}
+
+		ModbusStats stats = master.Stats();
+		state.counters["blocks/s"] = benchmark::Counter((double)blocks, benchmark::Counter::kIsRate);
+		state.counters["polls/s"] = stats.PollsPerSecond();
+		state.counters["utilisation"] = stats.Utilisation();
+	}
+	BENCHMARK(BM_BusSweep)->ArgName("merged")->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+}
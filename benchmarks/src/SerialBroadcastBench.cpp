@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialDevice.hpp>
+
+#include "PtyPair.hpp"
+
+#include <atomic>
+#include <thread>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace bench
+{
+	std::atomic<size_t> fast_bytes = { 0 };
+
+	void CountFast(std::string_view rx_data)
+	{
+		fast_bytes.fetch_add(rx_data.size(), std::memory_order_release);
+	}
+
+
+	///	A consumer falling behind, i.e. one writing to a slow disk.
+	void Dawdle(std::string_view)
+	{
+		std::this_thread::sleep_for(2ms);
+	}
+
+
+	///	Bytes the fast consumer sees per second while the slow one shares
+	///		the port: both as ReceivedView handlers on the RX thread, or
+	///		as broadcast subscribers on threads of their own.
+	void BM_FastConsumer(benchmark::State& state)
+	{
+		const bool broadcast = state.range(0) != 0;
+
+		tests::PtyPair pty;
+		if (broadcast)
+		{
+			pty.device.Broadcast().Subscribe(OnBroadcast(CountFast));
+			pty.device.Broadcast().Subscribe(OnBroadcast(Dawdle));
+		}
+		else
+		{
+			pty.device.RxDelivery(SerialRxDelivery::Views);
+			pty.device.ReceivedView += CountFast;
+			pty.device.ReceivedView += Dawdle;
+		}
+		pty.device.UsingEvents(true);
+		fast_bytes = 0;
+
+		const std::string chunk(4096, 'B');
+		size_t expected = 0;
+		for (auto _ : state)
+		{
+			pty.WriteMaster(chunk);
+			expected += chunk.size();
+			while (fast_bytes.load(std::memory_order_acquire) < expected)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		state.SetBytesProcessed((int64_t)expected);
+		pty.device.Close();
+	}
+	BENCHMARK(BM_FastConsumer)->ArgName("broadcast")->Arg(0)->Arg(1)->UseRealTime();
+
+
+	///	Publishing into the ring alone, against a number of subscribers.
+	void BM_Publish(benchmark::State& state)
+	{
+		SerialBroadcast broadcast;
+		for (int64_t i = 0; i < state.range(0); i++)
+		{
+			broadcast.Subscribe(OnBroadcast(CountFast));
+		}
+
+		const std::string chunk(SerialBroadcastChunk, 'P');
+		size_t published = 0;
+		for (auto _ : state)
+		{
+			published += broadcast.Publish(chunk.data(), chunk.size());
+		}
+		state.SetBytesProcessed((int64_t)published);
+	}
+	BENCHMARK(BM_Publish)->ArgName("subscribers")->Arg(1)->Arg(4)->Arg(8)->UseRealTime();
+}
@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialCoroutine.hpp>
+
+#include <pty.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace bench
+{
+	///	Exchanges per session per iteration.
+	constexpr int SessionExchanges = 10;
+
+
+	///	Ptys whose master sides answer every "\r" with "OK\r\n", from one
+	///		thread, standing in for a rack of modems.
+	struct ModemRack
+	{
+		explicit ModemRack(size_t count)
+		{
+			m_epoll = epoll_create1(EPOLL_CLOEXEC);
+			for (size_t i = 0; i < count; i++)
+			{
+				char name[128] = { 0 };
+				int master = -1, slave = -1;
+				if (openpty(&master, &slave, name, nullptr, nullptr) != 0) break;
+
+				devices.emplace_back(new SerialDevice(SerialDevice::FromPath(name)));
+				close(slave);
+
+				epoll_event event = { 0 };
+				event.events = EPOLLIN;
+				event.data.fd = master;
+				epoll_ctl(m_epoll, EPOLL_CTL_ADD, master, &event);
+				m_masters.push_back(master);
+			}
+			m_thread = std::thread([this] { answer(); });
+		}
+
+		~ModemRack()
+		{
+			m_running = false;
+			m_thread.join();
+			devices.clear();
+			for (int master : m_masters) close(master);
+			close(m_epoll);
+		}
+
+		std::vector<std::unique_ptr<SerialDevice>> devices;
+
+	private:
+		void answer()
+		{
+			epoll_event events[64];
+			char buf[256];
+			while (m_running)
+			{
+				int ready = epoll_wait(m_epoll, events, 64, 10);
+				for (int i = 0; i < ready; i++)
+				{
+					ssize_t len = read(events[i].data.fd, buf, sizeof(buf));
+					for (ssize_t at = 0; at < len; at++)
+					{
+						if (buf[at] == '\r' && write(events[i].data.fd, "OK\r\n", 4) != 4) break;
+					}
+				}
+			}
+		}
+
+		int m_epoll = -1;
+		std::vector<int> m_masters;
+		std::thread m_thread;
+		std::atomic<bool> m_running = { true };
+	};
+
+
+	///	The rack shared by the benchmarks, opened once.
+	ModemRack& Rack()
+	{
+		static ModemRack rack(1000);
+		return rack;
+	}
+
+
+	SerialTask<> Session(SerialDevice& device)
+	{
+		std::string line;
+		for (int i = 0; i < SessionExchanges; i++)
+		{
+			co_await WriteAsync(device, "AT\r");
+			if (!co_await ReadUntilAsync(device, line, "\r\n", 2000ms)) co_return;
+		}
+	}
+
+
+	///	A coroutine per session, all on one thread.
+	void BM_CoroutineSessions(benchmark::State& state)
+	{
+		ModemRack& rack = Rack();
+		const size_t sessions = (size_t)state.range(0);
+		for (auto _ : state)
+		{
+			SerialExecutor executor;
+			for (size_t i = 0; i < sessions; i++) Spawn(executor, Session(*rack.devices[i]));
+			executor.Run();
+		}
+		state.SetItemsProcessed(state.iterations() * sessions * SessionExchanges);
+	}
+	BENCHMARK(BM_CoroutineSessions)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+	///	A thread per session, blocking in the synchronous calls.
+	void BM_ThreadSessions(benchmark::State& state)
+	{
+		ModemRack& rack = Rack();
+		const size_t sessions = (size_t)state.range(0);
+		for (auto _ : state)
+		{
+			std::vector<std::thread> threads;
+			for (size_t i = 0; i < sessions; i++)
+			{
+				threads.emplace_back([&device = *rack.devices[i]] {
+					std::string line;
+					for (int i = 0; i < SessionExchanges; i++)
+					{
+						device.Write(std::string("AT\r"));
+						if (!device.ReadUntil(line, "\r\n", 2000ms)) return;
+					}
+				});
+			}
+			for (std::thread& thread : threads) thread.join();
+		}
+		state.SetItemsProcessed(state.iterations() * sessions * SessionExchanges);
+	}
+	BENCHMARK(BM_ThreadSessions)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
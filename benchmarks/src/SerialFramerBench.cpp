@@ -0,0 +1,156 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialFramer.hpp>
+
+#include <random>
+#include <string>
+
+using namespace Win32::Devices;
+
+constexpr size_t BenchStreamSize = 10u << 20;
+constexpr size_t BenchSliceSize = 4096;
+
+namespace bench
+{
+	///	Lines of random printable text ending in "\r\n", as from a modem.
+	std::string MakeLines(size_t frameSize)
+	{
+		std::mt19937 rng(7);
+		std::string stream;
+		stream.reserve(BenchStreamSize + frameSize);
+		while (stream.size() < BenchStreamSize)
+		{
+			size_t length = 1 + rng() % (2 * frameSize);
+			for (size_t i = 0; i < length; i++) stream += (char)(' ' + rng() % 94);
+			stream += "\r\n";
+		}
+		return stream;
+	}
+
+
+	///	SLIP frames of random bytes, escaped.
+	std::string MakeSlip(size_t frameSize)
+	{
+		std::mt19937 rng(7);
+		std::string stream;
+		stream.reserve(BenchStreamSize + 2 * frameSize);
+		while (stream.size() < BenchStreamSize)
+		{
+			for (size_t i = 0; i < frameSize; i++)
+			{
+				uint8_t octet = (uint8_t)rng();
+				if (octet == 0xC0) stream += "\xDB\xDC";
+				else if (octet == 0xDB) stream += "\xDB\xDD";
+				else stream += (char)octet;
+			}
+			stream += '\xC0';
+		}
+		return stream;
+	}
+
+
+	///	Feed the stream through the framer in ring-sized slices.
+	void run_framer(benchmark::State& state, SerialFramer& framer, const std::string& stream)
+	{
+		size_t frames = 0;
+		for (auto _ : state)
+		{
+			for (size_t at = 0; at < stream.size(); at += BenchSliceSize)
+			{
+				framer.Feed(std::string_view(stream).substr(at, BenchSliceSize),
+					[&](std::string_view frame) { frames++; benchmark::DoNotOptimize(frame.data()); });
+			}
+		}
+		state.SetBytesProcessed((int64_t)(state.iterations() * stream.size()));
+		state.counters["frames_per_s"] = benchmark::Counter((double)frames, benchmark::Counter::kIsRate);
+	}
+
+
+	///	What a $ReceivedData subscriber does by hand: append each burst and
+	///		search the accumulated string for the delimiter.
+	void BM_LinesAccumulate(benchmark::State& state)
+	{
+		const std::string stream = MakeLines((size_t)state.range(0));
+		size_t frames = 0;
+		for (auto _ : state)
+		{
+			std::string pending;
+			for (size_t at = 0; at < stream.size(); at += BenchSliceSize)
+			{
+				pending += stream.substr(at, BenchSliceSize);
+
+				size_t end;
+				while ((end = pending.find("\r\n")) != std::string::npos)
+				{
+					std::string frame = pending.substr(0, end);
+					benchmark::DoNotOptimize(frame.data());
+					pending.erase(0, end + 2);
+					frames++;
+				}
+			}
+		}
+		state.SetBytesProcessed((int64_t)(state.iterations() * stream.size()));
+		state.counters["frames_per_s"] = benchmark::Counter((double)frames, benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_LinesAccumulate)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+
+	void BM_DelimiterFramer(benchmark::State& state)
+	{
+		DelimiterFramer framer("\r\n");
+		run_framer(state, framer, MakeLines((size_t)state.range(0)));
+	}
+	BENCHMARK(BM_DelimiterFramer)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+
+	void BM_FixedLengthFramer(benchmark::State& state)
+	{
+		FixedLengthFramer framer((size_t)state.range(0));
+		run_framer(state, framer, std::string(BenchStreamSize, 'U'));
+	}
+	BENCHMARK(BM_FixedLengthFramer)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+
+	void BM_LengthPrefixFramer(benchmark::State& state)
+	{
+		const size_t frameSize = (size_t)state.range(0);
+		std::string stream;
+		stream.reserve(BenchStreamSize + frameSize);
+		while (stream.size() < BenchStreamSize)
+		{
+			stream += (char)(frameSize >> 8);
+			stream += (char)(frameSize & 0xFF);
+			stream.append(frameSize, 'U');
+		}
+
+		LengthPrefixFramer framer(2, true);
+		run_framer(state, framer, stream);
+	}
+	BENCHMARK(BM_LengthPrefixFramer)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+
+	void BM_SlipFramer(benchmark::State& state)
+	{
+		SlipFramer framer;
+		run_framer(state, framer, MakeSlip((size_t)state.range(0)));
+	}
+	BENCHMARK(BM_SlipFramer)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+
+	void BM_CobsFramer(benchmark::State& state)
+	{
+		//	one code byte per run of up to 254 non-zero bytes
+		const size_t frameSize = (size_t)state.range(0);
+		std::string stream;
+		stream.reserve(BenchStreamSize + frameSize + 2);
+		while (stream.size() < BenchStreamSize)
+		{
+			stream += (char)(frameSize + 1);
+			stream.append(frameSize, 'U');
+			stream += '\0';
+		}
+
+		CobsFramer framer;
+		run_framer(state, framer, stream);
+	}
+	BENCHMARK(BM_CobsFramer)->Arg(16)->Arg(254)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialPorts.hpp>
+
+#include <pty.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+using namespace Win32::Devices;
+
+namespace bench
+{
+	///	Ports of a simulated multi-port host.
+	constexpr int HostPorts = 256;
+
+
+	///	The slave paths of $HostPorts ptys, held open from the master side.
+	struct PtyHost
+	{
+		PtyHost()
+		{
+			for (int i = 0; i < HostPorts; i++)
+			{
+				char name[128] = { 0 };
+				int master = -1, slave = -1;
+				if (openpty(&master, &slave, name, nullptr, nullptr) != 0) break;
+				close(slave);
+				masters.push_back(master);
+				paths.push_back(name);
+			}
+		}
+
+		~PtyHost()
+		{
+			for (int master : masters) close(master);
+		}
+
+		std::vector<int> masters;
+		std::vector<std::string> paths;
+	};
+
+
+	SerialSettings HostSettings()
+	{
+		SerialSettings settings;
+		settings.baudRate = 115200;
+		return settings;
+	}
+
+
+	///	Bringing up every port in turn.
+	void BM_OpenSerially(benchmark::State& state)
+	{
+		PtyHost host;
+		const SerialSettings settings = HostSettings();
+		for (auto _ : state)
+		{
+			std::vector<SerialDevice> devices;
+			devices.reserve(host.paths.size());
+			for (const std::string& path : host.paths)
+			{
+				devices.push_back(SerialDevice::FromPath(path));
+				devices.back().Configure(settings);
+			}
+			benchmark::DoNotOptimize(devices.data());
+		}
+		state.counters["ports"] = (double)host.paths.size();
+	}
+	BENCHMARK(BM_OpenSerially)->Unit(benchmark::kMillisecond);
+
+
+	///	Bringing up every port with SerialPorts::Open.
+	void BM_OpenBulk(benchmark::State& state)
+	{
+		PtyHost host;
+		const SerialSettings settings = HostSettings();
+		for (auto _ : state)
+		{
+			std::vector<SerialOpenResult> results = SerialPorts::Open(host.paths, settings, (size_t)state.range(0));
+			benchmark::DoNotOptimize(results.data());
+		}
+		state.counters["ports"] = (double)host.paths.size();
+	}
+	BENCHMARK(BM_OpenBulk)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond);
+
+
+	///	Enumerating the ports of this machine.
+	void BM_Enumerate(benchmark::State& state)
+	{
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(SerialPorts::Enumerate());
+		}
+	}
+	BENCHMARK(BM_Enumerate)->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialReactor.hpp>
+
+#include "PtyPair.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+constexpr int BenchPorts = 256;
+constexpr size_t BenchMessageSize = 64;
+
+namespace bench
+{
+	std::atomic<size_t> rx_bytes = { 0 };
+	std::atomic<size_t> rx_samples = { 0 };
+	std::vector<int64_t> rx_latency_ns(1u << 20);
+
+	int64_t now_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	///	Each message leads with its send time, so the callback measures
+	///		RX-arrival-to-callback latency per device.
+	void TimeRxData(std::string rx_data)
+	{
+		if (rx_data.size() >= sizeof(int64_t))
+		{
+			int64_t sent;
+			std::memcpy(&sent, rx_data.data(), sizeof(sent));
+			size_t slot = rx_samples++;
+			if (slot < rx_latency_ns.size()) rx_latency_ns[slot] = now_ns() - sent;
+		}
+		rx_bytes += rx_data.size();
+	}
+
+
+	///	Push one message through every port per iteration, reporting the
+	///		aggregate rate and the p99 callback latency.
+	void run_rounds(benchmark::State& state, std::vector<std::unique_ptr<tests::PtyPair>>& ports)
+	{
+		std::string message(BenchMessageSize, 'U');
+		size_t expected = 0;
+		rx_bytes = 0;
+		rx_samples = 0;
+
+		for (auto _ : state)
+		{
+			expected += ports.size() * message.size();
+			for (auto& port : ports)
+			{
+				int64_t sent = now_ns();
+				std::memcpy(&message[0], &sent, sizeof(sent));
+				port->WriteMaster(message);
+			}
+			while (rx_bytes.load(std::memory_order_acquire) < expected)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		size_t samples = std::min(rx_samples.load(), rx_latency_ns.size());
+		std::sort(rx_latency_ns.begin(), rx_latency_ns.begin() + samples);
+
+		state.SetBytesProcessed((int64_t)rx_bytes.load());
+		state.counters["p99_callback_us"] = samples ? rx_latency_ns[samples * 99 / 100] / 1000.0 : 0.0;
+	}
+
+
+	void BM_ThreadPerDevice(benchmark::State& state)
+	{
+		std::vector<std::unique_ptr<tests::PtyPair>> ports;
+		for (int i = 0; i < BenchPorts; i++)
+		{
+			ports.emplace_back(new tests::PtyPair());
+			ports.back()->device.ReceivedData += TimeRxData;
+			ports.back()->device.UsingEvents(true);
+		}
+
+		run_rounds(state, ports);
+
+		//	let every poll period lapse together before joining
+		for (auto& port : ports) port->device.Defer(0ms);
+	}
+	BENCHMARK(BM_ThreadPerDevice)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+
+	void BM_Reactor(benchmark::State& state)
+	{
+		SerialReactor reactor((unsigned)state.range(0));
+		std::vector<std::unique_ptr<tests::PtyPair>> ports;
+		for (int i = 0; i < BenchPorts; i++)
+		{
+			ports.emplace_back(new tests::PtyPair());
+			ports.back()->device.ReceivedData += TimeRxData;
+			reactor.Attach(ports.back()->device);
+		}
+
+		run_rounds(state, ports);
+	}
+	BENCHMARK(BM_Reactor)->Arg(1)->Arg(2)->Arg(4)->UseRealTime()->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialDevice.hpp>
+
+#include "PtyPair.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+///	Bytes per second on a 115200 baud 8N1 line.
+constexpr double LineRate = 115200.0 / 10.0;
+
+namespace bench
+{
+	std::atomic<size_t> replayed_bytes = { 0 };
+
+	void CountReplayed(std::string_view rx_data)
+	{
+		replayed_bytes.fetch_add(rx_data.size(), std::memory_order_release);
+	}
+
+
+	///	A capture of 64-byte reads about as fast as the line carries them,
+	///		recorded once for every run.
+	const std::string& CapturePath()
+	{
+		static const std::string path = []
+		{
+			std::string capture = (std::filesystem::temp_directory_path() / "serial-replay-bench.cap").string();
+			SerialRecorder recorder(capture);
+			const std::string read(64, 'R');
+			for (int i = 0; i < 50; i++)
+			{
+				recorder.Append(SerialCaptureDirection::Rx, read.data(), read.size());
+				std::this_thread::sleep_for(std::chrono::duration<double>(read.size() / LineRate));
+			}
+			return capture;
+		}();
+		return path;
+	}
+
+
+	///	Replay the capture into a pty, into a view consumer, at a multiple
+	///		of the original pace or, for 0, as fast as possible.
+	void BM_Replay(benchmark::State& state)
+	{
+		SerialCapture capture(CapturePath());
+		const double speed = (double)state.range(0);
+
+		tests::PtyPair pty;
+		pty.device.RxDelivery(SerialRxDelivery::Views);
+		pty.device.ReceivedView += CountReplayed;
+		pty.device.UsingEvents(true);
+		replayed_bytes = 0;
+
+		size_t expected = 0;
+		auto started = std::chrono::steady_clock::now();
+		for (auto _ : state)
+		{
+			expected += ReplayCapture(capture, [&](const void* data, size_t len) {
+				pty.WriteMaster(std::string((const char*)data, len));
+			}, speed);
+			while (replayed_bytes.load(std::memory_order_acquire) < expected)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+		state.SetBytesProcessed((int64_t)expected);
+		state.counters["x_line_rate"] = (double)expected / elapsed.count() / LineRate;
+	}
+	BENCHMARK(BM_Replay)->ArgName("speed")->Arg(1)->Arg(50)->Arg(0)->UseRealTime();
+
+
+	///	Walking the mapped capture alone.
+	void BM_CaptureScan(benchmark::State& state)
+	{
+		SerialCapture capture(CapturePath());
+		for (auto _ : state)
+		{
+			size_t bytes = 0;
+			for (const SerialCapture::Record& record : capture) bytes += record.data.size();
+			benchmark::DoNotOptimize(bytes);
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)capture.Length());
+	}
+	BENCHMARK(BM_CaptureScan);
+
+
+	///	Recording cost per 64-byte read.
+	void BM_Record(benchmark::State& state)
+	{
+		std::string path = (std::filesystem::temp_directory_path() / "serial-record-bench.cap").string();
+		{
+			SerialRecorder recorder(path);
+			const std::string read(64, 'R');
+			for (auto _ : state)
+			{
+				recorder.Append(SerialCaptureDirection::Rx, read.data(), read.size());
+			}
+			state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)read.size());
+		}
+		std::remove(path.c_str());
+	}
+	BENCHMARK(BM_Record);
+}
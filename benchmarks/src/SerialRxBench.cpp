@@ -0,0 +1,118 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialReactor.hpp>
+
+#include "PtyPair.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+constexpr size_t BenchBurstSize = 256;
+
+///	Count every global allocation made by the process.
+static std::atomic<size_t> heap_allocations = { 0 };
+
+void* operator new(size_t size)
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+
+namespace bench
+{
+	std::atomic<size_t> rx_bytes = { 0 };
+
+	void CountRxData(std::string rx_data)
+	{
+		rx_bytes.fetch_add(rx_data.size(), std::memory_order_release);
+	}
+
+	void CountRxView(std::string_view rx_data)
+	{
+		rx_bytes.fetch_add(rx_data.size(), std::memory_order_release);
+	}
+
+
+	///	Push bursts through a pty into the reactor and count the heap
+	///		allocations made per burst on the receive path.
+	void run_bursts(benchmark::State& state, SerialRxDelivery delivery)
+	{
+		SerialReactor reactor;
+		tests::PtyPair pty;
+		pty.device.RxDelivery(delivery);
+		pty.device.ReceivedData += CountRxData;
+		pty.device.ReceivedView += CountRxView;
+		reactor.Attach(pty.device);
+
+		const std::string burst(BenchBurstSize, 'U');
+		size_t expected = 0;
+		rx_bytes = 0;
+
+		size_t allocations = heap_allocations.load();
+		for (auto _ : state)
+		{
+			expected += burst.size();
+			pty.WriteMaster(burst);
+			while (rx_bytes.load(std::memory_order_acquire) < expected)
+			{
+				std::this_thread::yield();
+			}
+		}
+		allocations = heap_allocations.load() - allocations;
+
+		state.SetBytesProcessed((int64_t)rx_bytes.load());
+		state.counters["allocs_per_burst"] = benchmark::Counter((double)allocations / state.iterations());
+	}
+
+
+	void BM_RxStrings(benchmark::State& state)
+	{
+		run_bursts(state, SerialRxDelivery::Strings);
+	}
+	BENCHMARK(BM_RxStrings)->UseRealTime();
+
+
+	void BM_RxViews(benchmark::State& state)
+	{
+		run_bursts(state, SerialRxDelivery::Views);
+	}
+	BENCHMARK(BM_RxViews)->UseRealTime();
+
+
+	///	The ring alone: copy bursts in and slice them out.
+	void BM_RingBuffer(benchmark::State& state)
+	{
+		SerialRingBuffer ring(SerialRxRingSize);
+		const std::string burst((size_t)state.range(0), 'U');
+
+		for (auto _ : state)
+		{
+			ring.Write(burst.data(), burst.size());
+
+			size_t span = 0;
+			const uint8_t* slice;
+			while ((slice = ring.Peek(span)), span)
+			{
+				benchmark::DoNotOptimize(slice);
+				ring.Consume(span);
+			}
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_RingBuffer)->Arg(16)->Arg(256)->Arg(4096);
+}
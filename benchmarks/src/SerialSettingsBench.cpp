@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialDevice.hpp>
+
+#include "PtyPair.hpp"
+
+using namespace Win32::Devices;
+
+namespace bench
+{
+	///	Two line setups to alternate between, so every change reaches the
+	///		port.
+	SerialSettings Setup(bool alternate)
+	{
+		SerialSettings settings;
+		settings.baudRate = alternate ? 57600 : 115200;
+		settings.stopBits = alternate ? SerialStopBits::StopBits_2 : SerialStopBits::StopBits_1;
+		settings.parity = alternate ? SerialParity::Even : SerialParity::None;
+		return settings;
+	}
+
+
+	///	Bringing up a port one setter at a time, each a round trip.
+	void BM_Setters(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		bool alternate = false;
+		for (auto _ : state)
+		{
+			alternate = !alternate;
+			SerialSettings settings = Setup(alternate);
+			pty.device.BaudRate(settings.baudRate);
+			pty.device.StopBits(alternate ? 2 : 1);
+			pty.device.ByteSize(settings.byteSize);
+		}
+	}
+	BENCHMARK(BM_Setters);
+
+
+	///	Bringing up a port with every setting in one call.
+	void BM_Configure(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		bool alternate = false;
+		for (auto _ : state)
+		{
+			alternate = !alternate;
+			benchmark::DoNotOptimize(pty.device.Configure(Setup(alternate)));
+		}
+	}
+	BENCHMARK(BM_Configure);
+
+
+	///	Reapplying the settings a port already holds.
+	void BM_ConfigureUnchanged(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		const SerialSettings settings = Setup(true);
+		pty.device.Configure(settings);
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(pty.device.Configure(settings));
+		}
+	}
+	BENCHMARK(BM_ConfigureUnchanged);
+}
@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialStream.hpp>
+
+#include "PtyPair.hpp"
+
+#include <random>
+#include <string>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+constexpr size_t BenchBurstSize = 2048;
+
+namespace bench
+{
+	///	Lines of random printable text ending in "\n", about $lineSize long.
+	std::string MakeLines(size_t lineSize, size_t& lines)
+	{
+		std::mt19937 rng(7);
+		std::string burst;
+		lines = 0;
+		while (burst.size() < BenchBurstSize)
+		{
+			size_t length = 1 + rng() % (2 * lineSize);
+			for (size_t i = 0; i < length; i++) burst += (char)(' ' + rng() % 94);
+			burst += '\n';
+			lines++;
+		}
+		return burst;
+	}
+
+
+	///	Bursts of lines read by std::getline over a $SerialStream.
+	void BM_StreamGetline(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		SerialStream stream(pty.device);
+		size_t lines;
+		const std::string burst = MakeLines((size_t)state.range(0), lines);
+		std::string line;
+
+		for (auto _ : state)
+		{
+			pty.WriteMaster(burst);
+			for (size_t i = 0; i < lines && std::getline(stream, line); i++)
+			{
+				benchmark::DoNotOptimize(line.data());
+			}
+		}
+		state.SetBytesProcessed((int64_t)(state.iterations() * burst.size()));
+		state.counters["lines_per_s"] = benchmark::Counter((double)(state.iterations() * lines), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_StreamGetline)->Arg(16)->Arg(128)->UseRealTime();
+
+
+	///	The same bursts, read by looping SerialDevice::Read and splitting
+	///		the lines by hand.
+	void BM_ReadLoop(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		size_t lines;
+		const std::string burst = MakeLines((size_t)state.range(0), lines);
+		std::string pending, chunk, line;
+
+		for (auto _ : state)
+		{
+			pty.WriteMaster(burst);
+			for (size_t i = 0; i < lines; )
+			{
+				size_t end = pending.find('\n');
+				if (end == std::string::npos)
+				{
+					if (!pty.device.Read(chunk)) break;
+					pending += chunk;
+					continue;
+				}
+				line.assign(pending, 0, end);
+				pending.erase(0, end + 1);
+				benchmark::DoNotOptimize(line.data());
+				i++;
+			}
+		}
+		state.SetBytesProcessed((int64_t)(state.iterations() * burst.size()));
+		state.counters["lines_per_s"] = benchmark::Counter((double)(state.iterations() * lines), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_ReadLoop)->Arg(16)->Arg(128)->UseRealTime();
+}
@@ -0,0 +1,265 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialReactor.hpp>
+
+#include "PtyPair.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+///	Traffic profiles over pseudo-terminal loopback. Each profile's sizes
+///	are its benchmark arguments; run the `bench` target for JSON results.
+namespace bench
+{
+	///	Sorted latency samples, in microseconds.
+	struct Latencies
+	{
+		std::vector<double> samples;
+
+		void Add(std::chrono::steady_clock::duration elapsed)
+		{
+			samples.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+		}
+
+		void Report(benchmark::State& state)
+		{
+			if (samples.empty()) return;
+			std::sort(samples.begin(), samples.end());
+			state.counters["p50_us"] = samples[samples.size() / 2];
+			state.counters["p99_us"] = samples[samples.size() * 99 / 100];
+		}
+	};
+
+
+	///	System calls made per byte moved, when statistics are compiled in.
+	void ReportSyscalls(benchmark::State& state, const SerialDevice& device)
+	{
+#ifdef SERIAL_STATS
+		SerialStats stats = device.Stats();
+		uint64_t bytes = stats.bytesIn + stats.bytesOut;
+		if (bytes)
+		{
+			state.counters["syscalls_per_byte"] = (double)(stats.readCalls + stats.writeCalls) / (double)bytes;
+		}
+#else
+		(void)state;
+		(void)device;
+#endif // SERIAL_STATS
+	}
+
+
+	///	Bulk streaming: the far end writes as fast as it can while the
+	///		device reads.
+	void BM_BulkStream(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		pty.device.CollectStats(true);
+		const std::string chunk((size_t)state.range(0), 'U');
+
+		std::string received;
+		for (auto _ : state)
+		{
+			std::thread writer([&] { pty.WriteMaster(chunk); });
+
+			size_t total = 0;
+			while (total < chunk.size())
+			{
+				total += pty.device.Read(received);
+			}
+			writer.join();
+		}
+
+		state.SetBytesProcessed((int64_t)(state.iterations() * chunk.size()));
+		ReportSyscalls(state, pty.device);
+	}
+	BENCHMARK(BM_BulkStream)->Arg(64 << 10)->Arg(1 << 20)->UseRealTime();
+
+
+	///	Small-frame ping-pong: each frame is echoed by the far end before
+	///		the next is sent.
+	void BM_PingPong(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		pty.device.CollectStats(true);
+		const size_t frameSize = (size_t)state.range(0);
+		const std::string frame(frameSize, 'P');
+
+		std::atomic<bool> running = { true };
+		std::thread echo([&] {
+			while (running)
+			{
+				std::string in = pty.ReadMaster(frameSize, 10ms);
+				if (!in.empty()) pty.WriteMaster(in);
+			}
+		});
+
+		Latencies latencies;
+		std::string reply;
+		for (auto _ : state)
+		{
+			auto start = std::chrono::steady_clock::now();
+			pty.device.Write(frame);
+			if (pty.device.ReadExactly(reply, frameSize, 1s) != frameSize)
+			{
+				state.SkipWithError("echo timed out");
+				break;
+			}
+			latencies.Add(std::chrono::steady_clock::now() - start);
+		}
+
+		running = false;
+		echo.join();
+
+		state.SetBytesProcessed((int64_t)(state.iterations() * frameSize * 2));
+		latencies.Report(state);
+		ReportSyscalls(state, pty.device);
+	}
+	BENCHMARK(BM_PingPong)->Arg(8)->Arg(64)->Arg(256)->UseRealTime();
+
+
+	std::atomic<size_t> burst_bytes = { 0 };
+	std::atomic<size_t> burst_callbacks = { 0 };
+
+	void CountBurst(std::string_view rx_data)
+	{
+		burst_callbacks.fetch_add(1, std::memory_order_relaxed);
+		burst_bytes.fetch_add(rx_data.size(), std::memory_order_release);
+	}
+
+
+	///	Bursty traffic: bursts separated by idle gaps, delivered by the
+	///		event thread. Reports callbacks per burst and burst latency.
+	void BM_Bursty(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		pty.device.CollectStats(true);
+		pty.device.RxDelivery(SerialRxDelivery::Views);
+		pty.device.ReceivedView += CountBurst;
+		pty.device.UsingEvents(true);
+
+		const std::string burst((size_t)state.range(0), 'B');
+		const auto gap = std::chrono::microseconds(state.range(1));
+		burst_bytes = 0;
+		burst_callbacks = 0;
+
+		Latencies latencies;
+		size_t expected = 0;
+		for (auto _ : state)
+		{
+			expected += burst.size();
+			auto start = std::chrono::steady_clock::now();
+			pty.WriteMaster(burst);
+			while (burst_bytes.load(std::memory_order_acquire) < expected)
+			{
+				std::this_thread::yield();
+			}
+			latencies.Add(std::chrono::steady_clock::now() - start);
+
+			state.PauseTiming();
+			std::this_thread::sleep_for(gap);
+			state.ResumeTiming();
+		}
+
+		state.SetBytesProcessed((int64_t)expected);
+		state.counters["callbacks_per_burst"] = (double)burst_callbacks.load() / (double)state.iterations();
+		latencies.Report(state);
+		ReportSyscalls(state, pty.device);
+	}
+	BENCHMARK(BM_Bursty)->Args({ 64, 200 })->Args({ 1024, 200 })->Args({ 4096, 1000 })->UseRealTime();
+
+
+	///	A trickle: a burst arriving a few bytes at a time, delivered with
+	///		and without RX batching. Batching trades a bounded hold for
+	///		fewer callbacks.
+	void BM_Trickle(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		pty.device.CollectStats(true);
+		if (state.range(0))
+		{
+			pty.device.RxBatching({ 256, std::chrono::microseconds(state.range(0)), -1 });
+		}
+		pty.device.RxDelivery(SerialRxDelivery::Views);
+		pty.device.ReceivedView += CountBurst;
+		pty.device.UsingEvents(true);
+
+		const std::string chunk(8, 'T');
+		burst_bytes = 0;
+		burst_callbacks = 0;
+
+		Latencies latencies;
+		size_t expected = 0;
+		for (auto _ : state)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < 32; i++)
+			{
+				expected += chunk.size();
+				pty.WriteMaster(chunk);
+				std::this_thread::sleep_for(std::chrono::microseconds(20));
+			}
+			while (burst_bytes.load(std::memory_order_acquire) < expected)
+			{
+				std::this_thread::yield();
+			}
+			latencies.Add(std::chrono::steady_clock::now() - start);
+		}
+
+		state.SetBytesProcessed((int64_t)expected);
+		state.counters["callbacks_per_kb"] = (double)burst_callbacks.load() * 1024.0 / (double)expected;
+		latencies.Report(state);
+		ReportSyscalls(state, pty.device);
+	}
+	BENCHMARK(BM_Trickle)->ArgName("hold_us")->Arg(0)->Arg(500)->Arg(2000)->UseRealTime();
+
+
+	std::atomic<size_t> fan_in_bytes = { 0 };
+
+	void CountFanIn(std::string_view rx_data)
+	{
+		fan_in_bytes.fetch_add(rx_data.size(), std::memory_order_release);
+	}
+
+
+	///	Many-port fan-in: every port receives a message per iteration and
+	///		one reactor thread dispatches them all.
+	void BM_FanIn(benchmark::State& state)
+	{
+		const size_t portCount = (size_t)state.range(0);
+		const std::string message((size_t)state.range(1), 'F');
+
+		SerialReactor reactor;
+		std::vector<std::unique_ptr<tests::PtyPair>> ports;
+		for (size_t i = 0; i < portCount; i++)
+		{
+			ports.emplace_back(new tests::PtyPair());
+			ports.back()->device.RxDelivery(SerialRxDelivery::Views);
+			ports.back()->device.ReceivedView += CountFanIn;
+			reactor.Attach(ports.back()->device);
+		}
+		fan_in_bytes = 0;
+
+		Latencies latencies;
+		size_t expected = 0;
+		for (auto _ : state)
+		{
+			expected += portCount * message.size();
+			auto start = std::chrono::steady_clock::now();
+			for (auto& port : ports) port->WriteMaster(message);
+			while (fan_in_bytes.load(std::memory_order_acquire) < expected)
+			{
+				std::this_thread::yield();
+			}
+			latencies.Add(std::chrono::steady_clock::now() - start);
+		}
+
+		reactor.Stop();
+		state.SetBytesProcessed((int64_t)expected);
+		latencies.Report(state);
+	}
+	BENCHMARK(BM_FanIn)->Args({ 16, 64 })->Args({ 64, 64 })->Args({ 64, 1024 })->UseRealTime();
+}
@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialCrc.hpp>
+#include <Win32.Devices.SerialTransfer.hpp>
+
+#include "XmodemReceiver.hpp"
+
+#include <random>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace bench
+{
+	std::string Image(size_t len)
+	{
+		std::mt19937 random(7);
+		std::string image(len, '\0');
+		for (char& c : image) c = (char)random();
+		return image;
+	}
+
+
+	///	CRC of a 1024 byte block, four bytes at a time from the tables.
+	void BM_Crc16Table(benchmark::State& state)
+	{
+		const std::string block = Image(1024);
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(Crc16Xmodem(block.data(), block.size()));
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)block.size());
+	}
+	BENCHMARK(BM_Crc16Table);
+
+
+	///	The same a bit at a time.
+	void BM_Crc16Bitwise(benchmark::State& state)
+	{
+		const std::string block = Image(1024);
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(tests::BitwiseCrc16(block.data(), block.size()));
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)block.size());
+	}
+	BENCHMARK(BM_Crc16Bitwise);
+
+
+	///	A 256 KiB image to an in-process receiver whose replies take
+	///		range(1) microseconds to come back, stop-and-wait against a
+	///		window of range(0) blocks.
+	void BM_SendImage(benchmark::State& state)
+	{
+		const size_t window = (size_t)state.range(0);
+		const std::string image = Image(256 * 1024);
+		const SerialTransferProtocol protocol = (window > 1)
+			? SerialTransferProtocol::Windowed : SerialTransferProtocol::Xmodem1k;
+
+		double retries = 0;
+		for (auto _ : state)
+		{
+			tests::PtyPair pty;
+			tests::XmodemReceiver receiver(pty.master, protocol);
+			receiver.latency = std::chrono::microseconds(state.range(1));
+			receiver.Start();
+
+			SerialTransferOptions options;
+			options.protocol = protocol;
+			options.window = window;
+			SerialTransfer transfer(pty.device, options);
+			SerialTransferResult result = transfer.Send(image.data(), image.size());
+			receiver.Join();
+
+			if (!result.Ok()) state.SkipWithError(result.error.c_str());
+			retries += result.progress.retries;
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)image.size());
+		state.counters["retries"] = retries / (double)state.iterations();
+	}
+	BENCHMARK(BM_SendImage)->ArgNames({ "window", "latency_us" })
+		->Args({ 1, 0 })->Args({ 8, 0 })
+		->Args({ 1, 1000 })->Args({ 4, 1000 })->Args({ 16, 1000 })
+		->Unit(benchmark::kMillisecond)->UseRealTime();
+}
@@ -0,0 +1,173 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialDevice.hpp>
+
+#include "PtyPair.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace Win32::Devices;
+
+namespace bench
+{
+	///	Drains the master side so the device never stalls on a full pty.
+	struct Drain
+	{
+		explicit Drain(int master)
+			: m_thread([this, master] {
+				char buf[16384];
+				while (m_running)
+				{
+					pollfd pfd = { master, POLLIN, 0 };
+					if (poll(&pfd, 1, 10) > 0 && read(master, buf, sizeof(buf)) < 0) break;
+				}
+			})
+		{
+		}
+
+		~Drain()
+		{
+			m_running = false;
+			m_thread.join();
+		}
+
+		std::atomic<bool> m_running = { true };
+		std::thread m_thread;
+	};
+
+
+	///	Blocking write of each message.
+	void BM_Write(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		Drain drain(pty.master);
+		const std::string message((size_t)state.range(0), 'U');
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(pty.device.Write(message));
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_Write)->Arg(8)->Arg(64)->Arg(512)->UseRealTime();
+
+
+	///	Pipelined writes, waiting only for the queue to drain at the end.
+	void BM_WriteAsync(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		Drain drain(pty.master);
+		const std::string message((size_t)state.range(0), 'U');
+
+		for (auto _ : state)
+		{
+			pty.device.WriteAsync(message);
+		}
+		pty.device.Flush();
+		state.SetBytesProcessed((int64_t)state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_WriteAsync)->Arg(8)->Arg(64)->Arg(512)->UseRealTime();
+
+
+	///	Frames of header + payload + CRC joined into one string, then written.
+	void BM_FrameConcatenate(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		Drain drain(pty.master);
+		const std::array<uint8_t, 4> header = { 0x7E, 0x01, 0x00, 0x00 };
+		const std::vector<uint8_t> payload((size_t)state.range(0), 0x55);
+		const std::array<uint8_t, 2> crc = { 0xBE, 0xEF };
+
+		for (auto _ : state)
+		{
+			std::string frame((const char*)header.data(), header.size());
+			frame.append((const char*)payload.data(), payload.size());
+			frame.append((const char*)crc.data(), crc.size());
+			benchmark::DoNotOptimize(pty.device.Write(frame));
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (state.range(0) + 6));
+	}
+	BENCHMARK(BM_FrameConcatenate)->RangeMultiplier(4)->Range(16, 4096)->UseRealTime();
+
+
+	///	The same frames handed over as a gathered write.
+	void BM_FrameVectored(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		Drain drain(pty.master);
+		const std::array<uint8_t, 4> header = { 0x7E, 0x01, 0x00, 0x00 };
+		const std::vector<uint8_t> payload((size_t)state.range(0), 0x55);
+		const std::array<uint8_t, 2> crc = { 0xBE, 0xEF };
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(pty.device.Write({ header, payload, crc }));
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (state.range(0) + 6));
+	}
+	BENCHMARK(BM_FrameVectored)->RangeMultiplier(4)->Range(16, 4096)->UseRealTime();
+
+
+	///	Frames queued from 1 to 16 producer threads at once into a queue
+	///		whose sink discards them, so only the queue itself is measured.
+	void BM_PushContended(benchmark::State& state)
+	{
+		static std::unique_ptr<SerialTxQueue> queue;
+		if (state.thread_index() == 0)
+		{
+			queue.reset(new SerialTxQueue([](const SerialBuffer* buffers, size_t count) {
+				size_t len = 0;
+				for (size_t i = 0; i < count; i++) len += buffers[i].size;
+				return len;
+			}, 256));
+		}
+		const std::string frame(32, 'U');
+
+		for (auto _ : state)
+		{
+			queue->Push(frame);
+		}
+
+		if (state.thread_index() == 0)
+		{
+			queue->Flush();
+			state.counters["batches"] = (double)queue->Batches();
+			queue.reset();
+		}
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_PushContended)->ThreadRange(1, 16)->UseRealTime();
+
+
+	///	Frames from 1 to 16 producer threads onto one port, written
+	///		directly under the port's write lock or queued.
+	void BM_WriteContended(benchmark::State& state)
+	{
+		static std::unique_ptr<tests::PtyPair> pty;
+		static std::unique_ptr<Drain> drain;
+		if (state.thread_index() == 0)
+		{
+			pty.reset(new tests::PtyPair());
+			drain.reset(new Drain(pty->master));
+		}
+		const bool queued = state.range(0) != 0;
+		const std::string frame(64, 'U');
+
+		for (auto _ : state)
+		{
+			if (queued) pty->device.WriteAsync(frame);
+			else benchmark::DoNotOptimize(pty->device.Write(frame));
+		}
+
+		if (state.thread_index() == 0)
+		{
+			pty->device.Flush();
+			drain.reset();
+			pty.reset();
+		}
+		state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)frame.size());
+	}
+	BENCHMARK(BM_WriteContended)->ArgName("queued")->Arg(0)->Arg(1)->ThreadRange(1, 16)->UseRealTime();
+}
@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+#include <Win32.Devices.SerialFramer.hpp>
+#include <Win32.Devices.StaticSerialDevice.hpp>
+
+#include "PtyPair.hpp"
+
+#include <random>
+#include <string>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+constexpr size_t BenchStreamSize = 4u << 20;
+constexpr size_t BenchSliceSize = 4096;
+constexpr size_t BenchBurstSize = 2048;
+
+namespace bench
+{
+	using LineDevice = StaticSerialDevice<SerialLine8N1<115200>, StaticDelimiterFraming<'\r', '\n'>, BenchSliceSize>;
+
+
+	///	Lines of random printable text ending in "\r\n", as from a modem.
+	std::string MakeLines(size_t frameSize, size_t streamSize)
+	{
+		std::mt19937 rng(7);
+		std::string stream;
+		stream.reserve(streamSize + 2 * frameSize + 2);
+		while (stream.size() < streamSize)
+		{
+			size_t length = 1 + rng() % (2 * frameSize);
+			for (size_t i = 0; i < length; i++) stream += (char)(' ' + rng() % 94);
+			stream += "\r\n";
+		}
+		return stream;
+	}
+
+
+	///	The framing alone, through the virtual framer of a $SerialDevice.
+	void BM_FramingDynamic(benchmark::State& state)
+	{
+		const std::string stream = MakeLines((size_t)state.range(0), BenchStreamSize);
+		DelimiterFramer framer("\r\n");
+		size_t frames = 0;
+		for (auto _ : state)
+		{
+			for (size_t at = 0; at < stream.size(); at += BenchSliceSize)
+			{
+				framer.Feed(std::string_view(stream).substr(at, BenchSliceSize),
+					[&](std::string_view frame) { frames++; benchmark::DoNotOptimize(frame.data()); });
+			}
+		}
+		state.SetBytesProcessed((int64_t)(state.iterations() * stream.size()));
+		state.counters["time_per_byte"] = benchmark::Counter((double)(state.iterations() * stream.size()),
+			benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+		state.counters["frames_per_s"] = benchmark::Counter((double)frames, benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_FramingDynamic)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+
+	///	The framing alone, through the inlined framing of a
+	///		$StaticSerialDevice, over the same slices.
+	void BM_FramingStatic(benchmark::State& state)
+	{
+		const std::string stream = MakeLines((size_t)state.range(0), BenchStreamSize);
+		StaticDelimiterFraming<'\r', '\n'> framing;
+		size_t frames = 0;
+		for (auto _ : state)
+		{
+			std::string_view pending;
+			for (size_t at = 0; at < stream.size(); at += BenchSliceSize)
+			{
+				//	as the device's buffer: the partial frame leads the next slice
+				std::string_view data(stream.data() + at - pending.size(),
+					pending.size() + (std::min)(BenchSliceSize, stream.size() - at));
+				std::string_view frame;
+				size_t used;
+				while (!data.empty() && (used = framing.Extract(data, frame)))
+				{
+					frames++;
+					benchmark::DoNotOptimize(frame.data());
+					data.remove_prefix(used);
+				}
+				pending = data;
+			}
+		}
+		state.SetBytesProcessed((int64_t)(state.iterations() * stream.size()));
+		state.counters["time_per_byte"] = benchmark::Counter((double)(state.iterations() * stream.size()),
+			benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+		state.counters["frames_per_s"] = benchmark::Counter((double)frames, benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_FramingStatic)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+
+	///	Bursts of lines through a pty, read a line at a time by
+	///		SerialDevice::ReadUntil.
+	void BM_LinesDynamic(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		pty.device.Configure(LineDevice::Settings());
+		const std::string burst = MakeLines((size_t)state.range(0), BenchBurstSize);
+		std::string line;
+		size_t bytes = 0;
+		for (auto _ : state)
+		{
+			pty.WriteMaster(burst);
+			for (size_t got = 0; got < burst.size(); )
+			{
+				if (!pty.device.ReadUntil(line, "\r\n", 1000ms)) break;
+				got += line.size();
+			}
+			bytes += burst.size();
+		}
+		state.SetBytesProcessed((int64_t)bytes);
+		state.counters["time_per_byte"] = benchmark::Counter((double)bytes,
+			benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+		state.counters["object_bytes"] = (double)sizeof(SerialDevice);
+	}
+	BENCHMARK(BM_LinesDynamic)->Arg(16)->Arg(256)->UseRealTime();
+
+
+	///	The same bursts, polled from a $StaticSerialDevice.
+	void BM_LinesStatic(benchmark::State& state)
+	{
+		tests::PtyPair pty;
+		LineDevice device(std::move(pty.device));
+		const std::string burst = MakeLines((size_t)state.range(0), BenchBurstSize);
+		size_t bytes = 0;
+		for (auto _ : state)
+		{
+			pty.WriteMaster(burst);
+			size_t got = 0;
+			auto deadline = std::chrono::steady_clock::now() + 1000ms;
+			while (got < burst.size() && std::chrono::steady_clock::now() < deadline)
+			{
+				device.Poll(100ms, [&](std::string_view frame) { got += frame.size() + 2; });
+			}
+			bytes += burst.size();
+		}
+		state.SetBytesProcessed((int64_t)bytes);
+		state.counters["time_per_byte"] = benchmark::Counter((double)bytes,
+			benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+		state.counters["object_bytes"] = (double)sizeof(LineDevice);
+	}
+	BENCHMARK(BM_LinesStatic)->Arg(16)->Arg(256)->UseRealTime();
+}
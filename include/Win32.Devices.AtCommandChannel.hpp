@@ -0,0 +1,173 @@
+/******************************************************************************
+*	AT command transactions over a serial device.
+*
+*	\file Win32.Devices.AtCommandChannel.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_ATCOMMANDCHANNEL_H_
+#define WIN32_DEVICES_ATCOMMANDCHANNEL_H_
+
+#include "Win32.Devices.SerialDevice.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Time allowed for a command's final result by default.
+		constexpr std::chrono::milliseconds AtDefaultTimeout = std::chrono::milliseconds(5000);
+
+		///	Time allowed after a timeout for the late final result.
+		constexpr std::chrono::milliseconds AtLateResultGuard = std::chrono::milliseconds(1000);
+
+
+		///	How an AT command completed.
+		enum class AtResult
+		{
+			Ok,			///< OK.
+			Error,		///< ERROR, or a call failure such as NO CARRIER.
+			CmeError,	///< +CME ERROR: <n>.
+			CmsError,	///< +CMS ERROR: <n>.
+			Timeout,	///< No final result before the deadline.
+			Aborted		///< The channel closed first.
+		};
+
+
+		///	The outcome of an AT command.
+		struct AtResponse
+		{
+			AtResult result = AtResult::Aborted;
+
+			///	Information lines received before the final result.
+			std::vector<std::string> lines;
+
+			///	The number of a +CME or +CMS error, otherwise -1.
+			int error = -1;
+
+			bool Ok() const { return result == AtResult::Ok; }
+		};
+
+
+		///	Handler signature for an unsolicited result code.
+		using OnAtUrc = corezero::Delegate<void(std::string_view)>;
+
+
+
+		///	An AT command channel.
+		///	Commands are queued and written one at a time; the next is
+		///		written as soon as the previous one's final result arrives,
+		///		without returning to the caller. Lines received while a
+		///		command is active belong to it, except those matching a
+		///		subscribed URC prefix the command does not itself query.
+		///		After a timeout, the next command waits for the late final
+		///		result, or $AtLateResultGuard, and lines until then are
+		///		dropped, so a late reply is not taken as the next one's.
+		///		The channel owns its device.
+		class AtCommandChannel final
+		{
+		public:
+			explicit AtCommandChannel(SerialDevice&& device, bool usingEvents = true);
+			~AtCommandChannel();
+
+			AtCommandChannel(const AtCommandChannel&) = delete;
+			AtCommandChannel& operator=(const AtCommandChannel&) = delete;
+
+			std::future<AtResponse> Send(std::string command,
+				std::chrono::milliseconds timeout = AtDefaultTimeout);
+
+			void Subscribe(std::string prefix, OnAtUrc handler);
+			void Close();
+
+			size_t Pending() const;
+			SerialDevice& Device() { return m_device; }
+
+		private:
+			///	A queued command.
+			struct Transaction
+			{
+				std::string command;
+				std::chrono::milliseconds timeout;
+				std::promise<AtResponse> done;
+				AtResponse response;
+			};
+
+			///	A URC subscription.
+			struct Subscription
+			{
+				std::string prefix;
+				OnAtUrc handler;
+			};
+
+			void handle_line(std::string_view line);
+			bool dispatch_urc(std::string_view line);
+			void complete(AtResult result, int error, std::unique_lock<std::mutex>& lock);
+			void end_drain(std::unique_lock<std::mutex>& lock);
+			void start_next(std::unique_lock<std::mutex>& lock);
+			void watchdog_thread();
+
+		private:
+			///	The modem.
+			SerialDevice m_device;
+
+			///	Commands not yet completed; the front is active once written.
+			std::deque<Transaction> m_queue;
+
+			///	Whether the front of $m_queue has been written.
+			bool m_active = false;
+
+			///	Whether the final result of a timed out command is awaited.
+			bool m_draining = false;
+
+			///	When the active command times out, or the drain ends.
+			std::chrono::steady_clock::time_point m_deadline;
+
+			///	URC subscriptions, by prefix.
+			std::vector<Subscription> m_urcs;
+
+			///	Guards the queue and subscriptions.
+			mutable std::mutex m_lock;
+
+			///	Serializes writes to the device.
+			std::mutex m_writeLock;
+
+			///	Wakes the watchdog when a command starts or the channel closes.
+			std::condition_variable m_changed;
+
+			///	Cleared by $Close.
+			bool m_running = true;
+
+			///	Expires the active command.
+			std::thread m_thWatchdog;
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_ATCOMMANDCHANNEL_H_
@@ -0,0 +1,322 @@
+/******************************************************************************
+*	Modbus RTU master, polling a multi-drop bus.
+*
+*	\file Win32.Devices.ModbusMaster.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_MODBUSMASTER_H_
+#define WIN32_DEVICES_MODBUSMASTER_H_
+
+#include "Win32.Devices.SerialDevice.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Registers a single read may ask for.
+		constexpr uint16_t ModbusMaxRegisters = 125;
+
+		///	Slave address of a broadcast, which no slave answers.
+		constexpr uint8_t ModbusBroadcast = 0;
+
+
+		///	Character and silence times of Modbus RTU at a line rate.
+		struct ModbusTiming
+		{
+			std::chrono::nanoseconds character;		///< One character on the wire.
+			std::chrono::nanoseconds interChar;		///< t1.5: the longest gap within a frame.
+			std::chrono::nanoseconds interFrame;	///< t3.5: the shortest silence between frames.
+		};
+
+
+		///	The character and silence times at a baud rate. Above 19200
+		///		baud the silences are fixed, as the specification advises.
+		///
+		///	\param[in] baudRate The baud rate.
+		///	\param[in] bitsPerChar Start, data, parity and stop bits; 11 for 8E1 or 8N2.
+		constexpr ModbusTiming ModbusRtuTiming(uint32_t baudRate, uint32_t bitsPerChar = 11)
+		{
+			const std::chrono::nanoseconds character = SerialCharacterTime(baudRate, bitsPerChar);
+			if (baudRate > 19200)
+			{
+				return { character, std::chrono::microseconds(750), std::chrono::microseconds(1750) };
+			}
+			return { character, character * 3 / 2, character * 7 / 2 };
+		}
+
+
+		///	A register table of a slave.
+		enum class ModbusTable : uint8_t
+		{
+			Holding = 0x03,		///< Holding registers, read with function 3.
+			Input = 0x04		///< Input registers, read with function 4.
+		};
+
+
+		///	How a transaction completed.
+		enum class ModbusStatus
+		{
+			Ok,				///< Answered.
+			Exception,		///< Answered with an exception code.
+			Timeout,		///< Not answered in time.
+			CrcError,		///< Answered with a damaged frame.
+			BadResponse		///< Answered by the wrong slave, or to the wrong function.
+		};
+
+
+		///	The outcome of a transaction.
+		struct ModbusResponse
+		{
+			ModbusStatus status = ModbusStatus::Timeout;
+
+			///	The exception code, with $status Exception.
+			uint8_t exception = 0;
+
+			///	The registers read.
+			std::vector<uint16_t> registers;
+
+			bool Ok() const { return status == ModbusStatus::Ok; }
+		};
+
+
+		///	A block of registers read by the poll scheduler. The values are
+		///		only valid for the duration of the call.
+		struct ModbusBlock
+		{
+			uint8_t slave;
+			ModbusTable table;
+			uint16_t address;
+			uint16_t count;
+			const uint16_t* values;
+		};
+
+
+		///	How a master behaves.
+		struct ModbusOptions
+		{
+			///	How long a slave has to start answering.
+			std::chrono::milliseconds responseTimeout = std::chrono::milliseconds(100);
+
+			///	Allowance past the wire time for the rest of an answer, i.e.
+			///		the latency of a USB adapter.
+			std::chrono::milliseconds byteTimeout = std::chrono::milliseconds(20);
+
+			///	Silence after a broadcast, for the slaves to act on it.
+			std::chrono::milliseconds turnaround = std::chrono::milliseconds(100);
+
+			///	Registers between two watched blocks read anyway to merge
+			///		them into one request; 0 merges only adjacent blocks.
+			uint16_t maxGap = 0;
+
+			///	Failures in a row before a slave is taken as offline.
+			uint32_t offlineAfter = 3;
+
+			///	How often an offline slave is tried, so it does not hold up
+			///		the rest of the bus with timeouts.
+			std::chrono::milliseconds offlinePeriod = std::chrono::milliseconds(5000);
+		};
+
+
+		///	Activity of a master.
+		struct ModbusStats
+		{
+			uint64_t polls = 0;			///< Transactions answered, exceptions included.
+			uint64_t timeouts = 0;		///< Transactions not answered.
+			uint64_t crcErrors = 0;		///< Answers with a damaged frame.
+			uint64_t exceptions = 0;	///< Answers with an exception code.
+
+			///	Time frames spent on the wire, from their length and the
+			///		character time.
+			std::chrono::nanoseconds busTime = std::chrono::nanoseconds(0);
+
+			///	Time since the master started.
+			std::chrono::nanoseconds elapsed = std::chrono::nanoseconds(0);
+
+			///	Answered transactions per second.
+			double PollsPerSecond() const
+			{
+				return elapsed.count() ? (double)polls * 1e9 / (double)elapsed.count() : 0.0;
+			}
+
+			///	The fraction of the time the bus carried a frame.
+			double Utilisation() const
+			{
+				return elapsed.count() ? (double)busTime.count() / (double)elapsed.count() : 0.0;
+			}
+		};
+
+
+		///	Handler signature for a block read by the poll scheduler.
+		using OnModbusBlock = corezero::Delegate<void(const ModbusBlock&)>;
+
+		///	Identifies a watched block of registers.
+		using ModbusWatchId = size_t;
+
+
+
+		///	A Modbus RTU master on a multi-drop bus, i.e. RS-485.
+		///	Watched registers are merged, per slave and table, into as few
+		///		read requests as possible, built once with their CRC. The
+		///		poll scheduler writes the next request as soon as the bus
+		///		has been silent for t3.5, reads each answer by its expected
+		///		length rather than waiting out a silence, and polls slaves
+		///		that stopped answering only now and then. Single reads and
+		///		writes go in between polls. Answers are read with ReadSome,
+		///		so the device must not be raising received data elsewhere.
+		class ModbusMaster final
+		{
+		public:
+			explicit ModbusMaster(SerialDevice& device, const ModbusOptions& options = ModbusOptions());
+			~ModbusMaster();
+
+			ModbusMaster(const ModbusMaster&) = delete;
+			ModbusMaster& operator=(const ModbusMaster&) = delete;
+
+			ModbusResponse ReadRegisters(uint8_t slave, ModbusTable table, uint16_t address, uint16_t count);
+			ModbusResponse WriteRegister(uint8_t slave, uint16_t address, uint16_t value);
+			ModbusResponse WriteRegisters(uint8_t slave, uint16_t address, const uint16_t* values, uint16_t count);
+
+			ModbusWatchId Watch(uint8_t slave, ModbusTable table, uint16_t address, uint16_t count,
+				std::chrono::milliseconds period = std::chrono::milliseconds(0));
+			std::vector<uint16_t> Values(ModbusWatchId id) const;
+			size_t Requests() const;
+
+			void Start();
+			void Stop();
+			bool PollOnce();
+
+			ModbusTiming Timing() const;
+			ModbusStats Stats() const;
+
+			corezero::Event<OnModbusBlock> Updated;
+
+		private:
+			///	A watched block of registers.
+			struct WatchEntry
+			{
+				uint8_t slave;
+				ModbusTable table;
+				uint16_t address;
+				uint16_t count;
+				std::chrono::milliseconds period;
+
+				///	The request reading it, and where in that request.
+				size_t request = 0;
+				uint16_t offset = 0;
+			};
+
+			///	A read request built from merged watches.
+			struct PollRequest
+			{
+				uint8_t slave;
+				ModbusTable table;
+				uint16_t address;
+				uint16_t count;
+				std::chrono::milliseconds period;
+
+				///	The frame, CRC included.
+				uint8_t frame[8];
+
+				///	The registers, as last read.
+				std::vector<uint16_t> values;
+				bool valid = false;
+
+				std::chrono::steady_clock::time_point due;
+			};
+
+			///	Whether a slave answers.
+			struct SlaveHealth
+			{
+				uint32_t failures = 0;
+				std::chrono::steady_clock::time_point retry;
+			};
+
+			///	A request picked for polling, copied so the watches may
+			///		change while it is on the bus.
+			struct PollTarget
+			{
+				size_t index;
+				uint64_t plan;
+				uint8_t frame[8];
+			};
+
+			void plan();
+			bool next_due(std::chrono::steady_clock::time_point now, PollTarget& target, std::chrono::steady_clock::time_point& wake);
+			void poll(const PollTarget& target);
+			void poll_thread();
+
+			ModbusStatus transact(const uint8_t* frame, size_t len, uint8_t* reply, size_t replyLen, uint8_t& exception);
+			size_t read_reply(uint8_t* dest, size_t len, std::chrono::steady_clock::time_point deadline);
+			void await_silence();
+			void purge();
+			void account(size_t bytes);
+			void healthy(uint8_t slave, bool answered);
+
+		private:
+			SerialDevice& m_device;
+			ModbusOptions m_options;
+
+			///	Timing at the device's baud rate, when the master was made.
+			ModbusTiming m_timing;
+
+			///	Watches, and the requests they are merged into.
+			std::vector<WatchEntry> m_watches;
+			std::vector<PollRequest> m_requests;
+
+			///	Counts the plans of $m_requests, so a poll finishing after
+			///		a new watch is not stored against the new plan.
+			uint64_t m_plan = 0;
+
+			///	Health of every slave address.
+			std::array<SlaveHealth, 256> m_health;
+
+			///	Guards the watches, requests and statistics.
+			mutable std::mutex m_lock;
+
+			///	Serialises transactions on the bus.
+			std::mutex m_busLock;
+
+			///	When the bus will have been silent for t3.5.
+			std::chrono::steady_clock::time_point m_busFree;
+
+			ModbusStats m_stats;
+			std::chrono::steady_clock::time_point m_started;
+
+			///	Wakes the poll thread on a new watch, or to stop.
+			std::condition_variable m_changed;
+			bool m_running = false;
+			std::thread m_thPoll;
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_MODBUSMASTER_H_
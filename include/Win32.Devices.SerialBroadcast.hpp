@@ -0,0 +1,190 @@
+/******************************************************************************
+*	Fan-out of received data to many subscribers, each on its own thread.
+*
+*	\file Win32.Devices.SerialBroadcast.hpp
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALBROADCAST_H_
+#define WIN32_DEVICES_SERIALBROADCAST_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include <corezero/event.hpp>
+
+#include "Win32.Devices.SerialMemory.hpp"
+#include "Win32.Devices.SerialRingBuffer.hpp"
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Capacity of the broadcast ring shared by the subscribers.
+		constexpr size_t SerialBroadcastSize = 0x40000ul;
+
+		///	Most bytes handed to a subscriber in one call.
+		constexpr size_t SerialBroadcastChunk = 0x4000ul;
+
+		///	Most subscribers of one broadcast.
+		constexpr size_t SerialBroadcastMaxSubscribers = 8;
+
+		///	Identifies a subscription; SerialBroadcastNone if none was made.
+		using SerialSubscriberId = size_t;
+		constexpr SerialSubscriberId SerialBroadcastNone = (SerialSubscriberId)-1;
+
+
+		///	What happens to a subscriber that falls a whole ring behind.
+		enum class SerialOverflowPolicy
+		{
+			DropOldest,		///< Skip ahead to newer data, counting what was lost.
+			Block,			///< Hold the publisher back; data waits in the device and the port.
+			Disconnect		///< End the subscription.
+		};
+
+
+		///	Counters of one subscriber.
+		struct SerialSubscriberStats
+		{
+			uint64_t delivered = 0;		///< Bytes handed to the subscriber.
+			uint64_t dropped = 0;		///< Bytes skipped by DropOldest or left by Disconnect.
+			uint64_t overflows = 0;		///< Times the subscriber fell a whole ring behind.
+			bool connected = false;		///< Whether the subscriber still receives data.
+		};
+
+		///	Handler signature for a subscriber; the view is only valid for
+		///		the duration of the call.
+		using OnBroadcast = corezero::Delegate<void(std::string_view)>;
+
+
+
+		///	One publisher, many subscribers, one ring.
+		///	The publisher copies data into the ring and advances its head;
+		///		each subscriber follows with its own cursor on its own
+		///		thread, so a slow subscriber delays only itself. Publishing
+		///		never waits on a subscriber's progress: only Block
+		///		subscribers hold it back, by limiting how much $Publish
+		///		accepts. The others are overtaken, and notice it by the
+		///		reservation the publisher makes before it writes.
+		class SerialBroadcast final
+		{
+		public:
+			explicit SerialBroadcast(size_t capacity = SerialBroadcastSize,
+				std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+			~SerialBroadcast();
+
+			SerialBroadcast(const SerialBroadcast&) = delete;
+			SerialBroadcast& operator=(const SerialBroadcast&) = delete;
+
+			SerialSubscriberId Subscribe(OnBroadcast handler, SerialOverflowPolicy policy = SerialOverflowPolicy::DropOldest);
+			void Unsubscribe(SerialSubscriberId id);
+			SerialSubscriberStats Stats(SerialSubscriberId id) const;
+			size_t Subscribers() const;
+
+			size_t Publish(const void* data, size_t len);
+			size_t Room() const;
+			bool AwaitRoom(std::chrono::milliseconds timeout);
+
+			size_t Capacity() const { return m_mask + 1; }
+
+		private:
+			///	A subscriber slot. Slots are never freed while the broadcast
+			///		lives, so the publisher reads them without a lock.
+			struct alignas(SerialCacheLine) Subscriber
+			{
+				///	Whether the publisher should account for this slot.
+				std::atomic<bool> active = { false };
+
+				///	Bytes consumed, in ring positions.
+				std::atomic<uint64_t> cursor = { 0 };
+
+				std::atomic<SerialOverflowPolicy> policy = { SerialOverflowPolicy::DropOldest };
+				OnBroadcast handler;
+
+				///	Whether the slot is taken; guarded by $m_subscribeLock.
+				bool claimed = false;
+
+				std::atomic<uint64_t> delivered = { 0 };
+				std::atomic<uint64_t> dropped = { 0 };
+				std::atomic<uint64_t> overflows = { 0 };
+				std::atomic<bool> connected = { false };
+
+				///	Set while the thread sleeps; the publisher only then
+				///		takes $lock, to wake it.
+				std::atomic<bool> sleeping = { false };
+				std::atomic<bool> running = { false };
+				std::mutex lock;
+				std::condition_variable wake;
+
+				///	Data copied out of the ring before the handler sees it.
+				SerialScratch scratch;
+
+				std::thread thread;
+			};
+
+			void subscriber_thread(Subscriber& subscriber);
+			bool await_data(Subscriber& subscriber, uint64_t cursor);
+			uint64_t overflow(Subscriber& subscriber, uint64_t cursor);
+			void wake(Subscriber& subscriber);
+			void release_room();
+			uint64_t blocking_cursor(uint64_t head) const;
+			void ring_write(uint64_t position, const uint8_t* src, size_t len);
+			void ring_read(uint64_t position, uint8_t* dest, size_t len) const;
+
+		private:
+			///	Capacity - 1.
+			const size_t m_mask;
+
+			///	The ring, and the memory it and the scratch buffers are from.
+			///		A subscriber may copy bytes the publisher is overwriting,
+			///		and discards them afterwards, so the ring is held in
+			///		words read and written with relaxed atomics.
+			std::pmr::memory_resource* const m_memory;
+			std::atomic<uint64_t>* const m_ring;
+
+			///	Bytes published.
+			alignas(SerialCacheLine) std::atomic<uint64_t> m_head = { 0 };
+
+			///	Bytes being published; runs ahead of $m_head during a copy.
+			std::atomic<uint64_t> m_reserved = { 0 };
+
+			///	The subscribers.
+			Subscriber m_subscribers[SerialBroadcastMaxSubscribers];
+
+			///	Guards subscribing and unsubscribing; never taken by $Publish.
+			mutable std::mutex m_subscribeLock;
+
+			///	Wakes a publisher waiting in $AwaitRoom.
+			std::atomic<bool> m_publisherWaiting = { false };
+			std::mutex m_roomLock;
+			std::condition_variable m_room;
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALBROADCAST_H_
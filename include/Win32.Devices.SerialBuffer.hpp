@@ -0,0 +1,74 @@
+/******************************************************************************
+*	Non-owning view of contiguous bytes handed to the serial device.
+*
+*	\file Win32.Devices.SerialBuffer.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALBUFFER_H_
+#define WIN32_DEVICES_SERIALBUFFER_H_
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	A span of bytes for a vectored write.
+		///	Converts from any contiguous container of trivially-copyable
+		///		elements (std::array, std::vector, std::string, built-in
+		///		arrays, std::string_view) and from C strings.
+		struct SerialBuffer
+		{
+			const void* data = nullptr;
+			size_t size = 0;
+
+			SerialBuffer() = default;
+
+			SerialBuffer(const void* src, size_t len)
+				: data(src), size(len)
+			{
+			}
+
+			SerialBuffer(const char* str)
+				: data(str), size(std::strlen(str))
+			{
+			}
+
+			template <typename Container,
+				typename Element = typename std::remove_cv<typename std::remove_pointer<
+					decltype(std::data(std::declval<const Container&>()))>::type>::type>
+			SerialBuffer(const Container& src)
+				: data(std::data(src)), size(std::size(src) * sizeof(Element))
+			{
+				static_assert(std::is_trivially_copyable<Element>::value,
+					"SerialBuffer elements must be trivially copyable");
+			}
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALBUFFER_H_
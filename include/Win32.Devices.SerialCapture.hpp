@@ -0,0 +1,246 @@
+/******************************************************************************
+*	Recording and replay of serial traffic.
+*
+*	\file Win32.Devices.SerialCapture.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALCAPTURE_H_
+#define WIN32_DEVICES_SERIALCAPTURE_H_
+
+#if !defined(SERIAL_BACKEND_POSIX) && defined(WIN32)
+#include <windows.h>
+#endif // !SERIAL_BACKEND_POSIX
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "Win32.Devices.SerialBuffer.hpp"
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Which way a captured record travelled.
+		enum class SerialCaptureDirection : uint16_t
+		{
+			Rx = 1,		///< Read from the port.
+			Tx = 2		///< Written to the port.
+		};
+
+
+		///	Identifies a capture file, and its format version.
+		constexpr char SerialCaptureMagic[8] = { 'S', 'E', 'R', 'C', 'A', 'P', '0', '1' };
+
+		///	Step by which a capture file and its mapping grow.
+		constexpr size_t SerialCaptureGrowth = 0x400000;
+
+
+		///	Start of a capture file. Fields are in native byte order.
+		struct SerialCaptureHeader
+		{
+			char magic[8];			///< "SERCAP01".
+			uint64_t startTime;		///< Wall clock at the start, in ns since the epoch.
+			uint64_t length;		///< Bytes in use, this header included.
+			uint64_t reserved;
+		};
+
+
+		///	A captured read or write. The payload follows, padded to 8 bytes,
+		///		so every record stays aligned in the mapping.
+		struct SerialCaptureRecord
+		{
+			uint64_t offset;		///< Nanoseconds since the start of the capture.
+			uint32_t length;		///< Payload bytes.
+			uint16_t direction;		///< A SerialCaptureDirection.
+			uint16_t reserved;
+		};
+
+
+
+		///	Appends timestamped reads and writes to a memory-mapped capture
+		///		file. Appending is a copy into the mapping under a lock; the
+		///		file only grows, in $SerialCaptureGrowth steps or more, and
+		///		the header's length is updated after every record so the
+		///		capture survives a crash up to the last whole record.
+		class SerialRecorder final
+		{
+		public:
+			explicit SerialRecorder(const std::string& path);
+			~SerialRecorder();
+
+			SerialRecorder(const SerialRecorder&) = delete;
+			SerialRecorder& operator=(const SerialRecorder&) = delete;
+
+			void Append(SerialCaptureDirection direction, const void* data, size_t len);
+			void Append(SerialCaptureDirection direction, const SerialBuffer* buffers, size_t count, size_t len);
+			void Close();
+
+			uint64_t Length() const;
+
+		private:
+			void start();
+			uint8_t* reserve(SerialCaptureDirection direction, size_t len);
+			void commit(size_t len);
+			bool map(size_t capacity);
+			void unmap();
+
+		private:
+			///	Guards the mapping, which moves as it grows.
+			mutable std::mutex m_lock;
+
+			///	The mapped file, $m_capacity bytes.
+			uint8_t* m_base = nullptr;
+			size_t m_capacity = 0;
+
+			///	Bytes in use.
+			size_t m_length = 0;
+
+			///	The monotonic start of the capture.
+			std::chrono::steady_clock::time_point m_started;
+
+#ifdef SERIAL_BACKEND_POSIX
+			int m_file = -1;
+#else
+			HANDLE m_file = INVALID_HANDLE_VALUE;
+			HANDLE m_mapping = nullptr;
+#endif // SERIAL_BACKEND_POSIX
+		};
+
+
+
+		///	A capture file, mapped read-only.
+		class SerialCapture final
+		{
+		public:
+			///	A record of the capture. $data points into the mapping.
+			struct Record
+			{
+				std::chrono::nanoseconds offset;
+				SerialCaptureDirection direction;
+				std::string_view data;
+			};
+
+
+			///	Walks the records in order.
+			class Iterator
+			{
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = Record;
+				using difference_type = std::ptrdiff_t;
+				using pointer = const Record*;
+				using reference = const Record&;
+
+				Iterator(const uint8_t* at, const uint8_t* end);
+
+				reference operator*() const { return m_record; }
+				pointer operator->() const { return &m_record; }
+				Iterator& operator++();
+				bool operator==(const Iterator& other) const { return m_at == other.m_at; }
+				bool operator!=(const Iterator& other) const { return m_at != other.m_at; }
+
+			private:
+				void load();
+
+				const uint8_t* m_at;
+				const uint8_t* m_end;
+				Record m_record;
+			};
+
+
+			explicit SerialCapture(const std::string& path);
+			~SerialCapture();
+
+			SerialCapture(const SerialCapture&) = delete;
+			SerialCapture& operator=(const SerialCapture&) = delete;
+
+			Iterator begin() const;
+			Iterator end() const;
+
+			std::chrono::system_clock::time_point Started() const;
+			size_t Length() const { return m_length; }
+
+		private:
+			static size_t validate(const uint8_t* base, size_t size);
+			void unmap();
+
+		private:
+			///	The mapped file, $m_mapped bytes, of which $m_length are in use.
+			const uint8_t* m_base = nullptr;
+			size_t m_mapped = 0;
+			size_t m_length = 0;
+
+#ifdef SERIAL_BACKEND_POSIX
+			int m_file = -1;
+#else
+			HANDLE m_file = INVALID_HANDLE_VALUE;
+			HANDLE m_mapping = nullptr;
+#endif // SERIAL_BACKEND_POSIX
+		};
+
+
+
+		/**********************************************************************
+		 *	Replay the records of a capture into a sink, i.e. the master side
+		 *		of a pty.
+		 *
+		 *	\param[in] capture The capture.
+		 *	\param[in] sink Called as sink(const void*, size_t) per record.
+		 *	\param[in] speed Multiple of the original pace, i.e. 1 for the
+		 *		original timing or 10 for ten times faster; 0 replays as fast
+		 *		as the sink takes the data.
+		 *	\param[in] direction The records to replay; what the device read
+		 *		by default.
+		 *	\returns The number of bytes replayed.
+		 */
+		template <typename Sink>
+		size_t ReplayCapture(const SerialCapture& capture, Sink&& sink, double speed = 1.0,
+			SerialCaptureDirection direction = SerialCaptureDirection::Rx)
+		{
+			const auto started = std::chrono::steady_clock::now();
+			size_t replayed = 0;
+
+			for (const SerialCapture::Record& record : capture)
+			{
+				if (record.direction != direction) continue;
+
+				if (speed > 0)
+				{
+					auto due = std::chrono::duration_cast<std::chrono::nanoseconds>(record.offset / speed);
+					std::this_thread::sleep_until(started + due);
+				}
+				sink(record.data.data(), record.data.size());
+				replayed += record.data.size();
+			}
+			return replayed;
+		}
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALCAPTURE_H_
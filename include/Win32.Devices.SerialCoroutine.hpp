@@ -0,0 +1,440 @@
+/******************************************************************************
+*	C++20 coroutine tasks and awaitable reads and writes of serial devices.
+*
+*	\file Win32.Devices.SerialCoroutine.hpp
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALCOROUTINE_H_
+#define WIN32_DEVICES_SERIALCOROUTINE_H_
+
+#include "Win32.Devices.SerialExecutor.hpp"
+
+//	the library builds as C++17; only C++20 users see the coroutines
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define SERIAL_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Promise state shared by every $SerialTask.
+		struct SerialTaskPromiseBase
+		{
+			///	Resumed when the task finishes; none for a spawned task.
+			std::coroutine_handle<> continuation;
+
+			///	Raised by the task, rethrown to its awaiter.
+			std::exception_ptr exception;
+
+			///	The executor owning a spawned task.
+			SerialExecutor* owner = nullptr;
+
+
+			///	Hands control back to the awaiter, or frees a spawned task.
+			struct FinalAwaiter
+			{
+				bool await_ready() noexcept { return false; }
+
+				template <typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> task) noexcept
+				{
+					SerialTaskPromiseBase& promise = task.promise();
+					if (promise.continuation) return promise.continuation;
+
+					if (promise.owner) promise.owner->Disown(task.address());
+					if (promise.exception) std::cerr << "Serial Error: Session ended by an exception!" << std::endl;
+					task.destroy();
+					return std::noop_coroutine();
+				}
+
+				void await_resume() noexcept {}
+			};
+
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			FinalAwaiter final_suspend() noexcept { return {}; }
+			void unhandled_exception() { exception = std::current_exception(); }
+		};
+
+
+
+		///	Promise state holding the result of a $SerialTask.
+		template <typename T>
+		struct SerialTaskPromise : SerialTaskPromiseBase
+		{
+			std::optional<T> value;
+
+			void return_value(T result) { value.emplace(std::move(result)); }
+			T result()
+			{
+				if (exception) std::rethrow_exception(exception);
+				return std::move(*value);
+			}
+		};
+
+
+		template <>
+		struct SerialTaskPromise<void> : SerialTaskPromiseBase
+		{
+			void return_void() {}
+			void result()
+			{
+				if (exception) std::rethrow_exception(exception);
+			}
+		};
+
+
+
+		///	A coroutine returning a T. Tasks are lazy: a task runs once
+		///		awaited by another, or once given to $Spawn.
+		template <typename T = void>
+		class SerialTask
+		{
+		public:
+			struct promise_type : SerialTaskPromise<T>
+			{
+				SerialTask get_return_object() { return SerialTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			};
+
+			SerialTask(SerialTask&& to_move) noexcept : m_task(std::exchange(to_move.m_task, nullptr)) {}
+			SerialTask(const SerialTask&) = delete;
+			SerialTask& operator=(const SerialTask&) = delete;
+			~SerialTask() { if (m_task) m_task.destroy(); }
+
+			auto operator co_await() && noexcept
+			{
+				struct Awaiter
+				{
+					std::coroutine_handle<promise_type> task;
+
+					bool await_ready() noexcept { return !task || task.done(); }
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+					{
+						task.promise().continuation = awaiting;
+						return task;
+					}
+					T await_resume() { return task.promise().result(); }
+				};
+				return Awaiter{ m_task };
+			}
+
+			///	Give up the coroutine, i.e. to an executor.
+			std::coroutine_handle<promise_type> Release() { return std::exchange(m_task, nullptr); }
+
+		private:
+			explicit SerialTask(std::coroutine_handle<promise_type> task) : m_task(task) {}
+
+			std::coroutine_handle<promise_type> m_task;
+		};
+
+
+
+		/**********************************************************************
+		 *	Start a task on an executor, which owns it until it finishes. The
+		 *		task first runs on the next turn of SerialExecutor::Run.
+		 *
+		 *	\param[in] executor The executor.
+		 *	\param[in] task The task, i.e. a session with one device.
+		 */
+		inline void Spawn(SerialExecutor& executor, SerialTask<void> task)
+		{
+			auto handle = task.Release();
+			if (!handle) return;
+
+			handle.promise().owner = &executor;
+			executor.Own(handle.address(), [](void* frame) { std::coroutine_handle<>::from_address(frame).destroy(); });
+			executor.Post([](void* frame) { std::coroutine_handle<>::from_address(frame).resume(); }, handle.address());
+		}
+
+
+
+		///	Base of the awaitables: suspends the awaiting coroutine on a wait
+		///		of the current executor, and resumes it from $on_ready once
+		///		$Derived::progress reports the operation done.
+		template <typename Derived>
+		class SerialAwaitable
+		{
+		public:
+			SerialAwaitable(SerialDevice& device, std::chrono::milliseconds timeout)
+				: m_device(device),
+				m_deadline(timeout == SerialAwaitForever ? SerialExecutor::Forever : std::chrono::steady_clock::now() + timeout) {}
+
+			///	Registered with the executor by address while suspended.
+			SerialAwaitable(const SerialAwaitable&) = delete;
+			SerialAwaitable& operator=(const SerialAwaitable&) = delete;
+
+			bool await_suspend(std::coroutine_handle<> awaiting)
+			{
+				m_executor = SerialExecutor::Current();
+				if (!m_executor)
+				{
+					std::cerr << "Serial Error: Awaiting outside of SerialExecutor::Run!" << std::endl;
+					return false;
+				}
+
+				m_awaiting = awaiting;
+				static_cast<Derived*>(this)->wait();
+				return true;
+			}
+
+		protected:
+			///	A wait ended: make progress, then resume or wait again.
+			static void on_ready(void* context)
+			{
+				Derived* self = static_cast<Derived*>(context);
+				if (self->progress() || std::chrono::steady_clock::now() >= self->m_deadline)
+				{
+					self->m_awaiting.resume();
+				}
+				else
+				{
+					self->wait();
+				}
+			}
+
+			SerialDevice& m_device;
+			std::chrono::steady_clock::time_point m_deadline;
+			SerialExecutor* m_executor = nullptr;
+			std::coroutine_handle<> m_awaiting;
+		};
+
+
+
+		///	Awaits some received bytes; see $ReadAsync.
+		class SerialReadAwaitable : public SerialAwaitable<SerialReadAwaitable>
+		{
+		public:
+			SerialReadAwaitable(SerialDevice& device, void* dest, size_t len, std::chrono::milliseconds timeout)
+				: SerialAwaitable(device, timeout), m_dest(dest), m_len(len) {}
+
+			bool await_ready()
+			{
+				//	bytes left past a delimiter are read at once
+				m_read = m_len ? SerialExecutor::TakeBuffered(m_device, m_dest, m_len) : 0;
+				return !m_len || m_read;
+			}
+			size_t await_resume() const { return m_read; }
+
+		private:
+			friend class SerialAwaitable<SerialReadAwaitable>;
+
+			void wait() { m_executor->WhenReadable(m_device, m_deadline, &on_ready, this); }
+
+			///	A read ends with what one readiness yields, even nothing, so
+			///		a hung up line or a timeout ends it with 0.
+			bool progress()
+			{
+				m_read = SerialExecutor::ReadNow(m_device, m_dest, m_len);
+				return true;
+			}
+
+			void* m_dest;
+			size_t m_len;
+			size_t m_read = 0;
+		};
+
+
+
+		///	Awaits a delimiter; see $ReadUntilAsync.
+		class SerialReadUntilAwaitable : public SerialAwaitable<SerialReadUntilAwaitable>
+		{
+		public:
+			SerialReadUntilAwaitable(SerialDevice& device, std::string& dest, std::string_view delimiter, std::chrono::milliseconds timeout)
+				: SerialAwaitable(device, timeout), m_dest(dest), m_delimiter(delimiter) {}
+
+			bool await_ready()
+			{
+				m_dest.clear();
+				if (m_delimiter.empty()) return true;
+
+				m_read = SerialExecutor::TakeUntil(m_device, m_dest, m_delimiter, m_scanned);
+				return m_read != 0;
+			}
+			size_t await_resume() const { return m_read; }
+
+		private:
+			friend class SerialAwaitable<SerialReadUntilAwaitable>;
+
+			void wait() { m_executor->WhenReadable(m_device, m_deadline, &on_ready, this); }
+
+			///	Drains the port into the receive ring until the delimiter
+			///		arrives or the port runs dry. A readiness yielding
+			///		nothing, on hang up, timeout or a full ring, ends the read.
+			bool progress()
+			{
+				bool filled = false;
+				while (SerialExecutor::FillNow(m_device))
+				{
+					filled = true;
+					m_read = SerialExecutor::TakeUntil(m_device, m_dest, m_delimiter, m_scanned);
+					if (m_read) return true;
+				}
+				return !filled;
+			}
+
+			std::string& m_dest;
+			std::string_view m_delimiter;
+			size_t m_scanned = 0;
+			size_t m_read = 0;
+		};
+
+
+
+		///	Awaits a whole write; see $WriteAsync.
+		class SerialWriteAwaitable : public SerialAwaitable<SerialWriteAwaitable>
+		{
+		public:
+			SerialWriteAwaitable(SerialDevice& device, std::string_view data)
+				: SerialAwaitable(device, total_timeout(device.Settings().timeouts, data.size())),
+				m_data(data) {}
+
+			bool await_ready()
+			{
+				m_written = SerialExecutor::WriteNow(m_device, m_data.data(), m_data.size());
+				return m_written == m_data.size();
+			}
+			size_t await_resume() const { return m_written; }
+
+		private:
+			friend class SerialAwaitable<SerialWriteAwaitable>;
+
+			void wait() { m_executor->WhenWritable(m_device, m_deadline, &on_ready, this); }
+
+			///	The bound of a write of $len bytes. As in COMMTIMEOUTS, zero
+			///		totals mean no bound.
+			static std::chrono::milliseconds total_timeout(const SerialTimeouts& timeouts, size_t len)
+			{
+				if (!timeouts.writeTotalConstant && !timeouts.writeTotalMultiplier) return SerialAwaitForever;
+				return std::chrono::milliseconds(timeouts.writeTotalConstant + timeouts.writeTotalMultiplier * (uint64_t)len);
+			}
+
+			bool progress()
+			{
+				size_t written = SerialExecutor::WriteNow(m_device, m_data.data() + m_written, m_data.size() - m_written);
+				m_written += written;
+				return !written || m_written == m_data.size();
+			}
+
+			std::string_view m_data;
+			size_t m_written = 0;
+		};
+
+
+
+		///	Awaits a delay; see $DelayAsync.
+		class SerialDelayAwaitable
+		{
+		public:
+			explicit SerialDelayAwaitable(std::chrono::milliseconds delay) : m_delay(delay) {}
+
+			bool await_ready() const { return m_delay.count() <= 0; }
+			bool await_suspend(std::coroutine_handle<> awaiting)
+			{
+				SerialExecutor* executor = SerialExecutor::Current();
+				if (!executor)
+				{
+					std::cerr << "Serial Error: Awaiting outside of SerialExecutor::Run!" << std::endl;
+					return false;
+				}
+
+				executor->PostAt(std::chrono::steady_clock::now() + m_delay,
+					[](void* frame) { std::coroutine_handle<>::from_address(frame).resume(); }, awaiting.address());
+				return true;
+			}
+			void await_resume() const {}
+
+		private:
+			std::chrono::milliseconds m_delay;
+		};
+
+
+
+		/**********************************************************************
+		 *	Read whatever arrives next, resuming once the port is readable.
+		 *
+		 *	\param[in] device A device without events or a reactor.
+		 *	\param[out] dest The destination.
+		 *	\param[in] len The size of the destination.
+		 *	\param[in] timeout How long to wait for the first byte.
+		 *	\returns An awaitable of the number of bytes read, 0 on timeout
+		 *		or hang up.
+		 */
+		inline SerialReadAwaitable ReadAsync(SerialDevice& device, void* dest, size_t len,
+			std::chrono::milliseconds timeout = SerialAwaitForever)
+		{
+			return SerialReadAwaitable(device, dest, len, timeout);
+		}
+
+
+
+		/**********************************************************************
+		 *	Read up to and including a delimiter, i.e. "\r\n". Bytes past the
+		 *		delimiter stay buffered for the next read.
+		 *
+		 *	\param[in] device A device without events or a reactor.
+		 *	\param[out] dest The bytes read, ending with the delimiter.
+		 *	\param[in] delimiter The bytes ending the read.
+		 *	\param[in] timeout How long to wait for the delimiter.
+		 *	\returns An awaitable of the number of bytes read, 0 on timeout
+		 *		or hang up.
+		 */
+		inline SerialReadUntilAwaitable ReadUntilAsync(SerialDevice& device, std::string& dest, std::string_view delimiter,
+			std::chrono::milliseconds timeout = SerialAwaitForever)
+		{
+			return SerialReadUntilAwaitable(device, dest, delimiter, timeout);
+		}
+
+
+
+		/**********************************************************************
+		 *	Write all of the data, resuming whenever the port has room. The
+		 *		write is bounded by the device's write timeouts, unless both
+		 *		are zero.
+		 *
+		 *	\param[in] device A device.
+		 *	\param[in] data The data, kept alive until the write completes.
+		 *	\returns An awaitable of the number of bytes written.
+		 */
+		inline SerialWriteAwaitable WriteAsync(SerialDevice& device, std::string_view data)
+		{
+			return SerialWriteAwaitable(device, data);
+		}
+
+
+
+		/**********************************************************************
+		 *	Resume after a delay, i.e. a modem's guard time.
+		 */
+		inline SerialDelayAwaitable DelayAsync(std::chrono::milliseconds delay)
+		{
+			return SerialDelayAwaitable(delay);
+		}
+	}
+}
+
+#endif // __cpp_impl_coroutine
+
+#endif	// !WIN32_DEVICES_SERIALCOROUTINE_H_
@@ -0,0 +1,49 @@
+/******************************************************************************
+*	Table-driven CRCs of serial protocols.
+*
+*	\file Win32.Devices.SerialCrc.hpp
+*	\author Jensen Miller
+*
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALCRC_H_
+#define WIN32_DEVICES_SERIALCRC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	CRC-16/XMODEM, as XMODEM and YMODEM append to each block:
+		///		polynomial 0x1021, most significant bit first, starting at 0.
+		uint16_t Crc16Xmodem(const void* data, size_t len, uint16_t crc = 0);
+
+		///	CRC-16/MODBUS, as Modbus RTU appends to each frame, low byte
+		///		first: polynomial 0x8005, least significant bit first,
+		///		starting at 0xFFFF.
+		uint16_t Crc16Modbus(const void* data, size_t len, uint16_t crc = 0xFFFF);
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALCRC_H_
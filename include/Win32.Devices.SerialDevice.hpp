@@ -27,72 +27,183 @@
 #ifndef WIN32_DEVICES_SERIALDEVICE_H_
 #define WIN32_DEVICES_SERIALDEVICE_H_
 
-#ifdef WIN32
+#if defined(SERIAL_BACKEND_POSIX)
+#include <sys/types.h>
+#elif defined(WIN32)
 #include <windows.h>
-#endif // WIN32
+#endif // SERIAL_BACKEND_POSIX
 
+#include <cstdint>
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <array>
+#include <initializer_list>
+#include <future>
+#include <memory>
+#include <memory_resource>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #include <corezero/event.hpp>
 
+#include "Win32.Devices.SerialBroadcast.hpp"
+#include "Win32.Devices.SerialBuffer.hpp"
+#include "Win32.Devices.SerialCapture.hpp"
+#include "Win32.Devices.SerialFramer.hpp"
+#include "Win32.Devices.SerialMemory.hpp"
+#include "Win32.Devices.SerialRingBuffer.hpp"
+#include "Win32.Devices.SerialSettings.hpp"
+#include "Win32.Devices.SerialShared.hpp"
+#include "Win32.Devices.SerialStats.hpp"
+#include "Win32.Devices.SerialTxQueue.hpp"
+
 namespace Win32
 {
 	namespace Devices
 	{
-		/// The number of bits per byte.
-		enum class SerialByteSize
+#ifdef SERIAL_BACKEND_POSIX
+		///	Native handle for a serial port: a non-blocking file descriptor.
+		using NativeHandle = int;
+#define SERIAL_INVALID_HANDLE	(-1)
+#else
+		///	Native handle for a serial port: an overlapped win32 file handle.
+		using NativeHandle = HANDLE;
+#define SERIAL_INVALID_HANDLE	nullptr
+#endif // SERIAL_BACKEND_POSIX
+
+		///	Wait forever on a read.
+		constexpr uint32_t SerialInfiniteTimeout = 0xFFFFFFFFul;
+
+		///	Wait forever in a read or awaitable taking a std::chrono timeout.
+		constexpr std::chrono::milliseconds SerialAwaitForever = (std::chrono::milliseconds::max)();
+
+		///	Capacity of the preallocated receive ring.
+		constexpr size_t SerialRxRingSize = 0x10000ul;
+
+
+		class SerialReactor;
+		class SerialPorts;
+		class SerialExecutor;
+		template <typename Line, typename Framing, size_t BufferSize> class StaticSerialDevice;
+
+		///	How received data is handed to subscribers.
+		enum class SerialRxDelivery
+		{
+			Strings,	///< Raise $ReceivedData with an owning string per burst.
+			Views,		///< Raise $ReceivedView with slices of the receive ring.
+			Frames,		///< Raise $ReceivedFrame with each frame cut by the framer.
+			Buffered,	///< Keep received data in the ring for the Read calls.
+			Broadcast,	///< Publish to the subscribers of $Broadcast, each on its own thread.
+			Shared,		///< Publish to a shared ring, for readers in other processes.
+			Payloads	///< Raise $ReceivedPayload with an owning copy in the device's memory.
+		};
+
+		///	Coalescing of received data before the event thread delivers it.
+		///	A smaller batch is held for more data, but never longer than
+		///		$maxHold, so a quiet line still delivers promptly.
+		struct SerialRxBatching
 		{
-			Byte_Size7b = 7,	///< 7 bits per byte.
-			Byte_Size8b = 8		///< 8 bits per byte.
+			size_t minBytes = 0;			///< Deliver once this many bytes are buffered.
+			std::chrono::microseconds maxHold = std::chrono::microseconds(0);	///< Longest a smaller batch is held; 0 delivers at once.
+			int delimiter = -1;				///< Deliver at once on receiving this byte; -1 for none.
 		};
 
+		///	State of the connection to the port, as raised by $ConnectionChanged.
+		enum class SerialConnectionState
+		{
+			Connected,		///< The port is open; raised again once reopened.
+			Lost,			///< The port failed, i.e. its adapter was unplugged or reset.
+			Reconnecting,	///< An attempt to reopen the port is under way.
+			Failed			///< Every attempt failed; the port stays closed.
+		};
 
-		/// The number of stop bits per transaction.
-		enum class SerialStopBits
-		{			
-			StopBits_1 = ONESTOPBIT,		///< 1 stop bit.
-			StopBits_1_5 = ONE5STOPBITS,	///< 1.5 stop bits.
-			StopBits_2 = TWOSTOPBITS		///< 2 stop bits.
+		///	Reopening of a lost port by the event thread, while supervised.
+		///	The wait before each attempt doubles from $firstDelay, up to
+		///		$maxDelay.
+		struct SerialReconnect
+		{
+			std::chrono::milliseconds firstDelay = std::chrono::milliseconds(100);	///< Wait before the first attempt.
+			std::chrono::milliseconds maxDelay = std::chrono::milliseconds(5000);	///< Longest wait between attempts.
+			uint32_t maxAttempts = 0;		///< Attempts before giving up; 0 to keep trying.
 		};
 
 		///	Handler signature for data in reciever.
 		using OnRxData = corezero::Delegate<void(std::string)>;		
 
+		///	Handler signature for a non-owning view of received data. The
+		///		view is only valid for the duration of the call.
+		using OnRxView = corezero::Delegate<void(std::string_view)>;
+
+		///	Handler signature for received data held in the device's memory.
+		///		The payload may be kept past the call.
+		using OnRxPayload = corezero::Delegate<void(SerialPayload)>;
+
+		///	Handler signature for a change in the connection to the port.
+		using OnConnectionState = corezero::Delegate<void(SerialConnectionState)>;
+
 
 
 		///	A windows serial device.
 		///	A modern c++ wrapper for the win32 api calls
-		///		for serial communication.
+		///		for serial communication. When built with SERIAL_BACKEND_POSIX
+		///		the same surface is provided over termios.
 		struct SerialDevice	final
 		{				
 			SerialDevice(std::nullptr_t);
 			SerialDevice(SerialDevice&& to_move) noexcept;
 			SerialDevice& operator=(SerialDevice&& to_move) noexcept;
 
-			virtual ~SerialDevice();
+			~SerialDevice();
 
 			static SerialDevice FromPortNumber(uint16_t COMPortNum);
+			static SerialDevice FromPath(const std::string& devicePath);
 
 
 
 			void Close();
 			void UsingEvents(bool usingCommEv);
+			void RxDelivery(SerialRxDelivery delivery);
+			SerialRxDelivery RxDelivery() const;
+			void UsingFramer(std::unique_ptr<SerialFramer> framer);
+			SerialBroadcast& Broadcast();
+			SerialSharedPublisher& Share(const std::string& name, size_t capacity = SerialSharedSize);
+			void UsingMemory(std::pmr::memory_resource* memory);
+			std::pmr::memory_resource* Memory() const;
 			void Defer(std::chrono::milliseconds deferMillis);
+			void RxBatching(const SerialRxBatching& batching);
+			SerialRxBatching RxBatching() const;
+			void Supervise(const SerialReconnect& reconnect = SerialReconnect());
+			SerialConnectionState Connection() const;
 
-			template <typename T, unsigned N>
+			template <typename T, size_t N>
 			size_t Write(const std::array<T, N>& src_ary);
 			size_t Write(const std::string& src_str);
+			size_t Write(std::initializer_list<SerialBuffer> buffers);
+			size_t Write(const SerialBuffer* buffers, size_t count);
+
+			std::future<size_t> WriteAsync(const std::string& src_str, SerialTxPriority priority = SerialTxPriority::Normal);
+			std::future<size_t> WriteAsync(std::initializer_list<SerialBuffer> frame, SerialTxPriority priority = SerialTxPriority::Normal);
+			void Flush();
+			void TxQueueDepth(size_t depth);
+			size_t TxQueueDepth() const;
 
-			template <typename T, unsigned N>
+			template <typename T, size_t N>
 			size_t Read(std::array<T, N>& dest_ary);
 			size_t Read(std::string& dest_str);
 
+			size_t ReadSome(void* dest, size_t len, std::chrono::milliseconds timeout);
+			size_t ReadExactly(std::string& dest_str, size_t count, std::chrono::milliseconds timeout);
+			size_t ReadUntil(std::string& dest_str, std::string_view delimiter, std::chrono::milliseconds timeout);
+
 			uint32_t Available();
 
+			bool Configure(const SerialSettings& settings);
+			const SerialSettings& Settings() const;
+
 			void BaudRate(uint32_t baudrate);
 			uint32_t BaudRate() const;
 
@@ -102,55 +213,185 @@ namespace Win32
 			void ByteSize(SerialByteSize byteSize);
 			SerialByteSize ByteSize() const;
 
-			corezero::Event<OnRxData> ReceivedData;
+			void CollectStats(bool collect);
+			SerialStats Stats() const;
 
-		private:
-			SerialDevice(HANDLE pSercom, uint16_t comPortNum) : m_pComm(pSercom), m_portNum(comPortNum) {}
+			void RecordTo(std::shared_ptr<SerialRecorder> recorder);
 
-			size_t win32_write(const void* _src, size_t len);
-			size_t win32_read(void* _dest, size_t len, DWORD readTimeout = INFINITE);
+			corezero::Event<OnRxData> ReceivedData;
+			corezero::Event<OnRxView> ReceivedView;
+			corezero::Event<OnRxView> ReceivedFrame;
+			corezero::Event<OnRxPayload> ReceivedPayload;
+			corezero::Event<OnConnectionState> ConnectionChanged;
 
-			void config_settings();
-			void config_timeouts();
+		private:
+			friend class SerialReactor;
+			friend class SerialPorts;
+			friend class SerialExecutor;
+			template <typename Line, typename Framing, size_t BufferSize> friend class StaticSerialDevice;
+
+#ifndef SERIAL_BACKEND_POSIX
+			///	A reusable overlapped operation. Its event is created on first
+			///		use and reset, rather than recreated, for every operation.
+			struct IoContext
+			{
+				OVERLAPPED overlapped = { 0 };
+
+				OVERLAPPED* Acquire();
+				void Release();
+			};
+#endif // !SERIAL_BACKEND_POSIX
+
+			SerialDevice(NativeHandle pSercom, uint16_t comPortNum)
+				: m_pComm(pSercom), m_portNum(comPortNum), m_rxRing(new SerialRingBuffer(SerialRxRingSize)) {}
+
+			static NativeHandle open_native(const std::string& devicePath, std::string& error);
+			void close_native();
+			bool bring_up(const SerialSettings& settings);
+
+			size_t native_write(const void* _src, size_t len);
+			size_t native_writev(const SerialBuffer* buffers, size_t count);
+			size_t native_read(void* _dest, size_t len, uint32_t readTimeout = SerialInfiniteTimeout);
+			size_t native_read_now(void* _dest, size_t len);
+			size_t native_write_now(const void* _src, size_t len);
+
+			bool config_settings(const SerialSettings& settings);
+			bool config_timeouts(const SerialTimeouts& timeouts);
 			void clear_comm();
 
 			void interrupt_thread();
 			void handle_data();
+			size_t fill_rx(size_t available, bool& delimited);
+			bool holding_rx(bool delimited) const;
+			bool await_input(std::chrono::microseconds timeout);
+			void deliver_rx();
+			void publish_rx();
+
+			bool await_rx(size_t count, std::chrono::steady_clock::time_point deadline);
+			void release_rx(size_t len);
+			size_t find_rx(std::string_view delimiter, size_t from) const;
+
+			SerialTxQueue* start_tx();
+			size_t write_tx(const SerialBuffer* buffers, size_t count);
+			void stop_tx();
+
+			bool reconnect();
+			bool await_reconnect();
+			void connection(SerialConnectionState state);
+
+			void line_errors(SerialStats& stats) const;
 
 		private:
 			///	Native handle for sercom.
-			HANDLE volatile m_pComm = nullptr;
+			NativeHandle volatile m_pComm = SERIAL_INVALID_HANDLE;
 
+#ifndef SERIAL_BACKEND_POSIX
 			BOOL m_ReadOpPending = FALSE;
+			BOOL m_WriteOpPending = FALSE;
+
+			///	Overlapped contexts for reads, writes and comm events.
+			IoContext m_readIo;
+			IoContext m_writeIo;
+			IoContext m_commEvIo;
+
+			///	Reused storage for joining a gathered write.
+			SerialScratch m_txGather;
+#endif // !SERIAL_BACKEND_POSIX
 
 			///	COM port number.
 			uint16_t m_portNum = (uint16_t)-1;
 
-			///	The BaudRate.
-			uint32_t m_baudrate = 9600U;
+			///	The path the port was opened by, to reopen it by.
+			std::string m_path;
+
+			///	The line settings and timeouts, as last configured.
+			SerialSettings m_settings;
 
-			/// The size of a byte.
-			SerialByteSize m_byteSize = SerialByteSize::Byte_Size8b;
+			///	Whether the port holds $m_settings.
+			bool m_configured = false;
 
 			/// Handle for a thread to await comm events
 			std::thread m_thCommEv;
 
 			///
 			std::atomic_flag m_continuePoll = ATOMIC_FLAG_INIT;
+
+			///	The reactor dispatching this device, if any.
+			SerialReactor* m_reactor = nullptr;
+
+			///	Holds the receive ring, queued writes and delivered payloads.
+			std::pmr::memory_resource* m_memory = std::pmr::get_default_resource();
+
+			///	Receive ring, filled by the event thread.
+			std::unique_ptr<SerialRingBuffer> m_rxRing;
+
+			///	How the event thread delivers the receive ring.
+			SerialRxDelivery m_rxDelivery = SerialRxDelivery::Strings;
+
+			///	How received data is coalesced before delivery.
+			SerialRxBatching m_rxBatching;
+
+			///	Splits the receive ring into frames for $ReceivedFrame.
+			std::unique_ptr<SerialFramer> m_framer;
+
+			///	Fans received data out to subscribers, once broadcasting.
+			std::unique_ptr<SerialBroadcast> m_broadcast;
+
+			///	Shares received data with other processes, once sharing.
+			std::unique_ptr<SerialSharedPublisher> m_shared;
+
+			///	Signals data added to, or space freed in, a Buffered ring.
+			std::mutex m_rxLock;
+			std::condition_variable m_rxSignal;
+
+			///	Serialises writes to the port, so the frames of concurrent
+			///		writers never interleave, and starting the transmit queue.
+			std::mutex m_writeLock;
+
+			///	Transmit queue, started by the first $WriteAsync.
+			std::unique_ptr<SerialTxQueue> m_txQueue;
+
+			///	$m_txQueue once started, for producers on other threads.
+			std::atomic<SerialTxQueue*> m_txActive = { nullptr };
+
+			///	Buffers in flight on the transmit queue.
+			size_t m_txDepth = SerialTxQueueDepth;
+
+			///	How a lost port is reopened, while supervised.
+			SerialReconnect m_reconnect;
+			std::atomic<bool> m_supervised = { false };
+
+			///	Set by a read or write failing as the port went away, and
+			///		cleared once reopened.
+			std::atomic<bool> m_linkLost = { false };
+
+			///	State of the connection, signalled on every change.
+			std::atomic<SerialConnectionState> m_connection = { SerialConnectionState::Connected };
+			std::mutex m_connectionLock;
+			std::condition_variable m_connectionSignal;
+
+			///	Counters, while collecting statistics.
+			std::unique_ptr<SerialCounters> m_stats;
+
+			///	Captures reads and writes, while recording.
+			std::shared_ptr<SerialRecorder> m_recorder;
 		};
 
 
-		template<typename T, unsigned N>
+		template<typename T, size_t N>
 		inline size_t SerialDevice::Write(const std::array<T, N>& src_ary)
 		{
-			return win32_write(src_ary.data, N);
+			static_assert(std::is_trivially_copyable<T>::value, "array elements must be trivially copyable");
+			std::lock_guard<std::mutex> lock(m_writeLock);
+			return native_write(src_ary.data(), N * sizeof(T));
 		}
 
 
-		template<typename T, unsigned N>
+		template<typename T, size_t N>
 		inline size_t SerialDevice::Read(std::array<T, N>& dest_ary)
 		{
-			return 0;
+			static_assert(std::is_trivially_copyable<T>::value, "array elements must be trivially copyable");
+			return native_read(dest_ary.data(), N * sizeof(T));
 		}
 	}
 }
@@ -0,0 +1,183 @@
+/******************************************************************************
+*	Single-threaded executor resuming serial I/O waits on port readiness.
+*
+*	\file Win32.Devices.SerialExecutor.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALEXECUTOR_H_
+#define WIN32_DEVICES_SERIALEXECUTOR_H_
+
+#include "Win32.Devices.SerialDevice.hpp"
+
+#include <chrono>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Runs work waiting on many serial devices from one thread.
+		///	Waits are one shot: a callback is registered for a device
+		///		becoming readable or writable, optionally with a deadline,
+		///		and runs once from $Run when either comes. Readiness is
+		///		awaited with epoll, or on Win32 with an I/O completion port
+		///		receiving comm events and overlapped writes. The awaitables of
+		///		Win32.Devices.SerialCoroutine.hpp suspend on these waits,
+		///		so a coroutine per session replaces a thread per device.
+		///
+		///	Everything but construction runs on the thread calling $Run.
+		///		Devices waited on must not use events or a reactor. On Win32
+		///		a device joins the completion port for good once waited on.
+		class SerialExecutor final
+		{
+		public:
+			///	A callback, run with the context it was registered with.
+			using Resume = void (*)(void* context);
+
+			///	Deadline of a wait that never times out.
+			static constexpr std::chrono::steady_clock::time_point Forever = (std::chrono::steady_clock::time_point::max)();
+
+			SerialExecutor();
+			~SerialExecutor();
+
+			SerialExecutor(const SerialExecutor&) = delete;
+			SerialExecutor& operator=(const SerialExecutor&) = delete;
+
+			void Post(Resume resume, void* context);
+			void PostAt(std::chrono::steady_clock::time_point when, Resume resume, void* context);
+			void WhenReadable(SerialDevice& device, std::chrono::steady_clock::time_point deadline, Resume resume, void* context);
+			void WhenWritable(SerialDevice& device, std::chrono::steady_clock::time_point deadline, Resume resume, void* context);
+
+			void Own(void* context, Resume destroy);
+			void Disown(void* context);
+
+			void Run();
+			void Stop();
+
+			size_t Waiting() const { return m_waiting; }
+
+			static SerialExecutor* Current();
+
+			static size_t ReadNow(SerialDevice& device, void* dest, size_t len);
+			static size_t TakeBuffered(SerialDevice& device, void* dest, size_t len);
+			static size_t FillNow(SerialDevice& device);
+			static size_t TakeUntil(SerialDevice& device, std::string& dest, std::string_view delimiter, size_t& scanned);
+			static size_t WriteNow(SerialDevice& device, const void* src, size_t len);
+
+		private:
+			///	A registered callback. $generation tells a live wait from
+			///		one a timer outlived.
+			struct Waiter
+			{
+				Resume resume = nullptr;
+				void* context = nullptr;
+				uint64_t generation = 0;
+			};
+
+			///	The waits on one device.
+			struct Watch
+			{
+				Waiter read;
+				Waiter write;
+
+				///	The device last waited on; alive while a wait is.
+				SerialDevice* device = nullptr;
+
+				///	Whether the device joined the epoll set, or the port.
+				bool added = false;
+
+#ifndef SERIAL_BACKEND_POSIX
+				///	The comm event wait behind a read wait.
+				OVERLAPPED rxWait = { 0 };
+				DWORD rxEvents = 0;
+				bool rxArmed = false;
+#endif // !SERIAL_BACKEND_POSIX
+			};
+
+			///	A deadline: of a wait on $handle, or of a $PostAt if
+			///		$handle is invalid.
+			struct Timer
+			{
+				std::chrono::steady_clock::time_point deadline;
+				NativeHandle handle;
+				bool writable;
+				uint64_t generation;
+				Resume resume;
+				void* context;
+
+				bool operator>(const Timer& other) const { return deadline > other.deadline; }
+			};
+
+			void when_ready(SerialDevice& device, bool writable, std::chrono::steady_clock::time_point deadline, Resume resume, void* context);
+			void arm(NativeHandle handle, Watch& watch);
+			void disarm(NativeHandle handle, Watch& watch, bool writable);
+			void ready(NativeHandle handle, bool readable, bool writable, bool failed);
+			bool await_native(int timeoutMs);
+#ifndef SERIAL_BACKEND_POSIX
+			void completed(NativeHandle handle, const OVERLAPPED* overlapped);
+#endif // !SERIAL_BACKEND_POSIX
+			bool stale(const Timer& timer) const;
+			void expire();
+			int wait_timeout();
+
+		private:
+#ifdef SERIAL_BACKEND_POSIX
+			///	The epoll instance.
+			int m_epoll = -1;
+#else
+			///	The completion port.
+			HANDLE m_port = NULL;
+#endif // SERIAL_BACKEND_POSIX
+
+			///	Waits by device handle.
+			std::unordered_map<NativeHandle, Watch> m_watches;
+
+			///	Deadlines, soonest first. Timers of finished waits are
+			///		dropped as they reach the top.
+			std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers;
+
+			///	Callbacks to run, and those being run.
+			std::vector<std::pair<Resume, void*>> m_ready;
+			std::vector<std::pair<Resume, void*>> m_running;
+
+			///	Work owned by the executor, destroyed with it if unfinished.
+			std::unordered_map<void*, Resume> m_owned;
+
+			///	Waits and $PostAt calls outstanding.
+			size_t m_waiting = 0;
+			size_t m_delayed = 0;
+
+			uint64_t m_generation = 0;
+
+			///	Cleared by $Stop.
+			bool m_runnable = false;
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALEXECUTOR_H_
@@ -0,0 +1,243 @@
+/******************************************************************************
+*	Incremental framers splitting a received byte stream into frames.
+*
+*	\file Win32.Devices.SerialFramer.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALFRAMER_H_
+#define WIN32_DEVICES_SERIALFRAMER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Largest frame a framer will reassemble by default.
+		constexpr size_t SerialMaxFrameSize = 0x10000ul;
+
+
+		///	An incremental framer.
+		///	Slices of the stream are fed in as they arrive. Frames lying
+		///		wholly inside a slice are emitted as views into it; only a
+		///		frame split across slices is copied, into storage reserved
+		///		up front. Decoding framers (SLIP, COBS) emit views into a
+		///		reused decode buffer. Emitted views are only valid for the
+		///		duration of the call.
+		class SerialFramer
+		{
+		public:
+			explicit SerialFramer(size_t maxFrameSize = SerialMaxFrameSize);
+			virtual ~SerialFramer() = default;
+
+			template <typename Handler>
+			void Feed(std::string_view slice, Handler&& emit);
+
+			void Reset();
+
+			///	Bytes discarded because a frame outgrew $MaxFrameSize.
+			uint64_t Dropped() const { return m_dropped; }
+			size_t MaxFrameSize() const { return m_maxFrameSize; }
+
+		protected:
+			///	Find the first complete frame in the data.
+			///	\param[in] data Contiguous stream bytes.
+			///	\param[out] frame The frame, valid until the next call.
+			///	\returns The bytes consumed, or 0 if no frame is complete. Bytes
+			///		skipped without a frame leave $frame null.
+			virtual size_t extract(std::string_view data, std::string_view& frame) = 0;
+
+		private:
+			template <typename Handler>
+			void emit_frame(std::string_view frame, Handler& emit);
+
+		private:
+			///	The start of a frame split across slices.
+			std::string m_partial;
+
+			const size_t m_maxFrameSize;
+			uint64_t m_dropped = 0;
+
+			///	Set when an oversized frame was dropped; its tail is discarded.
+			bool m_resync = false;
+		};
+
+
+		///	Frames ending in a delimiter, i.e. "\r\n".
+		class DelimiterFramer final : public SerialFramer
+		{
+		public:
+			explicit DelimiterFramer(std::string delimiter, bool keepDelimiter = false,
+				size_t maxFrameSize = SerialMaxFrameSize);
+
+		protected:
+			size_t extract(std::string_view data, std::string_view& frame) override;
+
+		private:
+			const std::string m_delimiter;
+			const bool m_keepDelimiter;
+		};
+
+
+		///	Frames of a fixed length.
+		class FixedLengthFramer final : public SerialFramer
+		{
+		public:
+			explicit FixedLengthFramer(size_t frameLength);
+
+		protected:
+			size_t extract(std::string_view data, std::string_view& frame) override;
+
+		private:
+			const size_t m_frameLength;
+		};
+
+
+		///	Frames led by an unsigned length of 1, 2 or 4 bytes. The emitted
+		///		frame excludes the prefix.
+		class LengthPrefixFramer final : public SerialFramer
+		{
+		public:
+			explicit LengthPrefixFramer(size_t prefixBytes = 2, bool bigEndian = true,
+				size_t maxFrameSize = SerialMaxFrameSize);
+
+		protected:
+			size_t extract(std::string_view data, std::string_view& frame) override;
+
+		private:
+			const size_t m_prefixBytes;
+			const bool m_bigEndian;
+		};
+
+
+		///	RFC 1055 SLIP frames, decoded.
+		class SlipFramer final : public SerialFramer
+		{
+		public:
+			explicit SlipFramer(size_t maxFrameSize = SerialMaxFrameSize);
+
+		protected:
+			size_t extract(std::string_view data, std::string_view& frame) override;
+
+		private:
+			std::string m_decoded;
+		};
+
+
+		///	Consistent overhead byte stuffing frames ending in 0x00, decoded.
+		class CobsFramer final : public SerialFramer
+		{
+		public:
+			explicit CobsFramer(size_t maxFrameSize = SerialMaxFrameSize);
+
+		protected:
+			size_t extract(std::string_view data, std::string_view& frame) override;
+
+		private:
+			std::string m_decoded;
+		};
+
+
+
+		/**********************************************************************
+		 *	Feed a slice of the stream, emitting every completed frame.
+		 *
+		 *	\param[in] slice The bytes received.
+		 *	\param[in] emit Called with each frame as a std::string_view.
+		 */
+		template <typename Handler>
+		inline void SerialFramer::Feed(std::string_view slice, Handler&& emit)
+		{
+			std::string_view frame;
+			size_t used;
+
+			if (!m_partial.empty())
+			{
+				//	complete the split frame from the front of the slice
+				const size_t joined = m_partial.size();
+				const size_t appended = (std::min)(slice.size(), m_maxFrameSize - joined);
+				m_partial.append(slice.data(), appended);
+
+				std::string_view pending(m_partial);
+				size_t scanned = 0;
+				while (scanned <= joined && (used = extract(pending.substr(scanned), frame)))
+				{
+					if (frame.data()) emit_frame(frame, emit);
+					scanned += used;
+				}
+
+				if (scanned > joined)
+				{
+					slice.remove_prefix(scanned - joined);
+				}
+				else if (m_partial.size() >= m_maxFrameSize)
+				{
+					m_dropped += m_partial.size();
+					m_resync = true;
+					slice.remove_prefix(appended);
+				}
+				else
+				{
+					return;
+				}
+				m_partial.clear();
+			}
+
+			//	frames wholly inside the slice are emitted in place
+			while (!slice.empty() && (used = extract(slice, frame)))
+			{
+				if (frame.data()) emit_frame(frame, emit);
+				slice.remove_prefix(used);
+			}
+
+			if (slice.size() >= m_maxFrameSize)
+			{
+				m_dropped += slice.size();
+				m_resync = true;
+			}
+			else
+			{
+				m_partial.assign(slice.data(), slice.size());
+			}
+		}
+
+
+
+		template <typename Handler>
+		inline void SerialFramer::emit_frame(std::string_view frame, Handler& emit)
+		{
+			if (m_resync)
+			{
+				m_dropped += frame.size();
+				m_resync = false;
+				return;
+			}
+			emit(frame);
+		}
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALFRAMER_H_
@@ -0,0 +1,229 @@
+/******************************************************************************
+*	Memory for the buffers of a serial device.
+*
+*	\file Win32.Devices.SerialMemory.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALMEMORY_H_
+#define WIN32_DEVICES_SERIALMEMORY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	A string whose storage comes from a device's memory.
+		using SerialString = std::pmr::string;
+
+
+		///	Sizes of a $SerialBlockPool. Blocks come in powers of two from
+		///		$minBlock to $maxBlock, $blocks of each.
+		struct SerialPoolSizes
+		{
+			size_t minBlock = 64;		///< Smallest block; holds a queued write or a payload's header.
+			size_t maxBlock = 4096;		///< Largest block; larger requests go upstream.
+			size_t blocks = 32;			///< Blocks of each size.
+		};
+
+
+		///	Counters of a $SerialBlockPool.
+		struct SerialPoolStats
+		{
+			size_t capacity = 0;		///< Bytes in the arena.
+			size_t inUse = 0;			///< Blocks handed out.
+			size_t peak = 0;			///< Most blocks handed out at once.
+			uint64_t fallbacks = 0;		///< Requests passed upstream.
+		};
+
+
+		///	A fixed-block memory resource over one arena, taken from
+		///		upstream when the pool is made. Each request is served by a
+		///		free block of the smallest size that fits, from a free list
+		///		of that size, so after startup serial I/O does not touch
+		///		the global heap. Requests larger than the largest block,
+		///		i.e. a receive ring made once, go upstream, as do those met
+		///		with every block that fits taken; both are counted, and the
+		///		latter are avoided by sizing the pool for the traffic.
+		///	Safe from any thread.
+		class SerialBlockPool final : public std::pmr::memory_resource
+		{
+		public:
+			explicit SerialBlockPool(const SerialPoolSizes& sizes = SerialPoolSizes(),
+				std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+			~SerialBlockPool();
+
+			SerialBlockPool(const SerialBlockPool&) = delete;
+			SerialBlockPool& operator=(const SerialBlockPool&) = delete;
+
+			SerialPoolStats Stats() const;
+
+		protected:
+			void* do_allocate(size_t bytes, size_t alignment) override;
+			void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		private:
+			///	A free block, linked through its own storage.
+			struct FreeBlock
+			{
+				FreeBlock* next;
+			};
+
+			///	The blocks of one size: a slice of the arena.
+			struct SizeClass
+			{
+				size_t blockSize = 0;
+				uint8_t* begin = nullptr;
+				uint8_t* end = nullptr;
+				FreeBlock* free = nullptr;
+			};
+
+			///	Classes from the minimum block size doubling up to the maximum.
+			static constexpr size_t MaxClasses = 24;
+
+		private:
+			std::pmr::memory_resource* const m_upstream;
+
+			SizeClass m_classes[MaxClasses];
+			size_t m_classCount = 0;
+
+			///	The arena, holding every class.
+			uint8_t* m_arena = nullptr;
+			size_t m_arenaSize = 0;
+
+			///	Guards the free lists and block counts.
+			mutable std::mutex m_lock;
+			size_t m_inUse = 0;
+			size_t m_peak = 0;
+
+			std::atomic<uint64_t> m_fallbacks = { 0 };
+		};
+
+
+
+		///	Received data raised to $ReceivedPayload, held in the device's
+		///		memory. Copies share the data, so a subscriber may keep it
+		///		past the call without copying it.
+		class SerialPayload
+		{
+		public:
+			SerialPayload() = default;
+			explicit SerialPayload(std::shared_ptr<const SerialString> data)
+				: m_data(std::move(data))
+			{
+			}
+
+			const char* data() const { return m_data ? m_data->data() : nullptr; }
+			size_t size() const { return m_data ? m_data->size() : 0; }
+			bool empty() const { return size() == 0; }
+
+			std::string_view View() const { return std::string_view(data(), size()); }
+			operator std::string_view() const { return View(); }
+
+			///	The memory holding the data.
+			std::pmr::memory_resource* Memory() const
+			{
+				return m_data ? m_data->get_allocator().resource() : nullptr;
+			}
+
+			///	Copy $len bytes from $fill into a payload allocated from
+			///		$memory.
+			template <typename Fill>
+			static SerialPayload Allocate(size_t len, std::pmr::memory_resource* memory, Fill&& fill)
+			{
+				//	the string is built with the same allocator as its control block
+				std::shared_ptr<SerialString> data = std::allocate_shared<SerialString>(
+					std::pmr::polymorphic_allocator<SerialString>(memory), len, '\0');
+				fill(&(*data)[0], len);
+				return SerialPayload(std::move(data));
+			}
+
+		private:
+			std::shared_ptr<const SerialString> m_data;
+		};
+
+
+
+		///	A reusable byte buffer whose storage comes from a memory
+		///		resource. It grows to the largest size asked for, and is
+		///		otherwise kept, so a steady stream of requests allocates
+		///		nothing.
+		class SerialScratch final
+		{
+		public:
+			explicit SerialScratch(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+				: m_memory(memory)
+			{
+			}
+
+			~SerialScratch() { release(); }
+
+			SerialScratch(const SerialScratch&) = delete;
+			SerialScratch& operator=(const SerialScratch&) = delete;
+
+			///	Storage for at least $len bytes. Its contents are not kept
+			///		when it grows.
+			uint8_t* Reserve(size_t len)
+			{
+				if (len > m_capacity)
+				{
+					release();
+					m_data = static_cast<uint8_t*>(m_memory->allocate(len));
+					m_capacity = len;
+				}
+				return m_data;
+			}
+
+			///	Release the storage and take it from $memory from now on.
+			void Memory(std::pmr::memory_resource* memory)
+			{
+				release();
+				m_memory = memory;
+			}
+
+			size_t Capacity() const { return m_capacity; }
+
+		private:
+			void release()
+			{
+				if (m_data) m_memory->deallocate(m_data, m_capacity);
+				m_data = nullptr;
+				m_capacity = 0;
+			}
+
+		private:
+			std::pmr::memory_resource* m_memory;
+			uint8_t* m_data = nullptr;
+			size_t m_capacity = 0;
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALMEMORY_H_
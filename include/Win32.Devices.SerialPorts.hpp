@@ -0,0 +1,98 @@
+/******************************************************************************
+*	Discovery and bulk opening of serial ports.
+*
+*	\file Win32.Devices.SerialPorts.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALPORTS_H_
+#define WIN32_DEVICES_SERIALPORTS_H_
+
+#include "Win32.Devices.SerialDevice.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Ports opened at once by SerialPorts::Open by default.
+		constexpr size_t SerialOpenConcurrency = 16;
+
+
+		///	A serial port found by SerialPorts::Enumerate.
+		struct SerialPortInfo
+		{
+			std::string path;			///< Path to open, i.e. "/dev/ttyUSB0" or "\\\\.\\COM3".
+			std::string driver;			///< The kernel driver, i.e. "ftdi_sio".
+			uint16_t vendorId = 0;		///< USB vendor ID, 0 if not USB.
+			uint16_t productId = 0;		///< USB product ID, 0 if not USB.
+			std::string serialNumber;	///< USB serial number, if reported.
+			std::string manufacturer;	///< USB manufacturer, if reported.
+			std::string product;		///< USB product, if reported.
+
+			bool IsUsb() const { return vendorId != 0; }
+		};
+
+
+		///	The outcome of opening one port of a bulk open.
+		struct SerialOpenResult
+		{
+			std::string path;
+
+			///	The open port, or nullptr if it could not be opened.
+			std::unique_ptr<SerialDevice> device;
+
+			///	Why the port failed to open or take its settings; empty
+			///		on success. A port that opened but refused its settings
+			///		is still returned in $device.
+			std::string error;
+
+			bool Ok() const { return device && error.empty(); }
+		};
+
+
+
+		///	Finds and opens serial ports.
+		class SerialPorts final
+		{
+		public:
+			SerialPorts() = delete;
+
+			static std::vector<SerialPortInfo> Enumerate();
+#ifdef SERIAL_BACKEND_POSIX
+			static std::vector<SerialPortInfo> Enumerate(const std::string& sysClassTty);
+#endif // SERIAL_BACKEND_POSIX
+
+			static std::vector<SerialOpenResult> Open(const std::vector<std::string>& paths,
+				const SerialSettings& settings = SerialSettings(),
+				size_t concurrency = SerialOpenConcurrency);
+
+		private:
+			static void open_one(SerialOpenResult& result, const SerialSettings& settings);
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALPORTS_H_
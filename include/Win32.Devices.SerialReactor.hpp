@@ -0,0 +1,106 @@
+/******************************************************************************
+*	Shared event reactor multiplexing many serial devices onto a small,
+*		fixed pool of threads.
+*
+*	\file Win32.Devices.SerialReactor.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALREACTOR_H_
+#define WIN32_DEVICES_SERIALREACTOR_H_
+
+#include "Win32.Devices.SerialDevice.hpp"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Win32
+{
+	namespace Devices
+	{
+#ifdef SERIAL_BACKEND_POSIX
+		///	A shared reactor for serial devices.
+		///	Attached devices raise $ReceivedData from one of the reactor's
+		///		threads instead of owning a thread each. Readiness is
+		///		awaited with epoll; an eventfd wakes the pool for shutdown.
+		///		A device is dispatched by at most one thread at a time, and
+		///		a device detached from its own handler is released once the
+		///		handler returns.
+		class SerialReactor final
+		{
+		public:
+			explicit SerialReactor(unsigned threadCount = 1);
+			~SerialReactor();
+
+			SerialReactor(const SerialReactor&) = delete;
+			SerialReactor& operator=(const SerialReactor&) = delete;
+
+			void Attach(SerialDevice& device);
+			void Detach(SerialDevice& device);
+			void Stop();
+
+			size_t Attached() const;
+
+		private:
+			///	A device registered with the reactor.
+			struct Registration
+			{
+				SerialDevice* device;
+				bool dispatching;
+				bool detached;
+				std::thread::id dispatcher;
+			};
+
+			void worker_thread();
+			void dispatch(int fd, uint32_t events);
+
+		private:
+			///	The epoll instance.
+			int m_epoll = -1;
+
+			///	Event used to wake the pool on shutdown.
+			int m_wakeup = -1;
+
+			///	Registered devices by descriptor.
+			std::unordered_map<int, std::unique_ptr<Registration>> m_registry;
+
+			///	Guards the registry.
+			mutable std::mutex m_registryLock;
+
+			///	Signals the end of a dispatch to $Detach.
+			std::condition_variable m_dispatchDone;
+
+			///	The thread pool.
+			std::vector<std::thread> m_workers;
+
+			///	Cleared to stop the pool.
+			std::atomic<bool> m_running;
+		};
+#endif // SERIAL_BACKEND_POSIX
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALREACTOR_H_
@@ -0,0 +1,204 @@
+/******************************************************************************
+*	Single-producer/single-consumer byte ring for serial receive data.
+*
+*	\file Win32.Devices.SerialRingBuffer.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALRINGBUFFER_H_
+#define WIN32_DEVICES_SERIALRINGBUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Size of a cache line, keeping producer and consumer indices apart.
+		constexpr size_t SerialCacheLine = 64;
+
+
+		///	A lock-free single-producer/single-consumer byte ring.
+		///	The buffer is allocated once; the producer writes into
+		///		contiguous free space with $Prepare/$Commit and the consumer
+		///		reads contiguous slices in place with $Peek/$Consume.
+		///		Indices run freely and are masked, so the capacity is a
+		///		power of two. The buffer comes from a memory resource, i.e.
+		///		a device's $SerialBlockPool.
+		class alignas(SerialCacheLine) SerialRingBuffer final
+		{
+		public:
+			explicit SerialRingBuffer(size_t capacity,
+				std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+				: m_mask(round_up(capacity) - 1)
+				, m_memory(memory)
+				, m_data(static_cast<uint8_t*>(m_memory->allocate(m_mask + 1, SerialCacheLine)))
+			{
+			}
+
+			~SerialRingBuffer()
+			{
+				m_memory->deallocate(m_data, Capacity(), SerialCacheLine);
+			}
+
+			SerialRingBuffer(const SerialRingBuffer&) = delete;
+			SerialRingBuffer& operator=(const SerialRingBuffer&) = delete;
+
+			///	The memory holding the buffer.
+			std::pmr::memory_resource* Memory() const { return m_memory; }
+
+			///	Total capacity in bytes.
+			size_t Capacity() const { return m_mask + 1; }
+
+			///	Bytes ready for the consumer.
+			size_t Size() const
+			{
+				return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+			}
+
+			///	Bytes free for the producer.
+			size_t Free() const { return Capacity() - Size(); }
+
+
+			/*	Producer	*/
+
+			///	Contiguous free space for the producer to fill.
+			///	\param[out] len The length of the returned region.
+			uint8_t* Prepare(size_t& len)
+			{
+				size_t head = m_head.load(std::memory_order_relaxed);
+				size_t tail = m_tail.load(std::memory_order_acquire);
+				size_t offset = head & m_mask;
+
+				len = (std::min)(Capacity() - (head - tail), Capacity() - offset);
+				return m_data + offset;
+			}
+
+			///	Publish bytes written into the prepared region.
+			void Commit(size_t len)
+			{
+				m_head.store(m_head.load(std::memory_order_relaxed) + len, std::memory_order_release);
+			}
+
+			///	Copy bytes in, returning how many fit.
+			size_t Write(const void* src, size_t len)
+			{
+				const uint8_t* bytes = static_cast<const uint8_t*>(src);
+				size_t written = 0;
+				while (written < len)
+				{
+					size_t span = 0;
+					uint8_t* dest = Prepare(span);
+					if (!span) break;
+
+					span = (std::min)(span, len - written);
+					std::memcpy(dest, bytes + written, span);
+					Commit(span);
+					written += span;
+				}
+				return written;
+			}
+
+
+			/*	Consumer	*/
+
+			///	Contiguous readable slice, valid until the next $Consume.
+			///	\param[out] len The length of the returned slice.
+			const uint8_t* Peek(size_t& len) const
+			{
+				size_t tail = m_tail.load(std::memory_order_relaxed);
+				size_t head = m_head.load(std::memory_order_acquire);
+				size_t offset = tail & m_mask;
+
+				len = (std::min)(head - tail, Capacity() - offset);
+				return m_data + offset;
+			}
+
+			///	Contiguous readable slice starting $offset bytes in, without
+			///		consuming. The offset must not exceed $Size.
+			///	\param[out] len The length of the returned slice.
+			const uint8_t* Peek(size_t offset, size_t& len) const
+			{
+				size_t tail = m_tail.load(std::memory_order_relaxed) + offset;
+				size_t head = m_head.load(std::memory_order_acquire);
+				size_t at = tail & m_mask;
+
+				len = (std::min)(head - tail, Capacity() - at);
+				return m_data + at;
+			}
+
+			///	Release bytes back to the producer.
+			void Consume(size_t len)
+			{
+				m_tail.store(m_tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+			}
+
+			///	Copy bytes out, returning how many were read.
+			size_t Read(void* dest, size_t len)
+			{
+				uint8_t* bytes = static_cast<uint8_t*>(dest);
+				size_t read = 0;
+				while (read < len)
+				{
+					size_t span = 0;
+					const uint8_t* src = Peek(span);
+					if (!span) break;
+
+					span = (std::min)(span, len - read);
+					std::memcpy(bytes + read, src, span);
+					Consume(span);
+					read += span;
+				}
+				return read;
+			}
+
+		private:
+			static size_t round_up(size_t capacity)
+			{
+				size_t pow2 = SerialCacheLine;
+				while (pow2 < capacity) pow2 <<= 1;
+				return pow2;
+			}
+
+		private:
+			///	Capacity - 1.
+			const size_t m_mask;
+
+			///	The preallocated, line aligned storage.
+			std::pmr::memory_resource* const m_memory;
+			uint8_t* const m_data;
+
+			///	Written by the producer.
+			alignas(SerialCacheLine) std::atomic<size_t> m_head = { 0 };
+
+			///	Written by the consumer.
+			alignas(SerialCacheLine) std::atomic<size_t> m_tail = { 0 };
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALRINGBUFFER_H_
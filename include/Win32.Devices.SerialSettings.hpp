@@ -0,0 +1,153 @@
+/******************************************************************************
+*	Line settings of a serial device.
+*
+*	\file Win32.Devices.SerialSettings.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALSETTINGS_H_
+#define WIN32_DEVICES_SERIALSETTINGS_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/// The number of bits per byte.
+		enum class SerialByteSize
+		{
+			Byte_Size7b = 7,	///< 7 bits per byte.
+			Byte_Size8b = 8		///< 8 bits per byte.
+		};
+
+
+		/// The number of stop bits per transaction.
+		///	Values match the win32 ONESTOPBIT, ONE5STOPBITS and TWOSTOPBITS.
+		enum class SerialStopBits
+		{
+			StopBits_1 = 0,		///< 1 stop bit.
+			StopBits_1_5 = 1,	///< 1.5 stop bits.
+			StopBits_2 = 2		///< 2 stop bits.
+		};
+
+
+		///	The parity bit.
+		///	Values match the win32 NOPARITY through SPACEPARITY.
+		enum class SerialParity
+		{
+			None = 0,	///< No parity bit.
+			Odd = 1,	///< Odd parity.
+			Even = 2,	///< Even parity.
+			Mark = 3,	///< Parity bit always set.
+			Space = 4	///< Parity bit always clear.
+		};
+
+
+		///	Flow control of the line.
+		enum class SerialFlowControl
+		{
+			None,		///< No flow control.
+			RtsCts,		///< Hardware flow control on RTS and CTS.
+			XonXoff		///< Software flow control with XON and XOFF.
+		};
+
+
+		///	Bits on the wire per character: start, data, parity and stop.
+		///		1.5 stop bits are counted as 2.
+		constexpr uint32_t SerialCharacterBits(SerialByteSize byteSize, SerialParity parity, SerialStopBits stopBits)
+		{
+			return 1
+				+ (uint32_t)byteSize
+				+ ((parity != SerialParity::None) ? 1 : 0)
+				+ ((stopBits == SerialStopBits::StopBits_1) ? 1 : 2);
+		}
+
+
+		///	Time one character of $bitsPerChar bits takes on the wire.
+		constexpr std::chrono::nanoseconds SerialCharacterTime(uint32_t baudRate, uint32_t bitsPerChar)
+		{
+			return std::chrono::nanoseconds(1000000000ll * bitsPerChar / baudRate);
+		}
+
+
+		///	Port timeouts, in milliseconds, as the win32 COMMTIMEOUTS. The
+		///		POSIX backend bounds writes by the write timeouts; its reads
+		///		wait as long as each Read call asks.
+		struct SerialTimeouts
+		{
+			uint32_t readInterval = 50;				///< Longest gap between two received bytes.
+			uint32_t readTotalConstant = 50;		///< Added to the total of a read.
+			uint32_t readTotalMultiplier = 10;		///< Per byte of a read.
+			uint32_t writeTotalConstant = 50;		///< Added to the total of a write.
+			uint32_t writeTotalMultiplier = 10;		///< Per byte of a write.
+
+			bool operator==(const SerialTimeouts& other) const
+			{
+				return readInterval == other.readInterval
+					&& readTotalConstant == other.readTotalConstant
+					&& readTotalMultiplier == other.readTotalMultiplier
+					&& writeTotalConstant == other.writeTotalConstant
+					&& writeTotalMultiplier == other.writeTotalMultiplier;
+			}
+			bool operator!=(const SerialTimeouts& other) const { return !(*this == other); }
+		};
+
+
+		///	Every setting of a port, applied together by
+		///		SerialDevice::Configure. The defaults are those a port is
+		///		opened with.
+		struct SerialSettings
+		{
+			uint32_t baudRate = 9600U;
+			SerialByteSize byteSize = SerialByteSize::Byte_Size8b;
+			SerialParity parity = SerialParity::None;
+			SerialStopBits stopBits = SerialStopBits::StopBits_1;
+			SerialFlowControl flowControl = SerialFlowControl::RtsCts;
+			SerialTimeouts timeouts;
+
+			constexpr uint32_t CharacterBits() const
+			{
+				return SerialCharacterBits(byteSize, parity, stopBits);
+			}
+
+			///	Whether the line itself differs, the timeouts aside.
+			bool LineDiffers(const SerialSettings& other) const
+			{
+				return baudRate != other.baudRate
+					|| byteSize != other.byteSize
+					|| parity != other.parity
+					|| stopBits != other.stopBits
+					|| flowControl != other.flowControl;
+			}
+
+			bool operator==(const SerialSettings& other) const
+			{
+				return !LineDiffers(other) && timeouts == other.timeouts;
+			}
+			bool operator!=(const SerialSettings& other) const { return !(*this == other); }
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALSETTINGS_H_
@@ -0,0 +1,174 @@
+/******************************************************************************
+*	Received data shared with other processes through a named memory ring.
+*
+*	\file Win32.Devices.SerialShared.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALSHARED_H_
+#define WIN32_DEVICES_SERIALSHARED_H_
+
+#if !defined(SERIAL_BACKEND_POSIX) && defined(WIN32)
+#include <windows.h>
+#endif // !SERIAL_BACKEND_POSIX
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "Win32.Devices.SerialBroadcast.hpp"
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Capacity of a shared ring.
+		constexpr size_t SerialSharedSize = 0x100000ul;
+
+		///	Identifies a shared ring, and its layout version.
+		constexpr char SerialSharedMagic[8] = { 'S', 'E', 'R', 'S', 'H', 'M', '0', '1' };
+
+
+		///	Start of a shared ring; the data follows. Written by the
+		///		publisher only, so readers may map it read-only.
+		struct SerialSharedHeader
+		{
+			char magic[8];							///< "SERSHM01".
+			uint64_t capacity;						///< Bytes of data, a power of two.
+			std::atomic<uint32_t> open;				///< 1 while the publisher lives.
+
+			///	Bytes published.
+			alignas(SerialCacheLine) std::atomic<uint64_t> head;
+
+			///	Bytes being published; runs ahead of $head during a copy.
+			std::atomic<uint64_t> reserved;
+
+			///	Bumped after every publish, for readers to sleep on.
+			alignas(SerialCacheLine) std::atomic<uint32_t> signal;
+		};
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring positions must be lock-free");
+		static_assert(sizeof(SerialSharedHeader) % SerialCacheLine == 0, "shared ring data must start on a cache line");
+
+
+
+		///	Writes received data into a named shared-memory ring, for readers
+		///		in other processes. Publishing is a copy and never waits on
+		///		a reader: the publisher announces each overwrite before it
+		///		makes it, and a reader that falls a whole ring behind notices
+		///		and skips ahead, as a DropOldest subscriber of a broadcast.
+		class SerialSharedPublisher final
+		{
+		public:
+			explicit SerialSharedPublisher(const std::string& name, size_t capacity = SerialSharedSize);
+			~SerialSharedPublisher();
+
+			SerialSharedPublisher(const SerialSharedPublisher&) = delete;
+			SerialSharedPublisher& operator=(const SerialSharedPublisher&) = delete;
+
+			void Publish(const void* data, size_t len);
+
+			uint64_t Published() const;
+			size_t Capacity() const { return m_mask + 1; }
+			const std::string& Name() const { return m_name; }
+
+		private:
+			bool map(size_t capacity);
+			void unmap();
+			void wake();
+
+		private:
+			///	The name readers attach by.
+			const std::string m_name;
+
+			///	The mapping: header, then data.
+			SerialSharedHeader* m_header = nullptr;
+			uint8_t* m_data = nullptr;
+
+			///	Capacity - 1.
+			size_t m_mask = 0;
+
+#ifdef SERIAL_BACKEND_POSIX
+			int m_file = -1;
+#else
+			HANDLE m_mapping = nullptr;
+#endif // SERIAL_BACKEND_POSIX
+		};
+
+
+
+		///	Follows a shared ring from another process, mapped read-only,
+		///		with a cursor of its own. $Peek returns data in place; it
+		///		holds only while $Consume of it succeeds, as the publisher
+		///		may overtake a slow reader at any time. Use a reader from one
+		///		thread.
+		class SerialSharedReader final
+		{
+		public:
+			explicit SerialSharedReader(const std::string& name);
+			~SerialSharedReader();
+
+			SerialSharedReader(const SerialSharedReader&) = delete;
+			SerialSharedReader& operator=(const SerialSharedReader&) = delete;
+
+			std::string_view Peek(std::chrono::milliseconds timeout);
+			bool Consume(size_t len);
+			size_t Read(void* dest, size_t len, std::chrono::milliseconds timeout);
+
+			size_t Available() const;
+			SerialSubscriberStats Stats() const;
+			size_t Capacity() const { return m_mask + 1; }
+
+		private:
+			bool overtaken() const;
+			void overflow();
+			bool await_data(std::chrono::milliseconds timeout);
+			void unmap();
+
+		private:
+			///	The mapping: header, then data.
+			const SerialSharedHeader* m_header = nullptr;
+			const uint8_t* m_data = nullptr;
+			size_t m_mapped = 0;
+
+			///	Capacity - 1.
+			size_t m_mask = 0;
+
+			///	Bytes consumed, in ring positions.
+			uint64_t m_cursor = 0;
+
+			uint64_t m_delivered = 0;
+			uint64_t m_dropped = 0;
+			uint64_t m_overflows = 0;
+
+#ifdef SERIAL_BACKEND_POSIX
+			int m_file = -1;
+#else
+			HANDLE m_mapping = nullptr;
+#endif // SERIAL_BACKEND_POSIX
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALSHARED_H_
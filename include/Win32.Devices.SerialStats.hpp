@@ -0,0 +1,148 @@
+/******************************************************************************
+*	Counters and latency histograms for a serial device.
+*
+*	\file Win32.Devices.SerialStats.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALSTATS_H_
+#define WIN32_DEVICES_SERIALSTATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	A log-linear latency histogram, in nanoseconds.
+		///	Values are bucketed by power of two, each split into 16 linear
+		///		sub-buckets, so any recorded value is known to within
+		///		6.25%. Recording is a single relaxed atomic increment.
+		class SerialHistogram final
+		{
+		public:
+			///	Linear sub-buckets per power of two, as a power of two.
+			static constexpr unsigned SubBucketBits = 4;
+			static constexpr size_t SubBuckets = (size_t)1 << SubBucketBits;
+			static constexpr size_t Buckets = SubBuckets + (64 - SubBucketBits) * SubBuckets;
+
+
+			///	A copy of the histogram's counts.
+			struct Snapshot
+			{
+				std::vector<uint64_t> counts;
+
+				uint64_t Count() const;
+				uint64_t Percentile(double percentile) const;
+				uint64_t Max() const;
+			};
+
+
+			SerialHistogram() = default;
+			SerialHistogram(const SerialHistogram&) = delete;
+			SerialHistogram& operator=(const SerialHistogram&) = delete;
+
+			void Record(uint64_t nanos)
+			{
+				m_counts[bucket_of(nanos)].fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void Record(std::chrono::steady_clock::time_point since)
+			{
+				auto elapsed = std::chrono::steady_clock::now() - since;
+				Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+			}
+
+			Snapshot Read() const;
+
+			static size_t bucket_of(uint64_t value);
+			static uint64_t upper_bound(size_t bucket);
+
+		private:
+			std::atomic<uint64_t> m_counts[Buckets] = {};
+		};
+
+
+		///	Live counters, updated by the device's hot paths.
+		struct SerialCounters
+		{
+			std::atomic<uint64_t> bytesIn = { 0 };
+			std::atomic<uint64_t> bytesOut = { 0 };
+			std::atomic<uint64_t> readCalls = { 0 };
+			std::atomic<uint64_t> writeCalls = { 0 };
+			std::atomic<uint64_t> commEvents = { 0 };
+			std::atomic<uint64_t> timeouts = { 0 };
+			std::atomic<uint64_t> overruns = { 0 };
+			std::atomic<uint64_t> framingErrors = { 0 };
+			std::atomic<uint64_t> parityErrors = { 0 };
+
+			///	From the start of a write to its completion.
+			SerialHistogram writeLatency;
+
+			///	From the event thread waking on data to raising the event.
+			SerialHistogram rxLatency;
+
+			///	When the event thread last woke on data. Event thread only.
+			std::chrono::steady_clock::time_point rxArrival;
+		};
+
+
+		///	A snapshot of a device's statistics.
+		struct SerialStats
+		{
+			uint64_t bytesIn = 0;			///< Bytes read from the port.
+			uint64_t bytesOut = 0;			///< Bytes written to the port.
+			uint64_t readCalls = 0;			///< Read system calls.
+			uint64_t writeCalls = 0;		///< Write system calls.
+			uint64_t commEvents = 0;		///< Event thread or reactor wakeups on data.
+			uint64_t timeouts = 0;			///< Reads and writes that timed out.
+			uint64_t overruns = 0;			///< Hardware or input buffer overruns.
+			uint64_t framingErrors = 0;		///< Framing errors.
+			uint64_t parityErrors = 0;		///< Parity errors.
+
+			SerialHistogram::Snapshot writeLatency;
+			SerialHistogram::Snapshot rxLatency;
+		};
+	}
+}
+
+
+
+//	Instrumentation of the hot paths. Compiled out unless SERIAL_STATS is
+//		defined; otherwise a single branch on the device's counters.
+#ifdef SERIAL_STATS
+#define SERIAL_STATS_ADD(counters, counter, n)	\
+	do { if (counters) (counters)->counter.fetch_add((n), std::memory_order_relaxed); } while (0)
+#define SERIAL_STATS_TIMER(counters, name)	\
+	const std::chrono::steady_clock::time_point name = (counters) ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()
+#define SERIAL_STATS_RECORD(counters, histogram, since)	\
+	do { if (counters) (counters)->histogram.Record(since); } while (0)
+#else
+#define SERIAL_STATS_ADD(counters, counter, n)				do { } while (0)
+#define SERIAL_STATS_TIMER(counters, name)					do { } while (0)
+#define SERIAL_STATS_RECORD(counters, histogram, since)		do { } while (0)
+#endif // SERIAL_STATS
+
+#endif	// !WIN32_DEVICES_SERIALSTATS_H_
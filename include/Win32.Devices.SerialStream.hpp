@@ -0,0 +1,116 @@
+/******************************************************************************
+*	Standard iostreams over a serial device.
+*
+*	\file Win32.Devices.SerialStream.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALSTREAM_H_
+#define WIN32_DEVICES_SERIALSTREAM_H_
+
+#include "Win32.Devices.SerialDevice.hpp"
+#include "Win32.Devices.SerialMemory.hpp"
+
+#include <chrono>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Default size of the get and put areas of a $SerialStreamBuf.
+		constexpr size_t SerialStreamBufferSize = 0x10000ul;
+
+
+		///	A std::streambuf over a serial device.
+		///	The get area is refilled by one ReadSome of up to its size, so
+		///		parsing a stream costs a read per buffer, not per call. A
+		///		refill waits up to $ReadTimeout; on timeout the stream sees
+		///		end of file, and may be cleared and read again. The put area
+		///		is written when full, and on flush or sync, which return once
+		///		the device took it; larger writes go straight through. Both
+		///		areas come from the device's memory.
+		///	Reads need SerialRxDelivery::Buffered while events are in use.
+		///		Use from one thread.
+		class SerialStreamBuf : public std::streambuf
+		{
+		public:
+			explicit SerialStreamBuf(SerialDevice& device,
+				size_t getSize = SerialStreamBufferSize, size_t putSize = SerialStreamBufferSize);
+			~SerialStreamBuf() override;
+
+			SerialStreamBuf(const SerialStreamBuf&) = delete;
+			SerialStreamBuf& operator=(const SerialStreamBuf&) = delete;
+
+			void ReadTimeout(std::chrono::milliseconds timeout) { m_timeout = timeout; }
+			std::chrono::milliseconds ReadTimeout() const { return m_timeout; }
+
+			///	Whether the last refill ended for want of data.
+			bool TimedOut() const { return m_timedOut; }
+
+			SerialDevice& Device() { return m_device; }
+
+		protected:
+			int_type underflow() override;
+			int_type overflow(int_type ch) override;
+			std::streamsize xsputn(const char_type* src, std::streamsize count) override;
+			std::streamsize showmanyc() override;
+			int sync() override;
+
+		private:
+			bool flush_put();
+
+		private:
+			SerialDevice& m_device;
+
+			SerialScratch m_get;
+			SerialScratch m_put;
+			const size_t m_getSize;
+			const size_t m_putSize;
+
+			std::chrono::milliseconds m_timeout = SerialAwaitForever;
+			bool m_timedOut = false;
+		};
+
+
+		///	A std::iostream over a serial device, through its own
+		///		$SerialStreamBuf.
+		class SerialStream : public std::iostream
+		{
+		public:
+			explicit SerialStream(SerialDevice& device,
+				size_t getSize = SerialStreamBufferSize, size_t putSize = SerialStreamBufferSize);
+
+			SerialStreamBuf* rdbuf() { return &m_buffer; }
+
+			void ReadTimeout(std::chrono::milliseconds timeout) { m_buffer.ReadTimeout(timeout); }
+			bool TimedOut() const { return m_buffer.TimedOut(); }
+
+		private:
+			SerialStreamBuf m_buffer;
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALSTREAM_H_
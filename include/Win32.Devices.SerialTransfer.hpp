@@ -0,0 +1,216 @@
+/******************************************************************************
+*	XMODEM-1K and YMODEM file transfer.
+*
+*	\file Win32.Devices.SerialTransfer.hpp
+*	\author Jensen Miller
+*
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALTRANSFER_H_
+#define WIN32_DEVICES_SERIALTRANSFER_H_
+
+#include "Win32.Devices.SerialDevice.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Framing bytes of XMODEM and YMODEM.
+		namespace Xmodem
+		{
+			constexpr uint8_t SOH = 0x01;	///< Starts a 128 byte block.
+			constexpr uint8_t STX = 0x02;	///< Starts a 1024 byte block.
+			constexpr uint8_t EOT = 0x04;	///< Ends the file.
+			constexpr uint8_t ACK = 0x06;	///< Block received.
+			constexpr uint8_t NAK = 0x15;	///< Block refused, send it again.
+			constexpr uint8_t CAN = 0x18;	///< Two in a row cancel the transfer.
+			constexpr uint8_t SUB = 0x1A;	///< Pads the last block.
+			constexpr uint8_t CRC = 'C';	///< Receiver ready, with CRC-16.
+			constexpr uint8_t WINDOW = 'W';	///< Receiver ready for windowed transfer.
+		}
+
+
+		///	Blocks in flight by default in windowed transfers.
+		constexpr size_t SerialTransferWindow = 8;
+
+
+		///	The protocol a transfer speaks.
+		enum class SerialTransferProtocol
+		{
+			Xmodem1k,	///< XMODEM with 1024 byte blocks and CRC-16.
+			Ymodem,		///< XMODEM-1K preceded by a block of the file's name and size.
+			Windowed	///< XMODEM-1K with several blocks in flight, if the receiver starts with 'W'.
+						///< Every ACK and NAK is then followed by the number of the block it refers to.
+		};
+
+
+		///	How a transfer behaves.
+		struct SerialTransferOptions
+		{
+			SerialTransferProtocol protocol = SerialTransferProtocol::Xmodem1k;
+
+			///	Blocks sent ahead of their acknowledgement, for Windowed.
+			///		At most 127, so block numbers stay unambiguous.
+			size_t window = SerialTransferWindow;
+
+			///	Times a block, or the end, is sent before giving up.
+			uint32_t retries = 10;
+
+			///	How long to wait for the receiver to start.
+			std::chrono::milliseconds startTimeout = std::chrono::milliseconds(60000);
+
+			///	How long to wait for a block to be acknowledged.
+			std::chrono::milliseconds blockTimeout = std::chrono::milliseconds(10000);
+		};
+
+
+		///	How far a transfer has got.
+		struct SerialTransferProgress
+		{
+			uint64_t bytes = 0;			///< File bytes acknowledged.
+			uint64_t total = 0;			///< File bytes to send.
+			uint32_t blocks = 0;		///< Blocks acknowledged.
+			uint32_t retries = 0;		///< Blocks sent again.
+			std::chrono::nanoseconds elapsed = std::chrono::nanoseconds(0);
+
+			///	The rate the line would carry the file at, in bytes per
+			///		second, i.e. 11520 at 115200 baud 8N1.
+			double lineRate = 0;
+
+			///	File bytes acknowledged per second.
+			double Throughput() const
+			{
+				return elapsed.count() ? (double)bytes * 1e9 / (double)elapsed.count() : 0.0;
+			}
+
+			///	$Throughput as a fraction of $lineRate; what framing,
+			///		acknowledgements and retries leave of the line.
+			double Efficiency() const
+			{
+				return lineRate > 0 ? Throughput() / lineRate : 0.0;
+			}
+		};
+
+
+		///	The outcome of a transfer.
+		struct SerialTransferResult
+		{
+			SerialTransferProgress progress;
+
+			///	Why the transfer failed; empty on success.
+			std::string error;
+
+			bool Ok() const { return error.empty(); }
+		};
+
+
+		///	Handler signature for transfer progress, raised per acknowledged block.
+		using OnTransferProgress = corezero::Delegate<void(const SerialTransferProgress&)>;
+
+
+
+		///	A file mapped read-only, so its blocks are written to the port
+		///		straight from the mapping.
+		class SerialMappedFile final
+		{
+		public:
+			explicit SerialMappedFile(const std::string& path);
+			~SerialMappedFile();
+
+			SerialMappedFile(const SerialMappedFile&) = delete;
+			SerialMappedFile& operator=(const SerialMappedFile&) = delete;
+
+			const uint8_t* Data() const { return m_base; }
+			size_t Size() const { return m_size; }
+
+		private:
+			void unmap();
+
+		private:
+			const uint8_t* m_base = nullptr;
+			size_t m_size = 0;
+
+#ifdef SERIAL_BACKEND_POSIX
+			int m_file = -1;
+#else
+			HANDLE m_file = INVALID_HANDLE_VALUE;
+			HANDLE m_mapping = nullptr;
+#endif // SERIAL_BACKEND_POSIX
+		};
+
+
+
+		///	Sends files to a receiver on the port, i.e. a bootloader.
+		///	Blocks are written as one gathered write of header, file data
+		///		and CRC, the data taken from the caller's memory or a file
+		///		mapping without copying. Responses are read with ReadSome, so
+		///		the device must not be raising received data elsewhere.
+		class SerialTransfer final
+		{
+		public:
+			explicit SerialTransfer(SerialDevice& device, const SerialTransferOptions& options = SerialTransferOptions());
+
+			SerialTransfer(const SerialTransfer&) = delete;
+			SerialTransfer& operator=(const SerialTransfer&) = delete;
+
+			SerialTransferResult SendFile(const std::string& path);
+			SerialTransferResult Send(const void* data, size_t len, const std::string& name = std::string());
+
+			corezero::Event<OnTransferProgress> Progress;
+
+		private:
+			bool await_start(std::string& error);
+			bool send_header(const std::string& name, size_t len, std::string& error);
+			bool send_stop_and_wait(std::string& error);
+			bool send_windowed(std::string& error);
+			bool send_end(std::string& error);
+
+			size_t block_count() const;
+			void write_block(size_t index);
+			void write_block(uint8_t number, const uint8_t* data, size_t len, size_t size);
+			int await_response(std::chrono::milliseconds timeout, int& number);
+			void purge();
+			void acknowledged(size_t index);
+			void cancel();
+
+		private:
+			SerialDevice& m_device;
+			SerialTransferOptions m_options;
+
+			///	The file being sent.
+			const uint8_t* m_data = nullptr;
+			size_t m_length = 0;
+
+			///	Whether the receiver asked for a windowed transfer.
+			bool m_windowed = false;
+
+			SerialTransferProgress m_progress;
+			std::chrono::steady_clock::time_point m_started;
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALTRANSFER_H_
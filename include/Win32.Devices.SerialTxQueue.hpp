@@ -0,0 +1,191 @@
+/******************************************************************************
+*	Bounded transmit queue that pipelines and coalesces writes.
+*
+*	\file Win32.Devices.SerialTxQueue.hpp
+*	\author Jensen Miller
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_SERIALTXQUEUE_H_
+#define WIN32_DEVICES_SERIALTXQUEUE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <future>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Win32.Devices.SerialBuffer.hpp"
+#include "Win32.Devices.SerialMemory.hpp"
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Default number of buffers in flight per device.
+		constexpr size_t SerialTxQueueDepth = 16;
+
+
+		///	Order in which queued buffers go out. Buffers of one priority
+		///		keep the order they were pushed in.
+		enum class SerialTxPriority
+		{
+			Normal,		///< Bulk data, i.e. a firmware upload.
+			High		///< Control frames, written ahead of any Normal buffer still queued.
+		};
+
+
+		///	A bounded multi-producer transmit queue.
+		///	Producers on any thread hand over whole frames and continue; a
+		///		single writer thread takes everything queued at once and
+		///		passes it to the sink as one gathered write, High buffers
+		///		first. A frame is one buffer, so frames are never interleaved.
+		///	Pushing is lock-free: a lock is only taken to wake a sleeping
+		///		writer, or while $Depth buffers are in flight and the
+		///		producer has to wait. Queued buffers are copied, and
+		///		their futures made, in the queue's memory.
+		class SerialTxQueue final
+		{
+		public:
+			///	Writes buffers to the port in order, returning how many bytes
+			///		were written.
+			using Sink = std::function<size_t(const SerialBuffer*, size_t)>;
+
+			SerialTxQueue(Sink sink, size_t depth = SerialTxQueueDepth,
+				std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+			~SerialTxQueue();
+
+			SerialTxQueue(const SerialTxQueue&) = delete;
+			SerialTxQueue& operator=(const SerialTxQueue&) = delete;
+
+			std::future<size_t> Push(SerialBuffer data, SerialTxPriority priority = SerialTxPriority::Normal);
+			std::future<size_t> Push(std::initializer_list<SerialBuffer> frame, SerialTxPriority priority = SerialTxPriority::Normal);
+			void Flush();
+			void Stop();
+
+			size_t Depth() const { return m_depth; }
+			std::pmr::memory_resource* Memory() const { return m_memory; }
+			size_t Pending() const { return m_pending.load(std::memory_order_acquire); }
+			uint64_t Batches() const { return m_batches.load(std::memory_order_relaxed); }
+
+		private:
+			///	A buffer awaiting transmission.
+			struct Request
+			{
+				SerialString data;
+				std::promise<size_t> done;
+			};
+
+
+			///	A queued request, linked by producers.
+			struct Node
+			{
+				Node() = default;
+				Node(SerialString data, std::promise<size_t> done)
+					: request{ std::move(data), std::move(done) }
+				{
+				}
+
+				std::atomic<Node*> next = { nullptr };
+				Request request;
+			};
+
+
+			///	An intrusive MPSC list of one priority. Producers swap
+			///		themselves in at the tail; only the writer moves the
+			///		head, which always points at a spent node.
+			struct Lane
+			{
+				Lane() : tail(&stub), head(&stub) {}
+				void Clear(std::pmr::memory_resource* memory);
+
+				void Push(Node* node);
+				bool Pop(std::vector<Request>& batch, std::pmr::memory_resource* memory);
+				bool Empty() const;
+
+				Node stub;
+				std::atomic<Node*> tail;
+				Node* head;
+			};
+
+			bool reserve();
+			void unreserve(size_t count);
+			void wake_writer();
+			bool idle() const;
+			size_t take(std::vector<Request>& batch);
+			std::future<size_t> push(const SerialBuffer* parts, size_t count, SerialTxPriority priority);
+			static void free_node(Node* node, std::pmr::memory_resource* memory);
+			void writer_thread();
+
+		private:
+			///	Destination of coalesced writes.
+			Sink m_sink;
+
+			///	Maximum buffers in flight.
+			const size_t m_depth;
+
+			///	Holds queued buffers and the state of their futures.
+			std::pmr::memory_resource* const m_memory;
+
+			///	Buffers not yet written, by priority.
+			Lane m_lanes[2];
+
+			///	Buffers queued or being written, and those reserved by
+			///		producers about to push.
+			std::atomic<size_t> m_pending = { 0 };
+
+			///	Whether the writer is, or is about to be, asleep.
+			std::atomic<bool> m_sleeping = { false };
+
+			///	Producers and flushers waiting on $m_space.
+			std::atomic<size_t> m_waiting = { 0 };
+
+			///	Guards sleeping on the condition variables.
+			mutable std::mutex m_lock;
+
+			///	Wakes the writer.
+			std::condition_variable m_ready;
+
+			///	Wakes producers and flushers.
+			std::condition_variable m_space;
+
+			///	Reused list of the buffers in a batch.
+			std::vector<SerialBuffer> m_gather;
+
+			///	Number of sink calls made.
+			std::atomic<uint64_t> m_batches = { 0 };
+
+			///	Cleared to stop the writer once drained.
+			std::atomic<bool> m_running = { true };
+
+			///	The writer.
+			std::thread m_thWriter;
+		};
+	}
+}
+
+#endif	// !WIN32_DEVICES_SERIALTXQUEUE_H_
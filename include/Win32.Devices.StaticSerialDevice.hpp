@@ -0,0 +1,349 @@
+/******************************************************************************
+*	A serial device whose line, framing and receive buffer are fixed at
+*		compile time.
+*
+*	\file Win32.Devices.StaticSerialDevice.hpp
+*
+*	Copyright (c) 2019 LooUQ Incorporated.
+*
+*	License: The GNU License
+*
+*	This file is part of CoreZero.
+*
+*   CoreZero is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   CoreZero is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with CoreZero.  If not, see <https://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+#ifndef WIN32_DEVICES_STATICSERIALDEVICE_H_
+#define WIN32_DEVICES_STATICSERIALDEVICE_H_
+
+#include "Win32.Devices.SerialDevice.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	A line fixed at compile time. Its character time and the
+		///		silence between frames are constants.
+		template <uint32_t BaudRate,
+			SerialByteSize ByteSize = SerialByteSize::Byte_Size8b,
+			SerialParity Parity = SerialParity::None,
+			SerialStopBits StopBits = SerialStopBits::StopBits_1,
+			SerialFlowControl FlowControl = SerialFlowControl::None>
+		struct SerialLine
+		{
+			static_assert(BaudRate > 0, "the baud rate must not be zero");
+
+			static constexpr uint32_t baudRate = BaudRate;
+			static constexpr SerialByteSize byteSize = ByteSize;
+			static constexpr SerialParity parity = Parity;
+			static constexpr SerialStopBits stopBits = StopBits;
+			static constexpr SerialFlowControl flowControl = FlowControl;
+
+			///	Start, data, parity and stop bits of a character.
+			static constexpr uint32_t CharacterBits = SerialCharacterBits(ByteSize, Parity, StopBits);
+
+			///	One character on the wire.
+			static constexpr std::chrono::nanoseconds CharacterTime = SerialCharacterTime(BaudRate, CharacterBits);
+
+			///	3.5 characters of silence, ending a frame on a line that
+			///		delimits frames by silence.
+			static constexpr std::chrono::nanoseconds InterFrameGap = CharacterTime * 7 / 2;
+
+			///	The settings the port is configured with.
+			static constexpr SerialSettings Settings()
+			{
+				SerialSettings settings{};
+				settings.baudRate = BaudRate;
+				settings.byteSize = ByteSize;
+				settings.parity = Parity;
+				settings.stopBits = StopBits;
+				settings.flowControl = FlowControl;
+				return settings;
+			}
+		};
+
+
+		///	8 data bits, no parity, 1 stop bit and no flow control.
+		template <uint32_t BaudRate>
+		using SerialLine8N1 = SerialLine<BaudRate>;
+
+
+
+		///	Framing of a $StaticSerialDevice: every read, as it arrives.
+		struct StaticRawFraming
+		{
+			size_t Extract(std::string_view data, std::string_view& frame) const
+			{
+				frame = data;
+				return data.size();
+			}
+		};
+
+
+		///	Framing of a $StaticSerialDevice: frames ending in a delimiter
+		///		known at compile time, i.e. StaticDelimiterFraming<'\r', '\n'>.
+		///		The emitted frame excludes the delimiter.
+		template <char First, char... Rest>
+		struct StaticDelimiterFraming
+		{
+			static constexpr size_t DelimiterSize = 1 + sizeof...(Rest);
+
+			size_t Extract(std::string_view data, std::string_view& frame) const
+			{
+				static constexpr char delimiter[DelimiterSize] = { First, Rest... };
+				const char* begin = data.data();
+				const char* end = begin + data.size();
+
+				for (const char* at = begin; (at = (const char*)std::memchr(at, First, end - at)) != nullptr; ++at)
+				{
+					if ((size_t)(end - at) < DelimiterSize) break;
+					if (DelimiterSize > 1 && std::memcmp(at + 1, delimiter + 1, DelimiterSize - 1) != 0) continue;
+
+					size_t length = (size_t)(at - begin);
+					frame = data.substr(0, length);
+					return length + DelimiterSize;
+				}
+				return 0;
+			}
+		};
+
+
+		///	Framing of a $StaticSerialDevice: frames of a fixed length.
+		template <size_t FrameLength>
+		struct StaticFixedLengthFraming
+		{
+			static_assert(FrameLength > 0, "frames must not be empty");
+
+			size_t Extract(std::string_view data, std::string_view& frame) const
+			{
+				if (data.size() < FrameLength) return 0;
+
+				frame = data.substr(0, FrameLength);
+				return FrameLength;
+			}
+		};
+
+
+
+		///	A serial device specialised at compile time.
+		///	The line is configured once, from $Line, when the device is
+		///		made, and cannot be changed. Received bytes are read straight
+		///		into a buffer of $BufferSize bytes held in the object, and
+		///		split by the $Framing's non-virtual Extract, so the receive
+		///		and transmit paths inline into the caller without the
+		///		receive ring, event thread or write lock of a $SerialDevice.
+		///		The port itself is a $SerialDevice, reached by $Device for
+		///		statistics and recording; its events must not be used.
+		///	Use from one thread.
+		template <typename Line, typename Framing = StaticRawFraming, size_t BufferSize = 0x1000ul>
+		class StaticSerialDevice final
+		{
+		public:
+			static_assert(BufferSize >= 64, "the receive buffer must hold at least 64 bytes");
+
+			static constexpr size_t Capacity = BufferSize;
+			static constexpr std::chrono::nanoseconds CharacterTime = Line::CharacterTime;
+			static constexpr std::chrono::nanoseconds InterFrameGap = Line::InterFrameGap;
+
+			///	Time $bytes take on the wire.
+			static constexpr std::chrono::nanoseconds TransmitTime(size_t bytes)
+			{
+				return CharacterTime * (int64_t)bytes;
+			}
+
+			static constexpr SerialSettings Settings() { return Line::Settings(); }
+
+			explicit StaticSerialDevice(SerialDevice&& device, Framing framing = Framing());
+
+			static StaticSerialDevice FromPath(const std::string& devicePath)
+			{
+				return StaticSerialDevice(SerialDevice::FromPath(devicePath));
+			}
+
+			static StaticSerialDevice FromPortNumber(uint16_t COMPortNum)
+			{
+				return StaticSerialDevice(SerialDevice::FromPortNumber(COMPortNum));
+			}
+
+			size_t Write(const void* src, size_t len) { return m_device.native_write(src, len); }
+			size_t Write(std::string_view src) { return m_device.native_write(src.data(), src.size()); }
+			size_t Write(std::initializer_list<SerialBuffer> buffers)
+			{
+				return m_device.native_writev(buffers.begin(), buffers.size());
+			}
+
+			template <typename Handler>
+			size_t Poll(std::chrono::milliseconds timeout, Handler&& emit);
+
+			size_t ReadSome(void* dest, size_t len, std::chrono::milliseconds timeout);
+
+			///	Bytes received and not yet taken as a frame.
+			size_t Buffered() const { return m_end - m_begin; }
+
+			///	Bytes discarded because a frame outgrew the buffer.
+			uint64_t Dropped() const { return m_dropped; }
+
+			SerialDevice& Device() { return m_device; }
+
+		private:
+			void make_room();
+			bool read_pending() const;
+
+		private:
+			SerialDevice m_device;
+			Framing m_framing;
+
+			///	The bytes received and not yet taken: [$m_begin, $m_end).
+			size_t m_begin = 0;
+			size_t m_end = 0;
+
+			uint64_t m_dropped = 0;
+
+			alignas(64) char m_buffer[BufferSize];
+		};
+
+
+
+		/**********************************************************************
+		 *	Take over an open port and configure it with the settings of
+		 *		the line.
+		 *
+		 *	\param[in] device The port, i.e. from SerialDevice::FromPath.
+		 *	\param[in] framing Splits the received bytes into frames.
+		 */
+		template <typename Line, typename Framing, size_t BufferSize>
+		inline StaticSerialDevice<Line, Framing, BufferSize>::StaticSerialDevice(SerialDevice&& device, Framing framing)
+			: m_device(std::move(device))
+			, m_framing(framing)
+		{
+			m_device.Configure(Line::Settings());
+		}
+
+
+
+		/**********************************************************************
+		 *	Read what has arrived, waiting up to $timeout for the first
+		 *		byte, and emit every frame it completes.
+		 *
+		 *	\param[in] timeout How long to wait for data.
+		 *	\param[in] emit Called with each frame as a std::string_view,
+		 *		valid until the next Poll or ReadSome.
+		 *	\returns The number of frames emitted.
+		 */
+		template <typename Line, typename Framing, size_t BufferSize>
+		template <typename Handler>
+		inline size_t StaticSerialDevice<Line, Framing, BufferSize>::Poll(std::chrono::milliseconds timeout, Handler&& emit)
+		{
+			make_room();
+			m_end += m_device.native_read(m_buffer + m_end, BufferSize - m_end, (uint32_t)timeout.count());
+
+			size_t frames = 0;
+			std::string_view frame;
+			size_t used;
+			while (m_begin < m_end
+				&& (used = m_framing.Extract(std::string_view(m_buffer + m_begin, m_end - m_begin), frame)))
+			{
+				if (frame.data())
+				{
+					emit(frame);
+					frames++;
+				}
+				m_begin += used;
+			}
+			return frames;
+		}
+
+
+
+		/**********************************************************************
+		 *	Read raw bytes, bypassing the framing: those buffered first,
+		 *		else what arrives within $timeout.
+		 *
+		 *	\param[out] dest Where to read to.
+		 *	\param[in] len The most bytes to read.
+		 *	\param[in] timeout How long to wait for the first byte.
+		 *	\returns The number of bytes read, 0 on timeout.
+		 */
+		template <typename Line, typename Framing, size_t BufferSize>
+		inline size_t StaticSerialDevice<Line, Framing, BufferSize>::ReadSome(void* dest, size_t len, std::chrono::milliseconds timeout)
+		{
+			if (m_begin == m_end && !read_pending())
+			{
+				return m_device.native_read(dest, len, (uint32_t)timeout.count());
+			}
+			if (m_begin == m_end) m_end += m_device.native_read(m_buffer + m_end, BufferSize - m_end, (uint32_t)timeout.count());
+
+			size_t read = (std::min)(len, m_end - m_begin);
+			std::memcpy(dest, m_buffer + m_begin, read);
+			m_begin += read;
+			return read;
+		}
+
+
+
+		/**********************************************************************
+		 *	Free the tail of the buffer for the next read, moving a partial
+		 *		frame to the front. A frame filling the whole buffer is
+		 *		dropped.
+		 */
+		template <typename Line, typename Framing, size_t BufferSize>
+		inline void StaticSerialDevice<Line, Framing, BufferSize>::make_room()
+		{
+			//	an unfinished read lands where it was issued
+			if (read_pending()) return;
+
+			if (m_begin == m_end)
+			{
+				m_begin = m_end = 0;
+			}
+			else if (BufferSize - m_end < BufferSize / 2)
+			{
+				if (m_begin == 0)
+				{
+					if (m_end < BufferSize) return;
+					m_dropped += m_end;
+					m_end = 0;
+					return;
+				}
+				std::memmove(m_buffer, m_buffer + m_begin, m_end - m_begin);
+				m_end -= m_begin;
+				m_begin = 0;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Whether an overlapped read is still filling the buffer.
+		 */
+		template <typename Line, typename Framing, size_t BufferSize>
+		inline bool StaticSerialDevice<Line, Framing, BufferSize>::read_pending() const
+		{
+#ifdef SERIAL_BACKEND_POSIX
+			return false;
+#else
+			return m_device.m_ReadOpPending != FALSE;
+#endif // SERIAL_BACKEND_POSIX
+		}
+	}
+}
+
+#endif	// !WIN32_DEVICES_STATICSERIALDEVICE_H_
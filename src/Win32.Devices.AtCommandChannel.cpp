@@ -0,0 +1,367 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.AtCommandChannel.hpp"
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Whether the line starts with the prefix.
+		static bool starts_with(std::string_view line, std::string_view prefix)
+		{
+			return line.size() >= prefix.size() && line.compare(0, prefix.size(), prefix) == 0;
+		}
+
+
+		///	The number following an error prefix, or -1 for a verbose error.
+		static int error_number(std::string_view line, size_t at)
+		{
+			while (at < line.size() && line[at] == ' ') at++;
+			if (at == line.size()) return -1;
+
+			int error = 0;
+			for (; at < line.size(); at++)
+			{
+				if (line[at] < '0' || line[at] > '9') return -1;
+				error = error * 10 + (line[at] - '0');
+			}
+			return error;
+		}
+
+
+		///	Whether the line is a final result code, and which.
+		static bool final_result(std::string_view line, AtResult& result, int& error)
+		{
+			error = -1;
+			if (line == "OK")
+			{
+				result = AtResult::Ok;
+			}
+			else if (line == "ERROR" || line == "NO CARRIER" || line == "BUSY"
+				|| line == "NO ANSWER" || line == "NO DIALTONE")
+			{
+				result = AtResult::Error;
+			}
+			else if (starts_with(line, "+CME ERROR:"))
+			{
+				result = AtResult::CmeError;
+				error = error_number(line, 11);
+			}
+			else if (starts_with(line, "+CMS ERROR:"))
+			{
+				result = AtResult::CmsError;
+				error = error_number(line, 11);
+			}
+			else
+			{
+				return false;
+			}
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Take over a device and frame its received data into lines.
+		 *		Result codes are expected in verbose form (ATV1).
+		 *
+		 *	\param[in] device The modem's serial device.
+		 *	\param[in] usingEvents Start the device's event thread. Pass false
+		 *		to attach $Device to a reactor instead.
+		 */
+		AtCommandChannel::AtCommandChannel(SerialDevice&& device, bool usingEvents)
+			: m_device(std::move(device))
+		{
+			m_device.UsingFramer(std::make_unique<DelimiterFramer>("\r\n"));
+			m_device.ReceivedFrame += OnRxView(this, &AtCommandChannel::handle_line);
+			m_thWatchdog = std::thread(&AtCommandChannel::watchdog_thread, this);
+
+			if (usingEvents) m_device.UsingEvents(true);
+		}
+
+
+
+		/**********************************************************************
+		 *	Abort outstanding commands and close the device.
+		 */
+		AtCommandChannel::~AtCommandChannel()
+		{
+			Close();
+		}
+
+
+
+		/**********************************************************************
+		 *	Queue a command.
+		 *
+		 *	\param[in] command The command, i.e. "AT+CSQ". A carriage return
+		 *		is appended if missing.
+		 *	\param[in] timeout Time allowed for the final result once the
+		 *		command is written.
+		 *	\returns A future holding the response.
+		 */
+		std::future<AtResponse> AtCommandChannel::Send(std::string command, std::chrono::milliseconds timeout)
+		{
+			if (command.empty() || command.back() != '\r') command += '\r';
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			std::promise<AtResponse> done;
+			std::future<AtResponse> result = done.get_future();
+			if (!m_running)
+			{
+				done.set_value(AtResponse());
+				return result;
+			}
+
+			m_queue.push_back(Transaction{ std::move(command), timeout, std::move(done), AtResponse() });
+			if (!m_active && !m_draining) start_next(lock);
+			return result;
+		}
+
+
+
+		/**********************************************************************
+		 *	Route unsolicited result codes to a handler.
+		 *
+		 *	\param[in] prefix The start of the URC, i.e. "+CREG". An empty
+		 *		prefix receives every line not taken by a command or another
+		 *		subscription.
+		 *	\param[in] handler Called with the line from the event thread.
+		 */
+		void AtCommandChannel::Subscribe(std::string prefix, OnAtUrc handler)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_urcs.push_back(Subscription{ std::move(prefix), handler });
+		}
+
+
+
+		/**********************************************************************
+		 *	Close the device and abort every queued command.
+		 */
+		void AtCommandChannel::Close()
+		{
+			m_device.Close();
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_running = false;
+			m_draining = false;
+			while (!m_queue.empty())
+			{
+				m_active = true;
+				complete(AtResult::Aborted, -1, lock);
+			}
+			m_active = false;
+			lock.unlock();
+
+			m_changed.notify_all();
+			if (m_thWatchdog.joinable()) m_thWatchdog.join();
+		}
+
+
+
+		/**********************************************************************
+		 *	The number of commands queued or awaiting their final result.
+		 */
+		size_t AtCommandChannel::Pending() const
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			return m_queue.size();
+		}
+
+
+
+		/**********************************************************************
+		 *	Handle a received line: a final result, an information line of the
+		 *		active command, or a URC. While draining, the late final
+		 *		result ends the drain, and other lines but subscribed URCs
+		 *		are dropped.
+		 */
+		void AtCommandChannel::handle_line(std::string_view line)
+		{
+			//	an echo ends in the command's own carriage return
+			while (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+			if (line.empty()) return;
+
+			AtResult result;
+			int error;
+			bool final = final_result(line, result, error);
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			if (m_draining)
+			{
+				if (final)
+				{
+					end_drain(lock);
+					return;
+				}
+
+				bool subscribed = false;
+				for (const Subscription& urc : m_urcs)
+				{
+					subscribed |= !urc.prefix.empty() && starts_with(line, urc.prefix);
+				}
+				lock.unlock();
+				if (subscribed) dispatch_urc(line);
+				return;
+			}
+
+			if (!m_active)
+			{
+				lock.unlock();
+				dispatch_urc(line);
+				return;
+			}
+
+			Transaction& active = m_queue.front();
+			std::string_view command(active.command.data(), active.command.size() - 1);
+			if (line == command) return;	// echo
+
+			if (final)
+			{
+				if (result != AtResult::Ok) active.response.lines.emplace_back(line);
+				complete(result, error, lock);
+				return;
+			}
+
+			//	a subscribed URC, unless the command itself queries it
+			for (const Subscription& urc : m_urcs)
+			{
+				if (!urc.prefix.empty() && starts_with(line, urc.prefix)
+					&& command.find(urc.prefix) == std::string_view::npos)
+				{
+					lock.unlock();
+					dispatch_urc(line);
+					return;
+				}
+			}
+			active.response.lines.emplace_back(line);
+		}
+
+
+
+		/**********************************************************************
+		 *	Raise the subscriptions matching a URC.
+		 *
+		 *	\returns Whether a subscription took the line.
+		 */
+		bool AtCommandChannel::dispatch_urc(std::string_view line)
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			const OnAtUrc* fallback = nullptr;
+			for (const Subscription& urc : m_urcs)
+			{
+				if (urc.prefix.empty())
+				{
+					if (!fallback) fallback = &urc.handler;
+				}
+				else if (starts_with(line, urc.prefix))
+				{
+					OnAtUrc handler = urc.handler;
+					lock.unlock();
+					handler(line);
+					return true;
+				}
+			}
+
+			if (!fallback) return false;
+
+			OnAtUrc handler = *fallback;
+			lock.unlock();
+			handler(line);
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Complete the active command and write the next one.
+		 *		Expects $lock held; returns with it held.
+		 */
+		void AtCommandChannel::complete(AtResult result, int error, std::unique_lock<std::mutex>& lock)
+		{
+			Transaction finished = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_active = false;
+
+			finished.response.result = result;
+			finished.response.error = error;
+
+			if (m_running && !m_draining && !m_queue.empty()) start_next(lock);
+
+			lock.unlock();
+			finished.done.set_value(std::move(finished.response));
+			lock.lock();
+		}
+
+
+
+		/**********************************************************************
+		 *	Stop awaiting a late final result and write the next command.
+		 *		Expects $lock held; returns with it held.
+		 */
+		void AtCommandChannel::end_drain(std::unique_lock<std::mutex>& lock)
+		{
+			m_draining = false;
+			if (m_running && !m_queue.empty()) start_next(lock);
+		}
+
+
+
+		/**********************************************************************
+		 *	Write the command at the front of the queue.
+		 *		Expects $lock held; returns with it held.
+		 */
+		void AtCommandChannel::start_next(std::unique_lock<std::mutex>& lock)
+		{
+			m_active = true;
+			Transaction& next = m_queue.front();
+			m_deadline = std::chrono::steady_clock::now() + next.timeout;
+			std::string command = next.command;
+			m_changed.notify_all();
+
+			lock.unlock();
+			{
+				std::lock_guard<std::mutex> writing(m_writeLock);
+				m_device.Write(command);
+			}
+			lock.lock();
+		}
+
+
+
+		/**********************************************************************
+		 *	The watchdog thread. Fails the active command once its deadline
+		 *		passes, then ends the drain for its late result once the
+		 *		guard time passes.
+		 */
+		void AtCommandChannel::watchdog_thread()
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			while (m_running)
+			{
+				if (!m_active && !m_draining)
+				{
+					m_changed.wait(lock);
+				}
+				else if (m_changed.wait_until(lock, m_deadline) == std::cv_status::timeout
+					&& std::chrono::steady_clock::now() >= m_deadline)
+				{
+					if (m_draining)
+					{
+						end_drain(lock);
+					}
+					else if (m_active)
+					{
+						m_draining = true;
+						m_deadline = std::chrono::steady_clock::now() + AtLateResultGuard;
+						complete(AtResult::Timeout, -1, lock);
+					}
+				}
+			}
+		}
+	}
+}
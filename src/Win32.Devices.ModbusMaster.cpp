@@ -0,0 +1,685 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.ModbusMaster.hpp"
+#include "Win32.Devices.SerialCrc.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#define FUNCTION_WRITE_REGISTER		(0x06)
+#define FUNCTION_WRITE_REGISTERS	(0x10)
+#define FUNCTION_EXCEPTION			(0x80)
+
+#define EXCEPTION_REPLY_SIZE		(5)
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Append the CRC of a frame, low byte first.
+		 *
+		 *	\param[in,out] frame The frame, with room for the CRC.
+		 *	\param[in] len The length of the frame before the CRC.
+		 *	\returns The length with the CRC.
+		 */
+		static size_t append_crc(uint8_t* frame, size_t len)
+		{
+			uint16_t crc = Crc16Modbus(frame, len);
+			frame[len] = (uint8_t)(crc & 0xFF);
+			frame[len + 1] = (uint8_t)(crc >> 8);
+			return len + 2;
+		}
+
+
+
+		/**********************************************************************
+		 *	Build the request for one register, or a block of them: a read,
+		 *		or a single write.
+		 *
+		 *	\param[out] frame The request, 8 bytes.
+		 */
+		static void build_request(uint8_t* frame, uint8_t slave, uint8_t function, uint16_t address, uint16_t value)
+		{
+			frame[0] = slave;
+			frame[1] = function;
+			frame[2] = (uint8_t)(address >> 8);
+			frame[3] = (uint8_t)(address & 0xFF);
+			frame[4] = (uint8_t)(value >> 8);
+			frame[5] = (uint8_t)(value & 0xFF);
+			append_crc(frame, 6);
+		}
+
+
+
+		/**********************************************************************
+		 *	Decode big-endian registers.
+		 */
+		static void decode_registers(const uint8_t* src, uint16_t* dest, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				dest[i] = (uint16_t)((src[2 * i] << 8) | src[2 * i + 1]);
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Construct a master on a port.
+		 *
+		 *	\param[in] device The bus; it must outlive the master.
+		 *	\param[in] options The timeouts, merging and offline policy.
+		 */
+		ModbusMaster::ModbusMaster(SerialDevice& device, const ModbusOptions& options)
+			: m_device(device), m_options(options)
+		{
+			m_timing = Timing();
+			m_started = std::chrono::steady_clock::now();
+			m_busFree = m_started;
+		}
+
+
+
+		/**********************************************************************
+		 *	Stop polling.
+		 */
+		ModbusMaster::~ModbusMaster()
+		{
+			Stop();
+		}
+
+
+
+		/**********************************************************************
+		 *	Read a block of registers.
+		 *
+		 *	\param[in] slave The slave address.
+		 *	\param[in] table Holding or input registers.
+		 *	\param[in] address The first register.
+		 *	\param[in] count The number of registers, 1 to 125.
+		 *	\returns The registers, or why there are none.
+		 */
+		ModbusResponse ModbusMaster::ReadRegisters(uint8_t slave, ModbusTable table, uint16_t address, uint16_t count)
+		{
+			if (!count || count > ModbusMaxRegisters)
+			{
+				throw std::invalid_argument("Modbus reads take 1 to 125 registers");
+			}
+
+			uint8_t frame[8];
+			build_request(frame, slave, (uint8_t)table, address, count);
+
+			uint8_t reply[5 + 2 * ModbusMaxRegisters];
+			ModbusResponse response;
+			response.status = transact(frame, sizeof(frame), reply, 5 + 2 * (size_t)count, response.exception);
+			if (response.Ok())
+			{
+				response.registers.resize(count);
+				decode_registers(reply + 3, response.registers.data(), count);
+			}
+			return response;
+		}
+
+
+
+		/**********************************************************************
+		 *	Write a single holding register, with function 6.
+		 *
+		 *	\param[in] slave The slave address; 0 for every slave.
+		 *	\param[in] address The register.
+		 *	\param[in] value The value.
+		 *	\returns Whether the slave took it.
+		 */
+		ModbusResponse ModbusMaster::WriteRegister(uint8_t slave, uint16_t address, uint16_t value)
+		{
+			uint8_t frame[8];
+			build_request(frame, slave, FUNCTION_WRITE_REGISTER, address, value);
+
+			//	the slave echoes the request
+			uint8_t reply[8];
+			ModbusResponse response;
+			response.status = transact(frame, sizeof(frame), reply, sizeof(reply), response.exception);
+			if (response.Ok() && slave != ModbusBroadcast && std::memcmp(frame, reply, sizeof(frame)) != 0)
+			{
+				response.status = ModbusStatus::BadResponse;
+			}
+			return response;
+		}
+
+
+
+		/**********************************************************************
+		 *	Write a block of holding registers, with function 16.
+		 *
+		 *	\param[in] slave The slave address; 0 for every slave.
+		 *	\param[in] address The first register.
+		 *	\param[in] values The values.
+		 *	\param[in] count The number of registers, 1 to 123.
+		 *	\returns Whether the slave took them.
+		 */
+		ModbusResponse ModbusMaster::WriteRegisters(uint8_t slave, uint16_t address, const uint16_t* values, uint16_t count)
+		{
+			if (!count || count > ModbusMaxRegisters - 2)
+			{
+				throw std::invalid_argument("Modbus writes take 1 to 123 registers");
+			}
+
+			uint8_t frame[9 + 2 * ModbusMaxRegisters];
+			build_request(frame, slave, FUNCTION_WRITE_REGISTERS, address, count);
+			frame[6] = (uint8_t)(2 * count);
+			for (uint16_t i = 0; i < count; i++)
+			{
+				frame[7 + 2 * i] = (uint8_t)(values[i] >> 8);
+				frame[8 + 2 * i] = (uint8_t)(values[i] & 0xFF);
+			}
+			size_t len = append_crc(frame, 7 + 2 * (size_t)count);
+
+			//	the slave answers with the address and count
+			uint8_t reply[8];
+			ModbusResponse response;
+			response.status = transact(frame, len, reply, sizeof(reply), response.exception);
+			if (response.Ok() && slave != ModbusBroadcast && std::memcmp(frame, reply, 6) != 0)
+			{
+				response.status = ModbusStatus::BadResponse;
+			}
+			return response;
+		}
+
+
+
+		/**********************************************************************
+		 *	Watch a block of registers. Blocks of the same slave and table
+		 *		that touch, or lie within $maxGap of each other, are read
+		 *		with one request.
+		 *
+		 *	\param[in] slave The slave address.
+		 *	\param[in] table Holding or input registers.
+		 *	\param[in] address The first register.
+		 *	\param[in] count The number of registers, 1 to 125.
+		 *	\param[in] period How often to read it; 0 for as often as the bus
+		 *		allows.
+		 *	\returns The id to get the values by.
+		 */
+		ModbusWatchId ModbusMaster::Watch(uint8_t slave, ModbusTable table, uint16_t address, uint16_t count, std::chrono::milliseconds period)
+		{
+			if (!count || count > ModbusMaxRegisters || slave == ModbusBroadcast)
+			{
+				throw std::invalid_argument("Modbus watches take 1 to 125 registers of a single slave");
+			}
+
+			std::lock_guard<std::mutex> lock(m_lock);
+			WatchEntry watch = { slave, table, address, count, period };
+			m_watches.push_back(watch);
+			plan();
+			m_changed.notify_all();
+			return m_watches.size() - 1;
+		}
+
+
+
+		/**********************************************************************
+		 *	Gets the values of a watched block, as last read.
+		 *
+		 *	\param[in] id The watch.
+		 *	\returns The values, or none if not yet read.
+		 */
+		std::vector<uint16_t> ModbusMaster::Values(ModbusWatchId id) const
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			if (id >= m_watches.size()) return {};
+
+			const WatchEntry& watch = m_watches[id];
+			const PollRequest& request = m_requests[watch.request];
+			if (!request.valid) return {};
+
+			auto first = request.values.begin() + watch.offset;
+			return std::vector<uint16_t>(first, first + watch.count);
+		}
+
+
+
+		/**********************************************************************
+		 *	Gets the number of requests the watches are merged into.
+		 */
+		size_t ModbusMaster::Requests() const
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			return m_requests.size();
+		}
+
+
+
+		/**********************************************************************
+		 *	Start polling the watched registers on a thread of the master's
+		 *		own. The statistics start over.
+		 */
+		void ModbusMaster::Start()
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			if (m_running) return;
+
+			m_stats = ModbusStats();
+			m_started = std::chrono::steady_clock::now();
+			m_running = true;
+			m_thPoll = std::thread(&ModbusMaster::poll_thread, this);
+		}
+
+
+
+		/**********************************************************************
+		 *	Stop polling, after the transaction on the bus.
+		 */
+		void ModbusMaster::Stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_running = false;
+			}
+			m_changed.notify_all();
+			if (m_thPoll.joinable()) m_thPoll.join();
+		}
+
+
+
+		/**********************************************************************
+		 *	Poll the request most overdue, on the caller's thread. Not to be
+		 *		called once started.
+		 *
+		 *	\returns Whether a request was due.
+		 */
+		bool ModbusMaster::PollOnce()
+		{
+			PollTarget target;
+			std::chrono::steady_clock::time_point wake;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				if (!next_due(std::chrono::steady_clock::now(), target, wake)) return false;
+			}
+			poll(target);
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	The character and silence times at the device's baud rate and
+		 *		line settings.
+		 */
+		ModbusTiming ModbusMaster::Timing() const
+		{
+			return ModbusRtuTiming(m_device.BaudRate(), m_device.Settings().CharacterBits());
+		}
+
+
+
+		/**********************************************************************
+		 *	Gets a snapshot of the statistics.
+		 */
+		ModbusStats ModbusMaster::Stats() const
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			ModbusStats stats = m_stats;
+			stats.elapsed = std::chrono::steady_clock::now() - m_started;
+			return stats;
+		}
+
+
+
+		/**********************************************************************
+		 *	Merge the watches into requests: per slave and table, in order of
+		 *		address, each watch joins the last request if it starts
+		 *		within $maxGap of its end and the request stays readable in
+		 *		one go. Called with $m_lock held.
+		 */
+		void ModbusMaster::plan()
+		{
+			std::vector<size_t> order(m_watches.size());
+			std::iota(order.begin(), order.end(), (size_t)0);
+			std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+				const WatchEntry& x = m_watches[a];
+				const WatchEntry& y = m_watches[b];
+				if (x.slave != y.slave) return x.slave < y.slave;
+				if (x.table != y.table) return x.table < y.table;
+				return x.address < y.address;
+			});
+
+			m_requests.clear();
+			for (size_t index : order)
+			{
+				WatchEntry& watch = m_watches[index];
+				uint32_t end = (uint32_t)watch.address + watch.count;
+
+				PollRequest* last = m_requests.empty() ? nullptr : &m_requests.back();
+				bool merge = last
+					&& last->slave == watch.slave
+					&& last->table == watch.table
+					&& watch.address <= (uint32_t)last->address + last->count + m_options.maxGap
+					&& (std::max)(end, (uint32_t)last->address + last->count) - last->address <= ModbusMaxRegisters;
+
+				if (merge)
+				{
+					last->count = (uint16_t)((std::max)(end, (uint32_t)last->address + last->count) - last->address);
+					last->period = (std::min)(last->period, watch.period);
+				}
+				else
+				{
+					PollRequest request;
+					request.slave = watch.slave;
+					request.table = watch.table;
+					request.address = watch.address;
+					request.count = watch.count;
+					request.period = watch.period;
+					m_requests.push_back(std::move(request));
+					last = &m_requests.back();
+				}
+
+				watch.request = m_requests.size() - 1;
+				watch.offset = (uint16_t)(watch.address - last->address);
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			for (PollRequest& request : m_requests)
+			{
+				build_request(request.frame, request.slave, (uint8_t)request.table, request.address, request.count);
+				request.values.assign(request.count, 0);
+				request.due = now;
+			}
+			m_plan++;
+		}
+
+
+
+		/**********************************************************************
+		 *	Pick the request most overdue. An offline slave is not due
+		 *		before its next try. Called with $m_lock held.
+		 *
+		 *	\param[in] now The time.
+		 *	\param[out] target The request, if one is due.
+		 *	\param[out] wake When the next request falls due, if none is.
+		 *	\returns Whether a request is due.
+		 */
+		bool ModbusMaster::next_due(std::chrono::steady_clock::time_point now, PollTarget& target, std::chrono::steady_clock::time_point& wake)
+		{
+			size_t best = m_requests.size();
+			wake = (std::chrono::steady_clock::time_point::max)();
+
+			for (size_t i = 0; i < m_requests.size(); i++)
+			{
+				const PollRequest& request = m_requests[i];
+				const SlaveHealth& health = m_health[request.slave];
+
+				auto due = request.due;
+				if (health.failures >= m_options.offlineAfter) due = (std::max)(due, health.retry);
+
+				if (due < wake)
+				{
+					wake = due;
+					best = i;
+				}
+			}
+
+			if (best == m_requests.size() || wake > now) return false;
+
+			target.index = best;
+			target.plan = m_plan;
+			std::memcpy(target.frame, m_requests[best].frame, sizeof(target.frame));
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Read a request's registers, store them and raise $Updated.
+		 *
+		 *	\param[in] target The request.
+		 */
+		void ModbusMaster::poll(const PollTarget& target)
+		{
+			const uint8_t slave = target.frame[0];
+			const uint16_t address = (uint16_t)((target.frame[2] << 8) | target.frame[3]);
+			const uint16_t count = (uint16_t)((target.frame[4] << 8) | target.frame[5]);
+
+			auto started = std::chrono::steady_clock::now();
+			uint8_t reply[5 + 2 * ModbusMaxRegisters];
+			uint8_t exception = 0;
+			ModbusStatus status = transact(target.frame, sizeof(target.frame), reply, 5 + 2 * (size_t)count, exception);
+
+			uint16_t values[ModbusMaxRegisters];
+			if (status == ModbusStatus::Ok) decode_registers(reply + 3, values, count);
+
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				if (target.plan == m_plan)
+				{
+					PollRequest& request = m_requests[target.index];
+					request.due = started + request.period;
+					if (status == ModbusStatus::Ok)
+					{
+						std::copy(values, values + count, request.values.begin());
+						request.valid = true;
+					}
+				}
+			}
+
+			if (status == ModbusStatus::Ok)
+			{
+				ModbusBlock block = { slave, (ModbusTable)target.frame[1], address, count, values };
+				Updated(block);
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	The background thread polling the watched registers, always the
+		 *		most overdue request next.
+		 */
+		void ModbusMaster::poll_thread()
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			while (m_running)
+			{
+				PollTarget target;
+				std::chrono::steady_clock::time_point wake;
+				if (!next_due(std::chrono::steady_clock::now(), target, wake))
+				{
+					if (wake == (std::chrono::steady_clock::time_point::max)()) m_changed.wait(lock);
+					else m_changed.wait_until(lock, wake);
+					continue;
+				}
+
+				lock.unlock();
+				poll(target);
+				lock.lock();
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Write a request once the bus is free, and read the answer by the
+		 *		length expected, or as an exception.
+		 *
+		 *	\param[in] frame The request, CRC included.
+		 *	\param[in] len The length of the request.
+		 *	\param[out] reply The answer.
+		 *	\param[in] replyLen The length of a normal answer.
+		 *	\param[out] exception The exception code, if answered with one.
+		 *	\returns How the transaction completed.
+		 */
+		ModbusStatus ModbusMaster::transact(const uint8_t* frame, size_t len, uint8_t* reply, size_t replyLen, uint8_t& exception)
+		{
+			std::lock_guard<std::mutex> bus(m_busLock);
+			m_timing = Timing();
+			await_silence();
+
+			SerialBuffer request(frame, len);
+			m_device.Write(&request, 1);
+			account(len);
+
+			auto now = std::chrono::steady_clock::now();
+			auto wire = m_timing.character * (int64_t)len;
+			if (frame[0] == ModbusBroadcast)
+			{
+				m_busFree = now + wire + m_options.turnaround;
+				return ModbusStatus::Ok;
+			}
+
+			//	slave and function first, to tell an exception apart
+			size_t got = read_reply(reply, 2, now + wire + m_options.responseTimeout);
+			bool excepted = (got == 2 && reply[1] == (frame[1] | FUNCTION_EXCEPTION));
+			size_t expected = excepted ? EXCEPTION_REPLY_SIZE : replyLen;
+			if (got == 2)
+			{
+				auto rest = m_timing.character * (int64_t)(expected - 2) + m_options.byteTimeout;
+				got += read_reply(reply + 2, expected - 2, std::chrono::steady_clock::now() + rest);
+			}
+			account(got);
+
+			ModbusStatus status = ModbusStatus::Ok;
+			if (got < expected)
+			{
+				status = ModbusStatus::Timeout;
+			}
+			else if (Crc16Modbus(reply, expected) != 0)
+			{
+				status = ModbusStatus::CrcError;
+			}
+			else if (reply[0] != frame[0])
+			{
+				status = ModbusStatus::BadResponse;
+			}
+			else if (excepted)
+			{
+				status = ModbusStatus::Exception;
+				exception = reply[2];
+			}
+			else if (reply[1] != frame[1]
+				|| ((frame[1] == (uint8_t)ModbusTable::Holding || frame[1] == (uint8_t)ModbusTable::Input) && reply[2] != expected - 5))
+			{
+				status = ModbusStatus::BadResponse;
+			}
+
+			if (status != ModbusStatus::Ok && status != ModbusStatus::Exception && got)
+			{
+				//	whatever is left of a damaged or stray answer
+				purge();
+			}
+			m_busFree = std::chrono::steady_clock::now() + m_timing.interFrame;
+
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				switch (status)
+				{
+				case ModbusStatus::Ok: m_stats.polls++; break;
+				case ModbusStatus::Exception: m_stats.polls++; m_stats.exceptions++; break;
+				case ModbusStatus::Timeout: m_stats.timeouts++; break;
+				case ModbusStatus::CrcError: m_stats.crcErrors++; break;
+				default: break;
+				}
+				healthy(frame[0], status == ModbusStatus::Ok || status == ModbusStatus::Exception);
+			}
+			return status;
+		}
+
+
+
+		/**********************************************************************
+		 *	Read part of an answer.
+		 *
+		 *	\param[out] dest The destination.
+		 *	\param[in] len The bytes wanted.
+		 *	\param[in] deadline When to give up.
+		 *	\returns The bytes read.
+		 */
+		size_t ModbusMaster::read_reply(uint8_t* dest, size_t len, std::chrono::steady_clock::time_point deadline)
+		{
+			size_t got = 0;
+			while (got < len)
+			{
+				auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+				if (left.count() <= 0) break;
+
+				size_t read = m_device.ReadSome(dest + got, len - got, left);
+				if (!read) break;
+				got += read;
+			}
+			return got;
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait for the bus to have been silent for t3.5 since the last
+		 *		frame, dropping anything stray received since.
+		 */
+		void ModbusMaster::await_silence()
+		{
+			std::this_thread::sleep_until(m_busFree);
+
+			//	whatever is buffered, then whatever waits in the port
+			uint8_t stray[64];
+			while (m_device.ReadSome(stray, sizeof(stray), std::chrono::milliseconds(0))
+				|| (m_device.Available() && m_device.ReadSome(stray, sizeof(stray), std::chrono::milliseconds(1))))
+			{
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Drop what arrives until the line has been silent for t3.5, so the
+		 *		next answer is read from its start.
+		 */
+		void ModbusMaster::purge()
+		{
+			auto quiet = std::chrono::ceil<std::chrono::milliseconds>(m_timing.interFrame);
+			uint8_t stray[64];
+			while (m_device.ReadSome(stray, sizeof(stray), quiet))
+			{
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Count the time frames spend on the wire.
+		 *
+		 *	\param[in] bytes The length of a frame.
+		 */
+		void ModbusMaster::account(size_t bytes)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stats.busTime += m_timing.character * (int64_t)bytes;
+		}
+
+
+
+		/**********************************************************************
+		 *	Note whether a slave answered. A slave that fails
+		 *		$offlineAfter times in a row is tried once per
+		 *		$offlinePeriod. Called with $m_lock held.
+		 */
+		void ModbusMaster::healthy(uint8_t slave, bool answered)
+		{
+			SlaveHealth& health = m_health[slave];
+			if (answered)
+			{
+				health.failures = 0;
+				return;
+			}
+
+			health.failures++;
+			if (health.failures >= m_options.offlineAfter)
+			{
+				health.retry = std::chrono::steady_clock::now() + m_options.offlinePeriod;
+			}
+		}
+	}
+}
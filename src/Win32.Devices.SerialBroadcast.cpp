@@ -0,0 +1,461 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialBroadcast.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "The broadcast ring needs lock free words");
+
+		///	Bytes in a word of the ring.
+		constexpr size_t RING_WORD = sizeof(uint64_t);
+
+
+		///	Rounds a ring capacity up to a power of two.
+		static size_t ring_size(size_t capacity)
+		{
+			size_t pow2 = SerialBroadcastChunk;
+			while (pow2 < capacity) pow2 <<= 1;
+			return pow2;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create the broadcast and its ring.
+		 *
+		 *	\param[in] capacity Bytes a subscriber may fall behind before it
+		 *		overflows; rounded up to a power of two.
+		 *	\param[in] memory Holds the ring and the subscribers' copies.
+		 */
+		SerialBroadcast::SerialBroadcast(size_t capacity, std::pmr::memory_resource* memory)
+			: m_mask(ring_size(capacity) - 1)
+			, m_memory(memory)
+			, m_ring(static_cast<std::atomic<uint64_t>*>(m_memory->allocate(m_mask + 1, SerialCacheLine)))
+		{
+			for (size_t word = 0; word < Capacity() / RING_WORD; word++)
+			{
+				new (&m_ring[word]) std::atomic<uint64_t>(0);
+			}
+			for (Subscriber& subscriber : m_subscribers) subscriber.scratch.Memory(m_memory);
+		}
+
+
+
+		/**********************************************************************
+		 *	End every subscription.
+		 */
+		SerialBroadcast::~SerialBroadcast()
+		{
+			for (SerialSubscriberId id = 0; id < SerialBroadcastMaxSubscribers; id++)
+			{
+				Unsubscribe(id);
+			}
+			m_memory->deallocate(m_ring, Capacity(), SerialCacheLine);
+		}
+
+
+
+		/**********************************************************************
+		 *	Add a subscriber, which receives everything published from now on
+		 *		on a thread of its own.
+		 *
+		 *	\param[in] handler Called with each chunk of data.
+		 *	\param[in] policy What to do once the subscriber falls a whole
+		 *		ring behind.
+		 *	\returns The subscription, or SerialBroadcastNone if every slot
+		 *		is taken.
+		 */
+		SerialSubscriberId SerialBroadcast::Subscribe(OnBroadcast handler, SerialOverflowPolicy policy)
+		{
+			std::lock_guard<std::mutex> lock(m_subscribeLock);
+			for (SerialSubscriberId id = 0; id < SerialBroadcastMaxSubscribers; id++)
+			{
+				Subscriber& subscriber = m_subscribers[id];
+				if (subscriber.claimed) continue;
+
+				subscriber.claimed = true;
+				subscriber.policy = policy;
+				subscriber.handler = handler;
+				subscriber.delivered = 0;
+				subscriber.dropped = 0;
+				subscriber.overflows = 0;
+				subscriber.connected = true;
+				subscriber.running = true;
+				subscriber.scratch.Reserve(SerialBroadcastChunk);
+
+				subscriber.cursor.store(m_head.load(std::memory_order_acquire), std::memory_order_relaxed);
+				subscriber.active.store(true, std::memory_order_seq_cst);
+				subscriber.thread = std::thread(&SerialBroadcast::subscriber_thread, this, std::ref(subscriber));
+				return id;
+			}
+
+			std::cerr << "Serial Error: No room for another subscriber!" << std::endl;
+			return SerialBroadcastNone;
+		}
+
+
+
+		/**********************************************************************
+		 *	End a subscription, waiting for its handler to return.
+		 *
+		 *	\param[in] id The subscription.
+		 */
+		void SerialBroadcast::Unsubscribe(SerialSubscriberId id)
+		{
+			if (id >= SerialBroadcastMaxSubscribers) return;
+
+			std::lock_guard<std::mutex> lock(m_subscribeLock);
+			Subscriber& subscriber = m_subscribers[id];
+			if (!subscriber.claimed) return;
+
+			subscriber.active.store(false, std::memory_order_seq_cst);
+			subscriber.running = false;
+			{
+				std::lock_guard<std::mutex> wake_lock(subscriber.lock);
+			}
+			subscriber.wake.notify_one();
+			if (subscriber.thread.joinable()) subscriber.thread.join();
+
+			subscriber.connected = false;
+			subscriber.claimed = false;
+			release_room();
+		}
+
+
+
+		/**********************************************************************
+		 *	The counters of a subscription. Safe from any thread.
+		 *
+		 *	\param[in] id The subscription.
+		 */
+		SerialSubscriberStats SerialBroadcast::Stats(SerialSubscriberId id) const
+		{
+			SerialSubscriberStats stats;
+			if (id >= SerialBroadcastMaxSubscribers) return stats;
+
+			const Subscriber& subscriber = m_subscribers[id];
+			stats.delivered = subscriber.delivered.load(std::memory_order_relaxed);
+			stats.dropped = subscriber.dropped.load(std::memory_order_relaxed);
+			stats.overflows = subscriber.overflows.load(std::memory_order_relaxed);
+			stats.connected = subscriber.connected.load(std::memory_order_relaxed);
+			return stats;
+		}
+
+
+
+		/**********************************************************************
+		 *	The number of subscriptions, disconnected ones included.
+		 */
+		size_t SerialBroadcast::Subscribers() const
+		{
+			std::lock_guard<std::mutex> lock(m_subscribeLock);
+			return (size_t)std::count_if(std::begin(m_subscribers), std::end(m_subscribers),
+				[](const Subscriber& subscriber) { return subscriber.claimed; });
+		}
+
+
+
+		/**********************************************************************
+		 *	Publish data to every subscriber. Called from one thread only.
+		 *
+		 *	\param[in] data The data.
+		 *	\param[in] len The length of the data.
+		 *	\returns The number of bytes published; fewer than $len only
+		 *		while a Block subscriber is a whole ring behind.
+		 */
+		size_t SerialBroadcast::Publish(const void* data, size_t len)
+		{
+			const uint64_t head = m_head.load(std::memory_order_relaxed);
+			len = (std::min)(len, Room());
+			if (!len) return 0;
+
+			//	announce the overwrite before making it
+			m_reserved.store(head + len, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			ring_write(head, static_cast<const uint8_t*>(data), len);
+
+			m_head.store(head + len, std::memory_order_release);
+
+			//	pairs with the fence of a subscriber going to sleep
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			for (Subscriber& subscriber : m_subscribers)
+			{
+				if (subscriber.sleeping.load(std::memory_order_relaxed)) wake(subscriber);
+			}
+			return len;
+		}
+
+
+
+		/**********************************************************************
+		 *	Bytes $Publish would accept now.
+		 */
+		size_t SerialBroadcast::Room() const
+		{
+			const uint64_t head = m_head.load(std::memory_order_relaxed);
+			return Capacity() - (size_t)(head - blocking_cursor(head));
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait for a Block subscriber to make room.
+		 *
+		 *	\param[in] timeout How long to wait.
+		 *	\returns Whether there is room.
+		 */
+		bool SerialBroadcast::AwaitRoom(std::chrono::milliseconds timeout)
+		{
+			std::unique_lock<std::mutex> lock(m_roomLock);
+			m_publisherWaiting.store(true, std::memory_order_seq_cst);
+			bool room = m_room.wait_for(lock, timeout, [this] { return Room() > 0; });
+			m_publisherWaiting.store(false, std::memory_order_relaxed);
+			return room;
+		}
+
+
+
+		/**********************************************************************
+		 *	A subscriber's thread. Copies data out of the ring, checks it was
+		 *		not overwritten meanwhile, and hands it to the handler.
+		 *
+		 *	\param[in] subscriber The subscriber.
+		 */
+		void SerialBroadcast::subscriber_thread(Subscriber& subscriber)
+		{
+			uint64_t cursor = subscriber.cursor.load(std::memory_order_relaxed);
+			uint8_t* scratch = subscriber.scratch.Reserve(SerialBroadcastChunk);
+
+			while (await_data(subscriber, cursor))
+			{
+				const uint64_t head = m_head.load(std::memory_order_acquire);
+				if (m_reserved.load(std::memory_order_acquire) - cursor > Capacity())
+				{
+					cursor = overflow(subscriber, cursor);
+					continue;
+				}
+
+				size_t len = (size_t)(std::min)(head - cursor, (uint64_t)SerialBroadcastChunk);
+				ring_read(cursor, scratch, len);
+
+				//	overwritten while copying
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (m_reserved.load(std::memory_order_relaxed) - cursor > Capacity())
+				{
+					cursor = overflow(subscriber, cursor);
+					continue;
+				}
+
+				subscriber.handler(std::string_view((const char*)scratch, len));
+
+				cursor += len;
+				subscriber.cursor.store(cursor, std::memory_order_release);
+				subscriber.delivered.fetch_add(len, std::memory_order_relaxed);
+				if (subscriber.policy == SerialOverflowPolicy::Block) release_room();
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Sleep until data is published past a cursor.
+		 *
+		 *	\returns False once the subscription is ending.
+		 */
+		bool SerialBroadcast::await_data(Subscriber& subscriber, uint64_t cursor)
+		{
+			if (!subscriber.running) return false;
+			if (m_head.load(std::memory_order_acquire) != cursor) return true;
+
+			std::unique_lock<std::mutex> lock(subscriber.lock);
+			subscriber.sleeping.store(true, std::memory_order_relaxed);
+
+			//	pairs with the fence of $Publish
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			subscriber.wake.wait(lock, [&] {
+				return m_head.load(std::memory_order_acquire) != cursor || !subscriber.running;
+			});
+
+			subscriber.sleeping.store(false, std::memory_order_relaxed);
+			return subscriber.running;
+		}
+
+
+
+		/**********************************************************************
+		 *	Apply the overflow policy to a subscriber overtaken by the
+		 *		publisher.
+		 *
+		 *	\param[in] subscriber The subscriber.
+		 *	\param[in] cursor Where it had read to.
+		 *	\returns Where it continues from.
+		 */
+		uint64_t SerialBroadcast::overflow(Subscriber& subscriber, uint64_t cursor)
+		{
+			const uint64_t reserved = m_reserved.load(std::memory_order_acquire);
+			subscriber.overflows.fetch_add(1, std::memory_order_relaxed);
+
+			if (subscriber.policy == SerialOverflowPolicy::Disconnect)
+			{
+				subscriber.dropped.fetch_add(reserved - cursor, std::memory_order_relaxed);
+				subscriber.active.store(false, std::memory_order_relaxed);
+				subscriber.connected = false;
+				subscriber.running = false;
+				return cursor;
+			}
+
+			//	keep the newest half of the ring, leaving the publisher room
+			uint64_t resume = reserved - Capacity() / 2;
+			subscriber.dropped.fetch_add(resume - cursor, std::memory_order_relaxed);
+			subscriber.cursor.store(resume, std::memory_order_release);
+			return resume;
+		}
+
+
+
+		/**********************************************************************
+		 *	Wake a sleeping subscriber.
+		 */
+		void SerialBroadcast::wake(Subscriber& subscriber)
+		{
+			{
+				std::lock_guard<std::mutex> lock(subscriber.lock);
+			}
+			subscriber.wake.notify_one();
+		}
+
+
+
+		/**********************************************************************
+		 *	Tell a publisher waiting in $AwaitRoom that room may have been made.
+		 */
+		void SerialBroadcast::release_room()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!m_publisherWaiting.load(std::memory_order_relaxed)) return;
+
+			{
+				std::lock_guard<std::mutex> lock(m_roomLock);
+			}
+			m_room.notify_all();
+		}
+
+
+
+		/**********************************************************************
+		 *	The cursor of the furthest behind Block subscriber, or $head.
+		 */
+		uint64_t SerialBroadcast::blocking_cursor(uint64_t head) const
+		{
+			uint64_t cursor = head;
+			for (const Subscriber& subscriber : m_subscribers)
+			{
+				if (!subscriber.active.load(std::memory_order_acquire)
+					|| subscriber.policy.load(std::memory_order_relaxed) != SerialOverflowPolicy::Block) continue;
+
+				cursor = (std::min)(cursor, subscriber.cursor.load(std::memory_order_acquire));
+			}
+			return cursor;
+		}
+
+
+
+		/**********************************************************************
+		 *	Copy data into the ring. Only the publisher writes the ring, so
+		 *		the words it fills in part need no more than a load first.
+		 *
+		 *	\param[in] position Where in the ring the data goes.
+		 *	\param[in] src The data.
+		 *	\param[in] len The length of the data.
+		 */
+		void SerialBroadcast::ring_write(uint64_t position, const uint8_t* src, size_t len)
+		{
+			const size_t last = Capacity() / RING_WORD - 1;
+			size_t word = (size_t)(position / RING_WORD) & last;
+			size_t skip = (size_t)(position % RING_WORD);
+			uint64_t value;
+
+			if (skip)
+			{
+				size_t span = (std::min)(len, RING_WORD - skip);
+				value = m_ring[word].load(std::memory_order_relaxed);
+				std::memcpy(reinterpret_cast<uint8_t*>(&value) + skip, src, span);
+				m_ring[word].store(value, std::memory_order_relaxed);
+
+				word = (word + 1) & last;
+				src += span;
+				len -= span;
+			}
+
+			std::atomic<uint64_t>* const ring = m_ring;
+			for (; len >= RING_WORD; len -= RING_WORD, src += RING_WORD)
+			{
+				uint64_t whole;
+				std::memcpy(&whole, src, RING_WORD);
+				ring[word].store(whole, std::memory_order_relaxed);
+				word = (word + 1) & last;
+			}
+
+			if (len)
+			{
+				value = m_ring[word].load(std::memory_order_relaxed);
+				std::memcpy(&value, src, len);
+				m_ring[word].store(value, std::memory_order_relaxed);
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Copy data out of the ring. The copy may be torn by the publisher;
+		 *		check $m_reserved after it to find out.
+		 *
+		 *	\param[in] position Where in the ring the data is.
+		 *	\param[out] dest The destination.
+		 *	\param[in] len The length of the data.
+		 */
+		void SerialBroadcast::ring_read(uint64_t position, uint8_t* dest, size_t len) const
+		{
+			const size_t last = Capacity() / RING_WORD - 1;
+			size_t word = (size_t)(position / RING_WORD) & last;
+			size_t skip = (size_t)(position % RING_WORD);
+			uint64_t value;
+
+			if (skip)
+			{
+				size_t span = (std::min)(len, RING_WORD - skip);
+				value = m_ring[word].load(std::memory_order_relaxed);
+				std::memcpy(dest, reinterpret_cast<const uint8_t*>(&value) + skip, span);
+
+				word = (word + 1) & last;
+				dest += span;
+				len -= span;
+			}
+
+			const std::atomic<uint64_t>* const ring = m_ring;
+			for (; len >= RING_WORD; len -= RING_WORD, dest += RING_WORD)
+			{
+				uint64_t whole = ring[word].load(std::memory_order_relaxed);
+				std::memcpy(dest, &whole, RING_WORD);
+				word = (word + 1) & last;
+			}
+
+			if (len)
+			{
+				value = m_ring[word].load(std::memory_order_relaxed);
+				std::memcpy(dest, &value, len);
+			}
+		}
+	}
+}
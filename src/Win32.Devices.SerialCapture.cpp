@@ -0,0 +1,248 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialCapture.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Record payloads are padded to keep records aligned.
+		static size_t padded(size_t len)
+		{
+			return (len + 7) & ~(size_t)7;
+		}
+
+
+
+		/**********************************************************************
+		 *	Append a read or write.
+		 *
+		 *	\param[in] direction Which way the data travelled.
+		 *	\param[in] data The bytes.
+		 *	\param[in] len The number of bytes.
+		 */
+		void SerialRecorder::Append(SerialCaptureDirection direction, const void* data, size_t len)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			uint8_t* payload = reserve(direction, len);
+			if (!payload) return;
+
+			std::memcpy(payload, data, len);
+			commit(len);
+		}
+
+
+
+		/**********************************************************************
+		 *	Append a gathering write as one record.
+		 *
+		 *	\param[in] direction Which way the data travelled.
+		 *	\param[in] buffers The buffers, in order.
+		 *	\param[in] count The number of buffers.
+		 *	\param[in] len The number of bytes from the buffers to record,
+		 *		i.e. those actually written.
+		 */
+		void SerialRecorder::Append(SerialCaptureDirection direction, const SerialBuffer* buffers, size_t count, size_t len)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			uint8_t* payload = reserve(direction, len);
+			if (!payload) return;
+
+			size_t copied = 0;
+			for (size_t i = 0; i < count && copied < len; i++)
+			{
+				size_t span = (std::min)(buffers[i].size, len - copied);
+				std::memcpy(payload + copied, buffers[i].data, span);
+				copied += span;
+			}
+			commit(len);
+		}
+
+
+
+		/**********************************************************************
+		 *	The bytes in use, the header included.
+		 */
+		uint64_t SerialRecorder::Length() const
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			return m_length;
+		}
+
+
+
+		/**********************************************************************
+		 *	Write a record header at the end of the capture, growing the
+		 *		mapping if needed. Expects $m_lock held.
+		 *
+		 *	\returns Where the payload goes, or nullptr once closed or if the
+		 *		file cannot grow.
+		 */
+		uint8_t* SerialRecorder::reserve(SerialCaptureDirection direction, size_t len)
+		{
+			if (!m_base || len > UINT32_MAX) return nullptr;
+
+			size_t needed = m_length + sizeof(SerialCaptureRecord) + padded(len);
+			if (needed > m_capacity)
+			{
+				size_t capacity = (std::max)(m_capacity * 2,
+					(needed + SerialCaptureGrowth - 1) / SerialCaptureGrowth * SerialCaptureGrowth);
+				if (!map(capacity))
+				{
+					std::cerr << "Serial Error: Capture file could not grow!" << std::endl;
+					return nullptr;
+				}
+			}
+
+			SerialCaptureRecord* record = reinterpret_cast<SerialCaptureRecord*>(m_base + m_length);
+			record->offset = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - m_started).count();
+			record->length = (uint32_t)len;
+			record->direction = (uint16_t)direction;
+			record->reserved = 0;
+			return reinterpret_cast<uint8_t*>(record + 1);
+		}
+
+
+
+		/**********************************************************************
+		 *	Pad the reserved record and publish it in the header.
+		 *		Expects $m_lock held.
+		 */
+		void SerialRecorder::commit(size_t len)
+		{
+			uint8_t* payload = m_base + m_length + sizeof(SerialCaptureRecord);
+			std::memset(payload + len, 0, padded(len) - len);
+
+			m_length += sizeof(SerialCaptureRecord) + padded(len);
+			reinterpret_cast<SerialCaptureHeader*>(m_base)->length = m_length;
+		}
+
+
+
+		/**********************************************************************
+		 *	Start at the record at $at.
+		 */
+		SerialCapture::Iterator::Iterator(const uint8_t* at, const uint8_t* end)
+			: m_at(at), m_end(end), m_record()
+		{
+			load();
+		}
+
+
+
+		/**********************************************************************
+		 *	Step to the next record.
+		 */
+		SerialCapture::Iterator& SerialCapture::Iterator::operator++()
+		{
+			m_at += sizeof(SerialCaptureRecord) + padded(m_record.data.size());
+			load();
+			return *this;
+		}
+
+
+
+		/**********************************************************************
+		 *	Decode the record at $m_at. A record cut short ends the capture.
+		 */
+		void SerialCapture::Iterator::load()
+		{
+			if ((size_t)(m_end - m_at) < sizeof(SerialCaptureRecord))
+			{
+				m_at = m_end;
+				return;
+			}
+
+			SerialCaptureRecord header;
+			std::memcpy(&header, m_at, sizeof(header));
+			if ((size_t)(m_end - m_at) - sizeof(SerialCaptureRecord) < padded(header.length))
+			{
+				m_at = m_end;
+				return;
+			}
+
+			m_record.offset = std::chrono::nanoseconds(header.offset);
+			m_record.direction = (SerialCaptureDirection)header.direction;
+			m_record.data = std::string_view((const char*)m_at + sizeof(SerialCaptureRecord), header.length);
+		}
+
+
+
+		/**********************************************************************
+		 *	The first record.
+		 */
+		SerialCapture::Iterator SerialCapture::begin() const
+		{
+			return Iterator(m_base + sizeof(SerialCaptureHeader), m_base + m_length);
+		}
+
+
+
+		/**********************************************************************
+		 *	Past the last record.
+		 */
+		SerialCapture::Iterator SerialCapture::end() const
+		{
+			return Iterator(m_base + m_length, m_base + m_length);
+		}
+
+
+
+		/**********************************************************************
+		 *	When the capture started, by the recording machine's wall clock.
+		 */
+		std::chrono::system_clock::time_point SerialCapture::Started() const
+		{
+			const SerialCaptureHeader* header = reinterpret_cast<const SerialCaptureHeader*>(m_base);
+			return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+				std::chrono::nanoseconds(header->startTime)));
+		}
+
+
+
+		/**********************************************************************
+		 *	Validate a mapped capture and find its end.
+		 *
+		 *	\param[in] base The mapping.
+		 *	\param[in] size The size of the file.
+		 *	\returns The bytes in use, or 0 if not a capture.
+		 */
+		size_t SerialCapture::validate(const uint8_t* base, size_t size)
+		{
+			if (size < sizeof(SerialCaptureHeader)) return 0;
+
+			SerialCaptureHeader header;
+			std::memcpy(&header, base, sizeof(header));
+			if (std::memcmp(header.magic, SerialCaptureMagic, sizeof(header.magic)) != 0) return 0;
+
+			//	a recorder still running or killed leaves the file longer
+			if (header.length < sizeof(SerialCaptureHeader) || header.length > size) return size;
+			return (size_t)header.length;
+		}
+
+
+
+		/**********************************************************************
+		 *	Write a fresh header. Expects the mapping in place.
+		 */
+		void SerialRecorder::start()
+		{
+			m_started = std::chrono::steady_clock::now();
+
+			SerialCaptureHeader* header = reinterpret_cast<SerialCaptureHeader*>(m_base);
+			std::memcpy(header->magic, SerialCaptureMagic, sizeof(header->magic));
+			header->startTime = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+			header->length = sizeof(SerialCaptureHeader);
+			header->reserved = 0;
+			m_length = sizeof(SerialCaptureHeader);
+		}
+	}
+}
@@ -0,0 +1,168 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialCapture.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <stdexcept>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Create a capture file, replacing any file at the path.
+		 *
+		 *	\param[in] path The file.
+		 */
+		SerialRecorder::SerialRecorder(const std::string& path)
+		{
+			m_file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			if (m_file < 0)
+			{
+				throw std::runtime_error("No capture file");
+			}
+
+			if (!map(SerialCaptureGrowth))
+			{
+				close(m_file);
+				m_file = -1;
+				throw std::runtime_error("No capture mapping");
+			}
+			start();
+		}
+
+
+
+		/**********************************************************************
+		 *	Close the capture.
+		 */
+		SerialRecorder::~SerialRecorder()
+		{
+			Close();
+		}
+
+
+
+		/**********************************************************************
+		 *	Unmap the capture and trim the file to the records written.
+		 *		Appends after closing are ignored.
+		 */
+		void SerialRecorder::Close()
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			if (m_file < 0) return;
+
+			unmap();
+			if (ftruncate(m_file, (off_t)m_length) != 0)
+			{
+				std::cerr << "Serial Error: Capture file could not be trimmed!" << std::endl;
+			}
+			close(m_file);
+			m_file = -1;
+		}
+
+
+
+		/**********************************************************************
+		 *	Extend the file and map it whole. The new mapping is made before
+		 *		the old one is released, so a failure leaves the old in place.
+		 *
+		 *	\param[in] capacity The new size of the file.
+		 *	\returns Whether the file is mapped at the new size.
+		 */
+		bool SerialRecorder::map(size_t capacity)
+		{
+			if (ftruncate(m_file, (off_t)capacity) != 0) return false;
+
+			void* base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+			if (base == MAP_FAILED) return false;
+
+			unmap();
+			m_base = static_cast<uint8_t*>(base);
+			m_capacity = capacity;
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the mapping.
+		 */
+		void SerialRecorder::unmap()
+		{
+			if (m_base) munmap(m_base, m_capacity);
+			m_base = nullptr;
+			m_capacity = 0;
+		}
+
+
+
+		/**********************************************************************
+		 *	Map a capture file for reading. A capture still being recorded
+		 *		reads up to its last whole record.
+		 *
+		 *	\param[in] path The file.
+		 */
+		SerialCapture::SerialCapture(const std::string& path)
+		{
+			m_file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (m_file < 0)
+			{
+				throw std::runtime_error("No capture file");
+			}
+
+			struct stat status;
+			if (fstat(m_file, &status) != 0 || (size_t)status.st_size < sizeof(SerialCaptureHeader))
+			{
+				close(m_file);
+				throw std::runtime_error("Not a capture file");
+			}
+
+			void* base = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+			if (base == MAP_FAILED)
+			{
+				close(m_file);
+				throw std::runtime_error("No capture mapping");
+			}
+			m_base = static_cast<const uint8_t*>(base);
+			m_mapped = (size_t)status.st_size;
+
+			m_length = validate(m_base, m_mapped);
+			if (!m_length)
+			{
+				unmap();
+				throw std::runtime_error("Not a capture file");
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the capture.
+		 */
+		SerialCapture::~SerialCapture()
+		{
+			unmap();
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the mapping and the file.
+		 */
+		void SerialCapture::unmap()
+		{
+			if (m_base) munmap(const_cast<uint8_t*>(m_base), m_mapped);
+			m_base = nullptr;
+			if (m_file >= 0) close(m_file);
+			m_file = -1;
+		}
+	}
+}
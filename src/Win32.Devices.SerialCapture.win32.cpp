@@ -0,0 +1,181 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialCapture.hpp"
+
+#include <exception>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Create a capture file, replacing any file at the path.
+		 *
+		 *	\param[in] path The file.
+		 */
+		SerialRecorder::SerialRecorder(const std::string& path)
+		{
+			m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+				nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+			{
+				throw std::exception("No capture file");
+			}
+
+			if (!map(SerialCaptureGrowth))
+			{
+				CloseHandle(m_file);
+				m_file = INVALID_HANDLE_VALUE;
+				throw std::exception("No capture mapping");
+			}
+			start();
+		}
+
+
+
+		/**********************************************************************
+		 *	Close the capture.
+		 */
+		SerialRecorder::~SerialRecorder()
+		{
+			Close();
+		}
+
+
+
+		/**********************************************************************
+		 *	Unmap the capture and trim the file to the records written.
+		 *		Appends after closing are ignored.
+		 */
+		void SerialRecorder::Close()
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			if (m_file == INVALID_HANDLE_VALUE) return;
+
+			unmap();
+
+			LARGE_INTEGER end;
+			end.QuadPart = (LONGLONG)m_length;
+			if (!SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+			{
+				std::cerr << "Serial Error: Capture file could not be trimmed!" << std::endl;
+			}
+			CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+		}
+
+
+
+		/**********************************************************************
+		 *	Map the file whole at a new size; mapping past the end extends
+		 *		it. The new view is made before the old one is released, so a
+		 *		failure leaves the old in place.
+		 *
+		 *	\param[in] capacity The new size of the file.
+		 *	\returns Whether the file is mapped at the new size.
+		 */
+		bool SerialRecorder::map(size_t capacity)
+		{
+			HANDLE mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE,
+				(DWORD)((uint64_t)capacity >> 32), (DWORD)capacity, nullptr);
+			if (!mapping) return false;
+
+			void* base = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity);
+			if (!base)
+			{
+				CloseHandle(mapping);
+				return false;
+			}
+
+			unmap();
+			m_mapping = mapping;
+			m_base = static_cast<uint8_t*>(base);
+			m_capacity = capacity;
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the view and its mapping.
+		 */
+		void SerialRecorder::unmap()
+		{
+			if (m_base) UnmapViewOfFile(m_base);
+			if (m_mapping) CloseHandle(m_mapping);
+			m_base = nullptr;
+			m_mapping = nullptr;
+			m_capacity = 0;
+		}
+
+
+
+		/**********************************************************************
+		 *	Map a capture file for reading. A capture still being recorded
+		 *		reads up to its last whole record.
+		 *
+		 *	\param[in] path The file.
+		 */
+		SerialCapture::SerialCapture(const std::string& path)
+		{
+			m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+				nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+			{
+				throw std::exception("No capture file");
+			}
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_file, &size) || (size_t)size.QuadPart < sizeof(SerialCaptureHeader))
+			{
+				unmap();
+				throw std::exception("Not a capture file");
+			}
+
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			void* base = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (!base)
+			{
+				unmap();
+				throw std::exception("No capture mapping");
+			}
+			m_base = static_cast<const uint8_t*>(base);
+			m_mapped = (size_t)size.QuadPart;
+
+			m_length = validate(m_base, m_mapped);
+			if (!m_length)
+			{
+				unmap();
+				throw std::exception("Not a capture file");
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the capture.
+		 */
+		SerialCapture::~SerialCapture()
+		{
+			unmap();
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the view, its mapping and the file.
+		 */
+		void SerialCapture::unmap()
+		{
+			if (m_base) UnmapViewOfFile(m_base);
+			if (m_mapping) CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+			m_base = nullptr;
+			m_mapping = nullptr;
+			m_file = INVALID_HANDLE_VALUE;
+		}
+	}
+}
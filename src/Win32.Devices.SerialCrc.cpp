@@ -0,0 +1,140 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialCrc.hpp"
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Tables for four bytes at a time: $at[k][b] is the CRC of byte b
+		///		followed by k zero bytes.
+		struct Crc16Tables
+		{
+			uint16_t at[4][256];
+		};
+
+
+
+		/**********************************************************************
+		 *	Build the slicing tables of an MSB-first CRC-16.
+		 *
+		 *	\param[in] polynomial The polynomial, without its top bit.
+		 */
+		static constexpr Crc16Tables msb_tables(uint16_t polynomial)
+		{
+			Crc16Tables tables = {};
+			for (unsigned b = 0; b < 256; b++)
+			{
+				uint16_t crc = (uint16_t)(b << 8);
+				for (int bit = 0; bit < 8; bit++)
+				{
+					crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ polynomial) : (uint16_t)(crc << 1);
+				}
+				tables.at[0][b] = crc;
+			}
+
+			//	one more zero byte through the byte table
+			for (int k = 1; k < 4; k++)
+			{
+				for (unsigned b = 0; b < 256; b++)
+				{
+					uint16_t crc = tables.at[k - 1][b];
+					tables.at[k][b] = (uint16_t)((crc << 8) ^ tables.at[0][crc >> 8]);
+				}
+			}
+			return tables;
+		}
+
+
+		/**********************************************************************
+		 *	Build the slicing tables of an LSB-first CRC-16.
+		 *
+		 *	\param[in] polynomial The polynomial, bit reversed.
+		 */
+		static constexpr Crc16Tables lsb_tables(uint16_t polynomial)
+		{
+			Crc16Tables tables = {};
+			for (unsigned b = 0; b < 256; b++)
+			{
+				uint16_t crc = (uint16_t)b;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ polynomial) : (uint16_t)(crc >> 1);
+				}
+				tables.at[0][b] = crc;
+			}
+
+			for (int k = 1; k < 4; k++)
+			{
+				for (unsigned b = 0; b < 256; b++)
+				{
+					uint16_t crc = tables.at[k - 1][b];
+					tables.at[k][b] = (uint16_t)((crc >> 8) ^ tables.at[0][crc & 0xFF]);
+				}
+			}
+			return tables;
+		}
+
+
+		static constexpr Crc16Tables xmodem_tables = msb_tables(0x1021);
+		static constexpr Crc16Tables modbus_tables = lsb_tables(0xA001);
+
+
+
+		/**********************************************************************
+		 *	CRC-16/XMODEM of a buffer.
+		 *
+		 *	\param[in] data The bytes.
+		 *	\param[in] len The number of bytes.
+		 *	\param[in] crc The CRC so far, to continue over several buffers.
+		 *	\returns The CRC.
+		 */
+		uint16_t Crc16Xmodem(const void* data, size_t len, uint16_t crc)
+		{
+			const uint8_t* at = static_cast<const uint8_t*>(data);
+			const auto& t = xmodem_tables.at;
+
+			//	the register folds into the first two of every four bytes
+			for (; len >= 4; len -= 4, at += 4)
+			{
+				crc = (uint16_t)(t[3][(crc >> 8) ^ at[0]] ^ t[2][(crc & 0xFF) ^ at[1]]
+					^ t[1][at[2]] ^ t[0][at[3]]);
+			}
+			for (; len; len--, at++)
+			{
+				crc = (uint16_t)((crc << 8) ^ t[0][(crc >> 8) ^ *at]);
+			}
+			return crc;
+		}
+
+
+
+		/**********************************************************************
+		 *	CRC-16/MODBUS of a buffer.
+		 *
+		 *	\param[in] data The bytes.
+		 *	\param[in] len The number of bytes.
+		 *	\param[in] crc The CRC so far, to continue over several buffers.
+		 *	\returns The CRC; its low byte goes on the line first.
+		 */
+		uint16_t Crc16Modbus(const void* data, size_t len, uint16_t crc)
+		{
+			const uint8_t* at = static_cast<const uint8_t*>(data);
+			const auto& t = modbus_tables.at;
+
+			for (; len >= 4; len -= 4, at += 4)
+			{
+				crc ^= (uint16_t)(at[0] | (at[1] << 8));
+				crc = (uint16_t)(t[3][crc & 0xFF] ^ t[2][crc >> 8] ^ t[1][at[2]] ^ t[0][at[3]]);
+			}
+			for (; len; len--, at++)
+			{
+				crc = (uint16_t)((crc >> 8) ^ t[0][(crc ^ *at) & 0xFF]);
+			}
+			return crc;
+		}
+	}
+}
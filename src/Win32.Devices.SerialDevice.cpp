@@ -2,8 +2,11 @@
 
 //	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
 #include "Win32.Devices.SerialDevice.hpp"
+#include "Win32.Devices.SerialReactor.hpp"
 
 #include <assert.h>
+#include <cstring>
+#include <vector>
 
 #ifdef DEBUG
 #define DEBUG_ASSERT(ptr) assert(ptr)
@@ -11,19 +14,21 @@
 #define DEBUG_ASSERT(ptr)
 #endif
 
-#define NO_SHARING	NULL
-#define NO_SECURITY	NULL
-#define NON_OVERLAPPED_IO	NULL
-#define NO_FLAGS	NULL
-
-#define SW_BUFFER_SIZE		(0xFFul)
-
 
 
 namespace Win32
 {
 	namespace Devices
-	{		
+	{
+		///	The deadline $timeout from now; $SerialAwaitForever never passes.
+		static std::chrono::steady_clock::time_point rx_deadline(std::chrono::milliseconds timeout)
+		{
+			if (timeout == SerialAwaitForever) return (std::chrono::steady_clock::time_point::max)();
+			return std::chrono::steady_clock::now() + timeout;
+		}
+
+
+
 		/**********************************************************************
 		 *	Blank Constructor.
 		 */
@@ -39,16 +44,40 @@ namespace Win32
 		 *	\param[in] A pointer to an available serial device.
 		 */
 		SerialDevice::SerialDevice(SerialDevice&& serialDevicePtr) noexcept			
-			: m_portNum(serialDevicePtr.m_portNum)
-			, m_pComm(serialDevicePtr.m_pComm)
+			: m_pComm(serialDevicePtr.m_pComm)
+			, m_portNum(serialDevicePtr.m_portNum)
+			, m_path(std::move(serialDevicePtr.m_path))
+			, m_settings(serialDevicePtr.m_settings)
+			, m_configured(serialDevicePtr.m_configured)
+			, m_memory(serialDevicePtr.m_memory)
+			, m_rxRing(std::move(serialDevicePtr.m_rxRing))
+			, m_rxDelivery(serialDevicePtr.m_rxDelivery)
+			, m_rxBatching(serialDevicePtr.m_rxBatching)
+			, m_framer(std::move(serialDevicePtr.m_framer))
+			, m_broadcast(std::move(serialDevicePtr.m_broadcast))
+			, m_shared(std::move(serialDevicePtr.m_shared))
+			, m_txDepth(serialDevicePtr.m_txDepth)
+			, m_reconnect(serialDevicePtr.m_reconnect)
+			, m_supervised(serialDevicePtr.m_supervised.load())
+			, m_stats(std::move(serialDevicePtr.m_stats))
+			, m_recorder(std::move(serialDevicePtr.m_recorder))
 		{
-			serialDevicePtr.m_pComm = nullptr;
+			//	the transmit queue writes through the moved-from device
+			serialDevicePtr.stop_tx();
+
+#ifdef SERIAL_BACKEND_POSIX
+			//	the reactor refers to the moved-from device
+			if (serialDevicePtr.m_reactor) serialDevicePtr.m_reactor->Detach(serialDevicePtr);
+#endif // SERIAL_BACKEND_POSIX
+			serialDevicePtr.m_pComm = SERIAL_INVALID_HANDLE;
 			serialDevicePtr.m_portNum = 0;
-			assert(m_pComm);
+			assert(m_pComm != SERIAL_INVALID_HANDLE);
+#ifndef SERIAL_BACKEND_POSIX
+			m_txGather.Memory(m_memory);
+#endif // !SERIAL_BACKEND_POSIX
 
-			config_settings();
-			config_timeouts();
-			clear_comm();
+			//	a port not yet configured, i.e. built from a handle, is brought up here
+			if (!m_configured) bring_up(m_settings);
 		}
 
 
@@ -62,16 +91,47 @@ namespace Win32
 		{	
 			if (&to_move != this)
 			{
+				//	writes queued here go out on this port, which is then closed
+				Close();
+
+#ifdef SERIAL_BACKEND_POSIX
+				//	the reactor refers to the moved-from device
+				if (to_move.m_reactor) to_move.m_reactor->Detach(to_move);
+#endif // SERIAL_BACKEND_POSIX
+
+				//	the transmit queue writes through the moved-from device
+				to_move.stop_tx();
+
 				m_portNum = to_move.m_portNum;
 				to_move.m_portNum = 0;
+				m_path = std::move(to_move.m_path);
 
 				m_pComm = to_move.m_pComm;
-				to_move.m_pComm = nullptr;
-				assert(m_pComm);
-
-				config_settings();
-				config_timeouts();
-				clear_comm();
+				to_move.m_pComm = SERIAL_INVALID_HANDLE;
+				assert(m_pComm != SERIAL_INVALID_HANDLE);
+
+				m_memory = to_move.m_memory;
+#ifndef SERIAL_BACKEND_POSIX
+				m_txGather.Memory(m_memory);
+#endif // !SERIAL_BACKEND_POSIX
+				m_rxRing = std::move(to_move.m_rxRing);
+				m_rxDelivery = to_move.m_rxDelivery;
+				m_rxBatching = to_move.m_rxBatching;
+				m_framer = std::move(to_move.m_framer);
+				m_broadcast = std::move(to_move.m_broadcast);
+				m_shared = std::move(to_move.m_shared);
+
+				m_txDepth = to_move.m_txDepth;
+				m_stats = std::move(to_move.m_stats);
+				m_recorder = std::move(to_move.m_recorder);
+
+				m_settings = to_move.m_settings;
+				m_configured = to_move.m_configured;
+				if (!m_configured) bring_up(m_settings);
+
+				m_reconnect = to_move.m_reconnect;
+				m_supervised = to_move.m_supervised.load();
+				to_move.m_supervised = false;
 			}
 
 			return *this;
@@ -90,582 +150,1105 @@ namespace Win32
 
 
 		/**********************************************************************
-		 *	Obtain a serial device from a specified COM Port number.
-		 *		 
-		 *	\param[in] COMPortNum The number of the COM Port. i.e. "COM10"
-		 *		requires an input of 10.
-		 *	\returns A serial device with an initalized comm handle.
+		 *	Tell the serial device to use a separate thread for awaiting events
+		 *		from the comm.
+		 *
+		 *	\param[in] usingCommEv Indicates whether to use serial events.
+		 */
+		void SerialDevice::UsingEvents(bool usingCommEv)
+		{
+			m_continuePoll.test_and_set();
+			m_thCommEv = std::thread(&SerialDevice::interrupt_thread, this);			
+		}
+
+
+
+		/**********************************************************************
+		 *	Defer operations to allow the working thread to process any pending
+		 *		data coming in. Useful only when $UsingEvents.
+		 *
+		 *	\param[in] deferMillis The amount of milliseconds to defer the
+		 *		ending of the worker thread.
+		 */
+		void SerialDevice::Defer(std::chrono::milliseconds deferMillis)
+		{
+			std::this_thread::sleep_for(deferMillis);
+			m_continuePoll.clear();
+		}
+
+
+
+		/**********************************************************************
+		 *	Coalesce received data before the event thread delivers it. Like
+		 *		the port timeouts, set it before $UsingEvents.
+		 *
+		 *	\param[in] batching The minimum batch, the longest hold, and an
+		 *		optional delimiter flushing the batch at once. i.e.
+		 *		{ 256, std::chrono::microseconds(500), '\n' }.
 		 */
-		SerialDevice SerialDevice::FromPortNumber(uint16_t COMPortNum)
+		void SerialDevice::RxBatching(const SerialRxBatching& batching)
 		{
-			//	prepend COM directory
-			std::wstring port_dir = { L"\\\\.\\COM" + std::to_wstring(COMPortNum) };
+			m_rxBatching = batching;
+		}
 
-			//	create the handle to the COM port
-			HANDLE h_sercom	= CreateFile(
-				port_dir.c_str(),
-				GENERIC_READ | GENERIC_WRITE,	// Open for reading and writing
-				NO_SHARING,						// No Sharing of the COM port
-				NO_SECURITY,					// No security necessary on COM port
-				OPEN_EXISTING,					// Open an existing port
-				FILE_FLAG_OVERLAPPED,			// Use overlapped operations
-				NO_FLAGS						// No other flags
-			);
-			
 
-			if (h_sercom == INVALID_HANDLE_VALUE)
+
+		/**********************************************************************
+		 *	Gets how received data is coalesced.
+		 */
+		SerialRxBatching SerialDevice::RxBatching() const
+		{
+			return m_rxBatching;
+		}
+
+
+
+		/**********************************************************************
+		 *	Supervise the connection: when the port goes away, i.e. a USB
+		 *		adapter is unplugged or resets, the event thread reopens it
+		 *		by the same path and reapplies the settings. Data received
+		 *		but not yet read, and buffers queued by $WriteAsync, are
+		 *		kept across the reconnect. Set it before $UsingEvents.
+		 *
+		 *	\param[in] reconnect The backoff between attempts to reopen.
+		 */
+		void SerialDevice::Supervise(const SerialReconnect& reconnect)
+		{
+			if (m_path.empty())
 			{
-				std::cerr << "Could not open port: COM" << COMPortNum << "!" << std::endl;			
-				throw std::exception("No COM HANDLE");
+				std::cerr << "Serial Error: No path to reopen the port by!" << std::endl;
+				return;
 			}
 
-			return SerialDevice(h_sercom, COMPortNum);
+			m_reconnect = reconnect;
+			m_supervised = true;
 		}
 
 
 
 		/**********************************************************************
-		 *	Close the serial device connection.		 		 
+		 *	Gets the state of the connection to the port.
 		 */
-		void SerialDevice::Close()
+		SerialConnectionState SerialDevice::Connection() const
 		{
-			m_continuePoll.clear();
-			if (m_thCommEv.joinable()) m_thCommEv.join();
+			return m_connection.load();
+		}
 
-			if (m_pComm != nullptr)
-			{
-				CloseHandle(m_pComm);
-				m_pComm = nullptr;
-			}				
+
+
+		/**********************************************************************
+		 *	Select how the event thread delivers received data.
+		 *
+		 *	\param[in] delivery Strings raise $ReceivedData with an owning copy
+		 *		per burst; Views raise $ReceivedView over the receive ring
+		 *		without allocating; Frames raise $ReceivedFrame per frame
+		 *		once a framer is set with $UsingFramer.
+		 */
+		void SerialDevice::RxDelivery(SerialRxDelivery delivery)
+		{
+			m_rxDelivery = delivery;
 		}
 
 
 
 		/**********************************************************************
-		 *	Tell the serial device to use a separate thread for awaiting events
-		 *		from the comm.
+		 *	Gets how the event thread delivers received data.
+		 */
+		SerialRxDelivery SerialDevice::RxDelivery() const
+		{
+			return m_rxDelivery;
+		}
+
+
+
+		/**********************************************************************
+		 *	Split received data into frames and deliver them by $ReceivedFrame.
 		 *
-		 *	\param[in] usingCommEv Indicates whether to use serial events.
+		 *	\param[in] framer The framer cutting the stream, i.e. a
+		 *		DelimiterFramer or SlipFramer.
 		 */
-		void SerialDevice::UsingEvents(bool usingCommEv)
+		void SerialDevice::UsingFramer(std::unique_ptr<SerialFramer> framer)
 		{
-			m_continuePoll.test_and_set();
-			m_thCommEv = std::thread(&SerialDevice::interrupt_thread, this);			
+			m_framer = std::move(framer);
+			m_rxDelivery = m_framer ? SerialRxDelivery::Frames : SerialRxDelivery::Strings;
 		}
 
 
 
 		/**********************************************************************
-		 *	Defer operations to allow the working thread to process any pending
-		 *		data coming in. Useful only when $UsingEvents.
+		 *	Deliver received data through a broadcast, so that each subscriber
+		 *		consumes it on its own thread and a slow one cannot stall the
+		 *		event thread. Subscribe before starting events.
 		 *
-		 *	\param[in] deferMillis The amount of milliseconds to defer the
-		 *		ending of the worker thread.
+		 *	\returns The broadcast, created on first use.
 		 */
-		void SerialDevice::Defer(std::chrono::milliseconds deferMillis)
+		SerialBroadcast& SerialDevice::Broadcast()
 		{
-			std::this_thread::sleep_for(deferMillis);
-			m_continuePoll.clear();
+			if (!m_broadcast) m_broadcast.reset(new SerialBroadcast(SerialBroadcastSize, m_memory));
+			m_rxDelivery = SerialRxDelivery::Broadcast;
+			return *m_broadcast;
 		}
 
 
 
 		/**********************************************************************
-		 *	Write a stl string to the serial device.
+		 *	Deliver received data into a named shared-memory ring, which
+		 *		processes that cannot open the port attach to with a
+		 *		SerialSharedReader. The event thread never waits on them.
+		 *		Share before starting events.
 		 *
-		 *	\param[in] src_string The string containing source data.
+		 *	\param[in] name The name readers attach by.
+		 *	\param[in] capacity Bytes a reader may fall behind.
+		 *	\returns The publisher, created on first use.
 		 */
-		size_t SerialDevice::Write(const std::string& src_str)
+		SerialSharedPublisher& SerialDevice::Share(const std::string& name, size_t capacity)
 		{
-			return win32_write(src_str.c_str(), src_str.length());
+			if (!m_shared) m_shared.reset(new SerialSharedPublisher(name, capacity));
+			m_rxDelivery = SerialRxDelivery::Shared;
+			return *m_shared;
 		}
 
 
 
 		/**********************************************************************
-		 *	Read data from the serial device and put it into an stl string.
+		 *	Take every buffer of the device from a memory resource: the
+		 *		receive ring, the transmit queue, a broadcast, and the
+		 *		payloads raised by $ReceivedPayload. With a SerialBlockPool,
+		 *		serial I/O stays off the global heap once running. Set it
+		 *		before anything else; the receive ring is remade, empty.
 		 *
-		 *	\param[out] dest_str The string designating the received data.
+		 *	\param[in] memory The resource, which must outlive the device.
 		 */
-		size_t SerialDevice::Read(std::string& dest_str)
+		void SerialDevice::UsingMemory(std::pmr::memory_resource* memory)
 		{
-			char temp[128];
+			m_memory = memory ? memory : std::pmr::get_default_resource();
+			if (m_rxRing) m_rxRing.reset(new SerialRingBuffer(m_rxRing->Capacity(), m_memory));
+#ifndef SERIAL_BACKEND_POSIX
+			m_txGather.Memory(m_memory);
+#endif // !SERIAL_BACKEND_POSIX
+
+			//	restarted in the new memory by the next WriteAsync
+			stop_tx();
+		}
 
-			size_t len = win32_read(temp, 128);
-			dest_str = { temp, len };
-			return len;
+
+
+		/**********************************************************************
+		 *	Gets the memory the device's buffers come from.
+		 */
+		std::pmr::memory_resource* SerialDevice::Memory() const
+		{
+			return m_memory;
 		}
 
 
 
 		/**********************************************************************
-		 *	Indicates the data received and available in the Rx buffer.
+		 *	Write a stl string to the serial device. Writes from several
+		 *		threads go out one after another, never interleaved.
 		 *
-		 *	\returns The number of bytes avaialbe in the Rx buffer.
+		 *	\param[in] src_string The string containing source data.
 		 */
-		uint32_t SerialDevice::Available()
+		size_t SerialDevice::Write(const std::string& src_str)
 		{
-			DWORD err_flags = { 0 };
-			COMSTAT com_status = { 0 };
-			DEBUG_ASSERT(m_pComm);
-			ClearCommError(m_pComm, &err_flags, &com_status);
-				
-			return com_status.cbInQue;
+			std::lock_guard<std::mutex> lock(m_writeLock);
+			return native_write(src_str.c_str(), src_str.length());
 		}
 
 
 
 		/**********************************************************************
-		 *	Sets the baudrate.
+		 *	Write several buffers as one write, without joining them first.
 		 *
-		 *	\param[in] baudrate The baud rate of the communication.
+		 *	\param[in] buffers The buffers, written in order. i.e.
+		 *		Write({ header, payload, crc }).
+		 *	\returns The number of bytes written.
 		 */
-		void SerialDevice::BaudRate(uint32_t baudrate)
+		size_t SerialDevice::Write(std::initializer_list<SerialBuffer> buffers)
 		{
-			m_baudrate = baudrate;
-			config_settings();
+			std::lock_guard<std::mutex> lock(m_writeLock);
+			return native_writev(buffers.begin(), buffers.size());
 		}
 
 
 
 		/**********************************************************************
-		 *	Gets the baudrate
+		 *	Write several buffers as one write, without joining them first.
 		 *
-		 *	\returns The current baud rate of the communication.
+		 *	\param[in] buffers The buffers, written in order.
+		 *	\param[in] count The number of buffers.
+		 *	\returns The number of bytes written.
 		 */
-		uint32_t SerialDevice::BaudRate() const
+		size_t SerialDevice::Write(const SerialBuffer* buffers, size_t count)
 		{
-			return m_baudrate;
+			std::lock_guard<std::mutex> lock(m_writeLock);
+			return native_writev(buffers, count);
 		}
 
 
 
 		/**********************************************************************
-		 *	Sets the stop bits.
+		 *	Queue a stl string for writing without waiting for the port.
+		 *		The string is copied into the device's memory. Buffers
+		 *		queued back-to-back are coalesced into one write.
+		 *		Blocks while $TxQueueDepth buffers are already in flight.
+		 *		Any number of threads may queue at once.
 		 *
-		 *	\param[in]	stopBits The number of stop bits to use for data
-		 *		flow control.
+		 *	\param[in] src_str The string containing source data.
+		 *	\param[in] priority High to go ahead of Normal buffers still queued.
+		 *	\returns A future holding the number of bytes written.
 		 */
-		void SerialDevice::StopBits(uint8_t stopBits)
+		std::future<size_t> SerialDevice::WriteAsync(const std::string& src_str, SerialTxPriority priority)
 		{
-			// \TODO: m_stopBits = stopBits;
-			config_settings();
+			SerialTxQueue* queue = m_txActive.load(std::memory_order_acquire);
+			if (!queue) queue = start_tx();
+			return queue->Push(src_str, priority);
 		}
 
 
 
 		/**********************************************************************
-		 *	Gets the number of stop bits.
+		 *	Queue a frame built from several parts. The parts are joined, so
+		 *		the frame goes out whole even with other threads queueing.
 		 *
-		 *	\returns The number of stop bits currently used for flow control.
+		 *	\param[in] frame The parts, in order. i.e. { header, payload, crc }.
+		 *	\param[in] priority High to go ahead of Normal buffers still queued.
+		 *	\returns A future holding the number of bytes written.
 		 */
-		uint8_t SerialDevice::StopBits() const
+		std::future<size_t> SerialDevice::WriteAsync(std::initializer_list<SerialBuffer> frame, SerialTxPriority priority)
 		{
-			// \TODO: return m_stopBits
-			return uint8_t();
+			SerialTxQueue* queue = m_txActive.load(std::memory_order_acquire);
+			if (!queue) queue = start_tx();
+			return queue->Push(frame, priority);
 		}
 
 
 
 		/**********************************************************************
-		 *	Set the size of a byte.
+		 *	Wait for every buffer queued by $WriteAsync to be written.
+		 */
+		void SerialDevice::Flush()
+		{
+			SerialTxQueue* queue = m_txActive.load(std::memory_order_acquire);
+			if (queue) queue->Flush();
+		}
+
+
+
+		/**********************************************************************
+		 *	Sets the number of $WriteAsync buffers allowed in flight. A
+		 *		running queue is drained and restarted with the new depth.
 		 *
-		 *	\param[in] byteSize The size of bytes in the communication.
+		 *	\param[in] depth The number of buffers.
 		 */
-		void SerialDevice::ByteSize(SerialByteSize byteSize)
+		void SerialDevice::TxQueueDepth(size_t depth)
 		{
-			m_byteSize = byteSize;
-			config_settings();
+			m_txDepth = depth;
+			stop_tx();
 		}
 
 
 
 		/**********************************************************************
-		 *	Gets the size of a byte.
+		 *	Gets the number of $WriteAsync buffers allowed in flight.
+		 */
+		size_t SerialDevice::TxQueueDepth() const
+		{
+			return m_txDepth;
+		}
+
+
+
+		/**********************************************************************
+		 *	Start the transmit queue, unless another producer just did.
 		 *
-		 *	\returns The current size of bytes in the communication.
+		 *	\returns The running queue.
 		 */
-		SerialByteSize SerialDevice::ByteSize() const
+		SerialTxQueue* SerialDevice::start_tx()
 		{
-			return m_byteSize;
+			std::lock_guard<std::mutex> lock(m_writeLock);
+			if (!m_txQueue)
+			{
+				m_txQueue.reset(new SerialTxQueue(
+					[this](const SerialBuffer* buffers, size_t count) {
+						return write_tx(buffers, count);
+					},
+					m_txDepth, m_memory));
+				m_txActive.store(m_txQueue.get(), std::memory_order_release);
+			}
+			return m_txQueue.get();
 		}
 
 
 
 		/**********************************************************************
-		 *	Basic write function that calls to the win32 api for serial
-		 *		writing.
+		 *	Write a batch from the transmit queue. While supervised, a batch
+		 *		cut short by the port going away is held until the port is
+		 *		reopened, and the rest written then.
 		 *
-		 *	\param[in] _src The source of the data to write to the serial
-		 *		device.
-		 *	\param[in] len The length of the source data.
+		 *	\param[in] buffers The buffers, written in order.
+		 *	\param[in] count The number of buffers.
+		 *	\returns The number of bytes written.
 		 */
-		size_t SerialDevice::win32_write(const void* _src, size_t len)
+		size_t SerialDevice::write_tx(const SerialBuffer* buffers, size_t count)
 		{
-			OVERLAPPED os_writer = { 0 };
-			DWORD bytes_written = 0;
-			
-			os_writer.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-			assert(os_writer.hEvent != NULL);
+			std::unique_lock<std::mutex> lock(m_writeLock);
+			size_t written = native_writev(buffers, count);
+
+			size_t len = 0;
+			for (size_t i = 0; i < count; i++) len += buffers[i].size;
 
-			if (!WriteFile(m_pComm, _src, len, &bytes_written, &os_writer))
+			while (written < len && m_linkLost && m_supervised)
 			{
-				if (GetLastError() != ERROR_IO_PENDING)
-				{
-					//	[error]: write operation has failed
-					return 0;
-				}
-				else
+				lock.unlock();
+				bool reopened = await_reconnect();
+				lock.lock();
+				if (!reopened) break;
+
+				//	the rest of the batch, past what was written
+				std::vector<SerialBuffer> rest;
+				size_t skip = written;
+				for (size_t i = 0; i < count; i++)
 				{
-					//	a write operation has been issued
-					if (!GetOverlappedResult(m_pComm, &os_writer, &bytes_written, TRUE))
+					if (skip >= buffers[i].size)
 					{
-						//	[error]: write operation has failed
-						return 0;
-					}
-					else
-					{	//	immediate
-						//	the write operation has completed successfully
-						return bytes_written;
+						skip -= buffers[i].size;
+						continue;
 					}
+					rest.emplace_back((const uint8_t*)buffers[i].data + skip, buffers[i].size - skip);
+					skip = 0;
 				}
+				written += native_writev(rest.data(), rest.size());
 			}
-			else
-			{
-				//	immediate success
-				//	the write operation has completed successfully
-				return bytes_written;
-			}
+			return written;
 		}
 
 
 
 		/**********************************************************************
-		 *	Basic read function that calls to the win32 api for serial reading.
-		 *
-		 *	\param[out] _dest The destination buffer for holding Rx data.
-		 *	\param[in] len The capacity of the destination buffer.
-		 *	\returns The number of bytes read into the destination buffer.
+		 *	Write out what is queued and stop the transmit queue. Not to be
+		 *		called while other threads still queue.
 		 */
-		size_t SerialDevice::win32_read(void* _dest, size_t len, DWORD readTimeout)
+		void SerialDevice::stop_tx()
 		{
-			OVERLAPPED os_reader = { 0 };
-			DWORD bytes_read = 0;
+			m_txActive.store(nullptr, std::memory_order_release);
+			m_txQueue.reset();
+		}
+
 
-			os_reader.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-			assert(os_reader.hEvent != NULL);
 
-			if (!m_ReadOpPending)
+		/**********************************************************************
+		 *	Reopen a port that went away, by the path it was opened by. Run
+		 *		by the event thread, which waits out a doubling backoff
+		 *		between attempts. The receive ring and the transmit queue
+		 *		are left as they are, so nothing buffered is lost.
+		 *
+		 *	\returns Whether the port was reopened; false once every attempt
+		 *		failed, or the device is closing.
+		 */
+		bool SerialDevice::reconnect()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_writeLock);
+				m_linkLost = true;
+				close_native();
+			}
+			connection(SerialConnectionState::Lost);
+
+			std::chrono::milliseconds delay = m_reconnect.firstDelay;
+			for (uint32_t attempt = 1; ; attempt++)
 			{
-				if (!ReadFile(m_pComm, _dest, len, &bytes_read, &os_reader))
 				{
-					if (GetLastError() != ERROR_IO_PENDING)
-					{
-						//	[error]: could not issue read operation
-						return 0;
-					}
-					else
-					{
-						//	read operation issued
-						m_ReadOpPending = TRUE;
-					}
+					//	closing ends the wait early
+					std::unique_lock<std::mutex> lock(m_connectionLock);
+					if (m_connectionSignal.wait_for(lock, delay, [this] { return !m_supervised; })) return false;
 				}
-				else
+				connection(SerialConnectionState::Reconnecting);
+
+				std::string error;
+				NativeHandle handle = open_native(m_path, error);
+				if (handle != SERIAL_INVALID_HANDLE)
 				{
-					//	read operation finished
-					m_ReadOpPending = FALSE;
-					return bytes_read;
+					std::lock_guard<std::mutex> lock(m_writeLock);
+					m_pComm = handle;
+					m_configured = false;
+					bring_up(m_settings);
+					m_linkLost = false;
+					break;
+				}
+
+				if (m_reconnect.maxAttempts && attempt >= m_reconnect.maxAttempts)
+				{
+					std::cerr << "Serial Error: Unable to reopen " << m_path << ": " << error << "!" << std::endl;
+					connection(SerialConnectionState::Failed);
+					return false;
 				}
+				delay = (std::min)(delay * 2, m_reconnect.maxDelay);
 			}
 
+			connection(SerialConnectionState::Connected);
+			return true;
+		}
+
 
-			DWORD object_result;
 
-			if (m_ReadOpPending)
+		/**********************************************************************
+		 *	Wait for a lost port to be reopened.
+		 *
+		 *	\returns Whether it was; false once reopening failed, or the
+		 *		device is closing.
+		 */
+		bool SerialDevice::await_reconnect()
+		{
+			std::unique_lock<std::mutex> lock(m_connectionLock);
+			m_connectionSignal.wait(lock, [this] {
+				return !m_linkLost || !m_supervised || m_connection == SerialConnectionState::Failed;
+			});
+			return !m_linkLost && m_supervised;
+		}
+
+
+
+		/**********************************************************************
+		 *	Change the state of the connection, waking writers held for a
+		 *		reconnect and raising $ConnectionChanged.
+		 *
+		 *	\param[in] state The new state.
+		 */
+		void SerialDevice::connection(SerialConnectionState state)
+		{
 			{
-				object_result = WaitForSingleObject(os_reader.hEvent, readTimeout);
-				switch (object_result)
-				{
-				case WAIT_OBJECT_0:
-					if (!GetOverlappedResult(m_pComm, &os_reader, &bytes_read, FALSE))
-					{
-						//	[error]: in communications
-						return 0;
-					}
-					else
-					{						
-						//	read operation finished
-						m_ReadOpPending = FALSE;
-						return bytes_read;
-					}
-					break;
+				std::lock_guard<std::mutex> lock(m_connectionLock);
+				m_connection = state;
+			}
+			m_connectionSignal.notify_all();
+			ConnectionChanged(state);
+		}
 
-				case WAIT_TIMEOUT:
-					break;
 
-				default:
-					break;
-				}
+
+		/**********************************************************************
+		 *	Read data from the serial device and put it into an stl string.
+		 *
+		 *	\param[out] dest_str The string designating the received data.
+		 */
+		size_t SerialDevice::Read(std::string& dest_str)
+		{
+			//	everything received so far, once there is something
+			if (!await_rx(1, (std::chrono::steady_clock::time_point::max)()))
+			{
+				dest_str.clear();
+				return 0;
 			}
-			return 0;
+
+			size_t len = m_rxRing->Size();
+			dest_str.resize(len);
+			m_rxRing->Read(&dest_str[0], len);
+			release_rx(len);
+			return len;
 		}
 
 
 
 		/**********************************************************************
-		 *	Configure the settings of the serial device using the win32 api.
+		 *	Read whatever has been received, waiting for at least one byte.
+		 *
+		 *	\param[out] dest The destination.
+		 *	\param[in] len The size of the destination.
+		 *	\param[in] timeout How long to wait for the first byte.
+		 *	\returns The number of bytes read, 0 on timeout.
 		 */
-		void SerialDevice::config_settings()
+		size_t SerialDevice::ReadSome(void* dest, size_t len, std::chrono::milliseconds timeout)
 		{
-			DCB data_cntrl_blk = { 0 };
+			if (!len || !await_rx(1, rx_deadline(timeout))) return 0;
+
+			size_t read = m_rxRing->Read(dest, len);
+			release_rx(read);
+			return read;
+		}
 
-			assert(m_pComm);			
 
-			if (!GetCommState(m_pComm, &data_cntrl_blk))
+
+		/**********************************************************************
+		 *	Read a number of bytes.
+		 *
+		 *	\param[out] dest_str The bytes read.
+		 *	\param[in] count The number of bytes to read.
+		 *	\param[in] timeout How long to wait for all of them.
+		 *	\returns The number of bytes read, less than $count on timeout.
+		 */
+		size_t SerialDevice::ReadExactly(std::string& dest_str, size_t count, std::chrono::milliseconds timeout)
+		{
+			auto deadline = rx_deadline(timeout);
+			dest_str.resize(count);
+
+			size_t read = 0;
+			while (read < count && await_rx((std::min)(count - read, m_rxRing->Capacity()), deadline))
 			{
-				std::cerr << "Serial Error: Unable to retrieve port settings!" << std::endl;
+				size_t len = m_rxRing->Read(&dest_str[read], count - read);
+				release_rx(len);
+				read += len;
 			}
-			else
+
+			//	keep a partial read rather than lose it
+			if (read < count)
 			{
-				/*	configure new settings */
+				size_t len = m_rxRing->Read(&dest_str[read], count - read);
+				release_rx(len);
+				read += len;
+			}
 
-				//	Binary Mode
-				data_cntrl_blk.fBinary = TRUE;
+			dest_str.resize(read);
+			return read;
+		}
 
-				//	Enable parity checking
-				data_cntrl_blk.fParity = TRUE;
 
-				//	DSR sensitivity
-				data_cntrl_blk.fDsrSensitivity = FALSE;
 
-				//	Disable error replacement
-				data_cntrl_blk.fErrorChar = FALSE;
+		/**********************************************************************
+		 *	Read up to and including a delimiter, i.e. "\r\n".
+		 *		The delimiter must arrive within the receive ring's capacity.
+		 *
+		 *	\param[out] dest_str The bytes read, ending with the delimiter.
+		 *	\param[in] delimiter The bytes ending the read.
+		 *	\param[in] timeout How long to wait for the delimiter.
+		 *	\returns The number of bytes read, 0 on timeout. Bytes received
+		 *		without the delimiter stay buffered.
+		 */
+		size_t SerialDevice::ReadUntil(std::string& dest_str, std::string_view delimiter, std::chrono::milliseconds timeout)
+		{
+			auto deadline = rx_deadline(timeout);
+			dest_str.clear();
+			if (delimiter.empty()) return 0;
 
-				//	No DSR output flow control
-				data_cntrl_blk.fOutxDsrFlow = FALSE;
+			size_t scanned = 0;
+			while (true)
+			{
+				size_t found = find_rx(delimiter, scanned);
+				if (found)
+				{
+					dest_str.resize(found);
+					m_rxRing->Read(&dest_str[0], found);
+					release_rx(found);
+					return found;
+				}
+
+				size_t pending = m_rxRing->Size();
+				if (pending == m_rxRing->Capacity())
+				{
+					std::cerr << "Serial Error: Delimiter not found within the receive ring!" << std::endl;
+					return 0;
+				}
+
+				//	rescan only the bytes that could start a delimiter
+				scanned = (pending >= delimiter.size()) ? pending - delimiter.size() + 1 : 0;
+				if (!await_rx(pending + 1, deadline)) return 0;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Apply every setting of the port at once: the line is programmed in
+		 *		a single round trip, and the timeouts in another only if they
+		 *		changed. Settings equal to those applied are not sent to the
+		 *		port at all.
+		 *
+		 *	\param[in] settings The line settings and timeouts.
+		 *	\returns Whether the port holds the settings. If not, they are
+		 *		kept, and sent whole on the next call.
+		 */
+		bool SerialDevice::Configure(const SerialSettings& settings)
+		{
+			if (m_configured && settings == m_settings) return true;
+
+			bool line = !m_configured || settings.LineDiffers(m_settings);
+			bool timeouts = !m_configured || settings.timeouts != m_settings.timeouts;
+
+			m_settings = settings;
+			m_configured = (!line || config_settings(settings))
+				&& (!timeouts || config_timeouts(settings.timeouts));
+			return m_configured;
+		}
+
+
+
+		/**********************************************************************
+		 *	Configure a newly opened port and clear anything already queued.
+		 *
+		 *	\param[in] settings The line settings and timeouts.
+		 *	\returns Whether the port took the settings.
+		 */
+		bool SerialDevice::bring_up(const SerialSettings& settings)
+		{
+			bool configured = Configure(settings);
+			clear_comm();
+			return configured;
+		}
 
-				//	Do not abort reads/writes on error
-				data_cntrl_blk.fAbortOnError = FALSE;
 
-				//	Disable null stripping
-				data_cntrl_blk.fNull = FALSE;
 
-				//	XOFF continues TX
-				data_cntrl_blk.fTXContinueOnXoff = TRUE;
+		/**********************************************************************
+		 *	Gets the settings of the port, as last configured.
+		 */
+		const SerialSettings& SerialDevice::Settings() const
+		{
+			return m_settings;
+		}
+
+
+
+		/**********************************************************************
+		 *	Sets the baudrate.
+		 *
+		 *	\param[in] baudrate The baud rate of the communication.
+		 */
+		void SerialDevice::BaudRate(uint32_t baudrate)
+		{
+			SerialSettings settings = m_settings;
+			settings.baudRate = baudrate;
+			Configure(settings);
+		}
+
+
+
+		/**********************************************************************
+		 *	Gets the baudrate
+		 *
+		 *	\returns The current baud rate of the communication.
+		 */
+		uint32_t SerialDevice::BaudRate() const
+		{
+			return m_settings.baudRate;
+		}
+
+
+
+		/**********************************************************************
+		 *	Sets the stop bits.
+		 *
+		 *	\param[in]	stopBits The number of stop bits to use for data
+		 *		flow control.
+		 */
+		void SerialDevice::StopBits(uint8_t stopBits)
+		{
+			SerialSettings settings = m_settings;
+			switch (stopBits)
+			{
+			case 1:
+				settings.stopBits = SerialStopBits::StopBits_1;
+				break;
+
+			case 2:
+				settings.stopBits = SerialStopBits::StopBits_2;
+				break;
+
+			default:
+				std::cerr << "Serial Error: Unsupported number of stop bits!" << std::endl;
+				return;
+			}
+			Configure(settings);
+		}
+
+
+
+		/**********************************************************************
+		 *	Gets the number of stop bits.
+		 *
+		 *	\returns The number of stop bits currently used for flow control.
+		 */
+		uint8_t SerialDevice::StopBits() const
+		{
+			return (m_settings.stopBits == SerialStopBits::StopBits_2) ? 2 : 1;
+		}
+
+
+
+		/**********************************************************************
+		 *	Set the size of a byte.
+		 *
+		 *	\param[in] byteSize The size of bytes in the communication.
+		 */
+		void SerialDevice::ByteSize(SerialByteSize byteSize)
+		{
+			SerialSettings settings = m_settings;
+			settings.byteSize = byteSize;
+			Configure(settings);
+		}
+
+
+
+		/**********************************************************************
+		 *	Gets the size of a byte.
+		 *
+		 *	\returns The current size of bytes in the communication.
+		 */
+		SerialByteSize SerialDevice::ByteSize() const
+		{
+			return m_settings.byteSize;
+		}
+
+
+
+		/**********************************************************************
+		 *	Start or stop collecting statistics. Collection starts from zero;
+		 *		set it before the device is in use.
+		 *
+		 *	\param[in] collect Whether to collect.
+		 */
+		void SerialDevice::CollectStats(bool collect)
+		{
+#ifdef SERIAL_STATS
+			if (collect && !m_stats) m_stats.reset(new SerialCounters());
+			else if (!collect) m_stats.reset();
+#else
+			if (collect) std::cerr << "Serial Error: Statistics were not compiled in (SERIAL_STATS)!" << std::endl;
+#endif // SERIAL_STATS
+		}
+
 
-				//	Set BAUD rate
-				data_cntrl_blk.BaudRate = m_baudrate;
 
-				//	Set byte size
-				data_cntrl_blk.ByteSize = (BYTE)m_byteSize;
+		/**********************************************************************
+		 *	Gets a snapshot of the statistics. Safe from any thread.
+		 *
+		 *	\returns The counters and histograms, zero when not collecting.
+		 */
+		SerialStats SerialDevice::Stats() const
+		{
+			SerialStats stats;
+			SerialCounters* counters = m_stats.get();
+			if (!counters) return stats;
+
+			stats.bytesIn = counters->bytesIn.load(std::memory_order_relaxed);
+			stats.bytesOut = counters->bytesOut.load(std::memory_order_relaxed);
+			stats.readCalls = counters->readCalls.load(std::memory_order_relaxed);
+			stats.writeCalls = counters->writeCalls.load(std::memory_order_relaxed);
+			stats.commEvents = counters->commEvents.load(std::memory_order_relaxed);
+			stats.timeouts = counters->timeouts.load(std::memory_order_relaxed);
+			stats.overruns = counters->overruns.load(std::memory_order_relaxed);
+			stats.framingErrors = counters->framingErrors.load(std::memory_order_relaxed);
+			stats.parityErrors = counters->parityErrors.load(std::memory_order_relaxed);
+			stats.writeLatency = counters->writeLatency.Read();
+			stats.rxLatency = counters->rxLatency.Read();
+
+			line_errors(stats);
+			return stats;
+		}
 
-				//	Set stop bits
-				data_cntrl_blk.StopBits = ONESTOPBIT;
 
-				//	Even Parity
-				data_cntrl_blk.Parity = NOPARITY;
 
-				/* --------------------------------------------------------------------- */
-				/*						Hardware flow control							 */
+		/**********************************************************************
+		 *	Capture every read and write from now on, as the port sees them.
+		 *		Set it before the device is in use.
+		 *
+		 *	\param[in] recorder The capture, which may be shared with other
+		 *		devices; nullptr stops recording.
+		 */
+		void SerialDevice::RecordTo(std::shared_ptr<SerialRecorder> recorder)
+		{
+			m_recorder = std::move(recorder);
+		}
 
-				// CTS output flow control
-				data_cntrl_blk.fOutxCtsFlow = TRUE;
 
-				// DTR flow control type
-				data_cntrl_blk.fDtrControl = DTR_CONTROL_ENABLE;
 
-				// No XON/XOFF out flow control
-				data_cntrl_blk.fOutX = FALSE;
+		/**********************************************************************
+		 *	Handle data received on the port.
+		 *
+		 *	This method is to be called by the worker thread for checking the
+		 *		RX data, reading it into the receive ring, and raising an event.
+		 */
+		void SerialDevice::handle_data()
+		{
+			assert(m_rxRing);
 
-				// No XON/XOFF in flow control
-				data_cntrl_blk.fInX = FALSE;
+			SERIAL_STATS_ADD(m_stats, commEvents, 1);
+#ifdef SERIAL_STATS
+			if (m_stats) m_stats->rxArrival = std::chrono::steady_clock::now();
+#endif // SERIAL_STATS
 
-				// RTS flow control
-				data_cntrl_blk.fRtsControl = RTS_CONTROL_ENABLE;
+			bool delimited = false;
+			fill_rx(Available(), delimited);
 
-				if (!SetCommState(m_pComm, &data_cntrl_blk))
+			//	hold a small batch for more, until the line goes quiet
+			if (holding_rx(delimited))
+			{
+				auto deadline = std::chrono::steady_clock::now() + m_rxBatching.maxHold;
+				do
 				{
-					std::cerr << "Serial Error: Unable to apply port settings!" << std::endl;
-				}
+					auto now = std::chrono::steady_clock::now();
+					if (now >= deadline) break;
+
+					auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+					if (!await_input(remaining) || !fill_rx(Available(), delimited)) break;
+				} while (holding_rx(delimited));
 			}
+
+			deliver_rx();
 		}
 
 
 
 		/**********************************************************************
-		 *	Configure the serial timeouts for read/write operations by calling
-		 *		the win32 api.
+		 *	Read the bytes waiting on the port straight into the receive ring.
+		 *
+		 *	\param[in] available The bytes waiting.
+		 *	\param[in,out] delimited Set once the batching delimiter is read.
+		 *	\returns The number of bytes read.
 		 */
-		void SerialDevice::config_timeouts()
+		size_t SerialDevice::fill_rx(size_t available, bool& delimited)
 		{
-			COMMTIMEOUTS timeouts;
+			size_t filled = 0;
 
-			assert(m_pComm);
-			
-			//	Get default timeout settings
-			if (!GetCommTimeouts(m_pComm, &timeouts))
+			//	at most twice when the ring wraps
+			while (available)
 			{
-				std::cerr << "Serial Error: Unable to retrieve timeout settings" << std::endl;
-			}			
-			else
-			{					
-				/*	All values are in milliseconds	*/
+				size_t span = 0;
+				uint8_t* _buf = m_rxRing->Prepare(span);
+				if (!span && m_rxDelivery == SerialRxDelivery::Broadcast && m_broadcast)
+				{
+					//	a Block subscriber is a whole ring behind; the rest waits in the port
+					if (!m_broadcast->AwaitRoom(std::chrono::milliseconds(50))) break;
+					publish_rx();
+					continue;
+				}
+				if (!span)
+				{
+					//	a Buffered ring is drained by the Read calls; give them a moment
+					if (m_rxDelivery != SerialRxDelivery::Buffered) break;
 
-				// Max time between arrival of two bytes
-				timeouts.ReadIntervalTimeout = 50;
+					std::unique_lock<std::mutex> lock(m_rxLock);
+					if (!m_rxSignal.wait_for(lock, std::chrono::milliseconds(50), [this] { return m_rxRing->Free() > 0; })) break;
+					continue;
+				}
+
+				size_t len = native_read(_buf, (std::min)(span, available));
+				if (!len) break;
 
-				// Total for read operation -> ReadFile()
-				timeouts.ReadTotalTimeoutConstant = 50;
+				if (m_rxBatching.delimiter >= 0 && !delimited)
+				{
+					delimited = std::memchr(_buf, m_rxBatching.delimiter, len) != nullptr;
+				}
 
-				// Used to calculate total period of read operation
-				timeouts.ReadTotalTimeoutMultiplier = 10;
+				m_rxRing->Commit(len);
+				available -= (std::min)(len, available);
+				filled += len;
+			}
+			return filled;
+		}
 
 
-				/*	Write timeouts	*/
 
-				// Total for write operation -> WriteFile()
-				timeouts.WriteTotalTimeoutConstant = 50;
+		/**********************************************************************
+		 *	Whether the batching policy holds the receive ring for more data.
+		 */
+		bool SerialDevice::holding_rx(bool delimited) const
+		{
+			return m_rxBatching.maxHold.count() > 0
+				&& m_rxDelivery != SerialRxDelivery::Buffered
+				&& !delimited
+				&& m_rxRing->Size() < m_rxBatching.minBytes
+				&& m_rxRing->Free() > 0;
+		}
 
-				// Total for write operation
-				timeouts.WriteTotalTimeoutMultiplier = 10;
 
-				//	Set port timeouts
-				if (!SetCommTimeouts(m_pComm, &timeouts))
+
+		/**********************************************************************
+		 *	Deliver the receive ring to subscribers and release it.
+		 */
+		void SerialDevice::deliver_rx()
+		{
+			size_t pending = m_rxRing->Size();
+			if (!pending) return;
+
+			SERIAL_STATS_RECORD(m_stats, rxLatency, m_stats->rxArrival);
+
+			if (m_rxDelivery == SerialRxDelivery::Buffered)
+			{
+				//	left for the Read calls
 				{
-					std::cerr << "Serial Error: Unable to apply new timeouts!" << std::endl;
+					std::lock_guard<std::mutex> lock(m_rxLock);
 				}
+				m_rxSignal.notify_all();
+			}
+			else if (m_rxDelivery == SerialRxDelivery::Frames && m_framer)
+			{
+				//	frames within a slice are raised in place
+				size_t span = 0;
+				const uint8_t* slice;
+				while ((slice = m_rxRing->Peek(span)), span)
+				{
+					m_framer->Feed(std::string_view((const char*)slice, span),
+						[this](std::string_view frame) { ReceivedFrame(frame); });
+					m_rxRing->Consume(span);
+				}
+			}
+			else if (m_rxDelivery == SerialRxDelivery::Broadcast)
+			{
+				publish_rx();
+			}
+			else if (m_rxDelivery == SerialRxDelivery::Shared)
+			{
+				//	never held back; a slow reader skips ahead instead
+				size_t span = 0;
+				const uint8_t* slice;
+				while ((slice = m_rxRing->Peek(span)), span)
+				{
+					if (m_shared) m_shared->Publish(slice, span);
+					m_rxRing->Consume(span);
+				}
+			}
+			else if (m_rxDelivery == SerialRxDelivery::Views)
+			{
+				//	one view per contiguous slice
+				size_t span = 0;
+				const uint8_t* slice;
+				while ((slice = m_rxRing->Peek(span)), span)
+				{
+					ReceivedView(std::string_view((const char*)slice, span));
+					m_rxRing->Consume(span);
+				}
+			}
+			else if (m_rxDelivery == SerialRxDelivery::Payloads)
+			{
+				ReceivedPayload(SerialPayload::Allocate(pending, m_memory,
+					[this](char* dest, size_t len) { m_rxRing->Read(dest, len); }));
+			}
+			else
+			{
+				std::string rx_data(pending, '\0');
+				m_rxRing->Read(&rx_data[0], pending);
+				ReceivedData(std::move(rx_data));
 			}
 		}
 
 
 
 		/**********************************************************************
-		 *	Clear the comm handle via a call to the win32 api.
+		 *	Publish the receive ring to the broadcast. What a Block subscriber
+		 *		has no room for stays in the ring.
 		 */
-		void SerialDevice::clear_comm()
+		void SerialDevice::publish_rx()
 		{
-			assert(m_pComm);
-			
-			//	Clear the port
-			if (PurgeComm(m_pComm, PURGE_TXCLEAR | PURGE_RXCLEAR) == 0)
+			size_t span = 0;
+			const uint8_t* slice;
+			while ((slice = m_rxRing->Peek(span)), span)
 			{
-				std::cerr << "Serial Error: Unable to clear the port!" << std::endl;
+				size_t published = m_broadcast ? m_broadcast->Publish(slice, span) : span;
+				m_rxRing->Consume(published);
+				if (published < span) break;
 			}
 		}
 
 
 
 		/**********************************************************************
-		 *	The background thread that awaits events on the comm. Using the
-		 *		win32 api, this thread sets the comm mask to await any received
-		 *		character. Upon characters, the thread checks for how many,
-		 *		reads the characters into a buffer, and then calls the CoreZero
-		 *		event, thus calling a user-defined handler.
+		 *	Wait until the receive ring holds a number of bytes. With an event
+		 *		thread or reactor filling the ring this waits for it; otherwise
+		 *		the port is read here.
+		 *
+		 *	\param[in] count The bytes wanted, at most the ring's capacity.
+		 *	\param[in] deadline When to give up; time_point::max() waits
+		 *		forever.
+		 *	\returns Whether the bytes are available.
 		 */
-		void SerialDevice::interrupt_thread()
+		bool SerialDevice::await_rx(size_t count, std::chrono::steady_clock::time_point deadline)
 		{
-			if (!SetCommMask(m_pComm, EV_RXCHAR))
+			const bool forever = (deadline == (std::chrono::steady_clock::time_point::max)());
+			count = (std::min)(count, m_rxRing->Capacity());
+
+			if (m_thCommEv.joinable() || m_reactor)
 			{
-#ifdef DEBUG
-				DWORD err = GetLastError();
-				std::cerr << std::to_string(err) << std::endl;
-#endif // DEBUG
+				if (m_rxDelivery != SerialRxDelivery::Buffered)
+				{
+					std::cerr << "Serial Error: Reading alongside events needs SerialRxDelivery::Buffered!" << std::endl;
+					return false;
+				}
 
-				abort();
-			}
-			else
-			{				
-				uint8_t* input_buffer = new uint8_t[SW_BUFFER_SIZE];
-				OVERLAPPED serial_status = { 0 };
-				BOOL stat_check_issued = FALSE;
-				DWORD comm_event = { 0 };
-				DWORD pending_object;
-				DWORD ov_res;
-
-				serial_status.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-				assert(serial_status.hEvent != NULL);
-
-				while (m_continuePoll.test_and_set())
+				auto ready = [this, count] { return m_rxRing->Size() >= count; };
+				std::unique_lock<std::mutex> lock(m_rxLock);
+				if (forever)
 				{
-					//	check for a previously issued status check
-					if (!stat_check_issued)
-					{
-						//	issue a check for status
-						if (!WaitCommEvent(m_pComm, &comm_event, &serial_status))
-						{
-							// did not return immediately, check for pending check
-							if (GetLastError() == ERROR_IO_PENDING)
-							{
-								stat_check_issued = TRUE;
-							}
-							else
-							{
-								//	could not issue a status check
-								stat_check_issued = FALSE;
-							}
-						}
-						else
-						{
-							// returned immediately
-							handle_data();
-						}
-					}
+					m_rxSignal.wait(lock, ready);
+					return true;
+				}
+				return m_rxSignal.wait_until(lock, deadline, ready);
+			}
 
-					//	handle an issued status check
-					if (stat_check_issued)
-					{
-						pending_object = WaitForSingleObject(serial_status.hEvent, 500);
-
-						switch (pending_object)
-						{
-						case WAIT_OBJECT_0:
-							if (!GetOverlappedResult(m_pComm, &serial_status, &ov_res, FALSE))
-							{
-								//	[error]: in overlapped operation
-							}
-							else
-							{
-								handle_data();
-							}
-							stat_check_issued = FALSE;
-							break;
-
-
-						case WAIT_TIMEOUT:
-							//	operation pending
-							break;
-
-
-						default:
-							break;
-						}
-					}
+			while (m_rxRing->Size() < count)
+			{
+				uint32_t wait = SerialInfiniteTimeout;
+				if (!forever)
+				{
+					auto now = std::chrono::steady_clock::now();
+					if (now >= deadline) return false;
+					wait = (uint32_t)std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
 				}
 
-				//	recycle the buffer
-				delete[] input_buffer;
+				size_t span = 0;
+				uint8_t* _buf = m_rxRing->Prepare(span);
+				size_t len = native_read(_buf, span, wait);
+				if (!len) return false;
+
+				m_rxRing->Commit(len);
 			}
+			return true;
 		}
 
 
 
 		/**********************************************************************
-		 *	Handle data received on the port.
+		 *	Tell an event thread waiting on a full ring that bytes were read.
+		 */
+		void SerialDevice::release_rx(size_t len)
+		{
+			if (!len || !(m_thCommEv.joinable() || m_reactor)) return;
+
+			{
+				std::lock_guard<std::mutex> lock(m_rxLock);
+			}
+			m_rxSignal.notify_all();
+		}
+
+
+
+		/**********************************************************************
+		 *	Search the receive ring for a delimiter without consuming it.
 		 *
-		 *	This method is to be called by the worker thread for checking the
-		 *		RX data, reading it into a buffer, and raising an event.
+		 *	\param[in] delimiter The bytes to find.
+		 *	\param[in] from The offset to start searching at.
+		 *	\returns The offset just past the delimiter, or 0 if not found.
 		 */
-		void SerialDevice::handle_data()
+		size_t SerialDevice::find_rx(std::string_view delimiter, size_t from) const
 		{
-			size_t _available = Available();
-			if (_available)
+			const size_t pending = m_rxRing->Size();
+			const size_t delimLen = delimiter.size();
+
+			for (size_t at = from; at + delimLen <= pending; )
 			{
-				uint8_t* _buf = new uint8_t[_available];
-				win32_read(_buf, _available);
-				ReceivedData(std::string((char*)_buf, _available));
-				delete[] _buf;
+				size_t span = 0;
+				const uint8_t* slice = m_rxRing->Peek(at, span);
+				span = (std::min)(span, pending - at);
+
+				const uint8_t* hit = (const uint8_t*)std::memchr(slice, delimiter[0], span);
+				if (!hit)
+				{
+					at += span;
+					continue;
+				}
+
+				size_t pos = at + (size_t)(hit - slice);
+				if (pos + delimLen > pending) break;
+
+				//	the rest of the delimiter may lie across the wrap
+				size_t matched = 1;
+				while (matched < delimLen && *m_rxRing->Peek(pos + matched, span) == (uint8_t)delimiter[matched])
+				{
+					matched++;
+				}
+				if (matched == delimLen) return pos + delimLen;
+
+				at = pos + 1;
 			}
+			return 0;
 		}
 	}
 }
-
@@ -0,0 +1,735 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialDevice.hpp"
+#include "Win32.Devices.SerialReactor.hpp"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <linux/serial.h>
+#endif // __linux__
+
+#include <climits>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef DEBUG
+#define DEBUG_ASSERT(ptr) assert(ptr)
+#else
+#define DEBUG_ASSERT(ptr)
+#endif
+
+#define TTY_DEVICE_PREFIX	"/dev/ttyS"
+
+#define POLL_PERIOD_MS		(500)
+
+#define GATHER_MAX_BUFFERS	(64)
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Map a baud rate onto a termios speed.
+		 *
+		 *	\param[in] baudrate The baud rate of the communication.
+		 *	\returns The termios speed, or B0 if the rate is unsupported.
+		 */
+		static speed_t to_speed(uint32_t baudrate)
+		{
+			switch (baudrate)
+			{
+			case 110: return B110;
+			case 300: return B300;
+			case 600: return B600;
+			case 1200: return B1200;
+			case 2400: return B2400;
+			case 4800: return B4800;
+			case 9600: return B9600;
+			case 19200: return B19200;
+			case 38400: return B38400;
+			case 57600: return B57600;
+			case 115200: return B115200;
+			case 230400: return B230400;
+#ifdef B460800
+			case 460800: return B460800;
+#endif
+#ifdef B921600
+			case 921600: return B921600;
+#endif
+#ifdef B1000000
+			case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+			case 2000000: return B2000000;
+#endif
+#ifdef B3000000
+			case 3000000: return B3000000;
+#endif
+#ifdef B4000000
+			case 4000000: return B4000000;
+#endif
+			default: return B0;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Convert a timeout in milliseconds to a poll() timeout.
+		 */
+		static int to_poll_timeout(uint32_t timeoutMs)
+		{
+			if (timeoutMs == SerialInfiniteTimeout)
+				return -1;
+			return (timeoutMs > (uint32_t)INT_MAX) ? INT_MAX : (int)timeoutMs;
+		}
+
+
+
+		/**********************************************************************
+		 *	Whether a failed read or write means the port went away, rather
+		 *		than a transient error.
+		 */
+		static bool port_gone(int err)
+		{
+			return err == EIO || err == ENXIO || err == ENODEV || err == EBADF;
+		}
+
+
+
+		/**********************************************************************
+		 *	Obtain a serial device from a specified COM Port number.
+		 *
+		 *	\param[in] COMPortNum The number of the tty. i.e. "/dev/ttyS10"
+		 *		requires an input of 10.
+		 *	\returns A serial device with an initalized file descriptor.
+		 */
+		SerialDevice SerialDevice::FromPortNumber(uint16_t COMPortNum)
+		{
+			SerialDevice device = { FromPath(TTY_DEVICE_PREFIX + std::to_string(COMPortNum)) };
+			device.m_portNum = COMPortNum;
+			return device;
+		}
+
+
+
+		/**********************************************************************
+		 *	Obtain a serial device from a device path.
+		 *
+		 *	\param[in] devicePath The path of the device. i.e. "/dev/ttyUSB0".
+		 *	\returns A serial device with an initalized file descriptor.
+		 */
+		SerialDevice SerialDevice::FromPath(const std::string& devicePath)
+		{
+			std::string error;
+			int fd_sercom = open_native(devicePath, error);
+
+			if (fd_sercom < 0)
+			{
+				std::cerr << "Could not open port: " << devicePath << "!" << std::endl;
+				throw std::runtime_error("No COM HANDLE");
+			}
+
+			//	configured here, as the move out of the factory may be elided
+			SerialDevice device(fd_sercom, 0);
+			device.m_path = devicePath;
+			device.bring_up(device.m_settings);
+			return device;
+		}
+
+
+
+		/**********************************************************************
+		 *	Open the descriptor of a device, without configuring it.
+		 *
+		 *	\param[in] devicePath The path of the device.
+		 *	\param[out] error Why the device could not be opened.
+		 *	\returns The descriptor, or SERIAL_INVALID_HANDLE.
+		 */
+		int SerialDevice::open_native(const std::string& devicePath, std::string& error)
+		{
+			int fd_sercom = open(
+				devicePath.c_str(),
+				O_RDWR			// Open for reading and writing
+				| O_NOCTTY		// Do not become the controlling terminal
+				| O_NONBLOCK	// Non-blocking operations
+				| O_CLOEXEC		// Do not leak into child processes
+			);
+
+			if (fd_sercom < 0)
+			{
+				error = std::system_category().message(errno);
+				return SERIAL_INVALID_HANDLE;
+			}
+
+			//	No sharing of the port
+			if (ioctl(fd_sercom, TIOCEXCL) != 0)
+			{
+				std::cerr << "Serial Error: Unable to lock the port!" << std::endl;
+			}
+
+			return fd_sercom;
+		}
+
+
+
+		/**********************************************************************
+		 *	Close the descriptor, if open.
+		 */
+		void SerialDevice::close_native()
+		{
+			if (m_pComm != SERIAL_INVALID_HANDLE)
+			{
+				close(m_pComm);
+				m_pComm = SERIAL_INVALID_HANDLE;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Close the serial device connection.
+		 */
+		void SerialDevice::Close()
+		{
+			if (m_reactor) m_reactor->Detach(*this);
+
+			//	release writers held for a reconnect
+			{
+				std::lock_guard<std::mutex> lock(m_connectionLock);
+				m_supervised = false;
+			}
+			m_connectionSignal.notify_all();
+
+			//	write out anything queued
+			stop_tx();
+
+			m_continuePoll.clear();
+			if (m_thCommEv.joinable()) m_thCommEv.join();
+
+			close_native();
+		}
+
+
+
+		/**********************************************************************
+		 *	Indicates the data received and available in the Rx buffer.
+		 *
+		 *	\returns The number of bytes avaialbe in the Rx buffer.
+		 */
+		uint32_t SerialDevice::Available()
+		{
+			int in_queue = 0;
+			DEBUG_ASSERT(m_pComm != SERIAL_INVALID_HANDLE);
+			if (ioctl(m_pComm, FIONREAD, &in_queue) != 0)
+			{
+				return 0;
+			}
+
+			return (uint32_t)in_queue;
+		}
+
+
+
+		/**********************************************************************
+		 *	Basic write function that writes to the non-blocking descriptor,
+		 *		waiting for the line to drain while the kernel buffer is full.
+		 *
+		 *	\param[in] _src The source of the data to write to the serial
+		 *		device.
+		 *	\param[in] len The length of the source data.
+		 *	\returns The number of bytes written.
+		 */
+		size_t SerialDevice::native_write(const void* _src, size_t len)
+		{
+			const uint8_t* src = static_cast<const uint8_t*>(_src);
+			size_t bytes_written = 0;
+			SERIAL_STATS_TIMER(m_stats, write_started);
+
+			while (bytes_written < len)
+			{
+				ssize_t res = write(m_pComm, src + bytes_written, len - bytes_written);
+				SERIAL_STATS_ADD(m_stats, writeCalls, 1);
+				if (res > 0)
+				{
+					bytes_written += (size_t)res;
+				}
+				else if (res < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				else if (res < 0 && errno == EAGAIN)
+				{
+					//	wait for room, bounded by the write timeouts
+					pollfd pfd = { m_pComm, POLLOUT, 0 };
+					uint32_t timeout = m_settings.timeouts.writeTotalConstant
+						+ m_settings.timeouts.writeTotalMultiplier * (uint32_t)(len - bytes_written);
+
+					if (poll(&pfd, 1, to_poll_timeout(timeout)) <= 0)
+					{
+						//	[error]: write operation has timed out
+						SERIAL_STATS_ADD(m_stats, timeouts, 1);
+						break;
+					}
+				}
+				else
+				{
+					//	[error]: write operation has failed
+					if (port_gone(errno)) m_linkLost = true;
+					break;
+				}
+			}
+
+			SERIAL_STATS_ADD(m_stats, bytesOut, bytes_written);
+			SERIAL_STATS_RECORD(m_stats, writeLatency, write_started);
+			if (m_recorder && bytes_written) m_recorder->Append(SerialCaptureDirection::Tx, _src, bytes_written);
+			return bytes_written;
+		}
+
+
+
+		/**********************************************************************
+		 *	Gathering write function. Hands the buffers to writev() in one
+		 *		call, resuming after partial writes.
+		 *
+		 *	\param[in] buffers The buffers, written in order.
+		 *	\param[in] count The number of buffers.
+		 *	\returns The number of bytes written.
+		 */
+		size_t SerialDevice::native_writev(const SerialBuffer* buffers, size_t count)
+		{
+			iovec io_vec[GATHER_MAX_BUFFERS];
+			size_t bytes_written = 0;
+			size_t index = 0;
+			size_t offset = 0;
+			SERIAL_STATS_TIMER(m_stats, write_started);
+
+			while (true)
+			{
+				//	skip what has been written, including empty buffers
+				while (index < count && offset == buffers[index].size)
+				{
+					index++;
+					offset = 0;
+				}
+				if (index == count) break;
+
+				int io_count = 0;
+				size_t io_bytes = 0;
+				for (size_t i = index; i < count && io_count < GATHER_MAX_BUFFERS; i++)
+				{
+					size_t skip = (i == index) ? offset : 0;
+					if (buffers[i].size == skip) continue;
+
+					io_vec[io_count].iov_base = (uint8_t*)buffers[i].data + skip;
+					io_vec[io_count].iov_len = buffers[i].size - skip;
+					io_bytes += io_vec[io_count].iov_len;
+					io_count++;
+				}
+
+				ssize_t res = writev(m_pComm, io_vec, io_count);
+				SERIAL_STATS_ADD(m_stats, writeCalls, 1);
+				if (res > 0)
+				{
+					bytes_written += (size_t)res;
+
+					size_t advance = (size_t)res;
+					while (advance)
+					{
+						size_t remaining = buffers[index].size - offset;
+						if (advance < remaining)
+						{
+							offset += advance;
+							advance = 0;
+						}
+						else
+						{
+							advance -= remaining;
+							index++;
+							offset = 0;
+						}
+					}
+				}
+				else if (res < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				else if (res < 0 && errno == EAGAIN)
+				{
+					//	wait for room, bounded by the write timeouts
+					pollfd pfd = { m_pComm, POLLOUT, 0 };
+					uint32_t timeout = m_settings.timeouts.writeTotalConstant
+						+ m_settings.timeouts.writeTotalMultiplier * (uint32_t)io_bytes;
+
+					if (poll(&pfd, 1, to_poll_timeout(timeout)) <= 0)
+					{
+						//	[error]: write operation has timed out
+						SERIAL_STATS_ADD(m_stats, timeouts, 1);
+						break;
+					}
+				}
+				else
+				{
+					//	[error]: write operation has failed
+					if (port_gone(errno)) m_linkLost = true;
+					break;
+				}
+			}
+
+			SERIAL_STATS_ADD(m_stats, bytesOut, bytes_written);
+			SERIAL_STATS_RECORD(m_stats, writeLatency, write_started);
+			if (m_recorder && bytes_written) m_recorder->Append(SerialCaptureDirection::Tx, buffers, count, bytes_written);
+			return bytes_written;
+		}
+
+
+
+		/**********************************************************************
+		 *	Basic read function that reads from the non-blocking descriptor.
+		 *
+		 *	\param[out] _dest The destination buffer for holding Rx data.
+		 *	\param[in] len The capacity of the destination buffer.
+		 *	\param[in] readTimeout Milliseconds to wait for data to arrive.
+		 *	\returns The number of bytes read into the destination buffer.
+		 */
+		size_t SerialDevice::native_read(void* _dest, size_t len, uint32_t readTimeout)
+		{
+			for (int attempt = 0; attempt < 2; attempt++)
+			{
+				//	with VMIN and VTIME zero an empty port reads 0, not EAGAIN
+				ssize_t res = read(m_pComm, _dest, len);
+				SERIAL_STATS_ADD(m_stats, readCalls, 1);
+				if (res > 0)
+				{
+					//	read operation finished
+					SERIAL_STATS_ADD(m_stats, bytesIn, (uint64_t)res);
+					if (m_recorder) m_recorder->Append(SerialCaptureDirection::Rx, _dest, (size_t)res);
+					return (size_t)res;
+				}
+				else if (res < 0 && errno != EAGAIN && errno != EINTR)
+				{
+					//	[error]: could not issue read operation
+					if (port_gone(errno)) m_linkLost = true;
+					return 0;
+				}
+
+				if (attempt == 0)
+				{
+					pollfd pfd = { m_pComm, POLLIN, 0 };
+					if (poll(&pfd, 1, to_poll_timeout(readTimeout)) <= 0)
+					{
+						//	timed out
+						SERIAL_STATS_ADD(m_stats, timeouts, 1);
+						return 0;
+					}
+				}
+			}
+			return 0;
+		}
+
+
+
+		/**********************************************************************
+		 *	Read whatever the port holds, without waiting.
+		 *
+		 *	\param[out] _dest The destination buffer for holding Rx data.
+		 *	\param[in] len The capacity of the destination buffer.
+		 *	\returns The number of bytes read, 0 if none were queued.
+		 */
+		size_t SerialDevice::native_read_now(void* _dest, size_t len)
+		{
+			ssize_t res;
+			do
+			{
+				res = read(m_pComm, _dest, len);
+				SERIAL_STATS_ADD(m_stats, readCalls, 1);
+			} while (res < 0 && errno == EINTR);
+
+			if (res <= 0) return 0;
+
+			SERIAL_STATS_ADD(m_stats, bytesIn, (uint64_t)res);
+			if (m_recorder) m_recorder->Append(SerialCaptureDirection::Rx, _dest, (size_t)res);
+			return (size_t)res;
+		}
+
+
+
+		/**********************************************************************
+		 *	Write as much as the port takes, without waiting for room.
+		 *
+		 *	\param[in] _src The source of the data to write.
+		 *	\param[in] len The length of the source data.
+		 *	\returns The number of bytes written, 0 if the port is full.
+		 */
+		size_t SerialDevice::native_write_now(const void* _src, size_t len)
+		{
+			ssize_t res;
+			do
+			{
+				res = write(m_pComm, _src, len);
+				SERIAL_STATS_ADD(m_stats, writeCalls, 1);
+			} while (res < 0 && errno == EINTR);
+
+			if (res <= 0) return 0;
+
+			SERIAL_STATS_ADD(m_stats, bytesOut, (uint64_t)res);
+			if (m_recorder) m_recorder->Append(SerialCaptureDirection::Tx, _src, (size_t)res);
+			return (size_t)res;
+		}
+
+
+
+		/**********************************************************************
+		 *	Configure the settings of the serial device using termios. The
+		 *		whole line, raw mode and the read timing go out in a single
+		 *		tcsetattr().
+		 *
+		 *	\param[in] settings The line settings to apply.
+		 *	\returns Whether the port took the settings.
+		 */
+		bool SerialDevice::config_settings(const SerialSettings& settings)
+		{
+			termios tty_settings = { 0 };
+
+			assert(m_pComm != SERIAL_INVALID_HANDLE);
+
+			if (tcgetattr(m_pComm, &tty_settings) != 0)
+			{
+				std::cerr << "Serial Error: Unable to retrieve port settings!" << std::endl;
+				return false;
+			}
+
+			/*	configure new settings */
+
+			//	Binary mode, no error replacement or null stripping
+			cfmakeraw(&tty_settings);
+
+			//	Ignore modem status lines, enable the receiver
+			tty_settings.c_cflag |= CLOCAL | CREAD;
+
+			//	Set BAUD rate
+			speed_t speed = to_speed(settings.baudRate);
+			if (speed == B0)
+			{
+				std::cerr << "Serial Error: Unsupported baud rate!" << std::endl;
+				return false;
+			}
+			cfsetispeed(&tty_settings, speed);
+			cfsetospeed(&tty_settings, speed);
+
+			//	Set byte size
+			tty_settings.c_cflag &= ~CSIZE;
+			tty_settings.c_cflag |= (settings.byteSize == SerialByteSize::Byte_Size7b) ? CS7 : CS8;
+
+			//	Set stop bits (1.5 is only available on 5 bit words)
+			if (settings.stopBits == SerialStopBits::StopBits_1)
+				tty_settings.c_cflag &= ~CSTOPB;
+			else
+				tty_settings.c_cflag |= CSTOPB;
+
+			//	Set parity, checked on input when enabled
+			tty_settings.c_cflag &= ~(PARENB | PARODD);
+			tty_settings.c_iflag &= ~INPCK;
+#ifdef CMSPAR
+			tty_settings.c_cflag &= ~CMSPAR;
+#endif // CMSPAR
+			switch (settings.parity)
+			{
+			case SerialParity::None:
+				break;
+
+			case SerialParity::Odd:
+				tty_settings.c_cflag |= PARENB | PARODD;
+				break;
+
+			case SerialParity::Even:
+				tty_settings.c_cflag |= PARENB;
+				break;
+
+#ifdef CMSPAR
+			case SerialParity::Mark:
+				tty_settings.c_cflag |= PARENB | PARODD | CMSPAR;
+				break;
+
+			case SerialParity::Space:
+				tty_settings.c_cflag |= PARENB | CMSPAR;
+				break;
+#endif // CMSPAR
+
+			default:
+				std::cerr << "Serial Error: Unsupported parity!" << std::endl;
+				return false;
+			}
+			if (settings.parity != SerialParity::None) tty_settings.c_iflag |= INPCK;
+
+			/* --------------------------------------------------------------------- */
+			/*							  Flow control								 */
+
+			tty_settings.c_cflag &= ~CRTSCTS;
+			tty_settings.c_iflag &= ~(IXON | IXOFF | IXANY);
+
+			if (settings.flowControl == SerialFlowControl::RtsCts)
+			{
+				// CTS/RTS flow control
+				tty_settings.c_cflag |= CRTSCTS;
+			}
+			else if (settings.flowControl == SerialFlowControl::XonXoff)
+			{
+				// XON/XOFF flow control
+				tty_settings.c_iflag |= IXON | IXOFF;
+			}
+
+			/* --------------------------------------------------------------------- */
+			/*								Read timing								 */
+
+			//	Reads return whatever is queued; waiting is done with poll()
+			//		by native_read and native_write
+			tty_settings.c_cc[VMIN] = 0;
+			tty_settings.c_cc[VTIME] = 0;
+
+			if (tcsetattr(m_pComm, TCSANOW, &tty_settings) != 0)
+			{
+				std::cerr << "Serial Error: Unable to apply port settings!" << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Configure the serial timeouts for read/write operations. Nothing
+		 *		goes to the port: native_write bounds its waits by the write
+		 *		timeouts held in $m_settings, and reads wait as long as each
+		 *		Read call asks.
+		 *
+		 *	\param[in] timeouts The timeouts to apply.
+		 *	\returns Whether the timeouts were applied.
+		 */
+		bool SerialDevice::config_timeouts(const SerialTimeouts& timeouts)
+		{
+			(void)timeouts;
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Clear the pending input and output of the descriptor.
+		 */
+		void SerialDevice::clear_comm()
+		{
+			assert(m_pComm != SERIAL_INVALID_HANDLE);
+
+			//	Clear the port
+			if (tcflush(m_pComm, TCIOFLUSH) != 0)
+			{
+				std::cerr << "Serial Error: Unable to clear the port!" << std::endl;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait for input, to the microsecond.
+		 *
+		 *	\param[in] timeout How long to wait.
+		 *	\returns Whether input is waiting.
+		 */
+		bool SerialDevice::await_input(std::chrono::microseconds timeout)
+		{
+			pollfd pfd = { m_pComm, POLLIN, 0 };
+			timespec wait = { (time_t)(timeout.count() / 1000000), (long)(timeout.count() % 1000000) * 1000 };
+
+			return ppoll(&pfd, 1, &wait, nullptr) > 0 && (pfd.revents & POLLIN);
+		}
+
+
+
+		/**********************************************************************
+		 *	Add the driver's line error counts to a snapshot. These count
+		 *		from when the driver opened the port; a pseudo-terminal has
+		 *		none.
+		 */
+		void SerialDevice::line_errors(SerialStats& stats) const
+		{
+#if defined(__linux__) && defined(TIOCGICOUNT)
+			serial_icounter_struct icount = { 0 };
+			if (m_pComm != SERIAL_INVALID_HANDLE && ioctl(m_pComm, TIOCGICOUNT, &icount) == 0)
+			{
+				stats.overruns += (uint64_t)icount.overrun + (uint64_t)icount.buf_overrun;
+				stats.framingErrors += (uint64_t)icount.frame;
+				stats.parityErrors += (uint64_t)icount.parity;
+			}
+#else
+			(void)stats;
+#endif // __linux__ && TIOCGICOUNT
+		}
+
+
+
+		/**********************************************************************
+		 *	The background thread that awaits events on the descriptor. Upon
+		 *		characters, the thread checks for how many, reads the
+		 *		characters into a buffer, and then calls the CoreZero event,
+		 *		thus calling a user-defined handler. While supervised, a hang
+		 *		up or a failed read has the thread reopen the port.
+		 */
+		void SerialDevice::interrupt_thread()
+		{
+			pollfd serial_status = { m_pComm, POLLIN, 0 };
+
+			while (m_continuePoll.test_and_set())
+			{
+				int pending_object = poll(&serial_status, 1, POLL_PERIOD_MS);
+
+				if (m_supervised)
+				{
+					if (pending_object > 0 && (serial_status.revents & POLLIN))
+					{
+						handle_data();
+					}
+
+					bool gone = pending_object > 0 && (serial_status.revents & (POLLHUP | POLLERR | POLLNVAL));
+					if (gone || m_linkLost)
+					{
+						//	the port went away; reopen it, or stop once it cannot be
+						if (!reconnect()) break;
+						serial_status.fd = m_pComm;
+					}
+				}
+				else if (pending_object > 0)
+				{
+					if (serial_status.revents & POLLNVAL)
+					{
+						//	[error]: descriptor is no longer valid
+						break;
+					}
+
+					if (serial_status.revents & POLLIN)
+					{
+						handle_data();
+					}
+
+					if (serial_status.revents & (POLLHUP | POLLERR))
+					{
+						//	hang up or error: a tty goes on raising it, with POLLIN
+						//		and nothing to read, so wait out the poll period
+						std::this_thread::sleep_for(std::chrono::milliseconds(POLL_PERIOD_MS));
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,807 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialDevice.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cstring>
+
+#ifdef DEBUG
+#define DEBUG_ASSERT(ptr) assert(ptr)
+#else
+#define DEBUG_ASSERT(ptr)
+#endif
+
+#define NO_SHARING	NULL
+#define NO_SECURITY	NULL
+#define NON_OVERLAPPED_IO	NULL
+#define NO_FLAGS	NULL
+#define SPIN_HOLD_US	(1000)
+
+static_assert((int)Win32::Devices::SerialStopBits::StopBits_1 == ONESTOPBIT, "stop bit values must match the DCB");
+static_assert((int)Win32::Devices::SerialStopBits::StopBits_1_5 == ONE5STOPBITS, "stop bit values must match the DCB");
+static_assert((int)Win32::Devices::SerialStopBits::StopBits_2 == TWOSTOPBITS, "stop bit values must match the DCB");
+static_assert((int)Win32::Devices::SerialParity::None == NOPARITY, "parity values must match the DCB");
+static_assert((int)Win32::Devices::SerialParity::Space == SPACEPARITY, "parity values must match the DCB");
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{		
+		/**********************************************************************
+		 *	Whether a failed operation means the port went away, i.e. its USB
+		 *		adapter was unplugged or reset, rather than a transient error.
+		 */
+		static bool port_gone(DWORD err)
+		{
+			return err == ERROR_ACCESS_DENIED || err == ERROR_BAD_COMMAND || err == ERROR_GEN_FAILURE
+				|| err == ERROR_DEVICE_NOT_CONNECTED || err == ERROR_INVALID_HANDLE;
+		}
+
+
+
+		/**********************************************************************
+		 *	Obtain a serial device from a specified COM Port number.
+		 *		 
+		 *	\param[in] COMPortNum The number of the COM Port. i.e. "COM10"
+		 *		requires an input of 10.
+		 *	\returns A serial device with an initalized comm handle.
+		 */
+		SerialDevice SerialDevice::FromPortNumber(uint16_t COMPortNum)
+		{
+			//	prepend COM directory
+			std::wstring port_dir = { L"\\\\.\\COM" + std::to_wstring(COMPortNum) };
+
+			//	create the handle to the COM port
+			HANDLE h_sercom	= CreateFile(
+				port_dir.c_str(),
+				GENERIC_READ | GENERIC_WRITE,	// Open for reading and writing
+				NO_SHARING,						// No Sharing of the COM port
+				NO_SECURITY,					// No security necessary on COM port
+				OPEN_EXISTING,					// Open an existing port
+				FILE_FLAG_OVERLAPPED,			// Use overlapped operations
+				NO_FLAGS						// No other flags
+			);
+			
+
+			if (h_sercom == INVALID_HANDLE_VALUE)
+			{
+				std::cerr << "Could not open port: COM" << COMPortNum << "!" << std::endl;			
+				throw std::exception("No COM HANDLE");
+			}
+
+			//	configured here, as the move out of the factory may be elided
+			SerialDevice device(h_sercom, COMPortNum);
+			device.m_path = "\\\\.\\COM" + std::to_string(COMPortNum);
+			device.bring_up(device.m_settings);
+			return device;
+		}
+
+
+
+		/**********************************************************************
+		 *	Obtain a serial device from a device path.
+		 *
+		 *	\param[in] devicePath The path of the device. i.e. "\\\\.\\COM10".
+		 *	\returns A serial device with an initalized comm handle.
+		 */
+		SerialDevice SerialDevice::FromPath(const std::string& devicePath)
+		{
+			std::string error;
+			HANDLE h_sercom = open_native(devicePath, error);
+
+			if (h_sercom == SERIAL_INVALID_HANDLE)
+			{
+				std::cerr << "Could not open port: " << devicePath << "!" << std::endl;
+				throw std::exception("No COM HANDLE");
+			}
+
+			//	configured here, as the move out of the factory may be elided
+			SerialDevice device(h_sercom, 0);
+			device.m_path = devicePath;
+			device.bring_up(device.m_settings);
+			return device;
+		}
+
+
+
+		/**********************************************************************
+		 *	Open the handle of a device, without configuring it.
+		 *
+		 *	\param[in] devicePath The path of the device.
+		 *	\param[out] error Why the device could not be opened.
+		 *	\returns The handle, or SERIAL_INVALID_HANDLE.
+		 */
+		HANDLE SerialDevice::open_native(const std::string& devicePath, std::string& error)
+		{
+			std::wstring port_dir = { devicePath.begin(), devicePath.end() };
+
+			//	create the handle to the device
+			HANDLE h_sercom = CreateFile(
+				port_dir.c_str(),
+				GENERIC_READ | GENERIC_WRITE,	// Open for reading and writing
+				NO_SHARING,						// No Sharing of the COM port
+				NO_SECURITY,					// No security necessary on COM port
+				OPEN_EXISTING,					// Open an existing port
+				FILE_FLAG_OVERLAPPED,			// Use overlapped operations
+				NO_FLAGS						// No other flags
+			);
+
+			if (h_sercom == INVALID_HANDLE_VALUE)
+			{
+				error = "Win32 error " + std::to_string(GetLastError());
+				return SERIAL_INVALID_HANDLE;
+			}
+
+			return h_sercom;
+		}
+
+
+
+		/**********************************************************************
+		 *	Close the comm handle, if open, abandoning any pending operation.
+		 */
+		void SerialDevice::close_native()
+		{
+			if (m_pComm != SERIAL_INVALID_HANDLE)
+			{
+				CloseHandle(m_pComm);
+				m_pComm = SERIAL_INVALID_HANDLE;
+			}
+
+			//	closing the handle cancels any pending operation
+			m_ReadOpPending = FALSE;
+		}
+
+
+
+		/**********************************************************************
+		 *	Close the serial device connection.		 		 
+		 */
+		void SerialDevice::Close()
+		{
+			//	release writers held for a reconnect
+			{
+				std::lock_guard<std::mutex> lock(m_connectionLock);
+				m_supervised = false;
+			}
+			m_connectionSignal.notify_all();
+
+			//	write out anything queued
+			stop_tx();
+
+			m_continuePoll.clear();
+			if (m_thCommEv.joinable()) m_thCommEv.join();
+
+			close_native();
+			m_readIo.Release();
+			m_writeIo.Release();
+			m_commEvIo.Release();
+		}
+
+
+
+		/**********************************************************************
+		 *	Prepare the context for a new overlapped operation.
+		 *
+		 *	\returns The reset overlapped structure, or nullptr if no event
+		 *		could be created.
+		 */
+		OVERLAPPED* SerialDevice::IoContext::Acquire()
+		{
+			HANDLE h_event = overlapped.hEvent;
+
+			if (h_event == NULL)
+			{
+				h_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+				if (h_event == NULL) return nullptr;
+			}
+			else
+			{
+				ResetEvent(h_event);
+			}
+
+			overlapped = { 0 };
+			overlapped.hEvent = h_event;
+			return &overlapped;
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the event held by the context.
+		 */
+		void SerialDevice::IoContext::Release()
+		{
+			if (overlapped.hEvent != NULL)
+			{
+				CloseHandle(overlapped.hEvent);
+				overlapped.hEvent = NULL;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Indicates the data received and available in the Rx buffer.
+		 *
+		 *	\returns The number of bytes avaialbe in the Rx buffer.
+		 */
+		uint32_t SerialDevice::Available()
+		{
+			DWORD err_flags = { 0 };
+			COMSTAT com_status = { 0 };
+			DEBUG_ASSERT(m_pComm);
+			ClearCommError(m_pComm, &err_flags, &com_status);
+
+			if (err_flags)
+			{
+				SERIAL_STATS_ADD(m_stats, overruns, (err_flags & (CE_OVERRUN | CE_RXOVER)) ? 1 : 0);
+				SERIAL_STATS_ADD(m_stats, framingErrors, (err_flags & CE_FRAME) ? 1 : 0);
+				SERIAL_STATS_ADD(m_stats, parityErrors, (err_flags & CE_RXPARITY) ? 1 : 0);
+			}
+				
+			return com_status.cbInQue;
+		}
+
+
+
+		/**********************************************************************
+		 *	Basic write function that calls to the win32 api for serial
+		 *		writing.
+		 *
+		 *	\param[in] _src The source of the data to write to the serial
+		 *		device.
+		 *	\param[in] len The length of the source data.
+		 */
+		size_t SerialDevice::native_write(const void* _src, size_t len)
+		{
+			OVERLAPPED* os_writer = m_writeIo.Acquire();
+			DWORD bytes_written = 0;
+			SERIAL_STATS_TIMER(m_stats, write_started);
+			
+			assert(os_writer != nullptr);
+
+			SERIAL_STATS_ADD(m_stats, writeCalls, 1);
+			if (!WriteFile(m_pComm, _src, len, &bytes_written, os_writer))
+			{
+				if (GetLastError() != ERROR_IO_PENDING)
+				{
+					//	[error]: write operation has failed
+					if (port_gone(GetLastError())) m_linkLost = true;
+					return 0;
+				}
+				else
+				{
+					//	a write operation has been issued
+					if (!GetOverlappedResult(m_pComm, os_writer, &bytes_written, TRUE))
+					{
+						//	[error]: write operation has failed
+						if (port_gone(GetLastError())) m_linkLost = true;
+						return 0;
+					}
+				}
+			}
+
+			//	the write operation has completed; short only on a write timeout
+			if (bytes_written < len) SERIAL_STATS_ADD(m_stats, timeouts, 1);
+			SERIAL_STATS_ADD(m_stats, bytesOut, bytes_written);
+			SERIAL_STATS_RECORD(m_stats, writeLatency, write_started);
+			if (m_recorder && bytes_written) m_recorder->Append(SerialCaptureDirection::Tx, _src, bytes_written);
+			return bytes_written;
+		}
+
+
+
+		/**********************************************************************
+		 *	Gathering write function. Overlapped serial writes take a single
+		 *		buffer, so the buffers are joined into storage kept by the
+		 *		device and issued as one write.
+		 *
+		 *	\param[in] buffers The buffers, written in order.
+		 *	\param[in] count The number of buffers.
+		 *	\returns The number of bytes written.
+		 */
+		size_t SerialDevice::native_writev(const SerialBuffer* buffers, size_t count)
+		{
+			if (count == 1)
+			{
+				return native_write(buffers[0].data, buffers[0].size);
+			}
+
+			size_t len = 0;
+			for (size_t i = 0; i < count; i++) len += buffers[i].size;
+
+			uint8_t* joined = m_txGather.Reserve(len);
+			size_t at = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				std::memcpy(joined + at, buffers[i].data, buffers[i].size);
+				at += buffers[i].size;
+			}
+			return native_write(joined, len);
+		}
+
+
+
+		/**********************************************************************
+		 *	Basic read function that calls to the win32 api for serial reading.
+		 *
+		 *	\param[out] _dest The destination buffer for holding Rx data.
+		 *	\param[in] len The capacity of the destination buffer.
+		 *	\returns The number of bytes read into the destination buffer.
+		 */
+		size_t SerialDevice::native_read(void* _dest, size_t len, uint32_t readTimeout)
+		{
+			OVERLAPPED* os_reader = &m_readIo.overlapped;
+			DWORD bytes_read = 0;
+
+			if (!m_ReadOpPending)
+			{
+				//	a pending read keeps its context until it completes
+				os_reader = m_readIo.Acquire();
+				assert(os_reader != nullptr);
+
+				SERIAL_STATS_ADD(m_stats, readCalls, 1);
+				if (!ReadFile(m_pComm, _dest, len, &bytes_read, os_reader))
+				{
+					if (GetLastError() != ERROR_IO_PENDING)
+					{
+						//	[error]: could not issue read operation
+						if (port_gone(GetLastError())) m_linkLost = true;
+						return 0;
+					}
+					else
+					{
+						//	read operation issued
+						m_ReadOpPending = TRUE;
+					}
+				}
+				else
+				{
+					//	read operation finished
+					m_ReadOpPending = FALSE;
+					SERIAL_STATS_ADD(m_stats, bytesIn, bytes_read);
+					if (m_recorder && bytes_read) m_recorder->Append(SerialCaptureDirection::Rx, _dest, bytes_read);
+					return bytes_read;
+				}
+			}
+
+
+			DWORD object_result;
+
+			if (m_ReadOpPending)
+			{
+				object_result = WaitForSingleObject(os_reader->hEvent, readTimeout);
+				switch (object_result)
+				{
+				case WAIT_OBJECT_0:
+					if (!GetOverlappedResult(m_pComm, os_reader, &bytes_read, FALSE))
+					{
+						//	[error]: in communications
+						m_ReadOpPending = FALSE;
+						if (port_gone(GetLastError())) m_linkLost = true;
+						return 0;
+					}
+					else
+					{						
+						//	read operation finished
+						m_ReadOpPending = FALSE;
+						SERIAL_STATS_ADD(m_stats, bytesIn, bytes_read);
+						if (m_recorder && bytes_read) m_recorder->Append(SerialCaptureDirection::Rx, _dest, bytes_read);
+						return bytes_read;
+					}
+					break;
+
+				case WAIT_TIMEOUT:
+					//	cancel rather than leave the read targeting $_dest,
+					//		keeping whatever arrived before the cancel
+					SERIAL_STATS_ADD(m_stats, timeouts, 1);
+					CancelIoEx(m_pComm, os_reader);
+					m_ReadOpPending = FALSE;
+					if (GetOverlappedResult(m_pComm, os_reader, &bytes_read, TRUE))
+					{
+						SERIAL_STATS_ADD(m_stats, bytesIn, bytes_read);
+						if (m_recorder && bytes_read) m_recorder->Append(SerialCaptureDirection::Rx, _dest, bytes_read);
+						return bytes_read;
+					}
+					break;
+
+				default:
+					break;
+				}
+			}
+			return 0;
+		}
+
+
+
+		/**********************************************************************
+		 *	Read whatever the port holds, without waiting.
+		 *
+		 *	\param[out] _dest The destination buffer for holding Rx data.
+		 *	\param[in] len The capacity of the destination buffer.
+		 *	\returns The number of bytes read, 0 if none were queued.
+		 */
+		size_t SerialDevice::native_read_now(void* _dest, size_t len)
+		{
+			size_t available = Available();
+			if (!available) return 0;
+
+			//	bytes already queued by the driver complete the read at once
+			return native_read(_dest, (std::min)(len, available), 0);
+		}
+
+
+
+		/**********************************************************************
+		 *	Write as much as the port takes, without waiting for room. A
+		 *		write the port cannot finish at once is left in flight, and
+		 *		collected by the next call, which must pass the same data.
+		 *
+		 *	\param[in] _src The source of the data to write.
+		 *	\param[in] len The length of the source data.
+		 *	\returns The number of bytes written, 0 while the write is in
+		 *		flight or if it failed.
+		 */
+		size_t SerialDevice::native_write_now(const void* _src, size_t len)
+		{
+			OVERLAPPED* os_writer = &m_writeIo.overlapped;
+			DWORD bytes_written = 0;
+
+			if (!m_WriteOpPending)
+			{
+				os_writer = m_writeIo.Acquire();
+				assert(os_writer != nullptr);
+
+				SERIAL_STATS_ADD(m_stats, writeCalls, 1);
+				if (!WriteFile(m_pComm, _src, (DWORD)len, &bytes_written, os_writer))
+				{
+					if (GetLastError() != ERROR_IO_PENDING)
+					{
+						//	[error]: write operation has failed
+						if (port_gone(GetLastError())) m_linkLost = true;
+						return 0;
+					}
+
+					//	a write operation has been issued
+					m_WriteOpPending = TRUE;
+					return 0;
+				}
+			}
+			else if (!GetOverlappedResult(m_pComm, os_writer, &bytes_written, FALSE))
+			{
+				DWORD err = GetLastError();
+				if (err == ERROR_IO_INCOMPLETE) return 0;
+				m_WriteOpPending = FALSE;
+
+				//	a write cancelled on its deadline keeps what went out
+				if (err != ERROR_OPERATION_ABORTED)
+				{
+					//	[error]: write operation has failed
+					if (port_gone(err)) m_linkLost = true;
+					return 0;
+				}
+				SERIAL_STATS_ADD(m_stats, timeouts, 1);
+			}
+
+			m_WriteOpPending = FALSE;
+			SERIAL_STATS_ADD(m_stats, bytesOut, bytes_written);
+			if (m_recorder && bytes_written) m_recorder->Append(SerialCaptureDirection::Tx, _src, bytes_written);
+			return bytes_written;
+		}
+
+
+
+		/**********************************************************************
+		 *	Configure the settings of the serial device using the win32 api.
+		 *
+		 *	\param[in] settings The line settings to apply.
+		 *	\returns Whether the port took the settings.
+		 */
+		bool SerialDevice::config_settings(const SerialSettings& settings)
+		{
+			DCB data_cntrl_blk = { 0 };
+
+			assert(m_pComm);			
+
+			if (!GetCommState(m_pComm, &data_cntrl_blk))
+			{
+				std::cerr << "Serial Error: Unable to retrieve port settings!" << std::endl;
+				return false;
+			}
+
+			/*	configure new settings */
+
+			//	Binary Mode
+			data_cntrl_blk.fBinary = TRUE;
+
+			//	Parity checking, when there is a parity bit
+			data_cntrl_blk.fParity = (settings.parity != SerialParity::None);
+
+			//	DSR sensitivity
+			data_cntrl_blk.fDsrSensitivity = FALSE;
+
+			//	Disable error replacement
+			data_cntrl_blk.fErrorChar = FALSE;
+
+			//	No DSR output flow control
+			data_cntrl_blk.fOutxDsrFlow = FALSE;
+
+			//	Do not abort reads/writes on error
+			data_cntrl_blk.fAbortOnError = FALSE;
+
+			//	Disable null stripping
+			data_cntrl_blk.fNull = FALSE;
+
+			//	XOFF continues TX
+			data_cntrl_blk.fTXContinueOnXoff = TRUE;
+
+			//	Set BAUD rate
+			data_cntrl_blk.BaudRate = settings.baudRate;
+
+			//	Set byte size
+			data_cntrl_blk.ByteSize = (BYTE)settings.byteSize;
+
+			//	Set stop bits
+			data_cntrl_blk.StopBits = (BYTE)settings.stopBits;
+
+			//	Set parity
+			data_cntrl_blk.Parity = (BYTE)settings.parity;
+
+			/* --------------------------------------------------------------------- */
+			/*							  Flow control								 */
+
+			// CTS output flow control
+			data_cntrl_blk.fOutxCtsFlow = (settings.flowControl == SerialFlowControl::RtsCts);
+
+			// DTR flow control type
+			data_cntrl_blk.fDtrControl = DTR_CONTROL_ENABLE;
+
+			// XON/XOFF out and in flow control
+			data_cntrl_blk.fOutX = (settings.flowControl == SerialFlowControl::XonXoff);
+			data_cntrl_blk.fInX = (settings.flowControl == SerialFlowControl::XonXoff);
+
+			// RTS flow control
+			data_cntrl_blk.fRtsControl = RTS_CONTROL_ENABLE;
+
+			if (!SetCommState(m_pComm, &data_cntrl_blk))
+			{
+				std::cerr << "Serial Error: Unable to apply port settings!" << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Configure the serial timeouts for read/write operations by calling
+		 *		the win32 api. Every field is set, so the current timeouts are
+		 *		not read back first.
+		 *
+		 *	\param[in] timeouts The timeouts to apply.
+		 *	\returns Whether the port took the timeouts.
+		 */
+		bool SerialDevice::config_timeouts(const SerialTimeouts& timeouts)
+		{
+			COMMTIMEOUTS comm_timeouts;
+
+			assert(m_pComm);
+
+			/*	All values are in milliseconds	*/
+
+			// Max time between arrival of two bytes
+			comm_timeouts.ReadIntervalTimeout = timeouts.readInterval;
+
+			// Total for read operation -> ReadFile()
+			comm_timeouts.ReadTotalTimeoutConstant = timeouts.readTotalConstant;
+
+			// Used to calculate total period of read operation
+			comm_timeouts.ReadTotalTimeoutMultiplier = timeouts.readTotalMultiplier;
+
+
+			/*	Write timeouts	*/
+
+			// Total for write operation -> WriteFile()
+			comm_timeouts.WriteTotalTimeoutConstant = timeouts.writeTotalConstant;
+
+			// Total for write operation
+			comm_timeouts.WriteTotalTimeoutMultiplier = timeouts.writeTotalMultiplier;
+
+			//	Set port timeouts
+			if (!SetCommTimeouts(m_pComm, &comm_timeouts))
+			{
+				std::cerr << "Serial Error: Unable to apply new timeouts!" << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Clear the comm handle via a call to the win32 api.
+		 */
+		void SerialDevice::clear_comm()
+		{
+			assert(m_pComm);
+			
+			//	Clear the port
+			if (PurgeComm(m_pComm, PURGE_TXCLEAR | PURGE_RXCLEAR) == 0)
+			{
+				std::cerr << "Serial Error: Unable to clear the port!" << std::endl;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait for input. The last millisecond of a hold is yielded
+		 *		through, as a sleep would overshoot it; longer holds wait on
+		 *		a comm event. This runs on the event thread between its own
+		 *		comm event waits, so the context is free, and no wait is left
+		 *		pending for it.
+		 *
+		 *	\param[in] timeout How long to wait.
+		 *	\returns Whether input is waiting.
+		 */
+		bool SerialDevice::await_input(std::chrono::microseconds timeout)
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (!Available())
+			{
+				auto remaining = deadline - std::chrono::steady_clock::now();
+				if (remaining <= std::chrono::steady_clock::duration::zero()) return false;
+
+				if (remaining < std::chrono::microseconds(SPIN_HOLD_US))
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				DWORD comm_event = { 0 };
+				DWORD ov_res;
+				OVERLAPPED* serial_status = m_commEvIo.Acquire();
+				if (serial_status == nullptr) return false;
+
+				if (WaitCommEvent(m_pComm, &comm_event, serial_status)) continue;
+				if (GetLastError() != ERROR_IO_PENDING) return false;
+
+				DWORD wait_ms = (DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count();
+				if (WaitForSingleObject(serial_status->hEvent, wait_ms) != WAIT_OBJECT_0)
+				{
+					CancelIoEx(m_pComm, serial_status);
+				}
+				GetOverlappedResult(m_pComm, serial_status, &ov_res, TRUE);
+			}
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Line errors are counted as ClearCommError reports them in
+		 *		$Available, so there is nothing to add.
+		 */
+		void SerialDevice::line_errors(SerialStats& stats) const
+		{
+			(void)stats;
+		}
+
+
+
+		/**********************************************************************
+		 *	The background thread that awaits events on the comm. Using the
+		 *		win32 api, this thread sets the comm mask to await any received
+		 *		character. Upon characters, the thread checks for how many,
+		 *		reads the characters into a buffer, and then calls the CoreZero
+		 *		event, thus calling a user-defined handler. When the comm fails,
+		 *		the thread reopens the port while supervised, or otherwise
+		 *		reports the loss and ends.
+		 */
+		void SerialDevice::interrupt_thread()
+		{
+			OVERLAPPED* serial_status = nullptr;
+			BOOL watching = FALSE;
+			BOOL stat_check_issued = FALSE;
+			BOOL comm_failed = FALSE;
+			DWORD comm_event = { 0 };
+			DWORD pending_object;
+			DWORD ov_res;
+
+			while (m_continuePoll.test_and_set())
+			{
+				//	watch for characters, again on a reopened port
+				if (!watching && !SetCommMask(m_pComm, EV_RXCHAR))
+				{
+					comm_failed = TRUE;
+				}
+				else
+				{
+					watching = TRUE;
+				}
+
+				//	check for a previously issued status check
+				if (watching && !stat_check_issued)
+				{
+					//	issue a check for status
+					serial_status = m_commEvIo.Acquire();
+					assert(serial_status != nullptr);
+
+					if (!WaitCommEvent(m_pComm, &comm_event, serial_status))
+					{
+						// did not return immediately, check for pending check
+						if (GetLastError() == ERROR_IO_PENDING)
+						{
+							stat_check_issued = TRUE;
+						}
+						else
+						{
+							//	[error]: could not issue a status check
+							comm_failed = TRUE;
+						}
+					}
+					else
+					{
+						// returned immediately
+						handle_data();
+					}
+				}
+
+				//	handle an issued status check
+				if (stat_check_issued)
+				{
+					pending_object = WaitForSingleObject(serial_status->hEvent, 500);
+
+					switch (pending_object)
+					{
+					case WAIT_OBJECT_0:
+						if (!GetOverlappedResult(m_pComm, serial_status, &ov_res, FALSE))
+						{
+							//	[error]: in overlapped operation
+							comm_failed = TRUE;
+						}
+						else
+						{
+							handle_data();
+						}
+						stat_check_issued = FALSE;
+						break;
+
+
+					case WAIT_TIMEOUT:
+						//	operation pending
+						break;
+
+
+					default:
+						break;
+					}
+				}
+
+				if (comm_failed || m_linkLost)
+				{
+					if (!m_supervised)
+					{
+#ifdef DEBUG
+						std::cerr << std::to_string(GetLastError()) << std::endl;
+#endif // DEBUG
+						std::cerr << "Serial Error: Lost the port!" << std::endl;
+						connection(SerialConnectionState::Lost);
+						break;
+					}
+
+					//	the port went away; reopen it, or stop once it cannot be
+					if (!reconnect()) break;
+					watching = FALSE;
+					stat_check_issued = FALSE;
+					comm_failed = FALSE;
+				}
+			}
+		}
+	}
+}
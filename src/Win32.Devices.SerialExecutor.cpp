@@ -0,0 +1,397 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialExecutor.hpp"
+
+#include <algorithm>
+#include <climits>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	The executor running on this thread, if any.
+		static thread_local SerialExecutor* t_current = nullptr;
+
+
+
+		/**********************************************************************
+		 *	Run a callback on the next turn of $Run.
+		 *
+		 *	\param[in] resume The callback.
+		 *	\param[in] context Passed to the callback.
+		 */
+		void SerialExecutor::Post(Resume resume, void* context)
+		{
+			m_ready.emplace_back(resume, context);
+		}
+
+
+
+		/**********************************************************************
+		 *	Run a callback once a time has come.
+		 *
+		 *	\param[in] when The time.
+		 *	\param[in] resume The callback.
+		 *	\param[in] context Passed to the callback.
+		 */
+		void SerialExecutor::PostAt(std::chrono::steady_clock::time_point when, Resume resume, void* context)
+		{
+			m_delayed++;
+			m_timers.push(Timer{ when, SERIAL_INVALID_HANDLE, false, 0, resume, context });
+		}
+
+
+
+		/**********************************************************************
+		 *	Run a callback once a device has data to read, or its deadline
+		 *		passes. A device has at most one read wait at a time.
+		 *
+		 *	\param[in] device An open device.
+		 *	\param[in] deadline When to give up; $Forever never does.
+		 *	\param[in] resume The callback.
+		 *	\param[in] context Passed to the callback.
+		 */
+		void SerialExecutor::WhenReadable(SerialDevice& device, std::chrono::steady_clock::time_point deadline, Resume resume, void* context)
+		{
+			when_ready(device, false, deadline, resume, context);
+		}
+
+
+
+		/**********************************************************************
+		 *	Run a callback once a device has room to write, or its deadline
+		 *		passes. A device has at most one write wait at a time.
+		 *
+		 *	\param[in] device An open device.
+		 *	\param[in] deadline When to give up; $Forever never does.
+		 *	\param[in] resume The callback.
+		 *	\param[in] context Passed to the callback.
+		 */
+		void SerialExecutor::WhenWritable(SerialDevice& device, std::chrono::steady_clock::time_point deadline, Resume resume, void* context)
+		{
+			when_ready(device, true, deadline, resume, context);
+		}
+
+
+
+		/**********************************************************************
+		 *	Take ownership of work, i.e. a coroutine frame. Work still owned
+		 *		when the executor is destroyed is destroyed with it.
+		 *
+		 *	\param[in] context The work.
+		 *	\param[in] destroy Destroys the work.
+		 */
+		void SerialExecutor::Own(void* context, Resume destroy)
+		{
+			m_owned[context] = destroy;
+		}
+
+
+
+		/**********************************************************************
+		 *	Release work that has finished.
+		 */
+		void SerialExecutor::Disown(void* context)
+		{
+			m_owned.erase(context);
+		}
+
+
+
+		/**********************************************************************
+		 *	Run callbacks as they become ready, until none are left to wait
+		 *		for or $Stop is called.
+		 */
+		void SerialExecutor::Run()
+		{
+			SerialExecutor* outer = t_current;
+			t_current = this;
+			m_runnable = true;
+
+			while (m_runnable)
+			{
+				m_running.swap(m_ready);
+				for (size_t i = 0; i < m_running.size(); i++)
+				{
+					m_running[i].first(m_running[i].second);
+					if (!m_runnable)
+					{
+						//	keep what was not run for the next $Run
+						m_ready.insert(m_ready.begin(), m_running.begin() + i + 1, m_running.end());
+						break;
+					}
+				}
+				m_running.clear();
+
+				if (!m_runnable) break;
+				if (m_ready.empty() && !m_waiting && !m_delayed) break;
+
+				if (!await_native(m_ready.empty() ? wait_timeout() : 0)) break;
+				expire();
+			}
+
+			t_current = outer;
+		}
+
+
+
+		/**********************************************************************
+		 *	Return from $Run once the callback running returns.
+		 */
+		void SerialExecutor::Stop()
+		{
+			m_runnable = false;
+		}
+
+
+
+		/**********************************************************************
+		 *	The executor running on the calling thread, or nullptr.
+		 */
+		SerialExecutor* SerialExecutor::Current()
+		{
+			return t_current;
+		}
+
+
+
+		/**********************************************************************
+		 *	Read what the port of a device holds, without waiting.
+		 *
+		 *	\param[in] device The device.
+		 *	\param[out] dest The destination.
+		 *	\param[in] len The size of the destination.
+		 *	\returns The number of bytes read, 0 if none were queued.
+		 */
+		size_t SerialExecutor::ReadNow(SerialDevice& device, void* dest, size_t len)
+		{
+			return device.native_read_now(dest, len);
+		}
+
+
+
+		/**********************************************************************
+		 *	Read bytes left in the receive ring of a device, i.e. past a
+		 *		delimiter taken by $TakeUntil.
+		 *
+		 *	\param[in] device The device.
+		 *	\param[out] dest The destination.
+		 *	\param[in] len The size of the destination.
+		 *	\returns The number of bytes read.
+		 */
+		size_t SerialExecutor::TakeBuffered(SerialDevice& device, void* dest, size_t len)
+		{
+			return device.m_rxRing->Read(dest, len);
+		}
+
+
+
+		/**********************************************************************
+		 *	Move what the port holds into a device's receive ring, without
+		 *		waiting.
+		 *
+		 *	\param[in] device The device.
+		 *	\returns The number of bytes added, 0 if none were queued or the
+		 *		ring is full.
+		 */
+		size_t SerialExecutor::FillNow(SerialDevice& device)
+		{
+			size_t span = 0;
+			uint8_t* _buf = device.m_rxRing->Prepare(span);
+			if (!span) return 0;
+
+			size_t len = device.native_read_now(_buf, span);
+			device.m_rxRing->Commit(len);
+			return len;
+		}
+
+
+
+		/**********************************************************************
+		 *	Take bytes up to and including a delimiter from a device's
+		 *		receive ring, if it has arrived.
+		 *
+		 *	\param[in] device The device.
+		 *	\param[out] dest The bytes, ending with the delimiter.
+		 *	\param[in] delimiter The bytes ending the read.
+		 *	\param[in,out] scanned Bytes of the ring already searched; kept
+		 *		between calls and reset once the delimiter is found.
+		 *	\returns The number of bytes taken, 0 if the delimiter has not
+		 *		arrived.
+		 */
+		size_t SerialExecutor::TakeUntil(SerialDevice& device, std::string& dest, std::string_view delimiter, size_t& scanned)
+		{
+			size_t found = device.find_rx(delimiter, scanned);
+			if (found)
+			{
+				dest.resize(found);
+				device.m_rxRing->Read(&dest[0], found);
+				scanned = 0;
+				return found;
+			}
+
+			size_t pending = device.m_rxRing->Size();
+			if (pending == device.m_rxRing->Capacity())
+			{
+				std::cerr << "Serial Error: Delimiter not found within the receive ring!" << std::endl;
+			}
+
+			//	rescan only the bytes that could start a delimiter
+			scanned = (pending >= delimiter.size()) ? pending - delimiter.size() + 1 : 0;
+			return 0;
+		}
+
+
+
+		/**********************************************************************
+		 *	Write as much as a device takes, without waiting for room. On
+		 *		Win32 a write the port cannot finish at once is left in
+		 *		flight and 0 returned; call again with the same data once
+		 *		writable to collect it.
+		 *
+		 *	\param[in] device The device.
+		 *	\param[in] src The data.
+		 *	\param[in] len The length of the data.
+		 *	\returns The number of bytes written.
+		 */
+		size_t SerialExecutor::WriteNow(SerialDevice& device, const void* src, size_t len)
+		{
+			return device.native_write_now(src, len);
+		}
+
+
+
+		/**********************************************************************
+		 *	Register a wait on a device.
+		 */
+		void SerialExecutor::when_ready(SerialDevice& device, bool writable, std::chrono::steady_clock::time_point deadline, Resume resume, void* context)
+		{
+			NativeHandle handle = device.m_pComm;
+			if (handle == SERIAL_INVALID_HANDLE)
+			{
+				std::cerr << "Serial Error: Awaiting a closed device!" << std::endl;
+				Post(resume, context);
+				return;
+			}
+
+			Watch& watch = m_watches[handle];
+			Waiter& waiter = writable ? watch.write : watch.read;
+			if (waiter.resume)
+			{
+				std::cerr << "Serial Error: Device is already awaited!" << std::endl;
+				Post(resume, context);
+				return;
+			}
+
+			waiter = Waiter{ resume, context, ++m_generation };
+			watch.device = &device;
+			m_waiting++;
+			if (deadline != Forever)
+			{
+				m_timers.push(Timer{ deadline, handle, writable, waiter.generation, resume, context });
+			}
+			arm(handle, watch);
+		}
+
+
+
+		/**********************************************************************
+		 *	Queue the waits satisfied by a device becoming ready, and rearm
+		 *		it for the rest.
+		 *
+		 *	\param[in] handle The device's handle.
+		 *	\param[in] readable Whether it has data to read.
+		 *	\param[in] writable Whether it has room to write.
+		 *	\param[in] failed Whether it hung up or failed, ending every wait.
+		 */
+		void SerialExecutor::ready(NativeHandle handle, bool readable, bool writable, bool failed)
+		{
+			auto found = m_watches.find(handle);
+			if (found == m_watches.end()) return;
+
+			Watch& watch = found->second;
+			bool armed = false;
+
+			for (Waiter* waiter : { &watch.read, &watch.write })
+			{
+				if (!waiter->resume) continue;
+
+				if (((waiter == &watch.read) ? readable : writable) || failed)
+				{
+					m_ready.emplace_back(waiter->resume, waiter->context);
+					*waiter = Waiter();
+					m_waiting--;
+				}
+				else
+				{
+					armed = true;
+				}
+			}
+
+			//	a one shot wait went off for the waits left
+			if (armed && !failed) arm(handle, watch);
+		}
+
+
+
+		/**********************************************************************
+		 *	Whether a timer belongs to a wait that has already run.
+		 */
+		bool SerialExecutor::stale(const Timer& timer) const
+		{
+			if (timer.handle == SERIAL_INVALID_HANDLE) return false;
+
+			auto found = m_watches.find(timer.handle);
+			if (found == m_watches.end()) return true;
+
+			const Waiter& waiter = timer.writable ? found->second.write : found->second.read;
+			return !waiter.resume || waiter.generation != timer.generation;
+		}
+
+
+
+		/**********************************************************************
+		 *	Queue the waits and posts whose time has come.
+		 */
+		void SerialExecutor::expire()
+		{
+			const auto now = std::chrono::steady_clock::now();
+			while (!m_timers.empty() && m_timers.top().deadline <= now)
+			{
+				Timer timer = m_timers.top();
+				m_timers.pop();
+
+				if (timer.handle == SERIAL_INVALID_HANDLE)
+				{
+					m_delayed--;
+					m_ready.emplace_back(timer.resume, timer.context);
+				}
+				else if (!stale(timer))
+				{
+					Watch& watch = m_watches[timer.handle];
+					disarm(timer.handle, watch, timer.writable);
+					(timer.writable ? watch.write : watch.read) = Waiter();
+					m_waiting--;
+					m_ready.emplace_back(timer.resume, timer.context);
+				}
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Milliseconds until the next live deadline, -1 if there is none.
+		 */
+		int SerialExecutor::wait_timeout()
+		{
+			while (!m_timers.empty() && stale(m_timers.top())) m_timers.pop();
+			if (m_timers.empty()) return -1;
+
+			auto wait = std::chrono::ceil<std::chrono::milliseconds>(m_timers.top().deadline - std::chrono::steady_clock::now());
+			return (int)(std::min)((std::max)(wait.count(), (decltype(wait.count()))0), (decltype(wait.count()))INT_MAX);
+		}
+	}
+}
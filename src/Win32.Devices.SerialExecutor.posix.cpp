@@ -0,0 +1,113 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialExecutor.hpp"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include <stdexcept>
+
+#define MAX_EVENTS_PER_WAIT		(64)
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Create the executor.
+		 */
+		SerialExecutor::SerialExecutor()
+		{
+			m_epoll = epoll_create1(EPOLL_CLOEXEC);
+			if (m_epoll < 0)
+			{
+				std::cerr << "Serial Error: Unable to create epoll instance!" << std::endl;
+				throw std::runtime_error("No epoll instance");
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Destroy any work still owned and release the epoll instance.
+		 */
+		SerialExecutor::~SerialExecutor()
+		{
+			std::unordered_map<void*, Resume> owned;
+			owned.swap(m_owned);
+			for (auto& work : owned) work.second(work.first);
+
+			close(m_epoll);
+		}
+
+
+
+		/**********************************************************************
+		 *	Register the waits of a descriptor with epoll, one shot. If epoll
+		 *		refuses them they run at once.
+		 */
+		void SerialExecutor::arm(int fd, Watch& watch)
+		{
+			epoll_event dev_event = { 0 };
+			dev_event.events = EPOLLONESHOT
+				| (watch.read.resume ? (uint32_t)EPOLLIN : 0)
+				| (watch.write.resume ? (uint32_t)EPOLLOUT : 0);
+			dev_event.data.fd = fd;
+
+			//	a descriptor closed and reused has left the epoll set
+			if (watch.added && epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &dev_event) == 0) return;
+			if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &dev_event) == 0
+				|| (errno == EEXIST && epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &dev_event) == 0))
+			{
+				watch.added = true;
+				return;
+			}
+
+			std::cerr << "Serial Error: Unable to await device!" << std::endl;
+			ready(fd, false, false, true);
+		}
+
+
+
+		/**********************************************************************
+		 *	Drop a wait whose deadline passed. Readiness still armed for it
+		 *		finds no wait and is ignored.
+		 */
+		void SerialExecutor::disarm(int fd, Watch& watch, bool writable)
+		{
+			(void)fd;
+			(void)watch;
+			(void)writable;
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait for readiness and queue the waits it satisfies.
+		 *
+		 *	\param[in] timeoutMs How long to wait; -1 waits forever.
+		 *	\returns False if epoll failed.
+		 */
+		bool SerialExecutor::await_native(int timeoutMs)
+		{
+			epoll_event events[MAX_EVENTS_PER_WAIT];
+			int count = epoll_wait(m_epoll, events, MAX_EVENTS_PER_WAIT, timeoutMs);
+			if (count < 0 && errno != EINTR)
+			{
+				std::cerr << "Serial Error: Unable to await devices!" << std::endl;
+				return false;
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				ready(events[i].data.fd, (events[i].events & EPOLLIN) != 0, (events[i].events & EPOLLOUT) != 0,
+					(events[i].events & (EPOLLHUP | EPOLLERR)) != 0);
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,205 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialExecutor.hpp"
+
+#include <stdexcept>
+
+#define MAX_EVENTS_PER_WAIT		(64)
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Create the executor and its completion port.
+		 */
+		SerialExecutor::SerialExecutor()
+		{
+			m_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+			if (m_port == NULL)
+			{
+				std::cerr << "Serial Error: Unable to create completion port!" << std::endl;
+				throw std::runtime_error("No completion port");
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Cancel the operations still in flight, destroy any work still
+		 *		owned and release the completion port. Operations are
+		 *		cancelled first, as the work may own their devices and
+		 *		buffers.
+		 */
+		SerialExecutor::~SerialExecutor()
+		{
+			for (auto& waits : m_watches)
+			{
+				if (waits.second.rxArmed) disarm(waits.first, waits.second, false);
+				if (waits.second.write.resume) disarm(waits.first, waits.second, true);
+			}
+
+			std::unordered_map<void*, Resume> owned;
+			owned.swap(m_owned);
+			for (auto& work : owned) work.second(work.first);
+
+			CloseHandle(m_port);
+		}
+
+
+
+		/**********************************************************************
+		 *	Start what the waits of a device need. A read wait is a comm
+		 *		event on a received character; a write wait is the write
+		 *		left in flight by $WriteNow. Both complete on the port. Waits
+		 *		already satisfied run at once.
+		 */
+		void SerialExecutor::arm(NativeHandle handle, Watch& watch)
+		{
+			if (!watch.added)
+			{
+				if (CreateIoCompletionPort(handle, m_port, (ULONG_PTR)handle, 0) == NULL
+					|| !SetCommMask(handle, EV_RXCHAR))
+				{
+					std::cerr << "Serial Error: Unable to await device!" << std::endl;
+					ready(handle, false, false, true);
+					return;
+				}
+
+				//	only operations left pending complete on the port
+				SetFileCompletionNotificationModes(handle, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS);
+				watch.added = true;
+			}
+
+			bool readable = false;
+			bool failed = false;
+			if (watch.read.resume && !watch.rxArmed)
+			{
+				//	a character read since the last wait still raises the event
+				readable = watch.device->Available() != 0;
+				if (!readable)
+				{
+					watch.rxWait = { 0 };
+					if (WaitCommEvent(handle, &watch.rxEvents, &watch.rxWait))
+					{
+						readable = true;
+					}
+					else if (GetLastError() == ERROR_IO_PENDING)
+					{
+						watch.rxArmed = true;
+					}
+					else
+					{
+						failed = true;
+					}
+				}
+			}
+
+			//	a write completed before the device joined the port posts nothing
+			bool writable = watch.write.resume
+				&& (!watch.device->m_WriteOpPending || HasOverlappedIoCompleted(&watch.device->m_writeIo.overlapped));
+
+			if (readable || writable || failed) ready(handle, readable, writable, failed);
+		}
+
+
+
+		/**********************************************************************
+		 *	Cancel the operation behind a wait whose deadline passed, and
+		 *		wait for it to let go of its buffers. Its completion still
+		 *		reaches the port, and is ignored.
+		 */
+		void SerialExecutor::disarm(NativeHandle handle, Watch& watch, bool writable)
+		{
+			DWORD ov_res;
+			if (writable)
+			{
+				if (!watch.device->m_WriteOpPending) return;
+
+				//	$WriteNow collects what was written before the cancel
+				OVERLAPPED* os_writer = &watch.device->m_writeIo.overlapped;
+				if (CancelIoEx(handle, os_writer) || GetLastError() != ERROR_NOT_FOUND)
+				{
+					GetOverlappedResult(handle, os_writer, &ov_res, TRUE);
+				}
+			}
+			else if (watch.rxArmed)
+			{
+				if (CancelIoEx(handle, &watch.rxWait) || GetLastError() != ERROR_NOT_FOUND)
+				{
+					GetOverlappedResult(handle, &watch.rxWait, &ov_res, TRUE);
+				}
+				watch.rxArmed = false;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait for completions and queue the waits they satisfy.
+		 *
+		 *	\param[in] timeoutMs How long to wait; -1 waits forever.
+		 *	\returns False if the completion port failed.
+		 */
+		bool SerialExecutor::await_native(int timeoutMs)
+		{
+			OVERLAPPED_ENTRY entries[MAX_EVENTS_PER_WAIT];
+			ULONG count = 0;
+			if (!GetQueuedCompletionStatusEx(m_port, entries, MAX_EVENTS_PER_WAIT, &count, (DWORD)timeoutMs, FALSE))
+			{
+				if (GetLastError() == WAIT_TIMEOUT) return true;
+
+				std::cerr << "Serial Error: Unable to await devices!" << std::endl;
+				return false;
+			}
+
+			for (ULONG i = 0; i < count; i++)
+			{
+				completed((NativeHandle)entries[i].lpCompletionKey, entries[i].lpOverlapped);
+			}
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Handle an operation completing on the port. Operations the
+		 *		device issued for itself, and those cancelled on a deadline,
+		 *		complete here too and are ignored.
+		 *
+		 *	\param[in] handle The device's handle.
+		 *	\param[in] overlapped The operation.
+		 */
+		void SerialExecutor::completed(NativeHandle handle, const OVERLAPPED* overlapped)
+		{
+			auto found = m_watches.find(handle);
+			if (found == m_watches.end()) return;
+
+			Watch& watch = found->second;
+			DWORD ov_res;
+			if (overlapped == &watch.rxWait)
+			{
+				//	a cancelled wait may complete after the next was issued
+				if (!watch.rxArmed || !HasOverlappedIoCompleted(&watch.rxWait)) return;
+				watch.rxArmed = false;
+
+				bool failed = !GetOverlappedResult(handle, &watch.rxWait, &ov_res, FALSE);
+				if (!failed && watch.read.resume && !watch.device->Available())
+				{
+					//	raised by a character already read
+					arm(handle, watch);
+					return;
+				}
+				ready(handle, true, false, failed);
+			}
+			else if (watch.write.resume && overlapped == &watch.device->m_writeIo.overlapped)
+			{
+				if (!HasOverlappedIoCompleted(overlapped)) return;
+				ready(handle, false, true, false);
+			}
+		}
+	}
+}
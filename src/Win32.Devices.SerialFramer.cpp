@@ -0,0 +1,241 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialFramer.hpp"
+
+#include <cstring>
+#include <iostream>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	SLIP special characters.
+		constexpr uint8_t SlipEnd = 0xC0;
+		constexpr uint8_t SlipEsc = 0xDB;
+		constexpr uint8_t SlipEscEnd = 0xDC;
+		constexpr uint8_t SlipEscEsc = 0xDD;
+
+
+
+		/**********************************************************************
+		 *	Reserve storage for a frame split across slices.
+		 *
+		 *	\param[in] maxFrameSize The largest frame reassembled.
+		 */
+		SerialFramer::SerialFramer(size_t maxFrameSize)
+			: m_maxFrameSize((std::max)(maxFrameSize, (size_t)2))
+		{
+			m_partial.reserve(m_maxFrameSize);
+		}
+
+
+
+		/**********************************************************************
+		 *	Discard a partially received frame.
+		 */
+		void SerialFramer::Reset()
+		{
+			m_partial.clear();
+			m_resync = false;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create a framer splitting on a delimiter.
+		 *
+		 *	\param[in] delimiter The bytes ending each frame.
+		 *	\param[in] keepDelimiter Whether emitted frames include it.
+		 *	\param[in] maxFrameSize The largest frame reassembled.
+		 */
+		DelimiterFramer::DelimiterFramer(std::string delimiter, bool keepDelimiter, size_t maxFrameSize)
+			: SerialFramer(maxFrameSize)
+			, m_delimiter(delimiter.empty() ? std::string("\n") : std::move(delimiter))
+			, m_keepDelimiter(keepDelimiter)
+		{
+		}
+
+
+
+		size_t DelimiterFramer::extract(std::string_view data, std::string_view& frame)
+		{
+			const char* begin = data.data();
+			const char* end = begin + data.size();
+			const size_t delimLen = m_delimiter.size();
+
+			for (const char* at = begin;
+				(at = (const char*)std::memchr(at, m_delimiter[0], end - at)) != nullptr; ++at)
+			{
+				if ((size_t)(end - at) < delimLen) break;
+				if (delimLen > 1 && std::memcmp(at + 1, m_delimiter.data() + 1, delimLen - 1) != 0) continue;
+
+				size_t length = (size_t)(at - begin);
+				frame = data.substr(0, m_keepDelimiter ? length + delimLen : length);
+				return length + delimLen;
+			}
+			return 0;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create a framer splitting every $frameLength bytes.
+		 *
+		 *	\param[in] frameLength The bytes in each frame.
+		 */
+		FixedLengthFramer::FixedLengthFramer(size_t frameLength)
+			: SerialFramer((std::max)(frameLength + 1, SerialMaxFrameSize))
+			, m_frameLength((std::max)(frameLength, (size_t)1))
+		{
+		}
+
+
+
+		size_t FixedLengthFramer::extract(std::string_view data, std::string_view& frame)
+		{
+			if (data.size() < m_frameLength) return 0;
+
+			frame = data.substr(0, m_frameLength);
+			return m_frameLength;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create a framer for length-prefixed frames.
+		 *
+		 *	\param[in] prefixBytes The size of the length: 1, 2 or 4.
+		 *	\param[in] bigEndian The byte order of the length.
+		 *	\param[in] maxFrameSize The largest frame reassembled.
+		 */
+		LengthPrefixFramer::LengthPrefixFramer(size_t prefixBytes, bool bigEndian, size_t maxFrameSize)
+			: SerialFramer(maxFrameSize)
+			, m_prefixBytes((prefixBytes == 1 || prefixBytes == 4) ? prefixBytes : 2)
+			, m_bigEndian(bigEndian)
+		{
+			if (prefixBytes != m_prefixBytes)
+			{
+				std::cerr << "Serial Error: Length prefix must be 1, 2 or 4 bytes!";
+			}
+		}
+
+
+
+		size_t LengthPrefixFramer::extract(std::string_view data, std::string_view& frame)
+		{
+			if (data.size() < m_prefixBytes) return 0;
+
+			const uint8_t* prefix = (const uint8_t*)data.data();
+			size_t length = 0;
+			for (size_t i = 0; i < m_prefixBytes; i++)
+			{
+				size_t octet = prefix[m_bigEndian ? i : m_prefixBytes - 1 - i];
+				length = (length << 8) | octet;
+			}
+
+			if (length + m_prefixBytes >= MaxFrameSize())
+			{
+				//	cannot be reassembled; skip the byte and resync
+				frame = std::string_view();
+				return 1;
+			}
+			if (data.size() < m_prefixBytes + length) return 0;
+
+			frame = data.substr(m_prefixBytes, length);
+			return m_prefixBytes + length;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create a SLIP decoder.
+		 *
+		 *	\param[in] maxFrameSize The largest encoded frame reassembled.
+		 */
+		SlipFramer::SlipFramer(size_t maxFrameSize)
+			: SerialFramer(maxFrameSize)
+		{
+			m_decoded.reserve(MaxFrameSize());
+		}
+
+
+
+		size_t SlipFramer::extract(std::string_view data, std::string_view& frame)
+		{
+			const char* end = (const char*)std::memchr(data.data(), SlipEnd, data.size());
+			if (!end) return 0;
+
+			size_t length = (size_t)(end - data.data());
+			frame = std::string_view();
+			if (!length) return 1;
+
+			//	copy the runs between escapes
+			m_decoded.clear();
+			const char* src = data.data();
+			const char* stop = src + length;
+			while (src < stop)
+			{
+				const char* esc = (const char*)std::memchr(src, SlipEsc, stop - src);
+				if (!esc) esc = stop;
+				m_decoded.append(src, esc - src);
+				if (esc + 1 >= stop)
+				{
+					m_decoded.append(esc, stop - esc);
+					break;
+				}
+
+				uint8_t octet = (uint8_t)esc[1];
+				if (octet == SlipEscEnd) octet = SlipEnd;
+				else if (octet == SlipEscEsc) octet = SlipEsc;
+				m_decoded.push_back((char)octet);
+				src = esc + 2;
+			}
+
+			frame = m_decoded;
+			return length + 1;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create a COBS decoder.
+		 *
+		 *	\param[in] maxFrameSize The largest encoded frame reassembled.
+		 */
+		CobsFramer::CobsFramer(size_t maxFrameSize)
+			: SerialFramer(maxFrameSize)
+		{
+			m_decoded.reserve(MaxFrameSize());
+		}
+
+
+
+		size_t CobsFramer::extract(std::string_view data, std::string_view& frame)
+		{
+			const char* end = (const char*)std::memchr(data.data(), 0, data.size());
+			if (!end) return 0;
+
+			size_t length = (size_t)(end - data.data());
+			frame = std::string_view();
+			if (!length) return 1;
+
+			m_decoded.clear();
+			const char* src = data.data();
+			for (size_t i = 0; i < length; )
+			{
+				size_t code = (uint8_t)src[i++];
+				size_t run = (std::min)(code - 1, length - i);
+				m_decoded.append(src + i, run);
+				i += run;
+
+				if (code < 0xFF && i < length) m_decoded.push_back('\0');
+			}
+
+			frame = m_decoded;
+			return length + 1;
+		}
+	}
+}
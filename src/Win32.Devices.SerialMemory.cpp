@@ -0,0 +1,153 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialMemory.hpp"
+
+#include <algorithm>
+#include <new>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Alignment of every block; that of a cache line.
+		static constexpr size_t BlockAlignment = 64;
+
+
+
+		/**********************************************************************
+		 *	Take the arena from upstream and cut it into blocks.
+		 *
+		 *	\param[in] sizes The block sizes, and how many of each.
+		 *	\param[in] upstream Provides the arena, and serves requests no
+		 *		block can.
+		 */
+		SerialBlockPool::SerialBlockPool(const SerialPoolSizes& sizes, std::pmr::memory_resource* upstream)
+			: m_upstream(upstream)
+		{
+			size_t blockSize = BlockAlignment;
+			while (blockSize < sizes.minBlock) blockSize <<= 1;
+
+			for (; blockSize <= sizes.maxBlock && m_classCount < MaxClasses; blockSize <<= 1)
+			{
+				m_classes[m_classCount++].blockSize = blockSize;
+				m_arenaSize += blockSize * sizes.blocks;
+			}
+			if (!m_arenaSize) return;
+
+			m_arena = static_cast<uint8_t*>(m_upstream->allocate(m_arenaSize, BlockAlignment));
+
+			uint8_t* at = m_arena;
+			for (size_t i = 0; i < m_classCount; i++)
+			{
+				SizeClass& sizeClass = m_classes[i];
+				sizeClass.begin = at;
+				sizeClass.end = at + sizeClass.blockSize * sizes.blocks;
+
+				//	link from the back, so the first block is handed out first
+				for (uint8_t* block = sizeClass.end; block != sizeClass.begin; )
+				{
+					block -= sizeClass.blockSize;
+					sizeClass.free = new (block) FreeBlock{ sizeClass.free };
+				}
+				at = sizeClass.end;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Give the arena back. Nothing may still be allocated from it.
+		 */
+		SerialBlockPool::~SerialBlockPool()
+		{
+			if (m_arena) m_upstream->deallocate(m_arena, m_arenaSize, BlockAlignment);
+		}
+
+
+
+		/**********************************************************************
+		 *	Gets the counters of the pool.
+		 */
+		SerialPoolStats SerialBlockPool::Stats() const
+		{
+			SerialPoolStats stats;
+			stats.capacity = m_arenaSize;
+			stats.fallbacks = m_fallbacks.load(std::memory_order_relaxed);
+
+			std::lock_guard<std::mutex> lock(m_lock);
+			stats.inUse = m_inUse;
+			stats.peak = m_peak;
+			return stats;
+		}
+
+
+
+		/**********************************************************************
+		 *	Hand out a block of the smallest size that fits and has one free.
+		 *
+		 *	\param[in] bytes The size wanted.
+		 *	\param[in] alignment The alignment wanted.
+		 *	\returns The block, or upstream's allocation if no block fits.
+		 */
+		void* SerialBlockPool::do_allocate(size_t bytes, size_t alignment)
+		{
+			if (alignment <= BlockAlignment)
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				for (size_t i = 0; i < m_classCount; i++)
+				{
+					SizeClass& sizeClass = m_classes[i];
+					if (sizeClass.blockSize < bytes || !sizeClass.free) continue;
+
+					FreeBlock* block = sizeClass.free;
+					sizeClass.free = block->next;
+					m_peak = (std::max)(m_peak, ++m_inUse);
+					return block;
+				}
+			}
+
+			m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+			return m_upstream->allocate(bytes, alignment);
+		}
+
+
+
+		/**********************************************************************
+		 *	Return a block to the free list of its size, or give upstream
+		 *		back its own.
+		 */
+		void SerialBlockPool::do_deallocate(void* p, size_t bytes, size_t alignment)
+		{
+			uint8_t* block = static_cast<uint8_t*>(p);
+			if (block < m_arena || block >= m_arena + m_arenaSize)
+			{
+				m_upstream->deallocate(p, bytes, alignment);
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(m_lock);
+			for (size_t i = 0; i < m_classCount; i++)
+			{
+				SizeClass& sizeClass = m_classes[i];
+				if (block >= sizeClass.end) continue;
+
+				sizeClass.free = new (block) FreeBlock{ sizeClass.free };
+				m_inUse--;
+				return;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	A pool only frees its own blocks.
+		 */
+		bool SerialBlockPool::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+		{
+			return this == &other;
+		}
+	}
+}
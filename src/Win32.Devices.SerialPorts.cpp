@@ -0,0 +1,78 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialPorts.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Open and configure many ports at once. Opening a port blocks on
+		 *		its driver, so several are opened concurrently; no port's
+		 *		failure affects another, and nothing is thrown.
+		 *
+		 *	\param[in] paths The ports, i.e. from $Enumerate.
+		 *	\param[in] settings Applied to every port.
+		 *	\param[in] concurrency The most ports opened at once.
+		 *	\returns A result per path, in the order given.
+		 */
+		std::vector<SerialOpenResult> SerialPorts::Open(const std::vector<std::string>& paths,
+			const SerialSettings& settings, size_t concurrency)
+		{
+			std::vector<SerialOpenResult> results(paths.size());
+			for (size_t i = 0; i < paths.size(); i++)
+			{
+				results[i].path = paths[i];
+			}
+
+			std::atomic<size_t> next = { 0 };
+			auto opener = [&]
+			{
+				for (size_t i = next++; i < results.size(); i = next++)
+				{
+					open_one(results[i], settings);
+				}
+			};
+
+			//	the calling thread is one of the openers
+			size_t threads = (std::min)((std::max)(concurrency, (size_t)1), results.size());
+			std::vector<std::thread> openers;
+			for (size_t i = 1; i < threads; i++)
+			{
+				openers.emplace_back(opener);
+			}
+			opener();
+			for (std::thread& thread : openers)
+			{
+				thread.join();
+			}
+
+			return results;
+		}
+
+
+
+		/**********************************************************************
+		 *	Open and configure a single port of a bulk open.
+		 */
+		void SerialPorts::open_one(SerialOpenResult& result, const SerialSettings& settings)
+		{
+			NativeHandle handle = SerialDevice::open_native(result.path, result.error);
+			if (handle == SERIAL_INVALID_HANDLE) return;
+
+			result.device.reset(new SerialDevice(handle, 0));
+			result.device->m_path = result.path;
+			if (!result.device->bring_up(settings))
+			{
+				result.error = "Settings not applied";
+			}
+		}
+	}
+}
@@ -0,0 +1,124 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialPorts.hpp"
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+
+#define SYS_CLASS_TTY	"/sys/class/tty"
+
+#define USB_SEARCH_DEPTH	(4)
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	The first line of a sysfs attribute, or empty if absent.
+		static std::string read_attribute(const std::string& path)
+		{
+			std::ifstream attribute(path);
+			std::string value;
+			std::getline(attribute, value);
+			return value;
+		}
+
+
+		///	The name a sysfs link points to, i.e. the driver of a device.
+		static std::string link_name(const std::string& path)
+		{
+			char target[PATH_MAX];
+			ssize_t len = readlink(path.c_str(), target, sizeof(target) - 1);
+			if (len <= 0) return std::string();
+
+			std::string name(target, (size_t)len);
+			size_t slash = name.rfind('/');
+			return (slash == std::string::npos) ? name : name.substr(slash + 1);
+		}
+
+
+		///	Fill in the USB identity of a port from the first device above
+		///		it that has one: the interface's parent for CDC ACM, one more
+		///		up for USB-serial converters.
+		static void read_usb(const std::string& device, SerialPortInfo& info)
+		{
+			std::string dir = device;
+			for (int level = 0; level < USB_SEARCH_DEPTH && !dir.empty(); level++)
+			{
+				std::string vendor = read_attribute(dir + "/idVendor");
+				if (!vendor.empty())
+				{
+					info.vendorId = (uint16_t)strtoul(vendor.c_str(), nullptr, 16);
+					info.productId = (uint16_t)strtoul(read_attribute(dir + "/idProduct").c_str(), nullptr, 16);
+					info.serialNumber = read_attribute(dir + "/serial");
+					info.manufacturer = read_attribute(dir + "/manufacturer");
+					info.product = read_attribute(dir + "/product");
+					return;
+				}
+				dir.erase(dir.rfind('/'));
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Find the serial ports of the system from sysfs.
+		 *
+		 *	\returns The ports, by path.
+		 */
+		std::vector<SerialPortInfo> SerialPorts::Enumerate()
+		{
+			return Enumerate(SYS_CLASS_TTY);
+		}
+
+
+
+		/**********************************************************************
+		 *	Find the serial ports under a sysfs tty class directory. Terminals
+		 *		without a device, such as consoles and ptys, are skipped, as
+		 *		are the placeholder 8250 ports of the legacy ISA range.
+		 *
+		 *	\param[in] sysClassTty The class directory, i.e. "/sys/class/tty".
+		 *	\returns The ports, by path.
+		 */
+		std::vector<SerialPortInfo> SerialPorts::Enumerate(const std::string& sysClassTty)
+		{
+			std::vector<SerialPortInfo> ports;
+
+			DIR* dir = opendir(sysClassTty.c_str());
+			if (!dir) return ports;
+
+			while (dirent* entry = readdir(dir))
+			{
+				std::string name = entry->d_name;
+				if (name.empty() || name[0] == '.') continue;
+
+				std::string tty = sysClassTty + "/" + name;
+				char device[PATH_MAX];
+				if (!realpath((tty + "/device").c_str(), device)) continue;
+
+				SerialPortInfo info;
+				info.path = "/dev/" + name;
+				info.driver = link_name(tty + "/device/driver");
+
+				//	the 8250 driver registers ports that may not exist
+				if (info.driver == "serial8250" && link_name(tty + "/device/subsystem") == "platform") continue;
+
+				read_usb(device, info);
+				ports.push_back(std::move(info));
+			}
+			closedir(dir);
+
+			std::sort(ports.begin(), ports.end(),
+				[](const SerialPortInfo& a, const SerialPortInfo& b) { return a.path < b.path; });
+			return ports;
+		}
+	}
+}
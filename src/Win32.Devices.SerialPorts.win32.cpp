@@ -0,0 +1,71 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialPorts.hpp"
+
+#include <algorithm>
+
+#define SERIALCOMM_KEY	L"HARDWARE\\DEVICEMAP\\SERIALCOMM"
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	A registry string, narrowed. Port and driver names are ASCII.
+		static std::string narrow(const wchar_t* str, size_t len)
+		{
+			std::string out;
+			for (size_t i = 0; i < len && str[i]; i++)
+			{
+				out += (char)str[i];
+			}
+			return out;
+		}
+
+
+
+		/**********************************************************************
+		 *	Find the serial ports of the system from the SERIALCOMM device
+		 *		map. Only the path and driver object are known there; USB
+		 *		identities need SetupAPI and are left unset.
+		 *
+		 *	\returns The ports, by path.
+		 */
+		std::vector<SerialPortInfo> SerialPorts::Enumerate()
+		{
+			std::vector<SerialPortInfo> ports;
+
+			HKEY serial_comm;
+			if (RegOpenKeyEx(HKEY_LOCAL_MACHINE, SERIALCOMM_KEY, 0, KEY_READ, &serial_comm) != ERROR_SUCCESS)
+			{
+				return ports;
+			}
+
+			for (DWORD index = 0;; index++)
+			{
+				wchar_t driver[MAX_PATH];
+				wchar_t port[MAX_PATH];
+				DWORD driver_len = MAX_PATH;
+				DWORD port_size = sizeof(port);
+				DWORD type = 0;
+
+				LSTATUS status = RegEnumValue(serial_comm, index, driver, &driver_len,
+					nullptr, &type, (BYTE*)port, &port_size);
+				if (status == ERROR_NO_MORE_ITEMS) break;
+				if (status != ERROR_SUCCESS || type != REG_SZ) continue;
+
+				SerialPortInfo info;
+				info.path = "\\\\.\\" + narrow(port, port_size / sizeof(wchar_t));
+				info.driver = narrow(driver, driver_len);
+				ports.push_back(std::move(info));
+			}
+			RegCloseKey(serial_comm);
+
+			std::sort(ports.begin(), ports.end(),
+				[](const SerialPortInfo& a, const SerialPortInfo& b) { return a.path < b.path; });
+			return ports;
+		}
+	}
+}
@@ -0,0 +1,244 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialReactor.hpp"
+
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <stdexcept>
+
+#define MAX_EVENTS_PER_WAIT		(64)
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Create the reactor and start its thread pool.
+		 *
+		 *	\param[in] threadCount The number of dispatching threads.
+		 */
+		SerialReactor::SerialReactor(unsigned threadCount)
+			: m_running(true)
+		{
+			m_epoll = epoll_create1(EPOLL_CLOEXEC);
+			m_wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+			if (m_epoll < 0 || m_wakeup < 0)
+			{
+				std::cerr << "Reactor Error: Unable to create epoll instance!" << std::endl;
+				throw std::runtime_error("No epoll instance");
+			}
+
+			//	level triggered so every worker observes shutdown
+			epoll_event wake_event = { 0 };
+			wake_event.events = EPOLLIN;
+			wake_event.data.fd = m_wakeup;
+			epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &wake_event);
+
+			if (threadCount == 0) threadCount = 1;
+			for (unsigned i = 0; i < threadCount; i++)
+			{
+				m_workers.emplace_back(&SerialReactor::worker_thread, this);
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Stop the pool and release the epoll instance.
+		 */
+		SerialReactor::~SerialReactor()
+		{
+			Stop();
+
+			std::vector<SerialDevice*> attached;
+			{
+				std::lock_guard<std::mutex> lock(m_registryLock);
+				for (auto& reg : m_registry) attached.push_back(reg.second->device);
+			}
+			for (SerialDevice* device : attached) Detach(*device);
+
+			close(m_wakeup);
+			close(m_epoll);
+		}
+
+
+
+		/**********************************************************************
+		 *	Register a device; its received data is dispatched by the pool.
+		 *
+		 *	\param[in] device An open device. It must not move while attached.
+		 */
+		void SerialReactor::Attach(SerialDevice& device)
+		{
+			assert(device.m_pComm != SERIAL_INVALID_HANDLE);
+			if (device.m_reactor == this) return;
+			if (device.m_reactor != nullptr) device.m_reactor->Detach(device);
+
+			const int fd = device.m_pComm;
+			std::lock_guard<std::mutex> lock(m_registryLock);
+			m_registry[fd].reset(new Registration{ &device, false, false, {} });
+			device.m_reactor = this;
+
+			//	one shot: a device is handled by one thread at a time
+			epoll_event dev_event = { 0 };
+			dev_event.events = EPOLLIN | EPOLLONESHOT;
+			dev_event.data.fd = fd;
+			if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &dev_event) != 0)
+			{
+				std::cerr << "Reactor Error: Unable to attach device!" << std::endl;
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Unregister a device, waiting for any dispatch in progress.
+		 *
+		 *	\param[in] device A device previously attached to this reactor.
+		 */
+		void SerialReactor::Detach(SerialDevice& device)
+		{
+			if (device.m_reactor != this) return;
+
+			const int fd = device.m_pComm;
+			std::unique_lock<std::mutex> lock(m_registryLock);
+			auto found = m_registry.find(fd);
+			if (found != m_registry.end())
+			{
+				epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+
+				Registration* reg = found->second.get();
+				if (reg->dispatching && reg->dispatcher == std::this_thread::get_id())
+				{
+					//	detached from its own handler, the dispatch erases it
+					reg->detached = true;
+				}
+				else
+				{
+					//	an attach during the wait may rehash the registry, so
+					//		only the registration itself is kept across it
+					m_dispatchDone.wait(lock, [&] { return !reg->dispatching; });
+					m_registry.erase(fd);
+				}
+			}
+			device.m_reactor = nullptr;
+		}
+
+
+
+		/**********************************************************************
+		 *	Stop and join the thread pool. Devices remain attached but are no
+		 *		longer dispatched.
+		 */
+		void SerialReactor::Stop()
+		{
+			if (m_running.exchange(false))
+			{
+				uint64_t wake = 1;
+				if (write(m_wakeup, &wake, sizeof(wake)) < 0)
+				{
+					std::cerr << "Reactor Error: Unable to wake the pool!" << std::endl;
+				}
+			}
+
+			for (std::thread& worker : m_workers)
+			{
+				if (worker.joinable()) worker.join();
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	The number of devices attached to the reactor.
+		 */
+		size_t SerialReactor::Attached() const
+		{
+			std::lock_guard<std::mutex> lock(m_registryLock);
+			return m_registry.size();
+		}
+
+
+
+		/**********************************************************************
+		 *	A pool thread. Awaits readiness on any attached device and raises
+		 *		its received data event.
+		 */
+		void SerialReactor::worker_thread()
+		{
+			epoll_event events[MAX_EVENTS_PER_WAIT];
+
+			while (m_running.load(std::memory_order_acquire))
+			{
+				int ready = epoll_wait(m_epoll, events, MAX_EVENTS_PER_WAIT, -1);
+				if (ready < 0 && errno != EINTR)
+				{
+					//	[error]: epoll instance is unusable
+					break;
+				}
+
+				for (int i = 0; i < ready; i++)
+				{
+					if (events[i].data.fd != m_wakeup)
+					{
+						dispatch(events[i].data.fd, events[i].events);
+					}
+				}
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Dispatch readiness on one device and rearm it.
+		 *
+		 *	\param[in] fd The descriptor of the ready device.
+		 *	\param[in] events The epoll events raised.
+		 */
+		void SerialReactor::dispatch(int fd, uint32_t events)
+		{
+			Registration* reg = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(m_registryLock);
+				auto found = m_registry.find(fd);
+				if (found == m_registry.end()) return;
+
+				reg = found->second.get();
+				reg->dispatching = true;
+				reg->dispatcher = std::this_thread::get_id();
+			}
+
+			if (events & EPOLLIN)
+			{
+				reg->device->handle_data();
+			}
+
+			std::lock_guard<std::mutex> lock(m_registryLock);
+			reg->dispatching = false;
+
+			if (reg->detached)
+			{
+				m_registry.erase(fd);
+			}
+			else if (!(events & (EPOLLHUP | EPOLLERR)))
+			{
+				//	a hung up line stays disarmed rather than spinning the pool;
+				//		a tty raises EPOLLIN along with the hangup, so it is not
+				//		a sign of data
+				epoll_event dev_event = { 0 };
+				dev_event.events = EPOLLIN | EPOLLONESHOT;
+				dev_event.data.fd = fd;
+				epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &dev_event);
+			}
+			m_dispatchDone.notify_all();
+		}
+	}
+}
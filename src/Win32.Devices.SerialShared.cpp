@@ -0,0 +1,189 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialShared.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Publish data to every reader. Called from one thread only; never
+		 *		waits. Of more than a ring at once, only the newest ring's
+		 *		worth is kept.
+		 *
+		 *	\param[in] data The data.
+		 *	\param[in] len The length of the data.
+		 */
+		void SerialSharedPublisher::Publish(const void* data, size_t len)
+		{
+			if (!len || !m_header) return;
+
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			uint64_t head = m_header->head.load(std::memory_order_relaxed);
+			const uint64_t end = head + len;
+			if (len > Capacity())
+			{
+				bytes += len - Capacity();
+				head = end - Capacity();
+				len = Capacity();
+			}
+
+			//	announce the overwrite before making it
+			m_header->reserved.store(end, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			size_t offset = (size_t)head & m_mask;
+			size_t first = (std::min)(len, Capacity() - offset);
+			std::memcpy(m_data + offset, bytes, first);
+			std::memcpy(m_data, bytes + first, len - first);
+
+			m_header->head.store(end, std::memory_order_release);
+			wake();
+		}
+
+
+
+		/**********************************************************************
+		 *	Bytes published since the ring was created.
+		 */
+		uint64_t SerialSharedPublisher::Published() const
+		{
+			return m_header ? m_header->head.load(std::memory_order_acquire) : 0;
+		}
+
+
+
+		/**********************************************************************
+		 *	The data following the cursor, in place, up to the end of the
+		 *		ring. It holds until $Consume says otherwise.
+		 *
+		 *	\param[in] timeout How long to wait for data.
+		 *	\returns The data; empty on a timeout, or once the publisher has
+		 *		closed and everything has been read.
+		 */
+		std::string_view SerialSharedReader::Peek(std::chrono::milliseconds timeout)
+		{
+			if (!m_header || !await_data(timeout)) return std::string_view();
+			if (overtaken()) overflow();
+
+			const uint64_t head = m_header->head.load(std::memory_order_acquire);
+			if ((int64_t)(head - m_cursor) <= 0) return std::string_view();
+
+			size_t offset = (size_t)m_cursor & m_mask;
+			size_t len = (size_t)(std::min)(head - m_cursor, (uint64_t)(Capacity() - offset));
+			return std::string_view((const char*)m_data + offset, len);
+		}
+
+
+
+		/**********************************************************************
+		 *	Move the cursor past data returned by $Peek, and check the
+		 *		publisher did not overwrite it meanwhile.
+		 *
+		 *	\param[in] len The bytes used, at most those peeked.
+		 *	\returns Whether the data held; if not, the cursor has skipped
+		 *		ahead and the data is counted as dropped.
+		 */
+		bool SerialSharedReader::Consume(size_t len)
+		{
+			if (!m_header) return false;
+
+			//	overwritten while in use
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (overtaken())
+			{
+				overflow();
+				return false;
+			}
+
+			m_cursor += len;
+			m_delivered += len;
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Copy data out of the ring.
+		 *
+		 *	\param[out] dest Where to copy to.
+		 *	\param[in] len The most bytes to copy.
+		 *	\param[in] timeout How long to wait for data.
+		 *	\returns The bytes copied, 0 on a timeout.
+		 */
+		size_t SerialSharedReader::Read(void* dest, size_t len, std::chrono::milliseconds timeout)
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (len)
+			{
+				auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+				std::string_view view = Peek((std::max)(remaining, std::chrono::milliseconds(0)));
+				if (view.empty()) return 0;
+
+				size_t copied = (std::min)(len, view.size());
+				std::memcpy(dest, view.data(), copied);
+				if (Consume(copied)) return copied;
+			}
+			return 0;
+		}
+
+
+
+		/**********************************************************************
+		 *	Bytes published past the cursor, at most a ring.
+		 */
+		size_t SerialSharedReader::Available() const
+		{
+			if (!m_header) return 0;
+
+			const int64_t ahead = (int64_t)(m_header->head.load(std::memory_order_acquire) - m_cursor);
+			return (size_t)(std::min)((uint64_t)(std::max)(ahead, (int64_t)0), (uint64_t)Capacity());
+		}
+
+
+
+		/**********************************************************************
+		 *	The counters of this reader; $connected tells whether the
+		 *		publisher is still open.
+		 */
+		SerialSubscriberStats SerialSharedReader::Stats() const
+		{
+			SerialSubscriberStats stats;
+			stats.delivered = m_delivered;
+			stats.dropped = m_dropped;
+			stats.overflows = m_overflows;
+			stats.connected = m_header && m_header->open.load(std::memory_order_acquire);
+			return stats;
+		}
+
+
+
+		/**********************************************************************
+		 *	Whether the publisher has reserved past a ring beyond the cursor.
+		 */
+		bool SerialSharedReader::overtaken() const
+		{
+			return m_header->reserved.load(std::memory_order_relaxed) - m_cursor > Capacity();
+		}
+
+
+
+		/**********************************************************************
+		 *	Skip ahead of the publisher, keeping the newest half of the ring.
+		 */
+		void SerialSharedReader::overflow()
+		{
+			const uint64_t resume = m_header->reserved.load(std::memory_order_acquire) - Capacity() / 2;
+			m_overflows++;
+			m_dropped += resume - m_cursor;
+			m_cursor = resume;
+		}
+	}
+}
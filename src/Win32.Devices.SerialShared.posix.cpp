@@ -0,0 +1,253 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialShared.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif // __linux__
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	A name as shm_open wants it, with one leading slash.
+		static std::string shm_name(const std::string& name)
+		{
+			return (!name.empty() && name[0] == '/') ? name : "/" + name;
+		}
+
+
+
+		///	Rounds a ring capacity up to a power of two, at least a page.
+		static size_t ring_size(size_t capacity)
+		{
+			size_t pow2 = 0x1000;
+			while (pow2 < capacity) pow2 <<= 1;
+			return pow2;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create the shared ring, replacing any ring of the same name.
+		 *
+		 *	\param[in] name The name readers attach by.
+		 *	\param[in] capacity Bytes a reader may fall behind before it
+		 *		overflows; rounded up to a power of two.
+		 */
+		SerialSharedPublisher::SerialSharedPublisher(const std::string& name, size_t capacity)
+			: m_name(shm_name(name))
+		{
+			//	a ring left behind by a publisher that crashed
+			shm_unlink(m_name.c_str());
+
+			m_file = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+			if (m_file < 0)
+			{
+				throw std::runtime_error("No shared ring");
+			}
+
+			if (!map(ring_size(capacity)))
+			{
+				close(m_file);
+				m_file = -1;
+				shm_unlink(m_name.c_str());
+				throw std::runtime_error("No shared ring mapping");
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Tell the readers the ring is closed and remove its name. Readers
+		 *		attached keep their mapping, and read what is left.
+		 */
+		SerialSharedPublisher::~SerialSharedPublisher()
+		{
+			if (m_header)
+			{
+				m_header->open.store(0, std::memory_order_release);
+				wake();
+			}
+			unmap();
+
+			if (m_file >= 0)
+			{
+				close(m_file);
+				shm_unlink(m_name.c_str());
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Size the shared memory and map it, writing the header last.
+		 *
+		 *	\param[in] capacity Bytes of data.
+		 *	\returns Whether the ring is mapped.
+		 */
+		bool SerialSharedPublisher::map(size_t capacity)
+		{
+			const size_t size = sizeof(SerialSharedHeader) + capacity;
+			if (ftruncate(m_file, (off_t)size) != 0) return false;
+
+			void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+			if (base == MAP_FAILED) return false;
+
+			m_header = new (base) SerialSharedHeader();
+			m_data = static_cast<uint8_t*>(base) + sizeof(SerialSharedHeader);
+			m_mask = capacity - 1;
+
+			m_header->capacity = capacity;
+			m_header->open.store(1, std::memory_order_relaxed);
+			std::memcpy(m_header->magic, SerialSharedMagic, sizeof(SerialSharedMagic));
+			std::atomic_thread_fence(std::memory_order_release);
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the mapping.
+		 */
+		void SerialSharedPublisher::unmap()
+		{
+			if (m_header) munmap(m_header, sizeof(SerialSharedHeader) + Capacity());
+			m_header = nullptr;
+			m_data = nullptr;
+		}
+
+
+
+		/**********************************************************************
+		 *	Wake the readers sleeping on the ring. One system call, which
+		 *		never blocks; a read-only reader cannot say whether it sleeps.
+		 */
+		void SerialSharedPublisher::wake()
+		{
+			m_header->signal.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+			syscall(SYS_futex, &m_header->signal, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif // __linux__
+		}
+
+
+
+		/**********************************************************************
+		 *	Attach to a shared ring, read-only, from its newest data on.
+		 *
+		 *	\param[in] name The name the publisher created it by.
+		 */
+		SerialSharedReader::SerialSharedReader(const std::string& name)
+		{
+			m_file = shm_open(shm_name(name).c_str(), O_RDONLY | O_CLOEXEC, 0);
+			if (m_file < 0)
+			{
+				throw std::runtime_error("No shared ring");
+			}
+
+			struct stat status = { 0 };
+			void* base = MAP_FAILED;
+			if (fstat(m_file, &status) == 0 && (size_t)status.st_size > sizeof(SerialSharedHeader))
+			{
+				base = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+			}
+			if (base == MAP_FAILED)
+			{
+				close(m_file);
+				m_file = -1;
+				throw std::runtime_error("No shared ring mapping");
+			}
+
+			m_header = static_cast<const SerialSharedHeader*>(base);
+			m_data = static_cast<const uint8_t*>(base) + sizeof(SerialSharedHeader);
+			m_mapped = (size_t)status.st_size;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t capacity = m_header->capacity;
+			if (std::memcmp(m_header->magic, SerialSharedMagic, sizeof(SerialSharedMagic)) != 0
+				|| !capacity || (capacity & (capacity - 1)) || sizeof(SerialSharedHeader) + capacity > m_mapped)
+			{
+				unmap();
+				throw std::runtime_error("Not a shared ring");
+			}
+
+			m_mask = (size_t)capacity - 1;
+			m_cursor = m_header->head.load(std::memory_order_acquire);
+		}
+
+
+
+		/**********************************************************************
+		 *	Detach from the ring.
+		 */
+		SerialSharedReader::~SerialSharedReader()
+		{
+			unmap();
+		}
+
+
+
+		/**********************************************************************
+		 *	Sleep until data is published past the cursor.
+		 *
+		 *	\param[in] timeout How long to wait.
+		 *	\returns False on a timeout, or once the publisher has closed
+		 *		with nothing left to read.
+		 */
+		bool SerialSharedReader::await_data(std::chrono::milliseconds timeout)
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			for (;;)
+			{
+				//	a publish after this load fails the wait at once
+				const uint32_t signal = m_header->signal.load(std::memory_order_acquire);
+				if (m_header->head.load(std::memory_order_acquire) != m_cursor) return true;
+				if (!m_header->open.load(std::memory_order_acquire)) return false;
+
+				auto now = std::chrono::steady_clock::now();
+				if (now >= deadline) return false;
+
+				auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+#ifdef __linux__
+				timespec wait = { (time_t)(remaining.count() / 1000000000), (long)(remaining.count() % 1000000000) };
+				syscall(SYS_futex, &m_header->signal, FUTEX_WAIT, signal, &wait, nullptr, 0);
+#else
+				(void)signal;
+				std::this_thread::sleep_for((std::min)(remaining, std::chrono::nanoseconds(std::chrono::milliseconds(1))));
+#endif // __linux__
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the mapping.
+		 */
+		void SerialSharedReader::unmap()
+		{
+			if (m_header) munmap(const_cast<SerialSharedHeader*>(m_header), m_mapped);
+			m_header = nullptr;
+			m_data = nullptr;
+
+			if (m_file >= 0) close(m_file);
+			m_file = -1;
+		}
+	}
+}
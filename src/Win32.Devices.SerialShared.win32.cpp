@@ -0,0 +1,209 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialShared.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <new>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Rounds a ring capacity up to a power of two, at least a page.
+		static size_t ring_size(size_t capacity)
+		{
+			size_t pow2 = 0x1000;
+			while (pow2 < capacity) pow2 <<= 1;
+			return pow2;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create the shared ring, backed by the paging file.
+		 *
+		 *	\param[in] name The name readers attach by, i.e. "Local\\com3".
+		 *	\param[in] capacity Bytes a reader may fall behind before it
+		 *		overflows; rounded up to a power of two.
+		 */
+		SerialSharedPublisher::SerialSharedPublisher(const std::string& name, size_t capacity)
+			: m_name(name)
+		{
+			if (!map(ring_size(capacity)))
+			{
+				throw std::exception("No shared ring mapping");
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Tell the readers the ring is closed. Readers attached keep the
+		 *		mapping alive, and read what is left.
+		 */
+		SerialSharedPublisher::~SerialSharedPublisher()
+		{
+			if (m_header)
+			{
+				m_header->open.store(0, std::memory_order_release);
+				wake();
+			}
+			unmap();
+		}
+
+
+
+		/**********************************************************************
+		 *	Create the named mapping and map it, writing the header last. A
+		 *		name still in use by another publisher is refused.
+		 *
+		 *	\param[in] capacity Bytes of data.
+		 *	\returns Whether the ring is mapped.
+		 */
+		bool SerialSharedPublisher::map(size_t capacity)
+		{
+			const uint64_t size = sizeof(SerialSharedHeader) + capacity;
+			m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+				(DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), m_name.c_str());
+			if (!m_mapping) return false;
+			if (GetLastError() == ERROR_ALREADY_EXISTS)
+			{
+				std::cerr << "Serial Error: Shared ring already published!" << std::endl;
+				CloseHandle(m_mapping);
+				m_mapping = nullptr;
+				return false;
+			}
+
+			void* base = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, (size_t)size);
+			if (!base)
+			{
+				CloseHandle(m_mapping);
+				m_mapping = nullptr;
+				return false;
+			}
+
+			m_header = new (base) SerialSharedHeader();
+			m_data = static_cast<uint8_t*>(base) + sizeof(SerialSharedHeader);
+			m_mask = capacity - 1;
+
+			m_header->capacity = capacity;
+			m_header->open.store(1, std::memory_order_relaxed);
+			std::memcpy(m_header->magic, SerialSharedMagic, sizeof(SerialSharedMagic));
+			std::atomic_thread_fence(std::memory_order_release);
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the mapping.
+		 */
+		void SerialSharedPublisher::unmap()
+		{
+			if (m_header) UnmapViewOfFile(m_header);
+			m_header = nullptr;
+			m_data = nullptr;
+
+			if (m_mapping) CloseHandle(m_mapping);
+			m_mapping = nullptr;
+		}
+
+
+
+		/**********************************************************************
+		 *	Bump the ring's signal. Readers poll it; nothing waits here.
+		 */
+		void SerialSharedPublisher::wake()
+		{
+			m_header->signal.fetch_add(1, std::memory_order_release);
+		}
+
+
+
+		/**********************************************************************
+		 *	Attach to a shared ring, read-only, from its newest data on.
+		 *
+		 *	\param[in] name The name the publisher created it by.
+		 */
+		SerialSharedReader::SerialSharedReader(const std::string& name)
+		{
+			m_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+			const void* base = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (!base)
+			{
+				unmap();
+				throw std::exception("No shared ring mapping");
+			}
+
+			m_header = static_cast<const SerialSharedHeader*>(base);
+			m_data = static_cast<const uint8_t*>(base) + sizeof(SerialSharedHeader);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t capacity = m_header->capacity;
+			if (std::memcmp(m_header->magic, SerialSharedMagic, sizeof(SerialSharedMagic)) != 0
+				|| !capacity || (capacity & (capacity - 1)))
+			{
+				unmap();
+				throw std::exception("Not a shared ring");
+			}
+
+			m_mapped = sizeof(SerialSharedHeader) + (size_t)capacity;
+			m_mask = (size_t)capacity - 1;
+			m_cursor = m_header->head.load(std::memory_order_acquire);
+		}
+
+
+
+		/**********************************************************************
+		 *	Detach from the ring.
+		 */
+		SerialSharedReader::~SerialSharedReader()
+		{
+			unmap();
+		}
+
+
+
+		/**********************************************************************
+		 *	Poll until data is published past the cursor. A read-only
+		 *		reader has no way to be woken across processes.
+		 *
+		 *	\param[in] timeout How long to wait.
+		 *	\returns False on a timeout, or once the publisher has closed
+		 *		with nothing left to read.
+		 */
+		bool SerialSharedReader::await_data(std::chrono::milliseconds timeout)
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			for (;;)
+			{
+				if (m_header->head.load(std::memory_order_acquire) != m_cursor) return true;
+				if (!m_header->open.load(std::memory_order_acquire)) return false;
+				if (std::chrono::steady_clock::now() >= deadline) return false;
+
+				Sleep(1);
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the mapping.
+		 */
+		void SerialSharedReader::unmap()
+		{
+			if (m_header) UnmapViewOfFile(m_header);
+			m_header = nullptr;
+			m_data = nullptr;
+
+			if (m_mapping) CloseHandle(m_mapping);
+			m_mapping = nullptr;
+		}
+	}
+}
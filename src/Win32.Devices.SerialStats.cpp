@@ -0,0 +1,126 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialStats.hpp"
+
+#include <cmath>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Index of the highest set bit of a non-zero value.
+		static unsigned highest_bit(uint64_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return (unsigned)index;
+#else
+			return 63u - (unsigned)__builtin_clzll(value);
+#endif // _MSC_VER
+		}
+
+
+
+		/**********************************************************************
+		 *	The bucket holding a value.
+		 */
+		size_t SerialHistogram::bucket_of(uint64_t value)
+		{
+			if (value < SubBuckets) return (size_t)value;
+
+			unsigned magnitude = highest_bit(value);
+			size_t sub = (size_t)(value >> (magnitude - SubBucketBits)) & (SubBuckets - 1);
+			return SubBuckets + (magnitude - SubBucketBits) * SubBuckets + sub;
+		}
+
+
+
+		/**********************************************************************
+		 *	The largest value a bucket holds.
+		 */
+		uint64_t SerialHistogram::upper_bound(size_t bucket)
+		{
+			if (bucket < SubBuckets) return (uint64_t)bucket;
+
+			unsigned magnitude = SubBucketBits + (unsigned)((bucket - SubBuckets) / SubBuckets);
+			uint64_t sub = (uint64_t)((bucket - SubBuckets) % SubBuckets);
+			uint64_t width = (uint64_t)1 << (magnitude - SubBucketBits);
+			return ((uint64_t)1 << magnitude) + sub * width + (width - 1);
+		}
+
+
+
+		/**********************************************************************
+		 *	Copy the counts. Safe while other threads record.
+		 */
+		SerialHistogram::Snapshot SerialHistogram::Read() const
+		{
+			Snapshot snapshot;
+			snapshot.counts.resize(Buckets);
+			for (size_t i = 0; i < Buckets; i++)
+			{
+				snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+			}
+			return snapshot;
+		}
+
+
+
+		/**********************************************************************
+		 *	The number of values recorded.
+		 */
+		uint64_t SerialHistogram::Snapshot::Count() const
+		{
+			uint64_t total = 0;
+			for (uint64_t count : counts) total += count;
+			return total;
+		}
+
+
+
+		/**********************************************************************
+		 *	The value below which a percentage of the recorded values fall.
+		 *
+		 *	\param[in] percentile The percentage, i.e. 99.0.
+		 *	\returns The bucket's upper bound, in nanoseconds; 0 when empty.
+		 */
+		uint64_t SerialHistogram::Snapshot::Percentile(double percentile) const
+		{
+			uint64_t total = Count();
+			if (!total) return 0;
+
+			uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * (double)total);
+			if (rank < 1) rank = 1;
+
+			uint64_t seen = 0;
+			for (size_t i = 0; i < counts.size(); i++)
+			{
+				seen += counts[i];
+				if (seen >= rank) return upper_bound(i);
+			}
+			return Max();
+		}
+
+
+
+		/**********************************************************************
+		 *	The largest value recorded, to the histogram's precision.
+		 */
+		uint64_t SerialHistogram::Snapshot::Max() const
+		{
+			for (size_t i = counts.size(); i > 0; i--)
+			{
+				if (counts[i - 1]) return upper_bound(i - 1);
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,170 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialStream.hpp"
+
+#include <algorithm>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Create a stream buffer over a device.
+		 *
+		 *	\param[in] device The device read and written.
+		 *	\param[in] getSize The most bytes taken by one refill.
+		 *	\param[in] putSize The bytes held before a write.
+		 */
+		SerialStreamBuf::SerialStreamBuf(SerialDevice& device, size_t getSize, size_t putSize)
+			: m_device(device)
+			, m_get(device.Memory())
+			, m_put(device.Memory())
+			, m_getSize((std::max)(getSize, (size_t)1))
+			, m_putSize((std::max)(putSize, (size_t)1))
+		{
+			char* get = reinterpret_cast<char*>(m_get.Reserve(m_getSize));
+			setg(get, get, get);
+
+			char* put = reinterpret_cast<char*>(m_put.Reserve(m_putSize));
+			setp(put, put + m_putSize);
+		}
+
+
+
+		/**********************************************************************
+		 *	Write what is left in the put area.
+		 */
+		SerialStreamBuf::~SerialStreamBuf()
+		{
+			flush_put();
+		}
+
+
+
+		/**********************************************************************
+		 *	Refill the get area with one read of the device.
+		 *
+		 *	\returns The next character, or eof if none arrived within
+		 *		$m_timeout.
+		 */
+		SerialStreamBuf::int_type SerialStreamBuf::underflow()
+		{
+			if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+			//	written requests are sent before their replies are awaited
+			if (!flush_put()) return traits_type::eof();
+
+			char* get = eback();
+			size_t got = m_device.ReadSome(get, m_getSize, m_timeout);
+			m_timedOut = (got == 0);
+			if (!got) return traits_type::eof();
+
+			setg(get, get, get + got);
+			return traits_type::to_int_type(*gptr());
+		}
+
+
+
+		/**********************************************************************
+		 *	Write the full put area, then take $ch.
+		 *
+		 *	\param[in] ch The character that did not fit, or eof.
+		 *	\returns Anything but eof, or eof if the device took less.
+		 */
+		SerialStreamBuf::int_type SerialStreamBuf::overflow(int_type ch)
+		{
+			if (!flush_put()) return traits_type::eof();
+			if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+			return ch;
+		}
+
+
+
+		/**********************************************************************
+		 *	Put characters, writing any that do not fit the put area straight
+		 *		to the device rather than through it.
+		 *
+		 *	\param[in] src The characters.
+		 *	\param[in] count The number of characters.
+		 *	\returns The number of characters taken.
+		 */
+		std::streamsize SerialStreamBuf::xsputn(const char_type* src, std::streamsize count)
+		{
+			if (count < epptr() - pptr())
+			{
+				std::copy(src, src + count, pptr());
+				pbump((int)count);
+				return count;
+			}
+
+			//	one gathered write of what is held and the new characters
+			size_t held = (size_t)(pptr() - pbase());
+			size_t written = m_device.Write({ SerialBuffer(pbase(), held), SerialBuffer(src, (size_t)count) });
+			setp(pbase(), epptr());
+			if (written < held) return 0;
+			return (std::streamsize)(written - held);
+		}
+
+
+
+		/**********************************************************************
+		 *	Gets how many characters a read may take without waiting.
+		 */
+		std::streamsize SerialStreamBuf::showmanyc()
+		{
+			return (std::streamsize)m_device.Available();
+		}
+
+
+
+		/**********************************************************************
+		 *	Write the put area to the device.
+		 *
+		 *	\returns 0 once the device took it all, -1 otherwise.
+		 */
+		int SerialStreamBuf::sync()
+		{
+			return flush_put() ? 0 : -1;
+		}
+
+
+
+		/**********************************************************************
+		 *	Write and empty the put area.
+		 *
+		 *	\returns Whether the device took every held character.
+		 */
+		bool SerialStreamBuf::flush_put()
+		{
+			size_t held = (size_t)(pptr() - pbase());
+			if (!held) return true;
+
+			SerialBuffer buffer(pbase(), held);
+			size_t written = m_device.Write(&buffer, 1);
+			setp(pbase(), epptr());
+			return written == held;
+		}
+
+
+
+		/**********************************************************************
+		 *	Create a stream over a device.
+		 *
+		 *	\param[in] device The device read and written.
+		 *	\param[in] getSize The most bytes taken by one refill.
+		 *	\param[in] putSize The bytes held before a write.
+		 */
+		SerialStream::SerialStream(SerialDevice& device, size_t getSize, size_t putSize)
+			: std::iostream(nullptr)
+			, m_buffer(device, getSize, putSize)
+		{
+			std::iostream::rdbuf(&m_buffer);
+		}
+	}
+}
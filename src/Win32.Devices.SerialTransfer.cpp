@@ -0,0 +1,496 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialTransfer.hpp"
+#include "Win32.Devices.SerialCrc.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		///	Bytes of file data in a full and a short block.
+		constexpr size_t XmodemBlock = 1024;
+		constexpr size_t XmodemShortBlock = 128;
+
+		///	Pads the last block of a file.
+		static const std::string sub_padding(XmodemBlock, (char)Xmodem::SUB);
+
+
+
+		/**********************************************************************
+		 *	Prepare to send over a device.
+		 *
+		 *	\param[in] device The port; it must outlive the transfer.
+		 *	\param[in] options The protocol, window and timeouts.
+		 */
+		SerialTransfer::SerialTransfer(SerialDevice& device, const SerialTransferOptions& options)
+			: m_device(device), m_options(options)
+		{
+			m_options.window = (std::max)((size_t)1, (std::min)(m_options.window, (size_t)127));
+		}
+
+
+
+		/**********************************************************************
+		 *	Send a file, read through a mapping of it. YMODEM names it by
+		 *		the last part of its path.
+		 *
+		 *	\param[in] path The file.
+		 *	\returns How far the transfer got, and why it stopped short.
+		 */
+		SerialTransferResult SerialTransfer::SendFile(const std::string& path)
+		{
+			SerialMappedFile file(path);
+
+			size_t slash = path.find_last_of("/\\");
+			return Send(file.Data(), file.Size(), (slash == std::string::npos) ? path : path.substr(slash + 1));
+		}
+
+
+
+		/**********************************************************************
+		 *	Send a file in memory. Waits for the receiver to start the
+		 *		transfer, then sends every block and the end of the file.
+		 *
+		 *	\param[in] data The file, kept valid until the call returns.
+		 *	\param[in] len The size of the file.
+		 *	\param[in] name The file's name, sent by YMODEM.
+		 *	\returns How far the transfer got, and why it stopped short.
+		 */
+		SerialTransferResult SerialTransfer::Send(const void* data, size_t len, const std::string& name)
+		{
+			m_data = static_cast<const uint8_t*>(data);
+			m_length = len;
+			m_windowed = false;
+
+			const SerialSettings& settings = m_device.Settings();
+			m_progress = SerialTransferProgress();
+			m_progress.total = len;
+			m_progress.lineRate = (double)settings.baudRate / (double)settings.CharacterBits();
+
+			SerialTransferResult result;
+			bool sent = await_start(result.error);
+			m_started = std::chrono::steady_clock::now();
+
+			if (sent && m_options.protocol == SerialTransferProtocol::Ymodem)
+			{
+				sent = send_header(name, len, result.error);
+			}
+			if (sent)
+			{
+				sent = m_windowed ? send_windowed(result.error) : send_stop_and_wait(result.error);
+			}
+			if (sent)
+			{
+				send_end(result.error);
+			}
+
+			m_progress.elapsed = std::chrono::steady_clock::now() - m_started;
+			result.progress = m_progress;
+			return result;
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait for the receiver to ask for the first block. A receiver
+		 *		asking for a windowed transfer gets one if the options allow;
+		 *		a Windowed transfer otherwise falls back to stop-and-wait.
+		 *
+		 *	\param[out] error Why the transfer cannot start.
+		 *	\returns Whether the receiver is ready.
+		 */
+		bool SerialTransfer::await_start(std::string& error)
+		{
+			auto deadline = std::chrono::steady_clock::now() + m_options.startTimeout;
+			while (true)
+			{
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+				int number;
+				int response = await_response((std::max)(left, std::chrono::milliseconds(0)), number);
+
+				switch (response)
+				{
+				case Xmodem::CRC:
+					purge();
+					return true;
+
+				case Xmodem::WINDOW:
+					if (m_options.protocol != SerialTransferProtocol::Windowed) continue;
+					m_windowed = true;
+					purge();
+					return true;
+
+				case Xmodem::NAK:
+					cancel();
+					error = "Receiver wants checksums rather than CRC-16";
+					return false;
+
+				case Xmodem::CAN:
+					error = "Cancelled by the receiver";
+					return false;
+
+				case -1:
+					error = "Receiver did not start";
+					return false;
+
+				default:
+					continue;
+				}
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Send YMODEM's block 0: the file's name and size. The receiver
+		 *		acknowledges it, then asks for the data as it did for the
+		 *		header.
+		 *
+		 *	\param[in] name The file's name.
+		 *	\param[in] len The file's size.
+		 *	\param[out] error Why the header was refused.
+		 *	\returns Whether the receiver is ready for the data.
+		 */
+		bool SerialTransfer::send_header(const std::string& name, size_t len, std::string& error)
+		{
+			std::string header = name;
+			header += '\0';
+			header += std::to_string(len);
+			if (header.size() > XmodemBlock)
+			{
+				error = "File name too long";
+				return false;
+			}
+			header.resize((header.size() <= XmodemShortBlock) ? XmodemShortBlock : XmodemBlock, '\0');
+
+			for (uint32_t attempt = 0; attempt <= m_options.retries; attempt++)
+			{
+				write_block(0, (const uint8_t*)header.data(), header.size(), header.size());
+
+				int number;
+				int response = await_response(m_options.blockTimeout, number);
+				if (response == Xmodem::ACK)
+				{
+					return await_start(error);
+				}
+				if (response == Xmodem::CAN)
+				{
+					error = "Cancelled by the receiver";
+					return false;
+				}
+			}
+
+			cancel();
+			error = "File header not acknowledged";
+			return false;
+		}
+
+
+
+		/**********************************************************************
+		 *	Send the blocks one at a time, each once the previous one is
+		 *		acknowledged.
+		 *
+		 *	\param[out] error Why a block was not delivered.
+		 *	\returns Whether every block was acknowledged.
+		 */
+		bool SerialTransfer::send_stop_and_wait(std::string& error)
+		{
+			const size_t count = block_count();
+			for (size_t index = 0; index < count; index++)
+			{
+				uint32_t attempt = 0;
+				while (true)
+				{
+					write_block(index);
+
+					int number;
+					int response = await_response(m_options.blockTimeout, number);
+					if (response == Xmodem::ACK)
+					{
+						acknowledged(index);
+						break;
+					}
+					if (response == Xmodem::CAN)
+					{
+						error = "Cancelled by the receiver";
+						return false;
+					}
+
+					//	refused, lost, or the receiver still asking to start
+					m_progress.retries++;
+					if (++attempt > m_options.retries)
+					{
+						cancel();
+						error = "Block " + std::to_string(index + 1) + " not acknowledged";
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Send the blocks up to a window ahead of the last acknowledged.
+		 *		Acknowledgements carry the block number and cover every block
+		 *		before it; a refusal, or silence, sends again from the block
+		 *		refused, or the oldest outstanding.
+		 *
+		 *	\param[out] error Why a block was not delivered.
+		 *	\returns Whether every block was acknowledged.
+		 */
+		bool SerialTransfer::send_windowed(std::string& error)
+		{
+			const size_t count = block_count();
+			size_t base = 0;
+			size_t next = 0;
+			uint32_t attempt = 0;
+
+			while (base < count)
+			{
+				while (next < count && next - base < m_options.window)
+				{
+					write_block(next++);
+				}
+
+				int number;
+				int response = await_response(m_options.blockTimeout, number);
+				if (response == Xmodem::CAN)
+				{
+					error = "Cancelled by the receiver";
+					return false;
+				}
+
+				//	the outstanding block a number refers to
+				size_t index = base;
+				while (index < next && (int)((index + 1) & 0xFF) != number) index++;
+
+				if (response == Xmodem::ACK && index < next)
+				{
+					while (base <= index) acknowledged(base++);
+					attempt = 0;
+					continue;
+				}
+				if (response == Xmodem::ACK)
+				{
+					//	a repeated acknowledgement
+					continue;
+				}
+				if (response == Xmodem::NAK && index == next)
+				{
+					continue;
+				}
+
+				//	go back to the refused block, or resend the window
+				if (response != Xmodem::NAK) index = base;
+				m_progress.retries += (uint32_t)(next - index);
+				next = index;
+				if (++attempt > m_options.retries)
+				{
+					cancel();
+					error = "Block " + std::to_string(base + 1) + " not acknowledged";
+					return false;
+				}
+			}
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	End the file, and with YMODEM the batch. A YMODEM receiver
+		 *		refuses the first EOT to be sure of it.
+		 *
+		 *	\param[out] error Why the end was not acknowledged.
+		 *	\returns Whether the receiver acknowledged the end.
+		 */
+		bool SerialTransfer::send_end(std::string& error)
+		{
+			const uint8_t eot = Xmodem::EOT;
+			bool ended = false;
+			for (uint32_t attempt = 0; !ended && attempt <= m_options.retries + 1; attempt++)
+			{
+				m_device.Write({ SerialBuffer(&eot, 1) });
+
+				int number;
+				int response = await_response(m_options.blockTimeout, number);
+				if (response == Xmodem::CAN)
+				{
+					error = "Cancelled by the receiver";
+					return false;
+				}
+				ended = (response == Xmodem::ACK);
+			}
+			if (!ended)
+			{
+				error = "End of file not acknowledged";
+				return false;
+			}
+			if (m_options.protocol != SerialTransferProtocol::Ymodem) return true;
+
+			//	an empty header ends the batch
+			const std::string last(XmodemShortBlock, '\0');
+			int number;
+			if (await_response(m_options.blockTimeout, number) != Xmodem::CRC)
+			{
+				error = "Receiver did not ask for the end of the batch";
+				return false;
+			}
+			for (uint32_t attempt = 0; attempt <= m_options.retries; attempt++)
+			{
+				write_block(0, (const uint8_t*)last.data(), last.size(), last.size());
+				if (await_response(m_options.blockTimeout, number) == Xmodem::ACK) return true;
+			}
+			error = "End of batch not acknowledged";
+			return false;
+		}
+
+
+
+		/**********************************************************************
+		 *	The number of data blocks in the file.
+		 */
+		size_t SerialTransfer::block_count() const
+		{
+			return (m_length + XmodemBlock - 1) / XmodemBlock;
+		}
+
+
+
+		/**********************************************************************
+		 *	Write a data block of the file. Every block but the last holds
+		 *		1024 bytes; the last is padded to 1024, or to 128 if it fits.
+		 *
+		 *	\param[in] index The block, from 0.
+		 */
+		void SerialTransfer::write_block(size_t index)
+		{
+			size_t offset = index * XmodemBlock;
+			size_t len = (std::min)(XmodemBlock, m_length - offset);
+			size_t size = (len <= XmodemShortBlock) ? XmodemShortBlock : XmodemBlock;
+			write_block((uint8_t)(index + 1), m_data + offset, len, size);
+		}
+
+
+
+		/**********************************************************************
+		 *	Write a block as one gathered write: header, data straight from
+		 *		the source, padding, then the CRC over data and padding.
+		 *
+		 *	\param[in] number The block number.
+		 *	\param[in] data The data.
+		 *	\param[in] len The bytes of data.
+		 *	\param[in] size The size of the block, 128 or 1024.
+		 */
+		void SerialTransfer::write_block(uint8_t number, const uint8_t* data, size_t len, size_t size)
+		{
+			const uint8_t header[3] = { (size == XmodemShortBlock) ? Xmodem::SOH : Xmodem::STX, number, (uint8_t)~number };
+
+			uint16_t crc = Crc16Xmodem(data, len);
+			crc = Crc16Xmodem(sub_padding.data(), size - len, crc);
+			const uint8_t trailer[2] = { (uint8_t)(crc >> 8), (uint8_t)crc };
+
+			m_device.Write({ header, SerialBuffer(data, len), SerialBuffer(sub_padding.data(), size - len), trailer });
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait for the receiver to respond. Bytes that mean nothing to the
+		 *		sender, i.e. line noise, are skipped.
+		 *
+		 *	\param[in] timeout How long to wait.
+		 *	\param[out] number The block number following ACK or NAK in a
+		 *		windowed transfer, otherwise -1.
+		 *	\returns ACK, NAK, CAN for two in a row, 'C' or 'W', or -1 on
+		 *		timeout.
+		 */
+		int SerialTransfer::await_response(std::chrono::milliseconds timeout, int& number)
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			number = -1;
+
+			while (true)
+			{
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+				uint8_t response;
+				if (left.count() < 0 || !m_device.ReadSome(&response, 1, left)) return -1;
+
+				switch (response)
+				{
+				case Xmodem::ACK:
+				case Xmodem::NAK:
+					if (m_windowed)
+					{
+						uint8_t block;
+						if (!m_device.ReadSome(&block, 1, m_options.blockTimeout)) return -1;
+						number = block;
+					}
+					return response;
+
+				case Xmodem::CAN:
+				{
+					uint8_t again;
+					if (m_device.ReadSome(&again, 1, std::chrono::milliseconds(1000)) && again == Xmodem::CAN) return Xmodem::CAN;
+					continue;
+				}
+
+				case Xmodem::CRC:
+				case Xmodem::WINDOW:
+					return response;
+
+				default:
+					continue;
+				}
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Discard what has been received, i.e. the receiver repeating its
+		 *		request to start, so it is not taken for a response.
+		 */
+		void SerialTransfer::purge()
+		{
+			uint8_t stale[64];
+			while (m_device.ReadSome(stale, sizeof(stale), std::chrono::milliseconds(0)))
+			{
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Count an acknowledged block and raise $Progress.
+		 *
+		 *	\param[in] index The block, from 0.
+		 */
+		void SerialTransfer::acknowledged(size_t index)
+		{
+			m_progress.blocks++;
+			m_progress.bytes += (std::min)(XmodemBlock, m_length - index * XmodemBlock);
+			m_progress.elapsed = std::chrono::steady_clock::now() - m_started;
+			Progress(m_progress);
+		}
+
+
+
+		/**********************************************************************
+		 *	Tell the receiver the transfer is abandoned.
+		 */
+		void SerialTransfer::cancel()
+		{
+			const uint8_t cans[2] = { Xmodem::CAN, Xmodem::CAN };
+			m_device.Write({ SerialBuffer(cans, sizeof(cans)) });
+		}
+	}
+}
@@ -0,0 +1,76 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialTransfer.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <stdexcept>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Map a file for reading. An empty file maps to nothing.
+		 *
+		 *	\param[in] path The file.
+		 */
+		SerialMappedFile::SerialMappedFile(const std::string& path)
+		{
+			m_file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (m_file < 0)
+			{
+				throw std::runtime_error("No such file");
+			}
+
+			struct stat status;
+			if (fstat(m_file, &status) != 0)
+			{
+				unmap();
+				throw std::runtime_error("File cannot be read");
+			}
+			if (status.st_size == 0) return;
+
+			void* base = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+			if (base == MAP_FAILED)
+			{
+				unmap();
+				throw std::runtime_error("No file mapping");
+			}
+			m_base = static_cast<const uint8_t*>(base);
+			m_size = (size_t)status.st_size;
+
+			//	blocks are read front to back, once
+			madvise(base, m_size, MADV_SEQUENTIAL);
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the file.
+		 */
+		SerialMappedFile::~SerialMappedFile()
+		{
+			unmap();
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the mapping and the file.
+		 */
+		void SerialMappedFile::unmap()
+		{
+			if (m_base) munmap(const_cast<uint8_t*>(m_base), m_size);
+			m_base = nullptr;
+			if (m_file >= 0) close(m_file);
+			m_file = -1;
+		}
+	}
+}
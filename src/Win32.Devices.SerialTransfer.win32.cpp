@@ -0,0 +1,72 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialTransfer.hpp"
+
+#include <exception>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Map a file for reading. An empty file maps to nothing.
+		 *
+		 *	\param[in] path The file.
+		 */
+		SerialMappedFile::SerialMappedFile(const std::string& path)
+		{
+			m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+				nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+			{
+				throw std::exception("No such file");
+			}
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_file, &size))
+			{
+				unmap();
+				throw std::exception("File cannot be read");
+			}
+			if (size.QuadPart == 0) return;
+
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			void* base = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (!base)
+			{
+				unmap();
+				throw std::exception("No file mapping");
+			}
+			m_base = static_cast<const uint8_t*>(base);
+			m_size = (size_t)size.QuadPart;
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the file.
+		 */
+		SerialMappedFile::~SerialMappedFile()
+		{
+			unmap();
+		}
+
+
+
+		/**********************************************************************
+		 *	Release the view, its mapping and the file.
+		 */
+		void SerialMappedFile::unmap()
+		{
+			if (m_base) UnmapViewOfFile(m_base);
+			if (m_mapping) CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+			m_base = nullptr;
+			m_mapping = nullptr;
+			m_file = INVALID_HANDLE_VALUE;
+		}
+	}
+}
@@ -0,0 +1,361 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#include "Win32.Devices.SerialTxQueue.hpp"
+
+#include <algorithm>
+#include <new>
+
+
+
+namespace Win32
+{
+	namespace Devices
+	{
+		/**********************************************************************
+		 *	Create the queue and start its writer.
+		 *
+		 *	\param[in] sink Writes a coalesced batch to the port.
+		 *	\param[in] depth The maximum number of buffers in flight.
+		 *	\param[in] memory Holds queued buffers and their futures.
+		 */
+		SerialTxQueue::SerialTxQueue(Sink sink, size_t depth, std::pmr::memory_resource* memory)
+			: m_sink(std::move(sink))
+			, m_depth((std::max)(depth, (size_t)1))
+			, m_memory(memory)
+		{
+			m_thWriter = std::thread(&SerialTxQueue::writer_thread, this);
+		}
+
+
+
+		/**********************************************************************
+		 *	Drain and stop the writer.
+		 */
+		SerialTxQueue::~SerialTxQueue()
+		{
+			Stop();
+			for (Lane& lane : m_lanes) lane.Clear(m_memory);
+		}
+
+
+
+		/**********************************************************************
+		 *	Queue a whole frame for transmission, blocking while the queue is
+		 *		full. Safe to call from any number of threads.
+		 *
+		 *	\param[in] data The bytes to write, copied into the queue.
+		 *	\param[in] priority High to go ahead of Normal buffers still queued.
+		 *	\returns A future holding the number of bytes written.
+		 */
+		std::future<size_t> SerialTxQueue::Push(SerialBuffer data, SerialTxPriority priority)
+		{
+			return push(&data, 1, priority);
+		}
+
+
+
+		/**********************************************************************
+		 *	Queue a frame built from several parts, joined as they are copied
+		 *		into the queue, so the frame still goes out whole.
+		 *
+		 *	\param[in] frame The parts, in order. i.e. { header, payload, crc }.
+		 *	\param[in] priority High to go ahead of Normal buffers still queued.
+		 *	\returns A future holding the number of bytes written.
+		 */
+		std::future<size_t> SerialTxQueue::Push(std::initializer_list<SerialBuffer> frame, SerialTxPriority priority)
+		{
+			return push(frame.begin(), frame.size(), priority);
+		}
+
+
+
+		/**********************************************************************
+		 *	Copy a frame into a node and link it in.
+		 *
+		 *	\param[in] parts The parts of the frame, in order.
+		 *	\param[in] count The number of parts.
+		 *	\param[in] priority The lane to link it into.
+		 *	\returns A future holding the number of bytes written.
+		 */
+		std::future<size_t> SerialTxQueue::push(const SerialBuffer* parts, size_t count, SerialTxPriority priority)
+		{
+			std::promise<size_t> done(std::allocator_arg, std::pmr::polymorphic_allocator<size_t>(m_memory));
+			std::future<size_t> result = done.get_future();
+
+			if (!reserve())
+			{
+				done.set_value(0);
+				return result;
+			}
+			if (!m_running.load())
+			{
+				//	stopped after reserving; the writer may be waiting on this
+				unreserve(1);
+				done.set_value(0);
+				return result;
+			}
+
+			size_t len = 0;
+			for (size_t i = 0; i < count; i++) len += parts[i].size;
+
+			SerialString data(m_memory);
+			data.reserve(len);
+			for (size_t i = 0; i < count; i++) data.append((const char*)parts[i].data, parts[i].size);
+
+			void* block = m_memory->allocate(sizeof(Node), alignof(Node));
+			Node* node = new (block) Node(std::move(data), std::move(done));
+			m_lanes[(size_t)priority].Push(node);
+
+			wake_writer();
+			return result;
+		}
+
+
+
+		/**********************************************************************
+		 *	Wait until every queued buffer has been written.
+		 */
+		void SerialTxQueue::Flush()
+		{
+			if (m_pending.load() == 0) return;
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_waiting.fetch_add(1);
+			m_space.wait(lock, [this] { return m_pending.load() == 0; });
+			m_waiting.fetch_sub(1);
+		}
+
+
+
+		/**********************************************************************
+		 *	Write what is queued, then stop the writer.
+		 */
+		void SerialTxQueue::Stop()
+		{
+			m_running.store(false);
+			{
+				//	a sleeper has either seen the flag or is waiting
+				std::lock_guard<std::mutex> lock(m_lock);
+			}
+			m_ready.notify_all();
+			m_space.notify_all();
+
+			if (m_thWriter.joinable()) m_thWriter.join();
+		}
+
+
+
+		/**********************************************************************
+		 *	Take a place in the queue, waiting for one while $m_depth
+		 *		buffers are pending.
+		 *
+		 *	\returns false if the queue stopped while waiting.
+		 */
+		bool SerialTxQueue::reserve()
+		{
+			size_t pending = m_pending.load(std::memory_order_relaxed);
+			while (true)
+			{
+				if (pending < m_depth)
+				{
+					if (m_pending.compare_exchange_weak(pending, pending + 1)) return true;
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(m_lock);
+				m_waiting.fetch_add(1);
+				m_space.wait(lock, [this] { return !m_running.load() || m_pending.load() < m_depth; });
+				m_waiting.fetch_sub(1);
+				if (!m_running.load()) return false;
+
+				pending = m_pending.load(std::memory_order_relaxed);
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Give back places in the queue, waking whoever waits on them.
+		 *
+		 *	\param[in] count The number of places.
+		 */
+		void SerialTxQueue::unreserve(size_t count)
+		{
+			m_pending.fetch_sub(count);
+			if (m_waiting.load())
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_space.notify_all();
+			}
+			wake_writer();
+		}
+
+
+
+		/**********************************************************************
+		 *	Wake the writer, if it sleeps.
+		 */
+		void SerialTxQueue::wake_writer()
+		{
+			if (m_sleeping.load())
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_ready.notify_one();
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Whether both lanes are empty. Writer only.
+		 */
+		bool SerialTxQueue::idle() const
+		{
+			return m_lanes[(size_t)SerialTxPriority::High].Empty()
+				&& m_lanes[(size_t)SerialTxPriority::Normal].Empty();
+		}
+
+
+
+		/**********************************************************************
+		 *	Move everything queued into a batch, High buffers first.
+		 *		Writer only.
+		 *
+		 *	\param[out] batch Receives the requests, in the order to write.
+		 *	\returns The number of requests taken.
+		 */
+		size_t SerialTxQueue::take(std::vector<Request>& batch)
+		{
+			for (SerialTxPriority priority : { SerialTxPriority::High, SerialTxPriority::Normal })
+			{
+				Lane& lane = m_lanes[(size_t)priority];
+				while (lane.Pop(batch, m_memory))
+					;
+			}
+			return batch.size();
+		}
+
+
+
+		/**********************************************************************
+		 *	Destroy a node and give its memory back.
+		 */
+		void SerialTxQueue::free_node(Node* node, std::pmr::memory_resource* memory)
+		{
+			node->~Node();
+			memory->deallocate(node, sizeof(Node), alignof(Node));
+		}
+
+
+
+		/**********************************************************************
+		 *	The writer thread. Takes everything queued, writes it with a single
+		 *		gathered sink call, then completes each buffer in order.
+		 */
+		void SerialTxQueue::writer_thread()
+		{
+			std::vector<Request> batch;
+			batch.reserve(m_depth);
+			m_gather.reserve(m_depth);
+
+			while (true)
+			{
+				batch.clear();
+				if (!take(batch))
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_sleeping.store(true);
+					m_ready.wait(lock, [this] { return !idle() || (!m_running.load() && m_pending.load() == 0); });
+					m_sleeping.store(false);
+
+					//	stopped, and nothing more is coming
+					if (idle()) break;
+					continue;
+				}
+
+				m_gather.clear();
+				for (Request& req : batch) m_gather.emplace_back(req.data);
+				size_t written = m_sink(m_gather.data(), m_gather.size());
+				m_batches.fetch_add(1, std::memory_order_relaxed);
+
+				//	attribute a short write to the buffers in order
+				for (Request& req : batch)
+				{
+					size_t part = (std::min)(written, req.data.size());
+					req.done.set_value(part);
+					written -= part;
+				}
+
+				unreserve(batch.size());
+			}
+		}
+
+
+
+		/**********************************************************************
+		 *	Free what was never taken.
+		 *
+		 *	\param[in] memory The memory the nodes came from.
+		 */
+		void SerialTxQueue::Lane::Clear(std::pmr::memory_resource* memory)
+		{
+			Node* node = head;
+			while (node)
+			{
+				Node* next = node->next.load();
+				if (node != &stub) free_node(node, memory);
+				node = next;
+			}
+			stub.next = nullptr;
+			tail = &stub;
+			head = &stub;
+		}
+
+
+
+		/**********************************************************************
+		 *	Append a node. Safe from any number of producers.
+		 *
+		 *	\param[in] node The node, owned by the lane from here on.
+		 */
+		void SerialTxQueue::Lane::Push(Node* node)
+		{
+			Node* prev = tail.exchange(node);
+
+			//	until linked, the writer sees the lane end at $prev
+			prev->next.store(node);
+		}
+
+
+
+		/**********************************************************************
+		 *	Take the oldest request. Writer only.
+		 *
+		 *	\param[out] batch Receives the request, which keeps its memory.
+		 *	\param[in] memory The memory the nodes came from.
+		 *	\returns false if nothing is linked yet.
+		 */
+		bool SerialTxQueue::Lane::Pop(std::vector<Request>& batch, std::pmr::memory_resource* memory)
+		{
+			Node* next = head->next.load();
+			if (!next) return false;
+
+			batch.push_back(std::move(next->request));
+			Node* spent = head;
+			head = next;
+			if (spent != &stub) free_node(spent, memory);
+			return true;
+		}
+
+
+
+		/**********************************************************************
+		 *	Whether nothing is linked after the head. Writer only.
+		 */
+		bool SerialTxQueue::Lane::Empty() const
+		{
+			return head->next.load() == nullptr;
+		}
+	}
+}
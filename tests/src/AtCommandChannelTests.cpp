@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.AtCommandChannel.hpp>
+
+#include "FakeModem.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	std::mutex urc_mutex;
+	std::condition_variable urc_signal;
+	std::vector<std::string> urc_lines;
+
+	void HandleUrc(std::string_view line)
+	{
+		std::lock_guard<std::mutex> lock(urc_mutex);
+		urc_lines.emplace_back(line);
+		urc_signal.notify_all();
+	}
+
+
+	TEST(AtCommandChannelTest, OkWithLines)
+	{
+		FakeModem modem;
+		modem.Script("AT+CSQ", "\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		auto future = channel.Send("AT+CSQ");
+		ASSERT_EQ(std::future_status::ready, future.wait_for(2s));
+
+		AtResponse response = future.get();
+		ASSERT_TRUE(response.Ok());
+		ASSERT_EQ(1u, response.lines.size());
+		ASSERT_EQ("+CSQ: 20,99", response.lines[0]);
+	}
+
+
+	TEST(AtCommandChannelTest, ErrorResults)
+	{
+		FakeModem modem;
+		modem.Script("AT+CPIN?", "\r\n+CME ERROR: 10\r\n");
+		modem.Script("AT+CMGS", "\r\n+CMS ERROR: 304\r\n");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		AtResponse unknown = channel.Send("AT+BOGUS").get();
+		ASSERT_EQ(AtResult::Error, unknown.result);
+
+		AtResponse cme = channel.Send("AT+CPIN?").get();
+		ASSERT_EQ(AtResult::CmeError, cme.result);
+		ASSERT_EQ(10, cme.error);
+
+		AtResponse cms = channel.Send("AT+CMGS").get();
+		ASSERT_EQ(AtResult::CmsError, cms.result);
+		ASSERT_EQ(304, cms.error);
+	}
+
+
+	TEST(AtCommandChannelTest, EchoIsIgnored)
+	{
+		FakeModem modem;
+		modem.echo = true;
+		modem.Script("ATI", "\r\nQuectel\r\n\r\nOK\r\n");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		AtResponse response = channel.Send("ATI").get();
+		ASSERT_TRUE(response.Ok());
+		ASSERT_EQ(std::vector<std::string>{ "Quectel" }, response.lines);
+	}
+
+
+	TEST(AtCommandChannelTest, UrcsAreRoutedToSubscribers)
+	{
+		FakeModem modem;
+		modem.Script("AT+CSQ", "\r\n+CREG: 5\r\n\r\n+CSQ: 1,1\r\n\r\nOK\r\n");
+		modem.Script("AT+CREG?", "\r\n+CREG: 0,1\r\n\r\nOK\r\n");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		urc_lines.clear();
+		channel.Subscribe("+CREG", HandleUrc);
+
+		//	a URC arriving during an unrelated command
+		AtResponse csq = channel.Send("AT+CSQ").get();
+		ASSERT_EQ(std::vector<std::string>{ "+CSQ: 1,1" }, csq.lines);
+
+		//	the same prefix answering a query
+		AtResponse creg = channel.Send("AT+CREG?").get();
+		ASSERT_EQ(std::vector<std::string>{ "+CREG: 0,1" }, creg.lines);
+
+		//	and while idle
+		modem.Urc("+CREG: 1");
+
+		std::unique_lock<std::mutex> lock(urc_mutex);
+		ASSERT_TRUE(urc_signal.wait_for(lock, 2s, [] { return urc_lines.size() >= 2; }));
+		ASSERT_EQ("+CREG: 5", urc_lines[0]);
+		ASSERT_EQ("+CREG: 1", urc_lines[1]);
+	}
+
+
+	TEST(AtCommandChannelTest, TimeoutDoesNotStallQueue)
+	{
+		FakeModem modem;
+		modem.Script("AT+SLOW", "");
+		modem.Script("AT", "\r\nOK\r\n");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		auto slow = channel.Send("AT+SLOW", 50ms);
+		auto next = channel.Send("AT");
+
+		ASSERT_EQ(AtResult::Timeout, slow.get().result);
+		ASSERT_EQ(std::future_status::ready, next.wait_for(2s));
+		ASSERT_TRUE(next.get().Ok());
+	}
+
+
+	TEST(AtCommandChannelTest, LateResultIsNotTakenByNextCommand)
+	{
+		FakeModem modem;
+		modem.Script("AT+SLOW", "");
+		modem.Script("AT+CSQ", "\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		ASSERT_EQ(AtResult::Timeout, channel.Send("AT+SLOW", 50ms).get().result);
+		auto next = channel.Send("AT+CSQ");
+		ASSERT_EQ(std::future_status::timeout, next.wait_for(100ms));
+		ASSERT_EQ(1u, modem.commands.load());
+
+		//	the slow command answers after all
+		modem.Urc("+SLOW: 1");
+		modem.Urc("ERROR");
+
+		ASSERT_EQ(std::future_status::ready, next.wait_for(2s));
+		AtResponse response = next.get();
+		ASSERT_TRUE(response.Ok());
+		ASSERT_EQ(std::vector<std::string>{ "+CSQ: 20,99" }, response.lines);
+	}
+
+
+	TEST(AtCommandChannelTest, PipelinedCommandsMatchInOrder)
+	{
+		FakeModem modem;
+		constexpr int count = 200;
+		for (int i = 0; i < count; i++)
+		{
+			modem.Script("AT+N=" + std::to_string(i), "\r\n+N: " + std::to_string(i) + "\r\n\r\nOK\r\n");
+		}
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		std::vector<std::future<AtResponse>> futures;
+		for (int i = 0; i < count; i++)
+		{
+			futures.push_back(channel.Send("AT+N=" + std::to_string(i)));
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			AtResponse response = futures[i].get();
+			ASSERT_TRUE(response.Ok());
+			ASSERT_EQ(std::vector<std::string>{ "+N: " + std::to_string(i) }, response.lines);
+		}
+		ASSERT_EQ(0u, channel.Pending());
+	}
+
+
+	TEST(AtCommandChannelTest, CloseAbortsPending)
+	{
+		FakeModem modem;
+		modem.Script("AT+SLOW", "");
+		AtCommandChannel channel(std::move(modem.pty.device));
+
+		auto first = channel.Send("AT+SLOW");
+		auto second = channel.Send("AT+SLOW");
+		channel.Close();
+
+		ASSERT_EQ(AtResult::Aborted, first.get().result);
+		ASSERT_EQ(AtResult::Aborted, second.get().result);
+		ASSERT_EQ(AtResult::Aborted, channel.Send("AT").get().result);
+	}
+}
@@ -0,0 +1,90 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#ifndef TESTS_FAKEMODEM_H_
+#define TESTS_FAKEMODEM_H_
+
+#include "PtyPair.hpp"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace tests
+{
+	///	A scripted modem on the master side of a pty.
+	///	Each command line ending in '\r' is answered from the script, or with
+	///		ERROR if unknown. Replies are written verbatim, so a script entry
+	///		carries its own "\r\n" framing.
+	struct FakeModem
+	{
+		FakeModem()
+		{
+			m_thread = std::thread([this] { serve(); });
+		}
+
+		~FakeModem()
+		{
+			m_running = false;
+			m_thread.join();
+		}
+
+		void Script(const std::string& command, const std::string& reply)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_script[command] = reply;
+		}
+
+		///	Send an unsolicited line.
+		void Urc(const std::string& line)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			pty.WriteMaster("\r\n" + line + "\r\n");
+		}
+
+		PtyPair pty;
+		std::atomic<bool> echo = { false };
+		std::atomic<size_t> commands = { 0 };
+
+	private:
+		void serve()
+		{
+			std::string line;
+			char buf[4096];
+			while (m_running)
+			{
+				pollfd pfd = { pty.master, POLLIN, 0 };
+				if (poll(&pfd, 1, 10) <= 0) continue;
+
+				ssize_t res = read(pty.master, buf, sizeof(buf));
+				if (res <= 0) continue;
+
+				for (ssize_t i = 0; i < res; i++)
+				{
+					if (buf[i] != '\r')
+					{
+						line += buf[i];
+						continue;
+					}
+
+					std::lock_guard<std::mutex> lock(m_lock);
+					auto reply = m_script.find(line);
+					std::string out = echo ? line + "\r" : std::string();
+					out += (reply != m_script.end()) ? reply->second : std::string("\r\nERROR\r\n");
+					pty.WriteMaster(out);
+					commands++;
+					line.clear();
+				}
+			}
+		}
+
+		std::map<std::string, std::string> m_script;
+		std::mutex m_lock;
+		std::atomic<bool> m_running = { true };
+		std::thread m_thread;
+	};
+}
+
+#endif	// !TESTS_FAKEMODEM_H_
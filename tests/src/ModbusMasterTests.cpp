@@ -0,0 +1,295 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.ModbusMaster.hpp>
+#include <Win32.Devices.SerialCrc.hpp>
+
+#include "ModbusSlaves.hpp"
+
+#include <functional>
+#include <random>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	ModbusOptions FastOptions()
+	{
+		ModbusOptions options;
+		options.responseTimeout = 50ms;
+		options.turnaround = 5ms;
+		return options;
+	}
+
+
+	bool WaitUntil(std::function<bool()> done, std::chrono::milliseconds timeout = 5000ms)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (!done())
+		{
+			if (std::chrono::steady_clock::now() > deadline) return false;
+			std::this_thread::sleep_for(1ms);
+		}
+		return true;
+	}
+
+
+	std::mutex updates_lock;
+	std::vector<ModbusBlock> updates;
+	std::vector<uint16_t> updated_values;
+
+	void RecordUpdate(const ModbusBlock& block)
+	{
+		std::lock_guard<std::mutex> lock(updates_lock);
+		updates.push_back(block);
+		updated_values.assign(block.values, block.values + block.count);
+	}
+
+
+	TEST(ModbusMasterTest, Crc16Modbus)
+	{
+		ASSERT_EQ(0x4B37, Crc16Modbus("123456789", 9));
+		ASSERT_EQ(0x4B37, Crc16Modbus("56789", 5, Crc16Modbus("1234", 4)));
+
+		//	read 10 holding registers of slave 1 goes out as ... C5 CD
+		const uint8_t request[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+		ASSERT_EQ(0xCDC5, Crc16Modbus(request, sizeof(request)));
+
+		std::mt19937 random(11);
+		std::vector<uint8_t> data(777);
+		for (uint8_t& b : data) b = (uint8_t)random();
+		for (size_t len = 0; len <= data.size(); len += 13)
+		{
+			ASSERT_EQ(BitwiseCrc16Modbus(data.data(), len), Crc16Modbus(data.data(), len)) << len;
+		}
+	}
+
+
+	TEST(ModbusMasterTest, SilenceFromBaudRate)
+	{
+		constexpr ModbusTiming slow = ModbusRtuTiming(9600);
+		static_assert(slow.character.count() == 1145833, "11 bits at 9600 baud");
+		ASSERT_EQ(4010415, slow.interFrame.count());
+		ASSERT_EQ(1718749, slow.interChar.count());
+
+		constexpr ModbusTiming fast = ModbusRtuTiming(115200);
+		ASSERT_EQ(std::chrono::nanoseconds(1750us), fast.interFrame);
+		ASSERT_EQ(std::chrono::nanoseconds(750us), fast.interChar);
+
+		PtyPair pty;
+		pty.device.BaudRate(19200);
+		ModbusMaster master(pty.device);
+		ASSERT_EQ(ModbusRtuTiming(19200, 10).interFrame, master.Timing().interFrame);
+	}
+
+
+	TEST(ModbusMasterTest, ReadAndWriteRegisters)
+	{
+		PtyPair pty;
+		ModbusSlaves slaves(pty.master);
+		slaves.Add(7);
+		slaves.Start();
+
+		ModbusMaster master(pty.device, FastOptions());
+		ModbusResponse read = master.ReadRegisters(7, ModbusTable::Holding, 100, 3);
+		ASSERT_TRUE(read.Ok());
+		ASSERT_EQ((std::vector<uint16_t>{ ModbusSlaves::Initial(7, 3, 100), ModbusSlaves::Initial(7, 3, 101), ModbusSlaves::Initial(7, 3, 102) }), read.registers);
+
+		read = master.ReadRegisters(7, ModbusTable::Input, 5, 1);
+		ASSERT_TRUE(read.Ok());
+		ASSERT_EQ(ModbusSlaves::Initial(7, 4, 5), read.registers[0]);
+
+		ASSERT_TRUE(master.WriteRegister(7, 10, 0xBEEF).Ok());
+		const uint16_t values[] = { 1, 2, 3, 4 };
+		ASSERT_TRUE(master.WriteRegisters(7, 20, values, 4).Ok());
+
+		read = master.ReadRegisters(7, ModbusTable::Holding, 10, 14);
+		ASSERT_TRUE(read.Ok());
+		ASSERT_EQ(0xBEEF, read.registers[0]);
+		ASSERT_EQ((std::vector<uint16_t>{ 1, 2, 3, 4 }), std::vector<uint16_t>(read.registers.begin() + 10, read.registers.end()));
+
+		ModbusStats stats = master.Stats();
+		ASSERT_EQ(5u, stats.polls);
+		ASSERT_GT(stats.busTime.count(), 0);
+		ASSERT_ANY_THROW(master.ReadRegisters(7, ModbusTable::Holding, 0, 126));
+	}
+
+
+	TEST(ModbusMasterTest, BroadcastIsNotAnswered)
+	{
+		PtyPair pty;
+		ModbusSlaves slaves(pty.master);
+		slaves.Add(1);
+		slaves.Add(2);
+		slaves.Start();
+
+		ModbusMaster master(pty.device, FastOptions());
+		ASSERT_TRUE(master.WriteRegister(ModbusBroadcast, 3, 42).Ok());
+
+		//	waits out the turnaround before the next request
+		ModbusResponse read = master.ReadRegisters(2, ModbusTable::Holding, 3, 1);
+		ASSERT_TRUE(read.Ok());
+		ASSERT_EQ(42, read.registers[0]);
+		ASSERT_EQ(42, slaves.Holding(1, 3));
+		ASSERT_EQ(0u, master.Stats().timeouts);
+	}
+
+
+	TEST(ModbusMasterTest, ExceptionTimeoutAndDamage)
+	{
+		PtyPair pty;
+		ModbusSlaves slaves(pty.master);
+		slaves.Add(1, 50);
+		slaves.Add(2);
+		slaves.silent = { 2 };
+		slaves.Start();
+
+		ModbusMaster master(pty.device, FastOptions());
+		ModbusResponse response = master.ReadRegisters(1, ModbusTable::Holding, 40, 20);
+		ASSERT_EQ(ModbusStatus::Exception, response.status);
+		ASSERT_EQ(0x02, response.exception);
+
+		ASSERT_EQ(ModbusStatus::Timeout, master.ReadRegisters(2, ModbusTable::Holding, 0, 1).status);
+		ASSERT_EQ(ModbusStatus::Timeout, master.ReadRegisters(9, ModbusTable::Holding, 0, 1).status);
+
+		slaves.corrupt = 1;
+		ASSERT_EQ(ModbusStatus::CrcError, master.ReadRegisters(1, ModbusTable::Holding, 0, 10).status);
+		ASSERT_TRUE(master.ReadRegisters(1, ModbusTable::Holding, 0, 10).Ok());
+
+		ModbusStats stats = master.Stats();
+		ASSERT_EQ(2u, stats.polls);
+		ASSERT_EQ(1u, stats.exceptions);
+		ASSERT_EQ(2u, stats.timeouts);
+		ASSERT_EQ(1u, stats.crcErrors);
+	}
+
+
+	TEST(ModbusMasterTest, AdjacentWatchesAreMerged)
+	{
+		PtyPair pty;
+		ModbusMaster master(pty.device, FastOptions());
+
+		ModbusWatchId middle = master.Watch(1, ModbusTable::Holding, 10, 10);
+		master.Watch(1, ModbusTable::Holding, 0, 10);
+		master.Watch(1, ModbusTable::Holding, 15, 15);
+		master.Watch(1, ModbusTable::Holding, 40, 5);
+		master.Watch(1, ModbusTable::Input, 0, 10);
+		master.Watch(2, ModbusTable::Holding, 0, 10);
+		ASSERT_EQ(4u, master.Requests());
+
+		//	no single read may exceed 125 registers
+		master.Watch(3, ModbusTable::Holding, 0, 100);
+		master.Watch(3, ModbusTable::Holding, 100, 50);
+		ASSERT_EQ(6u, master.Requests());
+
+		ModbusOptions gaps = FastOptions();
+		gaps.maxGap = 10;
+		ModbusMaster merging(pty.device, gaps);
+		merging.Watch(1, ModbusTable::Holding, 0, 30);
+		merging.Watch(1, ModbusTable::Holding, 40, 5);
+		ASSERT_EQ(1u, merging.Requests());
+
+		ASSERT_TRUE(master.Values(middle).empty());
+	}
+
+
+	TEST(ModbusMasterTest, PollOnceFillsWatches)
+	{
+		PtyPair pty;
+		ModbusSlaves slaves(pty.master);
+		slaves.Add(1);
+		slaves.Start();
+
+		ModbusMaster master(pty.device, FastOptions());
+		ModbusWatchId low = master.Watch(1, ModbusTable::Holding, 0, 4);
+		ModbusWatchId high = master.Watch(1, ModbusTable::Holding, 4, 2);
+
+		{
+			std::lock_guard<std::mutex> lock(updates_lock);
+			updates.clear();
+		}
+		master.Updated += RecordUpdate;
+		ASSERT_TRUE(master.PollOnce());
+		ASSERT_EQ(1u, slaves.Requests(1));
+
+		ASSERT_EQ((std::vector<uint16_t>{ ModbusSlaves::Initial(1, 3, 4), ModbusSlaves::Initial(1, 3, 5) }), master.Values(high));
+		ASSERT_EQ(4u, master.Values(low).size());
+
+		std::lock_guard<std::mutex> lock(updates_lock);
+		ASSERT_EQ(1u, updates.size());
+		ASSERT_EQ(0, updates[0].address);
+		ASSERT_EQ(6, updates[0].count);
+		ASSERT_EQ(ModbusSlaves::Initial(1, 3, 5), updated_values[5]);
+	}
+
+
+	TEST(ModbusMasterTest, SchedulerCoversEverySlave)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(115200);
+		ModbusSlaves slaves(pty.master);
+		slaves.paceBaud = 115200;
+
+		ModbusMaster master(pty.device, FastOptions());
+		std::vector<ModbusWatchId> watches;
+		for (uint8_t slave = 1; slave <= 30; slave++)
+		{
+			slaves.Add(slave);
+			for (uint16_t block = 0; block < 3; block++)
+			{
+				watches.push_back(master.Watch(slave, ModbusTable::Holding, (uint16_t)(block * 8), 8));
+			}
+		}
+		ASSERT_EQ(30u, master.Requests());
+
+		slaves.Start();
+		master.Start();
+		ASSERT_TRUE(WaitUntil([&] {
+			for (ModbusWatchId id : watches) if (master.Values(id).empty()) return false;
+			return true;
+		}));
+		std::this_thread::sleep_for(200ms);
+		master.Stop();
+
+		ASSERT_EQ(ModbusSlaves::Initial(30, 3, 23), master.Values(watches.back())[7]);
+
+		//	round robin: no slave is more than a poll ahead of another
+		size_t least = SIZE_MAX, most = 0;
+		for (uint8_t slave = 1; slave <= 30; slave++)
+		{
+			least = (std::min)(least, slaves.Requests(slave));
+			most = (std::max)(most, slaves.Requests(slave));
+		}
+		ASSERT_LE(most - least, 1u);
+
+		ModbusStats stats = master.Stats();
+		ASSERT_EQ(0u, stats.timeouts);
+		ASSERT_GT(stats.PollsPerSecond(), 0.0);
+		ASSERT_GT(stats.Utilisation(), 0.2);
+		ASSERT_LT(stats.Utilisation(), 1.0);
+	}
+
+
+	TEST(ModbusMasterTest, OfflineSlaveDoesNotHoldUpTheBus)
+	{
+		PtyPair pty;
+		ModbusSlaves slaves(pty.master);
+		slaves.Add(1);
+		slaves.Add(2);
+		slaves.Add(3);
+		slaves.silent = { 2 };
+		slaves.Start();
+
+		ModbusMaster master(pty.device, FastOptions());
+		for (uint8_t slave = 1; slave <= 3; slave++) master.Watch(slave, ModbusTable::Holding, 0, 10);
+
+		master.Start();
+		std::this_thread::sleep_for(500ms);
+		master.Stop();
+
+		//	three timeouts, then left alone for the offline period
+		ModbusStats stats = master.Stats();
+		ASSERT_EQ(3u, stats.timeouts);
+		ASSERT_GT(slaves.Requests(1), 20u);
+		ASSERT_GT(slaves.Requests(3), 20u);
+	}
+}
@@ -0,0 +1,228 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#ifndef TESTS_MODBUSSLAVES_H_
+#define TESTS_MODBUSSLAVES_H_
+
+#include "PtyPair.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tests
+{
+	///	CRC-16/MODBUS a bit at a time, to check the tables against.
+	inline uint16_t BitwiseCrc16Modbus(const void* data, size_t len, uint16_t crc = 0xFFFF)
+	{
+		const uint8_t* at = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < len; i++)
+		{
+			crc ^= at[i];
+			for (int bit = 0; bit < 8; bit++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+		}
+		return crc;
+	}
+
+
+	///	A set of Modbus RTU slaves on the master side of a pty, answering
+	///		on a thread of their own. Registers start out as a function of
+	///		slave, table and address, so reads can be checked.
+	struct ModbusSlaves
+	{
+		explicit ModbusSlaves(int fd)
+			: m_fd(fd)
+		{
+		}
+
+		~ModbusSlaves()
+		{
+			Stop();
+		}
+
+		static uint16_t Initial(uint8_t slave, uint8_t function, uint16_t address)
+		{
+			return (uint16_t)((slave << 8) ^ address ^ (function == 0x04 ? 0x8000 : 0));
+		}
+
+		void Add(uint8_t slave, uint16_t registers = 1000)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			std::vector<uint16_t>& holding = m_holding[slave];
+			holding.resize(registers);
+			for (uint16_t i = 0; i < registers; i++) holding[i] = Initial(slave, 0x03, i);
+		}
+
+		uint16_t Holding(uint8_t slave, uint16_t address)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			return m_holding[slave].at(address);
+		}
+
+		void Start()
+		{
+			m_stop = false;
+			m_thread = std::thread([this] { serve(); });
+		}
+
+		void Stop()
+		{
+			m_stop = true;
+			if (m_thread.joinable()) m_thread.join();
+		}
+
+		size_t Requests(uint8_t slave)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			return m_requests[slave];
+		}
+
+		///	Slaves that never answer.
+		std::set<uint8_t> silent;
+
+		///	Answers damaged on the line, from now.
+		std::atomic<int> corrupt = { 0 };
+
+		///	Hold each answer for the time the request and the answer take
+		///		on the wire at this baud rate, 11 bits a character; 0 for
+		///		no delay.
+		uint32_t paceBaud = 0;
+
+	private:
+		bool read_exact(uint8_t* dest, size_t len)
+		{
+			size_t got = 0;
+			while (got < len)
+			{
+				if (m_stop) return false;
+
+				pollfd pfd = { m_fd, POLLIN, 0 };
+				if (poll(&pfd, 1, 10) <= 0) continue;
+
+				ssize_t res = read(m_fd, dest + got, len - got);
+				if (res > 0) got += (size_t)res;
+			}
+			return true;
+		}
+
+		void reply(std::string out, size_t requestLen)
+		{
+			uint16_t crc = BitwiseCrc16Modbus(out.data(), out.size());
+			out += (char)(crc & 0xFF);
+			out += (char)(crc >> 8);
+			if (corrupt > 0 && corrupt-- > 0) out[out.size() / 2] ^= 0x5A;
+
+			if (paceBaud)
+			{
+				auto wire = std::chrono::nanoseconds(1000000000ll * 11 * (int64_t)(requestLen + out.size()) / paceBaud);
+				std::this_thread::sleep_for(wire);
+			}
+			ssize_t sent = write(m_fd, out.data(), out.size());
+			(void)sent;
+		}
+
+		void exception(uint8_t slave, uint8_t function, uint8_t code, size_t requestLen)
+		{
+			reply(std::string{ (char)slave, (char)(function | 0x80), (char)code }, requestLen);
+		}
+
+		void serve()
+		{
+			uint8_t frame[8 + 256];
+			while (read_exact(frame, 2))
+			{
+				const uint8_t slave = frame[0];
+				const uint8_t function = frame[1];
+
+				size_t len = 8;
+				if (function == 0x10)
+				{
+					if (!read_exact(frame + 2, 5)) return;
+					len = 7 + frame[6] + 2;
+					if (!read_exact(frame + 7, len - 7)) return;
+				}
+				else if (!read_exact(frame + 2, 6)) return;
+
+				if (BitwiseCrc16Modbus(frame, len) != 0) continue;
+
+				std::lock_guard<std::mutex> lock(m_lock);
+				if (slave == 0 && function == 0x06)
+				{
+					//	a broadcast is acted on by all, and answered by none
+					const uint16_t address = (uint16_t)((frame[2] << 8) | frame[3]);
+					for (auto& holding : m_holding) holding.second.at(address) = (uint16_t)((frame[4] << 8) | frame[5]);
+					continue;
+				}
+
+				auto found = m_holding.find(slave);
+				if (found == m_holding.end() || silent.count(slave)) continue;
+				m_requests[slave]++;
+
+				std::vector<uint16_t>& holding = found->second;
+				const uint16_t address = (uint16_t)((frame[2] << 8) | frame[3]);
+				const uint16_t value = (uint16_t)((frame[4] << 8) | frame[5]);
+
+				if (function == 0x03 || function == 0x04)
+				{
+					if ((size_t)address + value > holding.size())
+					{
+						exception(slave, function, 0x02, len);
+						continue;
+					}
+
+					std::string out = { (char)slave, (char)function, (char)(2 * value) };
+					for (uint16_t i = 0; i < value; i++)
+					{
+						uint16_t reg = (function == 0x03) ? holding[address + i] : Initial(slave, 0x04, address + i);
+						out += (char)(reg >> 8);
+						out += (char)(reg & 0xFF);
+					}
+					reply(out, len);
+				}
+				else if (function == 0x06)
+				{
+					if (address >= holding.size())
+					{
+						exception(slave, function, 0x02, len);
+						continue;
+					}
+					holding[address] = value;
+					reply(std::string((const char*)frame, 6), len);
+				}
+				else if (function == 0x10)
+				{
+					if ((size_t)address + value > holding.size())
+					{
+						exception(slave, function, 0x02, len);
+						continue;
+					}
+					for (uint16_t i = 0; i < value; i++)
+					{
+						holding[address + i] = (uint16_t)((frame[7 + 2 * i] << 8) | frame[8 + 2 * i]);
+					}
+					reply(std::string((const char*)frame, 6), len);
+				}
+				else
+				{
+					exception(slave, function, 0x01, len);
+				}
+			}
+		}
+
+	private:
+		int m_fd;
+		std::thread m_thread;
+		std::atomic<bool> m_stop = { false };
+
+		std::mutex m_lock;
+		std::map<uint8_t, std::vector<uint16_t>> m_holding;
+		std::map<uint8_t, size_t> m_requests;
+	};
+}
+
+#endif	// !TESTS_MODBUSSLAVES_H_
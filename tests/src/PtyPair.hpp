@@ -0,0 +1,96 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#ifndef TESTS_PTYPAIR_H_
+#define TESTS_PTYPAIR_H_
+
+#include <Win32.Devices.SerialDevice.hpp>
+
+#include <pty.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace tests
+{
+	using namespace Win32::Devices;
+	using namespace std::chrono_literals;
+
+	///	CPU time used by every thread of the process.
+	inline std::chrono::nanoseconds ProcessCpuTime()
+	{
+		timespec now = {};
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+		return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+	}
+
+
+	///	A pseudo-terminal pair standing in for a modem: the device opens the
+	///		slave side while the test drives the master side.
+	struct PtyPair
+	{
+		PtyPair()
+		{
+			char name[128] = { 0 };
+			int slave = -1;
+			if (openpty(&master, &slave, name, nullptr, nullptr) == 0)
+			{
+				path = name;
+				device = SerialDevice::FromPath(path);
+				close(slave);
+			}
+		}
+
+		~PtyPair()
+		{
+			device.Close();
+			if (master >= 0) close(master);
+		}
+
+		std::string ReadMaster(size_t len, std::chrono::milliseconds timeout = 1000ms)
+		{
+			std::string out;
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (out.size() < len && std::chrono::steady_clock::now() < deadline)
+			{
+				pollfd pfd = { master, POLLIN, 0 };
+				if (poll(&pfd, 1, 10) > 0)
+				{
+					char buf[256];
+					ssize_t res = read(master, buf, std::min(sizeof(buf), len - out.size()));
+					if (res > 0) out.append(buf, (size_t)res);
+				}
+			}
+			return out;
+		}
+
+		void WriteMaster(const std::string& data)
+		{
+			size_t written = 0;
+			while (written < data.size())
+			{
+				ssize_t res = write(master, data.data() + written, data.size() - written);
+				if (res > 0) written += (size_t)res;
+				else std::this_thread::sleep_for(1ms);
+			}
+		}
+
+		///	Hang up the line, as an unplugged adapter would.
+		void CloseMaster()
+		{
+			if (master >= 0) close(master);
+			master = -1;
+		}
+
+		int master = -1;
+		std::string path;
+		SerialDevice device = { nullptr };
+	};
+}
+
+#endif	// !TESTS_PTYPAIR_H_
@@ -0,0 +1,750 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialDevice.hpp>
+
+#include "PtyPair.hpp"
+
+#include <dirent.h>
+#include <termios.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+constexpr uint32_t TestBaudRate = 115200u;
+
+namespace tests
+{
+	TEST(PtySerialDeviceTest, OpenSerialPort)
+	{
+		PtyPair pty;
+		ASSERT_FALSE(pty.path.empty());
+
+		pty.device.Close();
+	}
+
+
+	TEST(PtySerialDeviceTest, OpenMissingPortThrows)
+	{
+		ASSERT_ANY_THROW(SerialDevice::FromPath("/dev/does-not-exist"));
+	}
+
+
+	TEST(PtySerialDeviceTest, LineSettings)
+	{
+		PtyPair pty;
+
+		pty.device.BaudRate(TestBaudRate);
+		ASSERT_EQ(TestBaudRate, pty.device.BaudRate());
+
+		pty.device.StopBits(2);
+		ASSERT_EQ(2u, pty.device.StopBits());
+
+		pty.device.ByteSize(SerialByteSize::Byte_Size7b);
+		ASSERT_EQ(SerialByteSize::Byte_Size7b, pty.device.ByteSize());
+	}
+
+
+	TEST(PtySerialDeviceTest, ConfigureAtOnce)
+	{
+		PtyPair pty;
+
+		SerialSettings settings;
+		settings.baudRate = 57600;
+		settings.parity = SerialParity::Even;
+		settings.stopBits = SerialStopBits::StopBits_2;
+		settings.flowControl = SerialFlowControl::XonXoff;
+		settings.timeouts.writeTotalConstant = 20;
+		ASSERT_TRUE(pty.device.Configure(settings));
+		ASSERT_EQ(settings, pty.device.Settings());
+		ASSERT_EQ(57600u, pty.device.BaudRate());
+		ASSERT_EQ(2u, pty.device.StopBits());
+
+		//	the master shares the slave's termios; a pty keeps 8N
+		termios tty = { 0 };
+		ASSERT_EQ(0, tcgetattr(pty.master, &tty));
+		ASSERT_EQ((speed_t)B57600, cfgetospeed(&tty));
+		ASSERT_TRUE(tty.c_cflag & CSTOPB);
+		ASSERT_FALSE(tty.c_cflag & CRTSCTS);
+		ASSERT_TRUE(tty.c_iflag & IXON);
+
+		//	unchanged settings are not sent again
+		cfsetospeed(&tty, B9600);
+		ASSERT_EQ(0, tcsetattr(pty.master, TCSANOW, &tty));
+		ASSERT_TRUE(pty.device.Configure(settings));
+		ASSERT_EQ(0, tcgetattr(pty.master, &tty));
+		ASSERT_EQ((speed_t)B9600, cfgetospeed(&tty));
+
+		settings.flowControl = SerialFlowControl::RtsCts;
+		ASSERT_TRUE(pty.device.Configure(settings));
+		ASSERT_EQ(0, tcgetattr(pty.master, &tty));
+		ASSERT_EQ((speed_t)B57600, cfgetospeed(&tty));
+		ASSERT_TRUE(tty.c_cflag & CRTSCTS);
+		ASSERT_FALSE(tty.c_iflag & IXON);
+	}
+
+
+	TEST(PtySerialDeviceTest, SendAndRecv)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		ASSERT_EQ(5u, pty.device.Write("ATE0\r"));
+		ASSERT_EQ("ATE0\r", pty.ReadMaster(5));
+
+		pty.WriteMaster("0\r");
+		std::this_thread::sleep_for(20ms);
+		ASSERT_EQ(2u, pty.device.Available());
+
+		std::string response;
+		ASSERT_EQ(2u, pty.device.Read(response));
+		ASSERT_EQ("0\r", response);
+	}
+
+
+	TEST(PtySerialDeviceTest, Send_Multiple_Async)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		auto ate0 = pty.device.WriteAsync("ATE0\r");
+		auto atv0 = pty.device.WriteAsync("ATV0\r");
+		auto gsn = pty.device.WriteAsync("AT+GSN\r");
+		auto ati = pty.device.WriteAsync("ATI\r");
+		pty.device.Flush();
+
+		ASSERT_EQ(5u, ate0.get());
+		ASSERT_EQ(5u, atv0.get());
+		ASSERT_EQ(7u, gsn.get());
+		ASSERT_EQ(4u, ati.get());
+		ASSERT_EQ("ATE0\rATV0\rAT+GSN\rATI\r", pty.ReadMaster(21));
+	}
+
+
+	TEST(PtySerialDeviceTest, ConcurrentWritersKeepFramesWhole)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		//	two threads writing directly, two queueing, one of them urgently
+		constexpr int Writers = 4;
+		constexpr int Frames = 100;
+		std::vector<std::thread> writers;
+		for (int w = 0; w < Writers; w++)
+		{
+			writers.emplace_back([&pty, w] {
+				const std::string frame = std::string(63, (char)('a' + w)) + "\n";
+				for (int f = 0; f < Frames; f++)
+				{
+					if (w < 2) pty.device.Write(frame);
+					else pty.device.WriteAsync(frame, (w == 3) ? SerialTxPriority::High : SerialTxPriority::Normal);
+				}
+			});
+		}
+
+		std::string received = pty.ReadMaster(Writers * Frames * 64, 5000ms);
+		for (std::thread& writer : writers) writer.join();
+		pty.device.Flush();
+
+		ASSERT_EQ((size_t)(Writers * Frames * 64), received.size());
+		int counts[Writers] = { 0 };
+		for (size_t at = 0; at < received.size(); at += 64)
+		{
+			char letter = received[at];
+			ASSERT_EQ(std::string(63, letter) + "\n", received.substr(at, 64));
+			counts[letter - 'a']++;
+		}
+		for (int count : counts) ASSERT_EQ(Frames, count);
+	}
+
+
+	TEST(PtySerialDeviceTest, VectoredWrite)
+	{
+		PtyPair pty;
+
+		const std::array<uint8_t, 4> header = { 0x7E, 0x01, 0x00, 0x03 };
+		const std::vector<char> payload = { 'A', 'T', '\r' };
+		const uint16_t crc[] = { 0xBEEF };
+
+		ASSERT_EQ(9u, pty.device.Write({ header, payload, crc }));
+		ASSERT_EQ(3u, pty.device.Write({ "AT", "", std::string("\r") }));
+
+		std::string expected = { '\x7E', '\x01', '\x00', '\x03', 'A', 'T', '\r' };
+		expected.append((const char*)crc, sizeof(crc));
+		expected += "AT\r";
+		ASSERT_EQ(expected, pty.ReadMaster(expected.size()));
+	}
+
+
+	TEST(PtySerialDeviceTest, VectoredWriteManyBuffers)
+	{
+		PtyPair pty;
+
+		std::vector<std::string> parts;
+		std::vector<SerialBuffer> buffers;
+		std::string expected;
+		for (int i = 0; i < 200; i++) parts.push_back(std::to_string(i) + ",");
+		for (const std::string& part : parts)
+		{
+			buffers.emplace_back(part);
+			expected += part;
+		}
+
+		ASSERT_EQ(expected.size(), pty.device.Write(buffers.data(), buffers.size()));
+		ASSERT_EQ(expected, pty.ReadMaster(expected.size()));
+	}
+
+
+	TEST(PtySerialDeviceTest, ArrayWriteAndRead)
+	{
+		PtyPair pty;
+
+		const std::array<uint16_t, 2> words = { 0x4154, 0x0D0A };
+		ASSERT_EQ(4u, pty.device.Write(words));
+		ASSERT_EQ(std::string((const char*)words.data(), 4), pty.ReadMaster(4));
+
+		pty.WriteMaster("OK");
+		std::array<char, 2> reply;
+		ASSERT_EQ(2u, pty.device.Read(reply));
+		ASSERT_EQ('O', reply[0]);
+		ASSERT_EQ('K', reply[1]);
+	}
+
+
+	TEST(PtySerialDeviceTest, ReadDoesNotTruncate)
+	{
+		PtyPair pty;
+		const std::string payload(1000, 'R');
+		pty.WriteMaster(payload);
+		std::this_thread::sleep_for(20ms);
+
+		std::string received;
+		ASSERT_EQ(payload.size(), pty.device.Read(received));
+		ASSERT_EQ(payload, received);
+	}
+
+
+	TEST(PtySerialDeviceTest, ReadSomeTimesOut)
+	{
+		PtyPair pty;
+		char buf[16];
+
+		auto start = std::chrono::steady_clock::now();
+		ASSERT_EQ(0u, pty.device.ReadSome(buf, sizeof(buf), 50ms));
+		ASSERT_LE(50ms, std::chrono::steady_clock::now() - start);
+
+		pty.WriteMaster("0\r");
+		ASSERT_EQ(2u, pty.device.ReadSome(buf, sizeof(buf), 1s));
+		ASSERT_EQ("0\r", std::string(buf, 2));
+	}
+
+
+	TEST(PtySerialDeviceTest, ReadExactlyAcrossWrites)
+	{
+		PtyPair pty;
+		std::thread writer([&] {
+			pty.WriteMaster("+CSQ: ");
+			std::this_thread::sleep_for(20ms);
+			pty.WriteMaster("20,99\r\nOK");
+		});
+
+		std::string reply;
+		ASSERT_EQ(11u, pty.device.ReadExactly(reply, 11, 2s));
+		ASSERT_EQ("+CSQ: 20,99", reply);
+		writer.join();
+
+		//	a timeout keeps what did arrive
+		ASSERT_EQ(4u, pty.device.ReadExactly(reply, 10, 50ms));
+		ASSERT_EQ("\r\nOK", reply);
+	}
+
+
+	TEST(PtySerialDeviceTest, ReadUntilDelimiter)
+	{
+		PtyPair pty;
+		pty.WriteMaster("+CREG: 1\r");
+		std::thread writer([&] {
+			std::this_thread::sleep_for(20ms);
+			pty.WriteMaster("\nOK\r\n");
+		});
+
+		std::string line;
+		ASSERT_EQ(10u, pty.device.ReadUntil(line, "\r\n", 2s));
+		ASSERT_EQ("+CREG: 1\r\n", line);
+		writer.join();
+
+		ASSERT_EQ(4u, pty.device.ReadUntil(line, "\r\n", 1s));
+		ASSERT_EQ("OK\r\n", line);
+
+		pty.WriteMaster("partial");
+		ASSERT_EQ(0u, pty.device.ReadUntil(line, "\r\n", 50ms));
+		ASSERT_EQ(7u, pty.device.ReadExactly(line, 7, 1s));
+	}
+
+
+	TEST(PtySerialDeviceTest, ReadAlongsideEvents)
+	{
+		PtyPair pty;
+		pty.device.RxDelivery(SerialRxDelivery::Buffered);
+		pty.device.UsingEvents(true);
+
+		//	more than the ring holds, so the event thread waits on the reader
+		std::string payload(SerialRxRingSize * 2 + 17, '\0');
+		for (size_t i = 0; i < payload.size(); i++) payload[i] = (char)('a' + i % 26);
+		std::thread writer([&] { pty.WriteMaster(payload); });
+
+		std::string received;
+		ASSERT_EQ(payload.size(), pty.device.ReadExactly(received, payload.size(), 5s));
+		writer.join();
+		ASSERT_EQ(payload, received);
+	}
+
+
+	std::mutex rx_mutex;
+	std::condition_variable rx_signal;
+	std::string rx_received;
+
+	void HandleRxData(std::string rx_data)
+	{
+		std::lock_guard<std::mutex> lock(rx_mutex);
+		rx_received += rx_data;
+		rx_signal.notify_all();
+	}
+
+
+	TEST(PtySerialDeviceTest, SendEvRx)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		rx_received.clear();
+		pty.device.ReceivedData += HandleRxData;
+		pty.device.UsingEvents(true);
+
+		ASSERT_EQ(5u, pty.device.Write("ATE0\r"));
+		ASSERT_EQ("ATE0\r", pty.ReadMaster(5));
+		pty.WriteMaster("0\r");
+
+		std::unique_lock<std::mutex> lock(rx_mutex);
+		ASSERT_TRUE(rx_signal.wait_for(lock, 2s, [] { return rx_received.size() >= 2; }));
+		ASSERT_EQ("0\r", rx_received);
+	}
+
+
+	TEST(PtySerialDeviceTest, HangupLeavesEventThreadIdle)
+	{
+		PtyPair pty;
+		pty.device.UsingEvents(true);
+		pty.CloseMaster();
+
+		//	a spinning event thread would use most of the second
+		std::this_thread::sleep_for(100ms);
+		auto used = ProcessCpuTime();
+		std::this_thread::sleep_for(1s);
+		ASSERT_LT(ProcessCpuTime() - used, 200ms);
+	}
+
+
+	std::string rx_viewed;
+
+	void HandleRxView(std::string_view rx_data)
+	{
+		std::lock_guard<std::mutex> lock(rx_mutex);
+		rx_viewed.append(rx_data.data(), rx_data.size());
+		rx_signal.notify_all();
+	}
+
+
+	TEST(PtySerialDeviceTest, SendEvRxView)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		rx_viewed.clear();
+		pty.device.RxDelivery(SerialRxDelivery::Views);
+		pty.device.ReceivedView += HandleRxView;
+		pty.device.UsingEvents(true);
+
+		//	more than the ring holds, so the ring wraps
+		const std::string payload(SerialRxRingSize + 4096, 'V');
+		std::thread writer([&] { pty.WriteMaster(payload); });
+
+		std::unique_lock<std::mutex> lock(rx_mutex);
+		bool received = rx_signal.wait_for(lock, 5s, [&] { return rx_viewed.size() >= payload.size(); });
+		lock.unlock();
+		writer.join();
+
+		ASSERT_TRUE(received);
+		ASSERT_EQ(payload, rx_viewed);
+	}
+
+
+	std::vector<std::string> rx_frames;
+
+	void HandleRxFrame(std::string_view frame)
+	{
+		std::lock_guard<std::mutex> lock(rx_mutex);
+		rx_frames.emplace_back(frame);
+		rx_signal.notify_all();
+	}
+
+
+	TEST(PtySerialDeviceTest, SendEvRxFrames)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		rx_frames.clear();
+		pty.device.UsingFramer(std::make_unique<DelimiterFramer>("\r\n"));
+		ASSERT_EQ(SerialRxDelivery::Frames, pty.device.RxDelivery());
+		pty.device.ReceivedFrame += HandleRxFrame;
+		pty.device.UsingEvents(true);
+
+		pty.WriteMaster("+CREG: 1\r\nO");
+		std::this_thread::sleep_for(20ms);
+		pty.WriteMaster("K\r\n");
+
+		std::unique_lock<std::mutex> lock(rx_mutex);
+		ASSERT_TRUE(rx_signal.wait_for(lock, 2s, [] { return rx_frames.size() >= 2; }));
+		ASSERT_EQ("+CREG: 1", rx_frames[0]);
+		ASSERT_EQ("OK", rx_frames[1]);
+	}
+
+
+	std::atomic<size_t> rx_batches = { 0 };
+
+	void CountRxBatch(std::string_view rx_data)
+	{
+		std::lock_guard<std::mutex> lock(rx_mutex);
+		rx_viewed.append(rx_data.data(), rx_data.size());
+		rx_batches++;
+		rx_signal.notify_all();
+	}
+
+
+	TEST(PtySerialDeviceTest, RxBatchingCoalesces)
+	{
+		PtyPair pty;
+		rx_viewed.clear();
+		rx_batches = 0;
+		pty.device.RxBatching({ 64, 50ms, -1 });
+		pty.device.RxDelivery(SerialRxDelivery::Views);
+		pty.device.ReceivedView += CountRxBatch;
+		pty.device.UsingEvents(true);
+
+		//	16 small arrivals, each well inside the hold
+		for (int i = 0; i < 16; i++)
+		{
+			pty.WriteMaster("abcd");
+			std::this_thread::sleep_for(1ms);
+		}
+
+		std::unique_lock<std::mutex> lock(rx_mutex);
+		ASSERT_TRUE(rx_signal.wait_for(lock, 2s, [] { return rx_viewed.size() >= 64; }));
+		ASSERT_EQ(64u, rx_viewed.size());
+		ASSERT_LT(rx_batches.load(), 8u);
+	}
+
+
+	TEST(PtySerialDeviceTest, RxBatchingFlushesEarly)
+	{
+		PtyPair pty;
+		rx_viewed.clear();
+		rx_batches = 0;
+		pty.device.RxBatching({ 1024, 1000ms, '\n' });
+		ASSERT_EQ('\n', pty.device.RxBatching().delimiter);
+		pty.device.RxDelivery(SerialRxDelivery::Views);
+		pty.device.ReceivedView += CountRxBatch;
+		pty.device.UsingEvents(true);
+
+		//	the delimiter flushes well before the hold expires
+		auto start = std::chrono::steady_clock::now();
+		pty.WriteMaster("OK\n");
+		{
+			std::unique_lock<std::mutex> lock(rx_mutex);
+			ASSERT_TRUE(rx_signal.wait_for(lock, 2s, [] { return rx_viewed.size() >= 3; }));
+		}
+		ASSERT_LT(std::chrono::steady_clock::now() - start, 500ms);
+
+		//	a quiet line delivers once the hold expires
+		pty.device.Close();
+		PtyPair quiet;
+		rx_viewed.clear();
+		quiet.device.RxBatching({ 1024, 20ms, -1 });
+		quiet.device.RxDelivery(SerialRxDelivery::Views);
+		quiet.device.ReceivedView += CountRxBatch;
+		quiet.device.UsingEvents(true);
+
+		quiet.WriteMaster("partial");
+		std::unique_lock<std::mutex> lock(rx_mutex);
+		ASSERT_TRUE(rx_signal.wait_for(lock, 2s, [] { return rx_viewed.size() >= 7; }));
+		ASSERT_EQ("partial", rx_viewed);
+	}
+
+
+	TEST(PtySerialDeviceTest, RecordAndReplay)
+	{
+		const std::string path = (std::filesystem::temp_directory_path() / "pty-serial-device.cap").string();
+		{
+			PtyPair pty;
+			pty.device.RecordTo(std::make_shared<SerialRecorder>(path));
+
+			ASSERT_EQ(9u, pty.device.Write({ "AT", "+CSQ\r" , "\n\n" }));
+			ASSERT_EQ(9u, pty.ReadMaster(9).size());
+
+			pty.WriteMaster("+CSQ: 20,99\r\n");
+			std::string response;
+			ASSERT_TRUE(pty.device.ReadExactly(response, 13, 1000ms));
+			pty.WriteMaster("OK\r\n");
+			ASSERT_TRUE(pty.device.ReadUntil(response, "OK\r\n", 1000ms));
+		}
+
+		SerialCapture capture(path);
+		std::string written;
+		ReplayCapture(capture, [&](const void* data, size_t len) { written.append((const char*)data, len); },
+			0.0, SerialCaptureDirection::Tx);
+		ASSERT_EQ("AT+CSQ\r\n\n", written);
+
+		//	what the device read, fed to another device's consumer
+		PtyPair replay;
+		rx_viewed.clear();
+		replay.device.RxDelivery(SerialRxDelivery::Views);
+		replay.device.ReceivedView += HandleRxView;
+		replay.device.UsingEvents(true);
+		ASSERT_EQ(17u, ReplayCapture(capture, [&](const void* data, size_t len) {
+			replay.WriteMaster(std::string((const char*)data, len));
+		}));
+
+		std::unique_lock<std::mutex> lock(rx_mutex);
+		ASSERT_TRUE(rx_signal.wait_for(lock, 2s, [] { return rx_viewed.size() >= 17; }));
+		ASSERT_EQ("+CSQ: 20,99\r\nOK\r\n", rx_viewed);
+		std::remove(path.c_str());
+	}
+
+
+	///	A broadcast subscriber; a closed gate holds it in its handler.
+	struct RxSubscriber
+	{
+		void Receive(std::string_view data)
+		{
+			while (!open) std::this_thread::sleep_for(1ms);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			received.append(data.data(), data.size());
+		}
+
+		size_t Size()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return received.size();
+		}
+
+		std::atomic<bool> open = { true };
+		std::mutex mutex;
+		std::string received;
+	};
+
+
+	bool WaitForSize(RxSubscriber& subscriber, size_t size, std::chrono::milliseconds timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (subscriber.Size() < size)
+		{
+			if (std::chrono::steady_clock::now() > deadline) return false;
+			std::this_thread::sleep_for(1ms);
+		}
+		return true;
+	}
+
+
+	TEST(PtySerialDeviceTest, BroadcastIsolatesSlowSubscriber)
+	{
+		RxSubscriber fast, slow;
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		slow.open = false;
+		SerialBroadcast& broadcast = pty.device.Broadcast();
+		ASSERT_EQ(SerialRxDelivery::Broadcast, pty.device.RxDelivery());
+		ASSERT_NE(SerialBroadcastNone, broadcast.Subscribe(OnBroadcast(&fast, &RxSubscriber::Receive)));
+		SerialSubscriberId slowId = broadcast.Subscribe(OnBroadcast(&slow, &RxSubscriber::Receive));
+		pty.device.UsingEvents(true);
+
+		//	more than the RX ring holds, all while one subscriber is stuck
+		std::string payload(SerialRxRingSize + 4096, '\0');
+		for (size_t i = 0; i < payload.size(); i++) payload[i] = (char)('a' + i % 26);
+		pty.WriteMaster(payload);
+
+		ASSERT_TRUE(WaitForSize(fast, payload.size(), 5000ms));
+		ASSERT_EQ(payload, fast.received);
+		ASSERT_EQ(0u, slow.Size());
+
+		slow.open = true;
+		ASSERT_TRUE(WaitForSize(slow, payload.size(), 5000ms));
+		ASSERT_EQ(payload, slow.received);
+		ASSERT_EQ(0u, broadcast.Stats(slowId).dropped);
+		pty.device.Close();
+	}
+
+
+#ifdef SERIAL_STATS
+	TEST(PtySerialDeviceTest, CollectStats)
+	{
+		PtyPair pty;
+		ASSERT_EQ(0u, pty.device.Stats().bytesOut);
+
+		pty.device.CollectStats(true);
+		pty.device.RxDelivery(SerialRxDelivery::Buffered);
+		pty.device.UsingEvents(true);
+
+		const std::string command(100, 'A');
+		ASSERT_EQ(command.size(), pty.device.Write(command));
+		ASSERT_EQ(command, pty.ReadMaster(command.size()));
+
+		pty.WriteMaster("OK\r\n");
+		std::string reply;
+		ASSERT_EQ(4u, pty.device.ReadExactly(reply, 4, 1s));
+
+		SerialStats stats = pty.device.Stats();
+		ASSERT_EQ(100u, stats.bytesOut);
+		ASSERT_LE(1u, stats.writeCalls);
+		ASSERT_EQ(1u, stats.writeLatency.Count());
+		ASSERT_EQ(4u, stats.bytesIn);
+		ASSERT_LE(1u, stats.readCalls);
+		ASSERT_LE(1u, stats.commEvents);
+		ASSERT_EQ(stats.commEvents, stats.rxLatency.Count());
+	}
+#endif // SERIAL_STATS
+
+
+	TEST(PtySerialDeviceTest, Throughput)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		const std::string payload(1u << 20, 'U');
+		auto start = std::chrono::steady_clock::now();
+		std::thread writer([&] { pty.WriteMaster(payload); });
+
+		size_t received = 0;
+		std::string chunk;
+		while (received < payload.size())
+		{
+			received += pty.device.Read(chunk);
+		}
+		writer.join();
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		RecordProperty("bytes_per_second", std::to_string((long long)(received / elapsed.count())));
+		ASSERT_EQ(payload.size(), received);
+	}
+
+
+	TEST(PtySerialDeviceTest, RoundTripLatency)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		std::vector<double> samples;
+		std::string chunk;
+		for (int i = 0; i < 1000; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			ASSERT_EQ(1u, pty.device.Write("A"));
+			ASSERT_EQ("A", pty.ReadMaster(1));
+			pty.WriteMaster("0");
+			ASSERT_EQ(1u, pty.device.Read(chunk));
+			samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		std::sort(samples.begin(), samples.end());
+		RecordProperty("p50_us", std::to_string((long long)samples[samples.size() / 2]));
+		RecordProperty("p99_us", std::to_string((long long)samples[samples.size() * 99 / 100]));
+	}
+
+
+	size_t OpenDescriptors()
+	{
+		size_t count = 0;
+		if (DIR* fds = opendir("/proc/self/fd"))
+		{
+			while (readdir(fds)) count++;
+			closedir(fds);
+		}
+		return count;
+	}
+
+
+	TEST(PtySerialDeviceTest, WritesKeepResourcesFlat)
+	{
+		PtyPair pty;
+		pty.device.BaudRate(TestBaudRate);
+
+		std::atomic<bool> draining = { true };
+		std::thread drain([&] {
+			char buf[4096];
+			while (draining)
+			{
+				pollfd pfd = { pty.master, POLLIN, 0 };
+				if (poll(&pfd, 1, 10) > 0 && read(pty.master, buf, sizeof(buf)) < 0) break;
+			}
+		});
+
+		//	warm up, then every write must reuse the same resources
+		ASSERT_EQ(3u, pty.device.Write("AT\r"));
+		const size_t descriptors = OpenDescriptors();
+
+		size_t written = 0;
+		for (int i = 0; i < 1000000; i++)
+		{
+			written += pty.device.Write("AT\r");
+		}
+
+		draining = false;
+		drain.join();
+
+		ASSERT_EQ(3000000u, written);
+		ASSERT_EQ(descriptors, OpenDescriptors());
+	}
+
+
+	TEST(PtySerialDeviceTest, MoveAssignFlushesAndClosesTheOldPort)
+	{
+		PtyPair from;
+		PtyPair into;
+
+		//	read the old port until it hangs up
+		std::string drained;
+		std::thread drain([&] {
+			char buf[4096];
+			while (true)
+			{
+				pollfd pfd = { into.master, POLLIN, 0 };
+				if (poll(&pfd, 1, 1000) <= 0) break;
+				ssize_t res = read(into.master, buf, sizeof(buf));
+				if (res <= 0) break;
+				drained.append(buf, (size_t)res);
+			}
+		});
+
+		const std::string block(1024, 'q');
+		for (int i = 0; i < 64; i++) into.device.WriteAsync(block);
+
+		const size_t descriptors = OpenDescriptors();
+		into.device = std::move(from.device);
+		ASSERT_EQ(descriptors - 1, OpenDescriptors());
+		drain.join();
+
+		//	every queued write went to the old port, none to the new one
+		ASSERT_EQ(block.size() * 64, drained.size());
+		ASSERT_EQ("", from.ReadMaster(1, 50ms));
+		ASSERT_EQ(3u, into.device.Write("AT\r"));
+		ASSERT_EQ("AT\r", from.ReadMaster(3));
+	}
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialBroadcast.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	///	A subscriber keeping what it receives; a closed gate holds it in
+	///		its handler, as a slow disk would.
+	struct Collector
+	{
+		void Receive(std::string_view data)
+		{
+			while (!open) std::this_thread::sleep_for(1ms);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			received.append(data.data(), data.size());
+		}
+
+		std::string Received()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return received;
+		}
+
+		std::atomic<bool> open = { true };
+		std::mutex mutex;
+		std::string received;
+	};
+
+
+	bool WaitFor(SerialBroadcast& broadcast, SerialSubscriberId id, uint64_t bytes, std::chrono::milliseconds timeout = 2000ms)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (std::chrono::steady_clock::now() < deadline)
+		{
+			SerialSubscriberStats stats = broadcast.Stats(id);
+			if (stats.delivered + stats.dropped >= bytes) return true;
+			std::this_thread::sleep_for(1ms);
+		}
+		return false;
+	}
+
+
+	std::string Pattern(size_t len, size_t seed)
+	{
+		std::string data(len, '\0');
+		for (size_t i = 0; i < len; i++) data[i] = (char)('a' + (seed + i) % 26);
+		return data;
+	}
+
+
+	TEST(SerialBroadcastTest, EverySubscriberGetsEverything)
+	{
+		Collector first, second;
+		SerialBroadcast broadcast;
+		SerialSubscriberId a = broadcast.Subscribe(OnBroadcast(&first, &Collector::Receive));
+		SerialSubscriberId b = broadcast.Subscribe(OnBroadcast(&second, &Collector::Receive), SerialOverflowPolicy::Block);
+		ASSERT_EQ(2u, broadcast.Subscribers());
+
+		std::string sent;
+		for (size_t i = 0; i < 200; i++)
+		{
+			std::string chunk = Pattern(1 + i * 7 % 300, i);
+			ASSERT_EQ(chunk.size(), broadcast.Publish(chunk.data(), chunk.size()));
+			sent += chunk;
+		}
+
+		ASSERT_TRUE(WaitFor(broadcast, a, sent.size()));
+		ASSERT_TRUE(WaitFor(broadcast, b, sent.size()));
+		ASSERT_EQ(sent, first.Received());
+		ASSERT_EQ(sent, second.Received());
+		ASSERT_EQ(0u, broadcast.Stats(a).dropped);
+	}
+
+
+	TEST(SerialBroadcastTest, DropOldestNeverHoldsThePublisher)
+	{
+		Collector slow;
+		SerialBroadcast broadcast(0x4000);
+		slow.open = false;
+		SerialSubscriberId id = broadcast.Subscribe(OnBroadcast(&slow, &Collector::Receive), SerialOverflowPolicy::DropOldest);
+
+		const std::string chunk = Pattern(1000, 0);
+		size_t published = 0;
+		for (int i = 0; i < 100; i++) published += broadcast.Publish(chunk.data(), chunk.size());
+		ASSERT_EQ(100000u, published);
+
+		slow.open = true;
+		ASSERT_TRUE(WaitFor(broadcast, id, published));
+
+		SerialSubscriberStats stats = broadcast.Stats(id);
+		ASSERT_GE(stats.overflows, 1u);
+		ASSERT_GT(stats.dropped, 0u);
+		ASSERT_EQ(published, stats.delivered + stats.dropped);
+		ASSERT_TRUE(stats.connected);
+
+		//	what is kept is the newest data, in order
+		std::string received = slow.Received();
+		std::string tail = received.substr(received.size() - 2000);
+		ASSERT_EQ(chunk + chunk, tail);
+	}
+
+
+	TEST(SerialBroadcastTest, BlockHoldsThePublisher)
+	{
+		Collector slow;
+		SerialBroadcast broadcast(0x4000);
+		slow.open = false;
+		SerialSubscriberId id = broadcast.Subscribe(OnBroadcast(&slow, &Collector::Receive), SerialOverflowPolicy::Block);
+
+		std::string sent;
+		size_t offered = 0;
+		while (true)
+		{
+			std::string chunk = Pattern(1000, offered);
+			size_t published = broadcast.Publish(chunk.data(), chunk.size());
+			sent += chunk.substr(0, published);
+			offered += 1000;
+			if (published < chunk.size()) break;
+		}
+		ASSERT_EQ(0u, broadcast.Room());
+		ASSERT_FALSE(broadcast.AwaitRoom(10ms));
+
+		slow.open = true;
+		ASSERT_TRUE(broadcast.AwaitRoom(1000ms));
+		ASSERT_TRUE(WaitFor(broadcast, id, sent.size()));
+		ASSERT_EQ(sent, slow.Received());
+		ASSERT_EQ(0u, broadcast.Stats(id).dropped);
+	}
+
+
+	TEST(SerialBroadcastTest, DisconnectEndsOnlyTheSlowSubscriber)
+	{
+		Collector slow, fast;
+		SerialBroadcast broadcast(0x4000);
+		slow.open = false;
+		SerialSubscriberId dropped = broadcast.Subscribe(OnBroadcast(&slow, &Collector::Receive), SerialOverflowPolicy::Disconnect);
+		SerialSubscriberId kept = broadcast.Subscribe(OnBroadcast(&fast, &Collector::Receive), SerialOverflowPolicy::Disconnect);
+
+		const std::string chunk = Pattern(1000, 0);
+		size_t published = 0;
+		for (int i = 0; i < 100; i++)
+		{
+			published += broadcast.Publish(chunk.data(), chunk.size());
+			ASSERT_TRUE(WaitFor(broadcast, kept, published));
+		}
+
+		slow.open = true;
+		auto deadline = std::chrono::steady_clock::now() + 2s;
+		while (broadcast.Stats(dropped).connected && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+
+		SerialSubscriberStats stats = broadcast.Stats(dropped);
+		ASSERT_FALSE(stats.connected);
+		ASSERT_EQ(1u, stats.overflows);
+		ASSERT_GT(stats.dropped, 0u);
+
+		ASSERT_TRUE(broadcast.Stats(kept).connected);
+		ASSERT_EQ(published, fast.Received().size());
+	}
+
+
+	TEST(SerialBroadcastTest, SlotsAreReused)
+	{
+		Collector collector;
+		SerialBroadcast broadcast;
+
+		SerialSubscriberId ids[SerialBroadcastMaxSubscribers];
+		for (SerialSubscriberId& id : ids)
+		{
+			id = broadcast.Subscribe(OnBroadcast(&collector, &Collector::Receive));
+			ASSERT_NE(SerialBroadcastNone, id);
+		}
+		ASSERT_EQ(SerialBroadcastNone, broadcast.Subscribe(OnBroadcast(&collector, &Collector::Receive)));
+
+		broadcast.Unsubscribe(ids[3]);
+		ASSERT_FALSE(broadcast.Stats(ids[3]).connected);
+		ASSERT_EQ(ids[3], broadcast.Subscribe(OnBroadcast(&collector, &Collector::Receive)));
+	}
+}
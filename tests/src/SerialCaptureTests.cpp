@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialCapture.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	///	A capture file removed at the end of the test.
+	struct TempCapture
+	{
+		TempCapture()
+			: path((std::filesystem::temp_directory_path()
+				/ ("serial-capture-" + std::to_string(std::rand()) + ".cap")).string())
+		{
+		}
+
+		~TempCapture()
+		{
+			std::remove(path.c_str());
+		}
+
+		std::string path;
+	};
+
+
+	TEST(SerialCaptureTest, RoundTrip)
+	{
+		TempCapture file;
+		{
+			SerialRecorder recorder(file.path);
+			recorder.Append(SerialCaptureDirection::Rx, "hello", 5);
+
+			SerialBuffer buffers[] = { "AT", "+CSQ\r" };
+			recorder.Append(SerialCaptureDirection::Tx, buffers, 2, 7);
+			recorder.Append(SerialCaptureDirection::Tx, buffers, 2, 4);
+		}
+
+		SerialCapture capture(file.path);
+		std::vector<SerialCapture::Record> records(capture.begin(), capture.end());
+		ASSERT_EQ(3u, records.size());
+
+		ASSERT_EQ(SerialCaptureDirection::Rx, records[0].direction);
+		ASSERT_EQ("hello", records[0].data);
+		ASSERT_EQ(SerialCaptureDirection::Tx, records[1].direction);
+		ASSERT_EQ("AT+CSQ\r", records[1].data);
+		ASSERT_EQ("AT+C", records[2].data);
+
+		ASSERT_LE(records[0].offset, records[1].offset);
+		ASSERT_LE(records[1].offset, records[2].offset);
+		ASSERT_LE(capture.Started(), std::chrono::system_clock::now());
+	}
+
+
+	TEST(SerialCaptureTest, GrowsPastFirstMapping)
+	{
+		TempCapture file;
+		const std::string chunk(1000, 'g');
+		const size_t count = 2 * SerialCaptureGrowth / chunk.size();
+		{
+			SerialRecorder recorder(file.path);
+			for (size_t i = 0; i < count; i++)
+			{
+				recorder.Append(SerialCaptureDirection::Rx, chunk.data(), chunk.size());
+			}
+		}
+
+		SerialCapture capture(file.path);
+		ASSERT_EQ(std::filesystem::file_size(file.path), capture.Length());
+
+		size_t records = 0;
+		for (const SerialCapture::Record& record : capture)
+		{
+			ASSERT_EQ(chunk, record.data);
+			records++;
+		}
+		ASSERT_EQ(count, records);
+	}
+
+
+	TEST(SerialCaptureTest, ReadsWhileRecording)
+	{
+		TempCapture file;
+		SerialRecorder recorder(file.path);
+		recorder.Append(SerialCaptureDirection::Rx, "one", 3);
+
+		//	the file is still its mapped size; the header says where it ends
+		SerialCapture capture(file.path);
+		ASSERT_EQ(recorder.Length(), capture.Length());
+		ASSERT_EQ(1, std::distance(capture.begin(), capture.end()));
+		ASSERT_EQ("one", capture.begin()->data);
+	}
+
+
+	TEST(SerialCaptureTest, RejectsOtherFiles)
+	{
+		TempCapture file;
+		std::ofstream(file.path) << "not a capture file, but long enough to hold a header";
+
+		ASSERT_ANY_THROW(SerialCapture capture(file.path));
+		ASSERT_ANY_THROW(SerialCapture capture(file.path + ".missing"));
+	}
+
+
+	TEST(SerialCaptureTest, ReplayKeepsTiming)
+	{
+		TempCapture file;
+		{
+			SerialRecorder recorder(file.path);
+			recorder.Append(SerialCaptureDirection::Rx, "a", 1);
+			std::this_thread::sleep_for(40ms);
+			recorder.Append(SerialCaptureDirection::Tx, "ignored", 7);
+			recorder.Append(SerialCaptureDirection::Rx, "b", 1);
+		}
+		SerialCapture capture(file.path);
+
+		std::string replayed;
+		auto sink = [&](const void* data, size_t len) { replayed.append((const char*)data, len); };
+
+		auto start = std::chrono::steady_clock::now();
+		ASSERT_EQ(2u, ReplayCapture(capture, sink));
+		ASSERT_GE(std::chrono::steady_clock::now() - start, 40ms);
+		ASSERT_EQ("ab", replayed);
+
+		//	ten times faster, and as fast as possible
+		start = std::chrono::steady_clock::now();
+		ReplayCapture(capture, sink, 10.0);
+		ReplayCapture(capture, sink, 0.0);
+		ASSERT_LT(std::chrono::steady_clock::now() - start, 40ms);
+		ASSERT_EQ("ababab", replayed);
+	}
+}
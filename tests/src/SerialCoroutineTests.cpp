@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialCoroutine.hpp>
+
+#include "FakeModem.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	SerialTask<> Exchange(SerialDevice& device, std::string& reply, std::string& rest)
+	{
+		co_await WriteAsync(device, "AT\r");
+		co_await ReadUntilAsync(device, reply, "\r\n");
+
+		char buf[16];
+		size_t len = co_await ReadAsync(device, buf, sizeof(buf));
+		rest.assign(buf, len);
+	}
+
+
+	TEST(SerialCoroutineTest, ReadsAndWrites)
+	{
+		PtyPair pty;
+		pty.WriteMaster("OK\r\nRING");
+
+		std::string reply, rest;
+		SerialExecutor executor;
+		Spawn(executor, Exchange(pty.device, reply, rest));
+		executor.Run();
+
+		ASSERT_EQ("OK\r\n", reply);
+		ASSERT_EQ("RING", rest);
+		ASSERT_EQ("AT\r", pty.ReadMaster(3));
+		ASSERT_EQ(0u, executor.Waiting());
+	}
+
+
+	SerialTask<size_t> AwaitLine(SerialDevice& device, std::chrono::milliseconds timeout)
+	{
+		std::string line;
+		co_return co_await ReadUntilAsync(device, line, "\r\n", timeout);
+	}
+
+
+	SerialTask<> TimeOut(SerialDevice& device, size_t& read, std::chrono::milliseconds& waited)
+	{
+		auto started = std::chrono::steady_clock::now();
+		read = co_await AwaitLine(device, 50ms);
+		waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+	}
+
+
+	TEST(SerialCoroutineTest, ReadTimesOut)
+	{
+		PtyPair pty;
+		pty.WriteMaster("partial");
+
+		size_t read = 1;
+		std::chrono::milliseconds waited(0);
+		SerialExecutor executor;
+		Spawn(executor, TimeOut(pty.device, read, waited));
+		executor.Run();
+
+		ASSERT_EQ(0u, read);
+		ASSERT_GE(waited.count(), 50);
+		ASSERT_LT(waited.count(), 1000);
+	}
+
+
+	SerialTask<> Modem(SerialDevice& device, int exchanges, int& completed)
+	{
+		std::string line;
+		for (int i = 0; i < exchanges; i++)
+		{
+			co_await WriteAsync(device, "AT+CSQ\r");
+			do
+			{
+				if (!co_await ReadUntilAsync(device, line, "\r\n", 2000ms)) co_return;
+			} while (line != "OK\r\n");
+			completed++;
+		}
+	}
+
+
+	TEST(SerialCoroutineTest, ManySessionsOnOneThread)
+	{
+		std::vector<std::unique_ptr<FakeModem>> modems;
+		std::vector<int> completed(16, 0);
+
+		SerialExecutor executor;
+		for (size_t i = 0; i < completed.size(); i++)
+		{
+			modems.emplace_back(new FakeModem());
+			modems.back()->Script("AT+CSQ", "\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+			Spawn(executor, Modem(modems.back()->pty.device, 10, completed[i]));
+		}
+		executor.Run();
+
+		for (int done : completed) ASSERT_EQ(10, done);
+	}
+
+
+	SerialTask<> WriteAll(SerialDevice& device, std::string_view data, size_t& written)
+	{
+		written = co_await WriteAsync(device, data);
+	}
+
+
+	TEST(SerialCoroutineTest, ZeroWriteTimeoutsWaitForRoom)
+	{
+		PtyPair pty;
+		SerialSettings settings = pty.device.Settings();
+		settings.timeouts.writeTotalConstant = 0;
+		settings.timeouts.writeTotalMultiplier = 0;
+		ASSERT_TRUE(pty.device.Configure(settings));
+
+		//	more than the pty holds, drained only after the write has waited
+		const std::string data(256 * 1024, 'x');
+		size_t drained = 0;
+		std::thread reader([&]
+		{
+			std::this_thread::sleep_for(100ms);
+			drained = pty.ReadMaster(data.size(), 5000ms).size();
+		});
+
+		size_t written = 0;
+		SerialExecutor executor;
+		Spawn(executor, WriteAll(pty.device, data, written));
+		executor.Run();
+		reader.join();
+
+		ASSERT_EQ(data.size(), written);
+		ASSERT_EQ(data.size(), drained);
+	}
+
+
+	SerialTask<int> Fail()
+	{
+		co_await DelayAsync(1ms);
+		throw std::runtime_error("modem gone");
+	}
+
+
+	SerialTask<> Catch(bool& caught)
+	{
+		try
+		{
+			co_await Fail();
+		}
+		catch (const std::runtime_error&)
+		{
+			caught = true;
+		}
+	}
+
+
+	TEST(SerialCoroutineTest, ExceptionsReachTheAwaiter)
+	{
+		bool caught = false;
+		SerialExecutor executor;
+		Spawn(executor, Catch(caught));
+		executor.Run();
+
+		ASSERT_TRUE(caught);
+	}
+
+
+	struct Guard
+	{
+		explicit Guard(bool& released) : released(released) {}
+		~Guard() { released = true; }
+		bool& released;
+	};
+
+
+	SerialTask<> Forever(SerialDevice& device, bool& released)
+	{
+		Guard guard(released);
+		char buf[16];
+		co_await ReadAsync(device, buf, sizeof(buf));
+	}
+
+
+	SerialTask<> StopLater(SerialExecutor& executor)
+	{
+		co_await DelayAsync(10ms);
+		executor.Stop();
+	}
+
+
+	TEST(SerialCoroutineTest, UnfinishedSessionsAreDestroyed)
+	{
+		PtyPair pty;
+		bool released = false;
+		{
+			SerialExecutor executor;
+			Spawn(executor, Forever(pty.device, released));
+			Spawn(executor, StopLater(executor));
+			executor.Run();
+
+			ASSERT_EQ(1u, executor.Waiting());
+			ASSERT_FALSE(released);
+		}
+		ASSERT_TRUE(released);
+	}
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialFramer.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace Win32::Devices;
+
+namespace tests
+{
+	///	Feed the stream in slices of $sliceSize and collect the frames.
+	std::vector<std::string> FeedAll(SerialFramer& framer, const std::string& stream, size_t sliceSize)
+	{
+		std::vector<std::string> frames;
+		for (size_t at = 0; at < stream.size(); at += sliceSize)
+		{
+			framer.Feed(std::string_view(stream).substr(at, sliceSize),
+				[&](std::string_view frame) { frames.emplace_back(frame); });
+		}
+		return frames;
+	}
+
+
+	TEST(SerialFramerTest, DelimiterSplitsLines)
+	{
+		DelimiterFramer framer("\r\n");
+		auto frames = FeedAll(framer, "OK\r\n\r\n+CSQ: 20,99\r\nERR", 64);
+
+		ASSERT_EQ(3u, frames.size());
+		ASSERT_EQ("OK", frames[0]);
+		ASSERT_EQ("", frames[1]);
+		ASSERT_EQ("+CSQ: 20,99", frames[2]);
+	}
+
+
+	TEST(SerialFramerTest, DelimiterAcrossSlices)
+	{
+		const std::string stream = "first\r\nsecond line\r\nthird\r\n";
+		for (size_t sliceSize = 1; sliceSize <= stream.size(); sliceSize++)
+		{
+			DelimiterFramer framer("\r\n", true);
+			auto frames = FeedAll(framer, stream, sliceSize);
+
+			ASSERT_EQ(3u, frames.size()) << "slice " << sliceSize;
+			ASSERT_EQ("first\r\n", frames[0]);
+			ASSERT_EQ("second line\r\n", frames[1]);
+			ASSERT_EQ("third\r\n", frames[2]);
+		}
+	}
+
+
+	TEST(SerialFramerTest, FramesInsideSliceAreNotCopied)
+	{
+		DelimiterFramer framer("\n");
+		const std::string stream = "abc\ndef\n";
+		std::vector<const char*> starts;
+		framer.Feed(stream, [&](std::string_view frame) { starts.push_back(frame.data()); });
+
+		ASSERT_EQ(2u, starts.size());
+		ASSERT_EQ(stream.data(), starts[0]);
+		ASSERT_EQ(stream.data() + 4, starts[1]);
+	}
+
+
+	TEST(SerialFramerTest, OversizedFrameIsDropped)
+	{
+		DelimiterFramer framer("\n", false, 16);
+		auto frames = FeedAll(framer, std::string(40, 'x') + "\nok\n", 8);
+
+		ASSERT_EQ(1u, frames.size());
+		ASSERT_EQ("ok", frames[0]);
+		ASSERT_EQ(40u, framer.Dropped());
+	}
+
+
+	TEST(SerialFramerTest, FixedLength)
+	{
+		FixedLengthFramer framer(4);
+		auto frames = FeedAll(framer, "aaaabbbbccccdd", 3);
+
+		ASSERT_EQ(3u, frames.size());
+		ASSERT_EQ("bbbb", frames[1]);
+		ASSERT_EQ("cccc", frames[2]);
+	}
+
+
+	TEST(SerialFramerTest, LengthPrefix)
+	{
+		LengthPrefixFramer framer(2, true);
+		const std::string stream = std::string("\x00\x03" "abc" "\x00\x00" "\x00\x05" "hello", 14);
+
+		for (size_t sliceSize = 1; sliceSize <= stream.size(); sliceSize++)
+		{
+			framer.Reset();
+			auto frames = FeedAll(framer, stream, sliceSize);
+
+			ASSERT_EQ(3u, frames.size()) << "slice " << sliceSize;
+			ASSERT_EQ("abc", frames[0]);
+			ASSERT_EQ("", frames[1]);
+			ASSERT_EQ("hello", frames[2]);
+		}
+	}
+
+
+	TEST(SerialFramerTest, LengthPrefixLittleEndian)
+	{
+		LengthPrefixFramer framer(4, false);
+		auto frames = FeedAll(framer, std::string("\x02\x00\x00\x00" "hi", 6), 6);
+
+		ASSERT_EQ(1u, frames.size());
+		ASSERT_EQ("hi", frames[0]);
+	}
+
+
+	TEST(SerialFramerTest, SlipDecodes)
+	{
+		SlipFramer framer;
+		const std::string stream("\xC0" "a\xDB\xDC" "b\xDB\xDD" "c\xC0\xC0" "plain\xC0", 16);
+
+		for (size_t sliceSize = 1; sliceSize <= stream.size(); sliceSize++)
+		{
+			framer.Reset();
+			auto frames = FeedAll(framer, stream, sliceSize);
+
+			ASSERT_EQ(2u, frames.size()) << "slice " << sliceSize;
+			ASSERT_EQ(std::string("a\xC0" "b\xDB" "c"), frames[0]);
+			ASSERT_EQ("plain", frames[1]);
+		}
+	}
+
+
+	TEST(SerialFramerTest, CobsDecodes)
+	{
+		CobsFramer framer;
+		//	encodings of { 11 22 00 33 } and { 00 }
+		const std::string stream("\x03\x11\x22\x02\x33\x00" "\x01\x01\x00", 9);
+
+		for (size_t sliceSize = 1; sliceSize <= stream.size(); sliceSize++)
+		{
+			framer.Reset();
+			auto frames = FeedAll(framer, stream, sliceSize);
+
+			ASSERT_EQ(2u, frames.size()) << "slice " << sliceSize;
+			ASSERT_EQ(std::string("\x11\x22\x00\x33", 4), frames[0]);
+			ASSERT_EQ(std::string("\x00", 1), frames[1]);
+		}
+	}
+
+
+	TEST(SerialFramerTest, CobsLongRun)
+	{
+		CobsFramer framer;
+		std::string payload(300, 'z');
+		std::string stream;
+		stream += '\xFF';
+		stream.append(payload, 0, 254);
+		stream += (char)(46 + 1);
+		stream.append(payload, 254, 46);
+		stream += '\0';
+
+		auto frames = FeedAll(framer, stream, 100);
+		ASSERT_EQ(1u, frames.size());
+		ASSERT_EQ(payload, frames[0]);
+	}
+}
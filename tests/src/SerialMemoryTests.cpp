@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialMemory.hpp>
+
+#include "PtyPair.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	///	Every operator new made while counting, from any thread.
+	std::atomic<bool> CountingNew = { false };
+	std::atomic<size_t> NewCalls = { 0 };
+}
+
+void* operator new(size_t size)
+{
+	if (tests::CountingNew.load(std::memory_order_relaxed)) tests::NewCalls.fetch_add(1);
+	void* p = std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	if (tests::CountingNew.load(std::memory_order_relaxed)) tests::NewCalls.fetch_add(1);
+	size_t align = (size_t)alignment;
+	void* p = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace tests
+{
+	std::atomic<size_t> PayloadBytes = { 0 };
+	std::atomic<std::pmr::memory_resource*> PayloadMemory = { nullptr };
+
+	void CountPayload(SerialPayload payload)
+	{
+		PayloadMemory = payload.Memory();
+		PayloadBytes += payload.size();
+	}
+
+
+	bool AwaitPayloadBytes(size_t bytes, std::chrono::milliseconds timeout = 2000ms)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (PayloadBytes.load() < bytes)
+		{
+			if (std::chrono::steady_clock::now() >= deadline) return false;
+			std::this_thread::sleep_for(1ms);
+		}
+		return true;
+	}
+
+
+	void DrainMaster(PtyPair& pty, size_t len)
+	{
+		char buf[256];
+		size_t drained = 0;
+		auto deadline = std::chrono::steady_clock::now() + 2000ms;
+		while (drained < len && std::chrono::steady_clock::now() < deadline)
+		{
+			pollfd pfd = { pty.master, POLLIN, 0 };
+			if (poll(&pfd, 1, 10) <= 0) continue;
+			ssize_t res = read(pty.master, buf, std::min(sizeof(buf), len - drained));
+			if (res > 0) drained += (size_t)res;
+		}
+	}
+
+
+	TEST(SerialMemoryTest, PoolServesTheSmallestBlockThatFits)
+	{
+		SerialBlockPool pool({ 64, 256, 2 });
+		ASSERT_EQ((64u + 128u + 256u) * 2u, pool.Stats().capacity);
+
+		void* small = pool.allocate(10);
+		void* medium = pool.allocate(100);
+		void* spill = pool.allocate(60);
+		void* next = pool.allocate(60);
+		ASSERT_EQ(0u, (size_t)small % 64);
+		ASSERT_EQ(128, (uint8_t*)medium - (uint8_t*)small);
+		ASSERT_EQ(64, (uint8_t*)spill - (uint8_t*)small);
+		ASSERT_EQ((uint8_t*)medium + 128, (uint8_t*)next);
+		ASSERT_EQ(4u, pool.Stats().inUse);
+		ASSERT_EQ(0u, pool.Stats().fallbacks);
+
+		//	freed blocks are handed out again
+		pool.deallocate(spill, 60);
+		ASSERT_EQ(spill, pool.allocate(60));
+
+		for (void* p : { small, medium, spill, next }) pool.deallocate(p, 60);
+		ASSERT_EQ(0u, pool.Stats().inUse);
+		ASSERT_EQ(4u, pool.Stats().peak);
+	}
+
+
+	TEST(SerialMemoryTest, PoolFallsBackUpstream)
+	{
+		SerialBlockPool pool({ 64, 64, 1 });
+
+		void* block = pool.allocate(64);
+		void* overflow = pool.allocate(64);
+		void* large = pool.allocate(1000);
+		ASSERT_EQ(2u, pool.Stats().fallbacks);
+		ASSERT_EQ(1u, pool.Stats().inUse);
+
+		pool.deallocate(large, 1000);
+		pool.deallocate(overflow, 64);
+		pool.deallocate(block, 64);
+		ASSERT_EQ(0u, pool.Stats().inUse);
+	}
+
+
+	TEST(SerialMemoryTest, BuffersComeFromTheDeviceMemory)
+	{
+		SerialBlockPool pool;
+		SerialString a("long enough to leave the small string buffer", &pool);
+		ASSERT_EQ(1u, pool.Stats().inUse);
+
+		SerialRingBuffer ring(256, &pool);
+		ASSERT_EQ(&pool, ring.Memory());
+		ASSERT_EQ(2u, pool.Stats().inUse);
+
+		SerialPayload payload = SerialPayload::Allocate(300, &pool, [](char* dest, size_t len) {
+			std::memset(dest, 'x', len);
+		});
+		ASSERT_EQ(&pool, payload.Memory());
+		ASSERT_EQ(std::string(300, 'x'), payload.View());
+		ASSERT_EQ(0u, pool.Stats().fallbacks);
+
+		SerialPayload shared = payload;
+		payload = SerialPayload();
+		ASSERT_EQ(300u, shared.size());
+	}
+
+
+	TEST(SerialMemoryTest, SteadyStateDoesNotAllocate)
+	{
+		SerialBlockPool pool({ 64, 4096, 64 });
+		PtyPair pty;
+		pty.device.UsingMemory(&pool);
+		pty.device.RxDelivery(SerialRxDelivery::Payloads);
+		pty.device.ReceivedPayload += CountPayload;
+		pty.device.UsingEvents(true);
+
+		const std::string rx(200, 'r');
+		const std::string tx(100, 't');
+		const std::string header = "<hdr>";
+
+		//	warm up: the event thread, the transmit queue and its writer
+		PayloadBytes = 0;
+		pty.WriteMaster(rx);
+		ASSERT_TRUE(AwaitPayloadBytes(rx.size()));
+		ASSERT_EQ(tx.size(), pty.device.WriteAsync(tx).get());
+		DrainMaster(pty, tx.size());
+		SerialPoolStats warm = pool.Stats();
+
+		constexpr size_t Rounds = 200;
+		PayloadBytes = 0;
+		NewCalls = 0;
+		CountingNew = true;
+		for (size_t round = 0; round < Rounds; round++)
+		{
+			pty.WriteMaster(rx);
+			pty.device.Write(tx);
+			pty.device.WriteAsync({ header, tx }).get();
+			DrainMaster(pty, tx.size() * 2 + header.size());
+		}
+		bool received = AwaitPayloadBytes(rx.size() * Rounds);
+		CountingNew = false;
+
+		ASSERT_TRUE(received);
+		ASSERT_EQ(0u, NewCalls.load());
+		ASSERT_EQ(&pool, PayloadMemory.load());
+		ASSERT_EQ(warm.fallbacks, pool.Stats().fallbacks);
+	}
+}
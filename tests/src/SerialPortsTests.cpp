@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialPorts.hpp>
+
+#include <pty.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Win32::Devices;
+namespace fs = std::filesystem;
+
+namespace tests
+{
+	///	A sysfs tree with a USB-serial converter, a CDC ACM modem, an
+	///		on-board UART, a legacy 8250 placeholder and a console.
+	struct FakeSysfs
+	{
+		FakeSysfs()
+			: root(fs::temp_directory_path() / ("serial-ports-" + std::to_string(std::rand())))
+		{
+			fs::path usb = root / "devices/pci0000:00/usb1";
+			Attribute(usb / "1-1/idVendor", "0403");
+			Attribute(usb / "1-1/idProduct", "6001");
+			Attribute(usb / "1-1/serial", "A10K3XYZ");
+			Attribute(usb / "1-1/manufacturer", "FTDI");
+			Attribute(usb / "1-1/product", "FT232R USB UART");
+			Device("ttyUSB0", usb / "1-1/1-1:1.0/ttyUSB0", "usb-serial", "ftdi_sio");
+
+			Attribute(usb / "1-2/idVendor", "2c7c");
+			Attribute(usb / "1-2/idProduct", "0125");
+			Device("ttyACM0", usb / "1-2/1-2:1.2", "usb", "cdc_acm");
+
+			Device("ttyS4", root / "devices/pnp0/00:05", "pnp", "serial");
+			Device("ttyS0", root / "devices/platform/serial8250", "platform", "serial8250");
+			fs::create_directories(root / "class/tty/tty0");
+		}
+
+		~FakeSysfs()
+		{
+			fs::remove_all(root);
+		}
+
+		void Attribute(const fs::path& path, const std::string& value)
+		{
+			fs::create_directories(path.parent_path());
+			std::ofstream(path) << value << "\n";
+		}
+
+		void Device(const std::string& name, const fs::path& device, const std::string& bus, const std::string& driver)
+		{
+			fs::create_directories(device);
+			fs::create_directories(root / "bus" / bus / "drivers" / driver);
+			fs::create_directory_symlink(root / "bus" / bus / "drivers" / driver, device / "driver");
+			fs::create_directory_symlink(root / "bus" / bus, device / "subsystem");
+
+			fs::create_directories(root / "class/tty" / name);
+			fs::create_directory_symlink(device, root / "class/tty" / name / "device");
+		}
+
+		fs::path root;
+	};
+
+
+	TEST(SerialPortsTest, EnumerateFromSysfs)
+	{
+		FakeSysfs sysfs;
+		std::vector<SerialPortInfo> ports = SerialPorts::Enumerate((sysfs.root / "class/tty").string());
+
+		ASSERT_EQ(3u, ports.size());
+
+		ASSERT_EQ("/dev/ttyACM0", ports[0].path);
+		ASSERT_EQ("cdc_acm", ports[0].driver);
+		ASSERT_EQ(0x2c7c, ports[0].vendorId);
+		ASSERT_EQ(0x0125, ports[0].productId);
+		ASSERT_EQ("", ports[0].serialNumber);
+
+		ASSERT_EQ("/dev/ttyS4", ports[1].path);
+		ASSERT_EQ("serial", ports[1].driver);
+		ASSERT_FALSE(ports[1].IsUsb());
+
+		ASSERT_EQ("/dev/ttyUSB0", ports[2].path);
+		ASSERT_EQ("ftdi_sio", ports[2].driver);
+		ASSERT_EQ(0x0403, ports[2].vendorId);
+		ASSERT_EQ(0x6001, ports[2].productId);
+		ASSERT_EQ("A10K3XYZ", ports[2].serialNumber);
+		ASSERT_EQ("FTDI", ports[2].manufacturer);
+		ASSERT_EQ("FT232R USB UART", ports[2].product);
+	}
+
+
+	TEST(SerialPortsTest, EnumerateMissingClass)
+	{
+		ASSERT_TRUE(SerialPorts::Enumerate("/does-not-exist").empty());
+	}
+
+
+	TEST(SerialPortsTest, OpenManyWithoutThrowing)
+	{
+		std::vector<int> masters;
+		std::vector<std::string> paths;
+		for (int i = 0; i < 16; i++)
+		{
+			char name[128] = { 0 };
+			int master = -1, slave = -1;
+			ASSERT_EQ(0, openpty(&master, &slave, name, nullptr, nullptr));
+			close(slave);
+			masters.push_back(master);
+			paths.push_back(name);
+		}
+		paths.insert(paths.begin() + 8, "/dev/does-not-exist");
+
+		SerialSettings settings;
+		settings.baudRate = 115200;
+		std::vector<SerialOpenResult> results = SerialPorts::Open(paths, settings, 4);
+
+		ASSERT_EQ(paths.size(), results.size());
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			ASSERT_EQ(paths[i], results[i].path);
+			if (i == 8)
+			{
+				ASSERT_FALSE(results[i].Ok());
+				ASSERT_FALSE(results[i].device);
+				ASSERT_FALSE(results[i].error.empty());
+				continue;
+			}
+			ASSERT_TRUE(results[i].Ok()) << results[i].error;
+			ASSERT_EQ(115200u, results[i].device->BaudRate());
+		}
+
+		ASSERT_EQ(2u, results[3].device->Write("ok"));
+		char echo[2] = { 0 };
+		ASSERT_EQ(2, read(masters[3], echo, 2));
+
+		results.clear();
+		for (int master : masters) close(master);
+	}
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialReactor.hpp>
+
+#include "PtyPair.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	std::atomic<size_t> reactor_rx_bytes = { 0 };
+
+	void CountRxData(std::string rx_data)
+	{
+		reactor_rx_bytes += rx_data.size();
+	}
+
+
+	bool WaitForBytes(size_t expected, std::chrono::milliseconds timeout = 2000ms)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (reactor_rx_bytes.load() < expected && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+		return reactor_rx_bytes.load() == expected;
+	}
+
+
+	TEST(SerialReactorTest, DispatchesManyDevices)
+	{
+		SerialReactor reactor(2);
+		std::vector<std::unique_ptr<PtyPair>> ports;
+
+		reactor_rx_bytes = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			ports.emplace_back(new PtyPair());
+			ports.back()->device.ReceivedData += CountRxData;
+			reactor.Attach(ports.back()->device);
+		}
+		ASSERT_EQ(16u, reactor.Attached());
+
+		for (auto& port : ports) port->WriteMaster("OK\r\n");
+		ASSERT_TRUE(WaitForBytes(16 * 4));
+	}
+
+
+	TEST(SerialReactorTest, HungUpDeviceLeavesPoolIdle)
+	{
+		SerialReactor reactor(2);
+		PtyPair pty;
+		reactor_rx_bytes = 0;
+		pty.device.ReceivedData += CountRxData;
+		reactor.Attach(pty.device);
+
+		pty.WriteMaster("OK\r\n");
+		ASSERT_TRUE(WaitForBytes(4));
+		pty.CloseMaster();
+
+		//	a rearmed hung up line would keep a pool thread busy
+		std::this_thread::sleep_for(100ms);
+		auto used = ProcessCpuTime();
+		std::this_thread::sleep_for(1s);
+		ASSERT_LT(ProcessCpuTime() - used, 200ms);
+	}
+
+
+	TEST(SerialReactorTest, DetachStopsDispatch)
+	{
+		SerialReactor reactor;
+		PtyPair pty;
+
+		reactor_rx_bytes = 0;
+		pty.device.ReceivedData += CountRxData;
+		reactor.Attach(pty.device);
+		reactor.Detach(pty.device);
+		ASSERT_EQ(0u, reactor.Attached());
+
+		pty.WriteMaster("OK\r\n");
+		std::this_thread::sleep_for(50ms);
+		ASSERT_EQ(0u, reactor_rx_bytes.load());
+		ASSERT_EQ(4u, pty.device.Available());
+	}
+
+
+	std::atomic<bool> reactor_handler_busy = { false };
+	std::atomic<bool> reactor_handler_release = { false };
+
+	void HoldRxData(std::string)
+	{
+		reactor_handler_busy = true;
+		while (!reactor_handler_release) std::this_thread::sleep_for(1ms);
+	}
+
+
+	TEST(SerialReactorTest, AttachWhileDetachWaits)
+	{
+		SerialReactor reactor(1);
+		PtyPair held;
+		reactor_handler_busy = false;
+		reactor_handler_release = false;
+		held.device.ReceivedData += HoldRxData;
+		reactor.Attach(held.device);
+
+		held.WriteMaster("OK\r\n");
+		while (!reactor_handler_busy) std::this_thread::sleep_for(1ms);
+		std::thread detacher([&] { reactor.Detach(held.device); });
+
+		//	enough attaches to rehash the registry under the waiting detach
+		std::this_thread::sleep_for(20ms);
+		std::vector<std::unique_ptr<PtyPair>> ports;
+		for (int i = 0; i < 64; i++)
+		{
+			ports.emplace_back(new PtyPair());
+			reactor.Attach(ports.back()->device);
+		}
+
+		reactor_handler_release = true;
+		detacher.join();
+		ASSERT_EQ(64u, reactor.Attached());
+	}
+
+
+	TEST(SerialReactorTest, CloseDetaches)
+	{
+		SerialReactor reactor;
+		PtyPair pty;
+
+		reactor.Attach(pty.device);
+		pty.device.Close();
+		ASSERT_EQ(0u, reactor.Attached());
+	}
+
+
+	TEST(SerialReactorTest, OutlivedByDevice)
+	{
+		PtyPair pty;
+		{
+			SerialReactor reactor;
+			reactor.Attach(pty.device);
+		}
+		pty.device.Close();
+	}
+}
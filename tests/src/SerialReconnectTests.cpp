@@ -0,0 +1,276 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialDevice.hpp>
+#include <Win32.Devices.SerialPorts.hpp>
+
+#include <pty.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	///	A pseudo-terminal behind a stable link, as udev gives a USB adapter
+	///		under /dev/serial/by-id. Unplugging closes the master, so the
+	///		device sees a hang up; plugging in again opens a new pair and
+	///		points the link at it.
+	struct HotPlugPty
+	{
+		HotPlugPty()
+		{
+			link = (std::filesystem::temp_directory_path() / ("serial-hotplug-" + std::to_string(getpid()))).string();
+			Plug();
+			device = SerialDevice::FromPath(link);
+		}
+
+		~HotPlugPty()
+		{
+			device.Close();
+			Unplug();
+			std::remove(link.c_str());
+		}
+
+		void Plug()
+		{
+			char name[128] = { 0 };
+			int slave = -1;
+			if (openpty(&master, &slave, name, nullptr, nullptr) != 0) return;
+			close(slave);
+
+			std::string staged = link + ".new";
+			std::remove(staged.c_str());
+			if (symlink(name, staged.c_str()) == 0) std::rename(staged.c_str(), link.c_str());
+		}
+
+		void Unplug()
+		{
+			if (master >= 0) close(master);
+			master = -1;
+		}
+
+		std::string ReadMaster(size_t len, std::chrono::milliseconds timeout = 2000ms)
+		{
+			std::string out;
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (out.size() < len && std::chrono::steady_clock::now() < deadline)
+			{
+				pollfd pfd = { master, POLLIN, 0 };
+				if (poll(&pfd, 1, 10) > 0)
+				{
+					char buf[256];
+					ssize_t res = read(master, buf, std::min(sizeof(buf), len - out.size()));
+					if (res > 0) out.append(buf, (size_t)res);
+				}
+			}
+			return out;
+		}
+
+		void WriteMaster(const std::string& data)
+		{
+			ssize_t written = write(master, data.data(), data.size());
+			(void)written;
+		}
+
+		int master = -1;
+		std::string link;
+		SerialDevice device = { nullptr };
+	};
+
+
+	std::mutex states_lock;
+	std::vector<SerialConnectionState> states;
+
+	void RecordState(SerialConnectionState state)
+	{
+		std::lock_guard<std::mutex> lock(states_lock);
+		states.push_back(state);
+	}
+
+
+	bool WaitForState(SerialConnectionState state, std::chrono::milliseconds timeout = 3000ms)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (std::chrono::steady_clock::now() < deadline)
+		{
+			{
+				std::lock_guard<std::mutex> lock(states_lock);
+				if (std::find(states.begin(), states.end(), state) != states.end()) return true;
+			}
+			std::this_thread::sleep_for(1ms);
+		}
+		return false;
+	}
+
+
+	SerialReconnect FastReconnect()
+	{
+		SerialReconnect reconnect;
+		reconnect.firstDelay = 10ms;
+		reconnect.maxDelay = 40ms;
+		return reconnect;
+	}
+
+
+	void Supervise(HotPlugPty& pty, const SerialReconnect& reconnect = FastReconnect())
+	{
+		states.clear();
+		pty.device.RxDelivery(SerialRxDelivery::Buffered);
+		pty.device.ConnectionChanged += RecordState;
+		pty.device.Supervise(reconnect);
+		pty.device.UsingEvents(true);
+	}
+
+
+	TEST(SerialReconnectTest, ReopensAndReappliesSettings)
+	{
+		HotPlugPty pty;
+		ASSERT_GE(pty.master, 0);
+		pty.device.BaudRate(115200);
+		Supervise(pty);
+
+		pty.Unplug();
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Lost));
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Reconnecting));
+
+		pty.Plug();
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Connected));
+		ASSERT_EQ(SerialConnectionState::Connected, pty.device.Connection());
+		ASSERT_EQ(SerialConnectionState::Lost, states.front());
+
+		//	master and slave share their termios
+		termios tty = { 0 };
+		ASSERT_EQ(0, tcgetattr(pty.master, &tty));
+		ASSERT_EQ((speed_t)B115200, cfgetospeed(&tty));
+
+		pty.WriteMaster("after");
+		std::string received;
+		ASSERT_EQ(5u, pty.device.ReadExactly(received, 5, 2000ms));
+		ASSERT_EQ("after", received);
+
+		ASSERT_EQ(5u, pty.device.Write("hello"));
+		ASSERT_EQ("hello", pty.ReadMaster(5));
+	}
+
+
+	TEST(SerialReconnectTest, KeepsUnreadRx)
+	{
+		HotPlugPty pty;
+		Supervise(pty);
+
+		pty.WriteMaster("before");
+		std::this_thread::sleep_for(100ms);
+
+		pty.Unplug();
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Lost));
+		pty.Plug();
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Connected));
+
+		pty.WriteMaster("|after");
+		std::string received;
+		ASSERT_EQ(12u, pty.device.ReadExactly(received, 12, 2000ms));
+		ASSERT_EQ("before|after", received);
+	}
+
+
+	TEST(SerialReconnectTest, KeepsQueuedTx)
+	{
+		HotPlugPty pty;
+		Supervise(pty);
+
+		pty.Unplug();
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Lost));
+
+		//	queued while the adapter is gone
+		std::future<size_t> first = pty.device.WriteAsync("queued ");
+		std::future<size_t> second = pty.device.WriteAsync("while lost");
+		ASSERT_EQ(std::future_status::timeout, first.wait_for(50ms));
+
+		pty.Plug();
+		ASSERT_EQ("queued while lost", pty.ReadMaster(17));
+		ASSERT_EQ(7u, first.get());
+		ASSERT_EQ(10u, second.get());
+	}
+
+
+	TEST(SerialReconnectTest, GivesUpAfterMaxAttempts)
+	{
+		HotPlugPty pty;
+		SerialReconnect reconnect = FastReconnect();
+		reconnect.maxAttempts = 3;
+		Supervise(pty, reconnect);
+
+		pty.Unplug();
+		std::remove(pty.link.c_str());
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Failed));
+
+		size_t reconnecting = 0;
+		{
+			std::lock_guard<std::mutex> lock(states_lock);
+			reconnecting = (size_t)std::count(states.begin(), states.end(), SerialConnectionState::Reconnecting);
+		}
+		ASSERT_EQ(3u, reconnecting);
+		ASSERT_EQ(SerialConnectionState::Failed, pty.device.Connection());
+
+		//	held writes are released rather than left waiting
+		ASSERT_EQ(0u, pty.device.WriteAsync("dropped").get());
+	}
+
+
+	TEST(SerialReconnectTest, CloseWhileLost)
+	{
+		HotPlugPty pty;
+		Supervise(pty);
+
+		pty.Unplug();
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Lost));
+		std::future<size_t> held = pty.device.WriteAsync("held");
+
+		pty.device.Close();
+		ASSERT_EQ(0u, held.get());
+	}
+
+
+	TEST(SerialReconnectTest, ReopensBulkOpenedPort)
+	{
+		HotPlugPty pty;
+		ASSERT_GE(pty.master, 0);
+		pty.device.Close();
+
+		std::vector<SerialOpenResult> results = SerialPorts::Open({ pty.link }, SerialSettings());
+		ASSERT_EQ(1u, results.size());
+		ASSERT_TRUE(results[0].Ok());
+		SerialDevice& device = *results[0].device;
+
+		states.clear();
+		device.RxDelivery(SerialRxDelivery::Buffered);
+		device.ConnectionChanged += RecordState;
+		device.Supervise(FastReconnect());
+		device.UsingEvents(true);
+
+		pty.Unplug();
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Reconnecting));
+		pty.Plug();
+		ASSERT_TRUE(WaitForState(SerialConnectionState::Connected));
+
+		ASSERT_EQ(5u, device.Write("hello"));
+		ASSERT_EQ("hello", pty.ReadMaster(5));
+		device.Close();
+	}
+
+
+	TEST(SerialReconnectTest, UnsupervisedWithoutPath)
+	{
+		SerialDevice device = { nullptr };
+		device.Supervise();
+		ASSERT_EQ(SerialConnectionState::Connected, device.Connection());
+	}
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialRingBuffer.hpp>
+
+#include <string>
+#include <thread>
+
+using namespace Win32::Devices;
+
+namespace tests
+{
+	TEST(SerialRingBufferTest, CapacityIsPowerOfTwo)
+	{
+		SerialRingBuffer ring(1000);
+		ASSERT_EQ(1024u, ring.Capacity());
+		ASSERT_EQ(0u, ring.Size());
+		ASSERT_EQ(1024u, ring.Free());
+	}
+
+
+	TEST(SerialRingBufferTest, StorageIsCacheLineAligned)
+	{
+		SerialRingBuffer ring(256);
+		size_t span = 0;
+		ASSERT_EQ(0u, (uintptr_t)ring.Prepare(span) % SerialCacheLine);
+		ASSERT_EQ(256u, span);
+	}
+
+
+	TEST(SerialRingBufferTest, WriteStopsWhenFull)
+	{
+		SerialRingBuffer ring(64);
+		std::string data(100, 'x');
+		ASSERT_EQ(64u, ring.Write(data.data(), data.size()));
+		ASSERT_EQ(0u, ring.Free());
+		ASSERT_EQ(0u, ring.Write("y", 1));
+	}
+
+
+	TEST(SerialRingBufferTest, PeekSplitsAtWrap)
+	{
+		SerialRingBuffer ring(64);
+		std::string head(48, 'a');
+		ring.Write(head.data(), head.size());
+		ring.Consume(48);
+
+		std::string wrapped(32, 'b');
+		ASSERT_EQ(32u, ring.Write(wrapped.data(), wrapped.size()));
+
+		size_t span = 0;
+		ring.Peek(span);
+		ASSERT_EQ(16u, span);
+		ring.Consume(span);
+		ring.Peek(span);
+		ASSERT_EQ(16u, span);
+	}
+
+
+	TEST(SerialRingBufferTest, ProducerConsumerThreads)
+	{
+		SerialRingBuffer ring(4096);
+		const size_t total = 1u << 20;
+
+		std::thread producer([&] {
+			uint8_t value = 0;
+			size_t sent = 0;
+			while (sent < total)
+			{
+				size_t span = 0;
+				uint8_t* dest = ring.Prepare(span);
+				if (!span) std::this_thread::yield();
+				span = (std::min)(span, total - sent);
+				for (size_t i = 0; i < span; i++) dest[i] = value++;
+				ring.Commit(span);
+				sent += span;
+			}
+		});
+
+		uint8_t expected = 0;
+		size_t received = 0;
+		bool ordered = true;
+		while (received < total)
+		{
+			size_t span = 0;
+			const uint8_t* src = ring.Peek(span);
+			if (!span) std::this_thread::yield();
+			for (size_t i = 0; i < span; i++) ordered &= (src[i] == expected++);
+			ring.Consume(span);
+			received += span;
+		}
+		producer.join();
+
+		ASSERT_TRUE(ordered);
+	}
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialShared.hpp>
+
+#include "PtyPair.hpp"
+
+#include <sys/wait.h>
+
+#include <string>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	std::string RingName(const char* test)
+	{
+		return std::string("serial-shared-") + test + "-" + std::to_string(getpid());
+	}
+
+
+	std::string Pattern(size_t len, size_t seed = 0)
+	{
+		std::string out(len, '\0');
+		for (size_t i = 0; i < len; i++) out[i] = (char)('a' + (seed + i) % 26);
+		return out;
+	}
+
+
+	std::string ReadAll(SerialSharedReader& reader, size_t len, std::chrono::milliseconds timeout = 2000ms)
+	{
+		std::string out;
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (out.size() < len && std::chrono::steady_clock::now() < deadline)
+		{
+			std::string_view view = reader.Peek(10ms);
+			std::string copy(view.substr(0, len - out.size()));
+			if (reader.Consume(copy.size())) out += copy;
+		}
+		return out;
+	}
+
+
+	TEST(SerialSharedTest, PeekIsInPlace)
+	{
+		SerialSharedPublisher publisher(RingName("peek"), 0x1000);
+		SerialSharedReader reader(RingName("peek"));
+		ASSERT_EQ(0x1000u, reader.Capacity());
+		ASSERT_TRUE(reader.Peek(0ms).empty());
+
+		publisher.Publish("hello", 5);
+		ASSERT_EQ(5u, reader.Available());
+
+		std::string_view first = reader.Peek(0ms);
+		ASSERT_EQ("hello", first);
+		ASSERT_TRUE(reader.Consume(2));
+		std::string_view rest = reader.Peek(0ms);
+		ASSERT_EQ("llo", rest);
+		ASSERT_EQ(first.data() + 2, rest.data());
+		ASSERT_TRUE(reader.Consume(rest.size()));
+
+		ASSERT_EQ(5u, reader.Stats().delivered);
+		ASSERT_EQ(5u, publisher.Published());
+	}
+
+
+	TEST(SerialSharedTest, WrapsInTwoSlices)
+	{
+		SerialSharedPublisher publisher(RingName("wrap"), 0x1000);
+		SerialSharedReader reader(RingName("wrap"));
+
+		std::string filler = Pattern(0x1000 - 10);
+		publisher.Publish(filler.data(), filler.size());
+		ASSERT_EQ(filler, ReadAll(reader, filler.size()));
+
+		std::string wrapped = Pattern(30, 7);
+		publisher.Publish(wrapped.data(), wrapped.size());
+		std::string_view head = reader.Peek(0ms);
+		ASSERT_EQ(10u, head.size());
+		ASSERT_TRUE(reader.Consume(head.size()));
+		ASSERT_EQ(wrapped.substr(10), std::string(reader.Peek(0ms)));
+	}
+
+
+	TEST(SerialSharedTest, ReadersHaveTheirOwnCursors)
+	{
+		SerialSharedPublisher publisher(RingName("cursors"), 0x1000);
+		SerialSharedReader early(RingName("cursors"));
+		publisher.Publish("one,", 4);
+		SerialSharedReader late(RingName("cursors"));
+		publisher.Publish("two", 3);
+
+		ASSERT_EQ("one,two", ReadAll(early, 7));
+		ASSERT_EQ("two", ReadAll(late, 3));
+
+		char buf[8];
+		ASSERT_EQ(0u, early.Read(buf, sizeof(buf), 10ms));
+	}
+
+
+	TEST(SerialSharedTest, SlowReaderSkipsAhead)
+	{
+		SerialSharedPublisher publisher(RingName("slow"), 0x1000);
+		SerialSharedReader reader(RingName("slow"));
+
+		std::string_view stale = (publisher.Publish("old", 3), reader.Peek(0ms));
+		ASSERT_EQ(3u, stale.size());
+
+		//	the publisher laps the reader without waiting for it
+		std::string lap = Pattern(0x1800);
+		publisher.Publish(lap.data(), lap.size());
+		ASSERT_FALSE(reader.Consume(stale.size()));
+
+		SerialSubscriberStats stats = reader.Stats();
+		ASSERT_EQ(1u, stats.overflows);
+		ASSERT_EQ(0x1803u - 0x800u, stats.dropped);
+		ASSERT_EQ(lap.substr(lap.size() - 0x800), ReadAll(reader, 0x800));
+
+		//	more than a ring at once keeps only the newest
+		std::string flood = Pattern(0x3000, 3);
+		publisher.Publish(flood.data(), flood.size());
+		ASSERT_EQ(flood.substr(flood.size() - 0x800), ReadAll(reader, 0x800));
+		ASSERT_EQ(2u, reader.Stats().overflows);
+	}
+
+
+	TEST(SerialSharedTest, ClosingEndsTheReaders)
+	{
+		std::unique_ptr<SerialSharedPublisher> publisher(new SerialSharedPublisher(RingName("close")));
+		SerialSharedReader reader(RingName("close"));
+		publisher->Publish("last", 4);
+		publisher.reset();
+
+		ASSERT_FALSE(reader.Stats().connected);
+		ASSERT_EQ("last", ReadAll(reader, 4));
+
+		auto started = std::chrono::steady_clock::now();
+		ASSERT_TRUE(reader.Peek(1000ms).empty());
+		ASSERT_LT(std::chrono::steady_clock::now() - started, 500ms);
+
+		ASSERT_ANY_THROW(SerialSharedReader(RingName("close")));
+	}
+
+
+	TEST(SerialSharedTest, SleepingReaderIsWoken)
+	{
+		SerialSharedPublisher publisher(RingName("wake"));
+		SerialSharedReader reader(RingName("wake"));
+
+		std::thread later([&] {
+			std::this_thread::sleep_for(50ms);
+			publisher.Publish("late", 4);
+		});
+		auto started = std::chrono::steady_clock::now();
+		std::string_view view = reader.Peek(5000ms);
+		later.join();
+
+		ASSERT_EQ("late", view);
+		ASSERT_LT(std::chrono::steady_clock::now() - started, 2000ms);
+	}
+
+
+	TEST(SerialSharedTest, DeviceSharesWithAnotherProcess)
+	{
+		PtyPair pty;
+		const std::string name = RingName("device");
+		pty.device.Share(name, 0x10000);
+		ASSERT_EQ(SerialRxDelivery::Shared, pty.device.RxDelivery());
+
+		const std::string expected = Pattern(20000, 5);
+		int ready[2];
+		ASSERT_EQ(0, pipe(ready));
+
+		pid_t child = fork();
+		ASSERT_GE(child, 0);
+		if (child == 0)
+		{
+			//	a reader with no access to the port
+			SerialSharedReader reader(name);
+			ssize_t told = write(ready[1], "r", 1);
+			(void)told;
+			_exit(ReadAll(reader, expected.size(), 5000ms) == expected ? 0 : 1);
+		}
+
+		char byte = 0;
+		ASSERT_EQ(1, read(ready[0], &byte, 1));
+		close(ready[0]);
+		close(ready[1]);
+
+		pty.device.UsingEvents(true);
+		pty.WriteMaster(expected);
+
+		int status = 0;
+		ASSERT_EQ(child, waitpid(child, &status, 0));
+		ASSERT_TRUE(WIFEXITED(status));
+		ASSERT_EQ(0, WEXITSTATUS(status));
+	}
+}
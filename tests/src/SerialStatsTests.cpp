@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialStats.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace Win32::Devices;
+
+namespace tests
+{
+	TEST(SerialHistogramTest, BucketsHoldTheirValues)
+	{
+		for (uint64_t value : { 0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull })
+		{
+			size_t bucket = SerialHistogram::bucket_of(value);
+			ASSERT_LT(bucket, SerialHistogram::Buckets);
+			ASSERT_LE(value, SerialHistogram::upper_bound(bucket));
+			if (bucket)
+			{
+				ASSERT_GT(value, SerialHistogram::upper_bound(bucket - 1));
+			}
+		}
+	}
+
+
+	TEST(SerialHistogramTest, PercentilesWithinPrecision)
+	{
+		SerialHistogram histogram;
+		for (uint64_t value = 1; value <= 10000; value++) histogram.Record(value * 1000);
+
+		SerialHistogram::Snapshot snapshot = histogram.Read();
+		ASSERT_EQ(10000u, snapshot.Count());
+
+		auto near = [](uint64_t actual, double expected) {
+			return actual >= expected && actual <= expected * 1.0625;
+		};
+		ASSERT_TRUE(near(snapshot.Percentile(50.0), 5000000.0));
+		ASSERT_TRUE(near(snapshot.Percentile(99.0), 9900000.0));
+		ASSERT_TRUE(near(snapshot.Max(), 10000000.0));
+	}
+
+
+	TEST(SerialHistogramTest, EmptySnapshot)
+	{
+		SerialHistogram histogram;
+		SerialHistogram::Snapshot snapshot = histogram.Read();
+		ASSERT_EQ(0u, snapshot.Count());
+		ASSERT_EQ(0u, snapshot.Percentile(99.0));
+		ASSERT_EQ(0u, snapshot.Max());
+	}
+
+
+	TEST(SerialHistogramTest, ConcurrentRecording)
+	{
+		SerialHistogram histogram;
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++)
+		{
+			threads.emplace_back([&] {
+				for (uint64_t i = 0; i < 10000; i++) histogram.Record(i);
+			});
+		}
+		for (auto& thread : threads) thread.join();
+
+		ASSERT_EQ(40000u, histogram.Read().Count());
+	}
+}
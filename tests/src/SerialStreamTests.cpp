@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialStream.hpp>
+
+#include "PtyPair.hpp"
+
+#include <string>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	TEST(SerialStreamTest, ParsesFormattedInput)
+	{
+		PtyPair pty;
+		SerialStream stream(pty.device);
+
+		pty.WriteMaster("42 3.5 OK\r\n+CSQ: 17,99\r\n");
+		int number = 0;
+		double real = 0;
+		std::string word;
+		stream >> number >> real >> word;
+		ASSERT_EQ(42, number);
+		ASSERT_DOUBLE_EQ(3.5, real);
+		ASSERT_EQ("OK", word);
+
+		std::string line;
+		stream >> std::ws;
+		ASSERT_TRUE(std::getline(stream, line));
+		ASSERT_EQ("+CSQ: 17,99\r", line);
+	}
+
+
+	TEST(SerialStreamTest, RefillsOnceABuffer)
+	{
+		PtyPair pty;
+		pty.device.CollectStats(true);
+		SerialStream stream(pty.device, 4096);
+
+		std::string lines;
+		for (int i = 0; i < 64; i++) lines += "line " + std::to_string(i) + "\n";
+		pty.WriteMaster(lines);
+
+		std::string line;
+		for (int i = 0; i < 64; i++)
+		{
+			ASSERT_TRUE(std::getline(stream, line));
+			ASSERT_EQ("line " + std::to_string(i), line);
+		}
+#ifdef SERIAL_STATS
+		ASSERT_LT(pty.device.Stats().readCalls, 16u);
+#endif // SERIAL_STATS
+	}
+
+
+	TEST(SerialStreamTest, TimesOutAndResumes)
+	{
+		PtyPair pty;
+		SerialStream stream(pty.device);
+		stream.ReadTimeout(20ms);
+
+		std::string line;
+		auto start = std::chrono::steady_clock::now();
+		ASSERT_FALSE(std::getline(stream, line));
+		ASSERT_GE(std::chrono::steady_clock::now() - start, 20ms);
+		ASSERT_TRUE(stream.TimedOut());
+		ASSERT_TRUE(stream.eof());
+
+		stream.clear();
+		pty.WriteMaster("late\n");
+		stream.ReadTimeout(1000ms);
+		ASSERT_TRUE(std::getline(stream, line));
+		ASSERT_EQ("late", line);
+		ASSERT_FALSE(stream.TimedOut());
+	}
+
+
+	TEST(SerialStreamTest, HoldsWritesUntilFlushed)
+	{
+		PtyPair pty;
+		SerialStream stream(pty.device);
+
+		stream << "AT+CSQ" << '=' << 1 << "\r";
+		ASSERT_EQ("", pty.ReadMaster(9, 50ms));
+
+		stream << std::flush;
+		ASSERT_TRUE(stream.good());
+		ASSERT_EQ("AT+CSQ=1\r", pty.ReadMaster(9));
+	}
+
+
+	TEST(SerialStreamTest, ReadingSendsHeldWrites)
+	{
+		PtyPair pty;
+		SerialStream stream(pty.device);
+		stream.ReadTimeout(50ms);
+
+		stream << "AT\r";
+		std::string reply;
+		stream >> reply;
+		ASSERT_EQ("AT\r", pty.ReadMaster(3));
+	}
+
+
+	TEST(SerialStreamTest, LargeWritesGoStraightThrough)
+	{
+		PtyPair pty;
+		SerialStream stream(pty.device, 256, 256);
+
+		const std::string large(1000, 'x');
+		stream << "head:" << large;
+		ASSERT_TRUE(stream.good());
+		ASSERT_EQ("head:" + large, pty.ReadMaster(large.size() + 5));
+	}
+}
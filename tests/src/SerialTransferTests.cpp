@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialCrc.hpp>
+#include <Win32.Devices.SerialTransfer.hpp>
+
+#include "XmodemReceiver.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	std::string Image(size_t len)
+	{
+		std::mt19937 random(7);
+		std::string image(len, '\0');
+		for (char& c : image) c = (char)random();
+		return image;
+	}
+
+
+	std::string WriteImage(const std::string& image)
+	{
+		std::string path = (std::filesystem::temp_directory_path() / "serial-transfer-image.bin").string();
+		std::ofstream(path, std::ios::binary) << image;
+		return path;
+	}
+
+
+	SerialTransferOptions Options(SerialTransferProtocol protocol)
+	{
+		SerialTransferOptions options;
+		options.protocol = protocol;
+		options.startTimeout = 2000ms;
+		options.blockTimeout = 200ms;
+		return options;
+	}
+
+
+	std::vector<SerialTransferProgress> progress_reports;
+
+	void RecordProgress(const SerialTransferProgress& progress)
+	{
+		progress_reports.push_back(progress);
+	}
+
+
+	TEST(SerialTransferTest, Crc16Xmodem)
+	{
+		ASSERT_EQ(0x31C3, Crc16Xmodem("123456789", 9));
+		ASSERT_EQ(0x31C3, Crc16Xmodem("56789", 5, Crc16Xmodem("1234", 4)));
+		ASSERT_EQ(0, Crc16Xmodem(nullptr, 0));
+
+		std::string image = Image(1031);
+		for (size_t len = 0; len <= image.size(); len += 17)
+		{
+			ASSERT_EQ(BitwiseCrc16(image.data(), len), Crc16Xmodem(image.data(), len)) << len;
+		}
+	}
+
+
+	TEST(SerialTransferTest, Xmodem1kFromMappedFile)
+	{
+		PtyPair pty;
+		const std::string image = Image(5000);
+		const std::string path = WriteImage(image);
+
+		XmodemReceiver receiver(pty.master, SerialTransferProtocol::Xmodem1k);
+		receiver.Start();
+
+		progress_reports.clear();
+		SerialTransfer transfer(pty.device, Options(SerialTransferProtocol::Xmodem1k));
+		transfer.Progress += RecordProgress;
+		SerialTransferResult result = transfer.SendFile(path);
+		receiver.Join();
+		std::remove(path.c_str());
+
+		ASSERT_TRUE(result.Ok()) << result.error;
+		ASSERT_TRUE(receiver.ok);
+		ASSERT_EQ(image + std::string(5 * 1024 - 5000, (char)Xmodem::SUB), receiver.data);
+
+		ASSERT_EQ(5u, progress_reports.size());
+		ASSERT_EQ(5000u, progress_reports.back().bytes);
+		ASSERT_EQ(5000u, result.progress.bytes);
+		ASSERT_EQ(0u, result.progress.retries);
+		ASSERT_GT(result.progress.Throughput(), 0.0);
+		ASSERT_DOUBLE_EQ(9600.0 / 10.0, result.progress.lineRate);
+	}
+
+
+	TEST(SerialTransferTest, ShortLastBlock)
+	{
+		PtyPair pty;
+		const std::string image = Image(1024 + 100);
+
+		XmodemReceiver receiver(pty.master, SerialTransferProtocol::Xmodem1k);
+		receiver.Start();
+
+		SerialTransfer transfer(pty.device, Options(SerialTransferProtocol::Xmodem1k));
+		SerialTransferResult result = transfer.Send(image.data(), image.size());
+		receiver.Join();
+
+		ASSERT_TRUE(result.Ok()) << result.error;
+		ASSERT_EQ(image + std::string(28, (char)Xmodem::SUB), receiver.data);
+	}
+
+
+	TEST(SerialTransferTest, YmodemCarriesNameAndSize)
+	{
+		PtyPair pty;
+		const std::string image = Image(3000);
+		const std::string path = WriteImage(image);
+
+		XmodemReceiver receiver(pty.master, SerialTransferProtocol::Ymodem);
+		receiver.Start();
+
+		SerialTransfer transfer(pty.device, Options(SerialTransferProtocol::Ymodem));
+		SerialTransferResult result = transfer.SendFile(path);
+		receiver.Join();
+		std::remove(path.c_str());
+
+		ASSERT_TRUE(result.Ok()) << result.error;
+		ASSERT_TRUE(receiver.ok);
+		ASSERT_EQ("serial-transfer-image.bin", receiver.name);
+		ASSERT_EQ(3000u, receiver.size);
+		ASSERT_EQ(image, receiver.data);
+	}
+
+
+	TEST(SerialTransferTest, RefusedAndLostBlocksAreSentAgain)
+	{
+		PtyPair pty;
+		const std::string image = Image(6 * 1024);
+
+		XmodemReceiver receiver(pty.master, SerialTransferProtocol::Xmodem1k);
+		receiver.refuse = { 2 };
+		receiver.lose = { 4 };
+		receiver.Start();
+
+		SerialTransfer transfer(pty.device, Options(SerialTransferProtocol::Xmodem1k));
+		SerialTransferResult result = transfer.Send(image.data(), image.size());
+		receiver.Join();
+
+		ASSERT_TRUE(result.Ok()) << result.error;
+		ASSERT_EQ(image, receiver.data);
+		ASSERT_EQ(2u, result.progress.retries);
+	}
+
+
+	TEST(SerialTransferTest, WindowedRecoversFromLoss)
+	{
+		PtyPair pty;
+		const std::string image = Image(40 * 1024);
+
+		XmodemReceiver receiver(pty.master, SerialTransferProtocol::Windowed);
+		receiver.lose = { 3, 40 };
+		receiver.refuse = { 17 };
+		receiver.Start();
+
+		SerialTransferOptions options = Options(SerialTransferProtocol::Windowed);
+		options.window = 4;
+		SerialTransfer transfer(pty.device, options);
+		SerialTransferResult result = transfer.Send(image.data(), image.size());
+		receiver.Join();
+
+		ASSERT_TRUE(result.Ok()) << result.error;
+		ASSERT_TRUE(receiver.ok);
+		ASSERT_EQ(image, receiver.data);
+		ASSERT_EQ(40u, result.progress.blocks);
+		ASSERT_GT(result.progress.retries, 0u);
+	}
+
+
+	TEST(SerialTransferTest, WindowedFallsBackToStopAndWait)
+	{
+		PtyPair pty;
+		const std::string image = Image(3 * 1024);
+
+		XmodemReceiver receiver(pty.master, SerialTransferProtocol::Windowed);
+		receiver.startPlain = true;
+		receiver.Start();
+
+		SerialTransfer transfer(pty.device, Options(SerialTransferProtocol::Windowed));
+		SerialTransferResult result = transfer.Send(image.data(), image.size());
+		receiver.Join();
+
+		ASSERT_TRUE(result.Ok()) << result.error;
+		ASSERT_EQ(image, receiver.data);
+	}
+
+
+	TEST(SerialTransferTest, ReceiverCancels)
+	{
+		PtyPair pty;
+		const std::string image = Image(4 * 1024);
+
+		XmodemReceiver receiver(pty.master, SerialTransferProtocol::Xmodem1k);
+		receiver.cancelAt = 2;
+		receiver.Start();
+
+		SerialTransfer transfer(pty.device, Options(SerialTransferProtocol::Xmodem1k));
+		SerialTransferResult result = transfer.Send(image.data(), image.size());
+		receiver.Join();
+
+		ASSERT_FALSE(result.Ok());
+		ASSERT_EQ("Cancelled by the receiver", result.error);
+		ASSERT_EQ(1u, result.progress.blocks);
+	}
+
+
+	TEST(SerialTransferTest, NoReceiver)
+	{
+		PtyPair pty;
+		SerialTransferOptions options = Options(SerialTransferProtocol::Xmodem1k);
+		options.startTimeout = 100ms;
+
+		SerialTransfer transfer(pty.device, options);
+		SerialTransferResult result = transfer.Send("x", 1);
+		ASSERT_FALSE(result.Ok());
+		ASSERT_EQ("Receiver did not start", result.error);
+	}
+
+
+	TEST(SerialTransferTest, MissingFileThrows)
+	{
+		PtyPair pty;
+		SerialTransfer transfer(pty.device);
+		ASSERT_ANY_THROW(transfer.SendFile("/nonexistent/firmware.bin"));
+	}
+}
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.SerialTxQueue.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	size_t TotalSize(const SerialBuffer* buffers, size_t count)
+	{
+		size_t len = 0;
+		for (size_t i = 0; i < count; i++) len += buffers[i].size;
+		return len;
+	}
+
+
+	TEST(SerialTxQueueTest, WritesInOrder)
+	{
+		std::string port;
+		SerialTxQueue queue([&](const SerialBuffer* buffers, size_t count) {
+			size_t len = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				port.append((const char*)buffers[i].data, buffers[i].size);
+				len += buffers[i].size;
+			}
+			return len;
+		});
+
+		std::vector<std::future<size_t>> done;
+		done.push_back(queue.Push("ATE0\r"));
+		done.push_back(queue.Push("ATV0\r"));
+		done.push_back(queue.Push("AT+GSN\r"));
+		done.push_back(queue.Push("ATI\r"));
+		queue.Flush();
+
+		ASSERT_EQ(5u, done[0].get());
+		ASSERT_EQ(5u, done[1].get());
+		ASSERT_EQ(7u, done[2].get());
+		ASSERT_EQ(4u, done[3].get());
+		ASSERT_EQ("ATE0\rATV0\rAT+GSN\rATI\r", port);
+	}
+
+
+	TEST(SerialTxQueueTest, CoalescesWhileBusy)
+	{
+		std::mutex gate;
+		std::unique_lock<std::mutex> held(gate);
+		SerialTxQueue queue([&](const SerialBuffer* buffers, size_t count) {
+			std::lock_guard<std::mutex> wait(gate);
+			return TotalSize(buffers, count);
+		}, 8);
+
+		//	the first write stalls in the sink, the rest pile up behind it
+		queue.Push("first");
+		std::this_thread::sleep_for(20ms);
+		for (int i = 0; i < 7; i++) queue.Push("next");
+		held.unlock();
+		queue.Flush();
+
+		ASSERT_EQ(2u, queue.Batches());
+	}
+
+
+	TEST(SerialTxQueueTest, BlocksWhenFull)
+	{
+		std::mutex gate;
+		std::unique_lock<std::mutex> held(gate);
+		SerialTxQueue queue([&](const SerialBuffer* buffers, size_t count) {
+			std::lock_guard<std::mutex> wait(gate);
+			return TotalSize(buffers, count);
+		}, 2);
+
+		queue.Push("a");
+		queue.Push("b");
+		auto blocked = std::async(std::launch::async, [&] { return queue.Push("c").get(); });
+		ASSERT_EQ(std::future_status::timeout, blocked.wait_for(50ms));
+
+		held.unlock();
+		ASSERT_EQ(1u, blocked.get());
+	}
+
+
+	TEST(SerialTxQueueTest, ShortWriteCompletesInOrder)
+	{
+		std::mutex gate;
+		std::unique_lock<std::mutex> held(gate);
+		SerialTxQueue queue([&](const SerialBuffer* buffers, size_t count) {
+			std::lock_guard<std::mutex> wait(gate);
+			size_t len = TotalSize(buffers, count);
+			return (len > 3) ? len - 3 : 0;
+		});
+
+		auto first = queue.Push("x");
+		std::this_thread::sleep_for(20ms);
+		auto second = queue.Push("abcd");
+		auto third = queue.Push("ef");
+		held.unlock();
+
+		ASSERT_EQ(0u, first.get());
+		ASSERT_EQ(3u, second.get());
+		ASSERT_EQ(0u, third.get());
+	}
+
+
+	TEST(SerialTxQueueTest, HighPriorityGoesFirst)
+	{
+		std::mutex gate;
+		std::unique_lock<std::mutex> held(gate);
+		std::string port;
+		SerialTxQueue queue([&](const SerialBuffer* buffers, size_t count) {
+			std::lock_guard<std::mutex> wait(gate);
+			for (size_t i = 0; i < count; i++) port.append((const char*)buffers[i].data, buffers[i].size);
+			return TotalSize(buffers, count);
+		});
+
+		//	bulk piles up behind the stalled first write, control overtakes it
+		queue.Push("[bulk0]");
+		std::this_thread::sleep_for(20ms);
+		queue.Push("[bulk1]");
+		queue.Push("[bulk2]");
+		queue.Push("[ping]", SerialTxPriority::High);
+		queue.Push("[bulk3]");
+		queue.Push("[pong]", SerialTxPriority::High);
+		held.unlock();
+		queue.Flush();
+
+		ASSERT_EQ("[bulk0][ping][pong][bulk1][bulk2][bulk3]", port);
+	}
+
+
+	TEST(SerialTxQueueTest, ManyProducersKeepFramesWhole)
+	{
+		constexpr int Producers = 8;
+		constexpr int Frames = 500;
+
+		std::string port;
+		SerialTxQueue queue([&](const SerialBuffer* buffers, size_t count) {
+			for (size_t i = 0; i < count; i++) port.append((const char*)buffers[i].data, buffers[i].size);
+			return TotalSize(buffers, count);
+		}, 4);
+
+		std::vector<std::thread> producers;
+		for (int p = 0; p < Producers; p++)
+		{
+			producers.emplace_back([&queue, p] {
+				for (int f = 0; f < Frames; f++)
+				{
+					//	frames of a producer are all of its letter, and numbered
+					std::string frame = "<" + std::string(8 + f % 24, (char)('a' + p)) + std::to_string(f) + ">";
+					queue.Push(std::move(frame), (f % 7) ? SerialTxPriority::Normal : SerialTxPriority::High);
+				}
+			});
+		}
+		for (std::thread& producer : producers) producer.join();
+		queue.Flush();
+		ASSERT_EQ(0u, queue.Pending());
+
+		int next[Producers] = { 0 };
+		int high[Producers] = { 0 };
+		size_t at = 0, frames = 0;
+		while (at < port.size())
+		{
+			size_t end = port.find('>', at);
+			ASSERT_NE(std::string::npos, end);
+			std::string frame = port.substr(at + 1, end - at - 1);
+			at = end + 1;
+			frames++;
+
+			int p = frame[0] - 'a';
+			ASSERT_GE(p, 0);
+			ASSERT_LT(p, Producers);
+			size_t digits = frame.find_first_of("0123456789");
+			ASSERT_EQ(std::string(digits, frame[0]), frame.substr(0, digits));
+			int f = std::stoi(frame.substr(digits));
+
+			//	each priority of a producer keeps its order
+			int& expected = (f % 7) ? next[p] : high[p];
+			ASSERT_GE(f, expected);
+			expected = f + 1;
+		}
+		ASSERT_EQ((size_t)(Producers * Frames), frames);
+	}
+
+
+	TEST(SerialTxQueueTest, StopReleasesBlockedProducers)
+	{
+		std::mutex gate;
+		std::unique_lock<std::mutex> held(gate);
+		SerialTxQueue queue([&](const SerialBuffer* buffers, size_t count) {
+			std::lock_guard<std::mutex> wait(gate);
+			return TotalSize(buffers, count);
+		}, 1);
+
+		auto written = queue.Push("a");
+		auto blocked = std::async(std::launch::async, [&] { return queue.Push("b").get(); });
+		ASSERT_EQ(std::future_status::timeout, blocked.wait_for(50ms));
+
+		auto stopped = std::async(std::launch::async, [&] { queue.Stop(); });
+		ASSERT_EQ(0u, blocked.get());
+		held.unlock();
+		stopped.get();
+		ASSERT_EQ(1u, written.get());
+		ASSERT_EQ(0u, queue.Push("c").get());
+	}
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <Win32.Devices.StaticSerialDevice.hpp>
+#include <Win32.Devices.ModbusMaster.hpp>
+
+#include "PtyPair.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace Win32::Devices;
+using namespace std::chrono_literals;
+
+namespace tests
+{
+	using Line9600 = SerialLine8N1<9600>;
+	using Line8E1 = SerialLine<19200, SerialByteSize::Byte_Size8b, SerialParity::Even>;
+	using LineDevice = StaticSerialDevice<SerialLine8N1<115200>, StaticDelimiterFraming<'\r', '\n'>, 256>;
+
+	static_assert(Line9600::CharacterBits == 10, "8N1 is 10 bits a character");
+	static_assert(Line8E1::CharacterBits == 11, "8E1 is 11 bits a character");
+	static_assert(Line9600::Settings().baudRate == 9600, "settings are constant");
+	static_assert(LineDevice::TransmitTime(10) == LineDevice::CharacterTime * 10, "transmit time is constant");
+
+
+	std::vector<std::string> PollFrames(LineDevice& device, size_t frames)
+	{
+		std::vector<std::string> got;
+		auto deadline = std::chrono::steady_clock::now() + 2000ms;
+		while (got.size() < frames && std::chrono::steady_clock::now() < deadline)
+		{
+			device.Poll(10ms, [&](std::string_view frame) { got.emplace_back(frame); });
+		}
+		return got;
+	}
+
+
+	TEST(StaticSerialDeviceTest, TimingIsFixedByTheLine)
+	{
+		ASSERT_EQ(std::chrono::nanoseconds(1041666), Line9600::CharacterTime);
+		ASSERT_EQ(Line9600::CharacterTime * 7 / 2, Line9600::InterFrameGap);
+		ASSERT_EQ(ModbusRtuTiming(19200, 11).character, Line8E1::CharacterTime);
+		ASSERT_EQ(Line8E1::CharacterBits, Line8E1::Settings().CharacterBits());
+	}
+
+
+	TEST(StaticSerialDeviceTest, FramingSplitsAtCompileTimeDelimiters)
+	{
+		StaticDelimiterFraming<'\r', '\n'> lines;
+		std::string_view frame;
+		ASSERT_EQ(0u, lines.Extract("no end\r", frame));
+		ASSERT_EQ(7u, lines.Extract("a\rb\nc\r\nd\r\n", frame));
+		ASSERT_EQ("a\rb\nc", frame);
+
+		StaticFixedLengthFraming<4> fixed;
+		ASSERT_EQ(0u, fixed.Extract("abc", frame));
+		ASSERT_EQ(4u, fixed.Extract("abcdef", frame));
+		ASSERT_EQ("abcd", frame);
+	}
+
+
+	TEST(StaticSerialDeviceTest, PollEmitsFramesAcrossReads)
+	{
+		PtyPair pty;
+		LineDevice device(std::move(pty.device));
+		ASSERT_EQ(LineDevice::Settings(), device.Device().Settings());
+
+		pty.WriteMaster("first\r\nsec");
+		ASSERT_EQ(std::vector<std::string>({ "first" }), PollFrames(device, 1));
+		ASSERT_EQ(3u, device.Buffered());
+
+		pty.WriteMaster("ond\r\nthird\r\n");
+		ASSERT_EQ(std::vector<std::string>({ "second", "third" }), PollFrames(device, 2));
+		ASSERT_EQ(0u, device.Buffered());
+
+		ASSERT_EQ(0u, device.Poll(10ms, [](std::string_view) {}));
+	}
+
+
+	TEST(StaticSerialDeviceTest, FramesKeepFlowingPastTheBufferSize)
+	{
+		PtyPair pty;
+		LineDevice device(std::move(pty.device));
+
+		const std::string line(50, 'x');
+		std::string stream;
+		for (int i = 0; i < 40; i++) stream += line + "\r\n";
+		pty.WriteMaster(stream);
+
+		std::vector<std::string> frames = PollFrames(device, 40);
+		ASSERT_EQ(40u, frames.size());
+		for (const std::string& frame : frames) ASSERT_EQ(line, frame);
+		ASSERT_EQ(0u, device.Dropped());
+	}
+
+
+	TEST(StaticSerialDeviceTest, FrameOutgrowingTheBufferIsDropped)
+	{
+		PtyPair pty;
+		LineDevice device(std::move(pty.device));
+
+		pty.WriteMaster(std::string(LineDevice::Capacity, 'x'));
+		auto deadline = std::chrono::steady_clock::now() + 2000ms;
+		while (device.Buffered() < LineDevice::Capacity && std::chrono::steady_clock::now() < deadline)
+		{
+			device.Poll(10ms, [](std::string_view) {});
+		}
+		pty.WriteMaster("tail\r\nnext\r\n");
+
+		ASSERT_EQ(std::vector<std::string>({ "tail", "next" }), PollFrames(device, 2));
+		ASSERT_EQ(LineDevice::Capacity, device.Dropped());
+	}
+
+
+	TEST(StaticSerialDeviceTest, WritesAndRawReadsReachThePort)
+	{
+		PtyPair pty;
+		LineDevice device(std::move(pty.device));
+
+		ASSERT_EQ(5u, device.Write("hello"));
+		ASSERT_EQ(7u, device.Write({ SerialBuffer("AT", 2), SerialBuffer("+OK\r\n", 5) }));
+		ASSERT_EQ("helloAT+OK\r\n", pty.ReadMaster(12));
+
+		//	buffered bytes are read before the port
+		pty.WriteMaster("line\r\nrest");
+		PollFrames(device, 1);
+		char raw[16];
+		ASSERT_EQ(4u, device.ReadSome(raw, sizeof(raw), 100ms));
+		ASSERT_EQ("rest", std::string(raw, 4));
+		ASSERT_EQ(0u, device.ReadSome(raw, sizeof(raw), 10ms));
+	}
+}
@@ -0,0 +1,266 @@
+//	Copyright (c) 2019 LooUQ Incorporated.
+
+//	Licensed under the GNU GPLv3. See LICENSE file in the project root for full license information.
+#ifndef TESTS_XMODEMRECEIVER_H_
+#define TESTS_XMODEMRECEIVER_H_
+
+#include "PtyPair.hpp"
+
+#include <Win32.Devices.SerialTransfer.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace tests
+{
+	///	CRC-16/XMODEM a bit at a time, to check the tables against.
+	inline uint16_t BitwiseCrc16(const void* data, size_t len, uint16_t crc = 0)
+	{
+		const uint8_t* at = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < len; i++)
+		{
+			crc ^= (uint16_t)(at[i] << 8);
+			for (int bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+		return crc;
+	}
+
+
+	///	An XMODEM-1K, YMODEM or windowed receiver on the master side of a
+	///		pty, run on a thread of its own. Blocks can be refused or lost
+	///		on first arrival, as on a noisy line.
+	struct XmodemReceiver
+	{
+		XmodemReceiver(int fd, Win32::Devices::SerialTransferProtocol protocol)
+			: m_fd(fd), m_protocol(protocol)
+		{
+		}
+
+		~XmodemReceiver()
+		{
+			Join();
+		}
+
+		void Start()
+		{
+			m_thread = std::thread([this] { ok = receive(); });
+			if (latency.count()) m_replier = std::thread([this] { send_replies(); });
+		}
+
+		void Join()
+		{
+			if (m_thread.joinable()) m_thread.join();
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_done = true;
+			}
+			m_replied.notify_all();
+			if (m_replier.joinable()) m_replier.join();
+		}
+
+		///	Delay of every reply on its way back, as over a USB adapter
+		///		or a radio link.
+		std::chrono::microseconds latency = std::chrono::microseconds(0);
+
+		///	Block indexes, from 1, refused with NAK on first arrival.
+		std::set<size_t> refuse;
+
+		///	Block indexes, from 1, ignored on first arrival.
+		std::set<size_t> lose;
+
+		///	Cancel on the arrival of this block index; 0 for never.
+		size_t cancelAt = 0;
+
+		///	Start with 'C' even when the protocol is Windowed.
+		bool startPlain = false;
+
+		bool ok = false;
+		std::string data;
+		std::string name;
+		size_t size = 0;
+		size_t blocks = 0;
+
+	private:
+		bool windowed() const
+		{
+			return m_protocol == Win32::Devices::SerialTransferProtocol::Windowed && !startPlain;
+		}
+
+		bool read_exact(uint8_t* dest, size_t len, int timeoutMs = 2000)
+		{
+			size_t got = 0;
+			while (got < len)
+			{
+				pollfd pfd = { m_fd, POLLIN, 0 };
+				if (poll(&pfd, 1, timeoutMs) <= 0) return false;
+
+				ssize_t res = read(m_fd, dest + got, len - got);
+				if (res > 0) got += (size_t)res;
+			}
+			return true;
+		}
+
+		void reply(uint8_t response, size_t index)
+		{
+			std::string out = { (char)response, (char)index };
+			if (!windowed()) out.resize(1);
+			send(out);
+		}
+
+		void send(const std::string& out)
+		{
+			if (!latency.count())
+			{
+				ssize_t sent = write(m_fd, out.data(), out.size());
+				(void)sent;
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_replies.push_back({ std::chrono::steady_clock::now() + latency, out });
+			m_replied.notify_all();
+		}
+
+		void send_replies()
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			while (!m_done || !m_replies.empty())
+			{
+				if (m_replies.empty())
+				{
+					m_replied.wait(lock);
+					continue;
+				}
+
+				auto due = m_replies.front().first;
+				if (std::chrono::steady_clock::now() < due)
+				{
+					m_replied.wait_until(lock, due);
+					continue;
+				}
+				std::string out = m_replies.front().second;
+				m_replies.pop_front();
+				ssize_t sent = write(m_fd, out.data(), out.size());
+				(void)sent;
+			}
+		}
+
+		///	Reads a block after its first byte; returns its number, or -1
+		///		if damaged.
+		int read_block(uint8_t first, std::string& payload)
+		{
+			size_t len = (first == Win32::Devices::Xmodem::SOH) ? 128 : 1024;
+			uint8_t block[2 + 1024 + 2];
+			if (!read_exact(block, 2 + len + 2)) return -1;
+			if ((uint8_t)~block[0] != block[1]) return -1;
+
+			uint16_t crc = (uint16_t)((block[2 + len] << 8) | block[3 + len]);
+			if (BitwiseCrc16(block + 2, len) != crc) return -1;
+
+			payload.assign((const char*)block + 2, len);
+			return block[0];
+		}
+
+		bool receive()
+		{
+			using namespace Win32::Devices;
+			const bool ymodem = m_protocol == SerialTransferProtocol::Ymodem;
+			const uint8_t start = windowed() ? Xmodem::WINDOW : Xmodem::CRC;
+
+			//	ask until the first block arrives
+			uint8_t first = 0;
+			for (int attempt = 0; attempt < 50 && !first; attempt++)
+			{
+				send(std::string(1, (char)start));
+				if (!read_exact(&first, 1, 100)) first = 0;
+			}
+			if (!first) return false;
+
+			std::string payload;
+			if (ymodem)
+			{
+				if (read_block(first, payload) != 0) return false;
+				name = payload.c_str();
+				size = std::stoul(payload.substr(name.size() + 1));
+				reply(Xmodem::ACK, 0);
+				send(std::string(1, (char)start));
+				if (!read_exact(&first, 1)) return false;
+			}
+
+			size_t expected = 1;
+			bool refused = false;
+			int eots = 0;
+			while (true)
+			{
+				if (first == Xmodem::EOT)
+				{
+					//	YMODEM refuses the first EOT to be sure of it
+					if (ymodem && eots++ == 0) reply(Xmodem::NAK, expected);
+					else break;
+				}
+				else if (first == Xmodem::SOH || first == Xmodem::STX)
+				{
+					int number = read_block(first, payload);
+					if (cancelAt && number == (int)(cancelAt & 0xFF))
+					{
+						send(std::string(2, (char)Xmodem::CAN));
+						return false;
+					}
+
+					if (number == (int)(expected & 0xFF) && lose.erase(expected))
+					{
+						//	lost on the line
+					}
+					else if (number == (int)(expected & 0xFF) && !refuse.erase(expected))
+					{
+						data += payload;
+						blocks++;
+						refused = false;
+						reply(Xmodem::ACK, expected++);
+					}
+					else if (number == (int)((expected - 1) & 0xFF))
+					{
+						reply(Xmodem::ACK, expected - 1);
+					}
+					else if (!refused)
+					{
+						//	damaged, refused, or past a gap
+						refused = windowed();
+						reply(Xmodem::NAK, expected);
+					}
+				}
+				if (!read_exact(&first, 1)) return false;
+			}
+			reply(Xmodem::ACK, expected);
+
+			if (ymodem)
+			{
+				send(std::string(1, (char)start));
+				if (!read_exact(&first, 1)) return false;
+				if (read_block(first, payload) != 0 || payload[0] != '\0') return false;
+				reply(Xmodem::ACK, 0);
+				data.resize(size);
+			}
+			return true;
+		}
+
+	private:
+		int m_fd;
+		Win32::Devices::SerialTransferProtocol m_protocol;
+		std::thread m_thread;
+
+		///	Replies on their way back, while simulating latency.
+		std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> m_replies;
+		std::mutex m_lock;
+		std::condition_variable m_replied;
+		bool m_done = false;
+		std::thread m_replier;
+	};
+}
+
+#endif	// !TESTS_XMODEMRECEIVER_H_